@@ -0,0 +1,140 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOArena
+ *
+ *  Preallocated, aligned memory for the render path.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOArena.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+struct audio_arena
+{
+    char           *data;
+    size_t          size;
+    int             locked;
+
+    /*------------------------------------------------------------------------*
+     * Offsets of the end of the persistent region and the top of the
+     * scratch stack. The stack always sits above the persistent region.
+     *-----------------------------------------------------------------------*/
+    size_t          persistent_top;
+    size_t          scratch_top;
+
+    atomic_size_t   high_water_mark;
+};
+
+static size_t audio_arena_align(size_t size)
+{
+    return (size + AUDIO_ARENA_ALIGNMENT - 1) & ~((size_t) AUDIO_ARENA_ALIGNMENT - 1);
+}
+
+audio_arena_t *audio_arena_create(size_t size, int lock)
+{
+    audio_arena_t *arena = calloc(1, sizeof(audio_arena_t));
+    if (!arena) return NULL;
+
+    /*------------------------------------------------------------------------*
+     * Page alignment satisfies AUDIO_ARENA_ALIGNMENT and allows locking
+     * without dragging in neighbouring allocations.
+     *-----------------------------------------------------------------------*/
+    size = audio_arena_align(size);
+    void *data = NULL;
+    if (posix_memalign(&data, (size_t) getpagesize(), size ? size : AUDIO_ARENA_ALIGNMENT))
+    {
+        free(arena);
+        return NULL;
+    }
+
+    memset(data, 0, size);
+    arena->data = data;
+    arena->size = size;
+    arena->locked = lock && size && (mlock(data, size) == 0);
+    atomic_init(&arena->high_water_mark, 0);
+
+    return arena;
+}
+
+void audio_arena_destroy(audio_arena_t *arena)
+{
+    if (!arena) return;
+
+    if (arena->locked)
+        munlock(arena->data, arena->size);
+    free(arena->data);
+    free(arena);
+}
+
+static void audio_arena_update_high_water_mark(audio_arena_t *arena, size_t used)
+{
+    /*------------------------------------------------------------------------*
+     * Only one thread allocates at a time, so no compare-and-swap needed.
+     *-----------------------------------------------------------------------*/
+    if (used > atomic_load_explicit(&arena->high_water_mark, memory_order_relaxed))
+        atomic_store_explicit(&arena->high_water_mark, used, memory_order_relaxed);
+}
+
+void *audio_arena_alloc(audio_arena_t *arena, size_t size)
+{
+    if (arena->scratch_top != arena->persistent_top)
+        return NULL;
+
+    size = audio_arena_align(size);
+    if (size > arena->size - arena->persistent_top)
+        return NULL;
+
+    char *allocation = arena->data + arena->persistent_top;
+    memset(allocation, 0, size);
+    arena->persistent_top += size;
+    arena->scratch_top = arena->persistent_top;
+    audio_arena_update_high_water_mark(arena, arena->persistent_top);
+
+    return allocation;
+}
+
+size_t audio_arena_scratch_mark(audio_arena_t *arena)
+{
+    return arena->scratch_top;
+}
+
+void *audio_arena_scratch_alloc(audio_arena_t *arena, size_t size)
+{
+    size = audio_arena_align(size);
+    if (size > arena->size - arena->scratch_top)
+        return NULL;
+
+    char *allocation = arena->data + arena->scratch_top;
+    arena->scratch_top += size;
+    audio_arena_update_high_water_mark(arena, arena->scratch_top);
+
+    return allocation;
+}
+
+void audio_arena_scratch_release(audio_arena_t *arena, size_t mark)
+{
+    if (mark < arena->persistent_top || mark > arena->scratch_top)
+        return;
+
+    arena->scratch_top = mark;
+}
+
+size_t audio_arena_size(audio_arena_t *arena)
+{
+    return arena->size;
+}
+
+size_t audio_arena_high_water_mark(audio_arena_t *arena)
+{
+    return atomic_load_explicit(&arena->high_water_mark, memory_order_relaxed);
+}
+
+int audio_arena_is_locked(audio_arena_t *arena)
+{
+    return arena->locked;
+}
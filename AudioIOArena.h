@@ -0,0 +1,108 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOArena
+ *
+ *  Preallocated block of memory from which the render path takes all of
+ *  its working buffers, so that nothing is allocated while audio runs.
+ *
+ *  The arena holds two regions. Persistent allocations, made at setup
+ *  time, are carved from the bottom and live as long as the arena. Above
+ *  them is a scratch stack for temporary buffers: take a mark, allocate,
+ *  and release back to the mark when done. All allocations are aligned
+ *  to AUDIO_ARENA_ALIGNMENT bytes, suitable for vDSP.
+ *
+ *  The arena is not thread-safe: persistent allocations must be made
+ *  before audio starts, and the scratch stack used only from the audio
+ *  thread. audio_arena_high_water_mark() may be read from any thread.
+ *
+ *  Example usage:
+ *
+ *  size_t mark = audio_arena_scratch_mark(arena);
+ *  float *temp = audio_arena_scratch_alloc(arena, num_frames * sizeof(float));
+ *  ...
+ *  audio_arena_scratch_release(arena, mark);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_ARENA_H
+#define AUDIO_IO_ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Alignment of every allocation, in bytes (one cache line).
+ *----------------------------------------------------------------------------*/
+#define AUDIO_ARENA_ALIGNMENT 64
+
+typedef struct audio_arena audio_arena_t;
+
+/**-----------------------------------------------------------------------------
+ * Create a new arena. Every page is written to on creation so that no page
+ * faults occur on first use.
+ *
+ * @param size  Capacity in bytes. Rounded up to AUDIO_ARENA_ALIGNMENT.
+ * @param lock  Nonzero to lock the arena into memory with mlock. Failure
+ *              to lock is not fatal; see audio_arena_is_locked().
+ * @return A new arena, or NULL if memory could not be allocated.
+ *----------------------------------------------------------------------------*/
+audio_arena_t *audio_arena_create(size_t size, int lock);
+
+/**-----------------------------------------------------------------------------
+ * Unlock and free an arena, and everything allocated from it.
+ *----------------------------------------------------------------------------*/
+void audio_arena_destroy(audio_arena_t *arena);
+
+/**-----------------------------------------------------------------------------
+ * Make a persistent allocation, zero-filled. Not realtime-safe in spirit:
+ * call at setup time, while the scratch stack is empty.
+ *
+ * @return The allocation, or NULL if the arena is exhausted or scratch
+ *         buffers are outstanding.
+ *----------------------------------------------------------------------------*/
+void *audio_arena_alloc(audio_arena_t *arena, size_t size);
+
+/**-----------------------------------------------------------------------------
+ * Returns the current top of the scratch stack, to pass to
+ * audio_arena_scratch_release(). Realtime-safe.
+ *----------------------------------------------------------------------------*/
+size_t audio_arena_scratch_mark(audio_arena_t *arena);
+
+/**-----------------------------------------------------------------------------
+ * Push a scratch buffer onto the stack. The contents are undefined.
+ * Realtime-safe.
+ *
+ * @return The buffer, or NULL if the arena is exhausted.
+ *----------------------------------------------------------------------------*/
+void *audio_arena_scratch_alloc(audio_arena_t *arena, size_t size);
+
+/**-----------------------------------------------------------------------------
+ * Release all scratch buffers allocated since `mark` was taken.
+ * Realtime-safe.
+ *----------------------------------------------------------------------------*/
+void audio_arena_scratch_release(audio_arena_t *arena, size_t mark);
+
+/**-----------------------------------------------------------------------------
+ * Returns the arena's capacity, in bytes.
+ *----------------------------------------------------------------------------*/
+size_t audio_arena_size(audio_arena_t *arena);
+
+/**-----------------------------------------------------------------------------
+ * Returns the greatest number of bytes ever in use at once, persistent and
+ * scratch combined. May be called from any thread.
+ *----------------------------------------------------------------------------*/
+size_t audio_arena_high_water_mark(audio_arena_t *arena);
+
+/**-----------------------------------------------------------------------------
+ * Returns nonzero if the arena was successfully locked into memory.
+ *----------------------------------------------------------------------------*/
+int audio_arena_is_locked(audio_arena_t *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
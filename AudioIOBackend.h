@@ -0,0 +1,90 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOBackend
+ *
+ *  Interface between AudioIOManager and the system audio services: the
+ *  audio session, the I/O unit, and the notifications they post.
+ *
+ *  The default backend, AudioIORemoteIOBackend, wraps AVAudioSession and
+ *  AURemoteIO. Substituting another backend (for example AudioIOMockBackend)
+ *  allows the manager's lifecycle to be driven without audio hardware.
+ *
+ *  Session methods mirror their AVAudioSession equivalents; unit methods
+ *  mirror the AudioUnit C API, operating on the backend's single unit.
+ *
+ *----------------------------------------------------------------------------*/
+
+#import <AudioToolbox/AudioToolbox.h>
+#import <AVFoundation/AVFoundation.h>
+
+@protocol AudioIOBackend <NSObject>
+
+/**-----------------------------------------------------------------------------
+ * The object which posts session notifications (interruptions, route
+ * changes and media services resets) and is KVO-compliant for
+ * `outputVolume`.
+ *----------------------------------------------------------------------------*/
+@property (readonly) id notificationSource;
+
+/**-----------------------------------------------------------------------------
+ * Session configuration. See AVAudioSession.
+ *----------------------------------------------------------------------------*/
+- (BOOL) setPreferredSampleRate:(double)sampleRate error:(NSError **)error;
+- (BOOL) setCategory:(NSString *)category withOptions:(AVAudioSessionCategoryOptions)options error:(NSError **)error;
+- (BOOL) setMode:(NSString *)mode error:(NSError **)error;
+- (BOOL) setPreferredIOBufferDuration:(NSTimeInterval)duration error:(NSError **)error;
+- (BOOL) setActive:(BOOL)active error:(NSError **)error;
+
+@property (readonly) NSArray<NSString *> *availableModes;
+@property (readonly) double sampleRate;
+@property (readonly) float outputVolume;
+@property (readonly) NSTimeInterval inputLatency;
+@property (readonly) NSTimeInterval outputLatency;
+@property (readonly) NSTimeInterval IOBufferDuration;
+
+/**-----------------------------------------------------------------------------
+ * I/O unit lifecycle. See AudioComponentInstanceNew, AudioUnitInitialize,
+ * AudioOutputUnitStart and friends.
+ *
+ * stopUnit must not return until any render callback in progress has
+ * completed.
+ *----------------------------------------------------------------------------*/
+- (OSStatus) createUnit;
+- (OSStatus) initializeUnit;
+- (OSStatus) startUnit;
+- (OSStatus) stopUnit;
+- (OSStatus) uninitializeUnit;
+- (OSStatus) disposeUnit;
+
+- (OSStatus) setUnitProperty:(AudioUnitPropertyID)property
+                       scope:(AudioUnitScope)scope
+                     element:(AudioUnitElement)element
+                        data:(const void *)data
+                        size:(UInt32)size;
+
+- (OSStatus) getUnitProperty:(AudioUnitPropertyID)property
+                       scope:(AudioUnitScope)scope
+                     element:(AudioUnitElement)element
+                        data:(void *)data
+                        size:(UInt32 *)size;
+
+/**-----------------------------------------------------------------------------
+ * YES between createUnit and disposeUnit.
+ *----------------------------------------------------------------------------*/
+@property (readonly) BOOL hasUnit;
+
+/**-----------------------------------------------------------------------------
+ * The underlying AudioUnit, which the render callback pulls input from.
+ * May be NULL for backends that supply input directly to the render
+ * callback's buffers.
+ *----------------------------------------------------------------------------*/
+@property (readonly) AudioUnit unit;
+
+@end
+
+
+/**-----------------------------------------------------------------------------
+ * The default backend, using AVAudioSession and AURemoteIO.
+ *----------------------------------------------------------------------------*/
+@interface AudioIORemoteIOBackend : NSObject <AudioIOBackend>
+@end
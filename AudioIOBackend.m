@@ -0,0 +1,152 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOBackend
+ *
+ *  Default backend, forwarding to AVAudioSession and AURemoteIO.
+ *
+ *----------------------------------------------------------------------------*/
+
+#import "AudioIOBackend.h"
+
+@implementation AudioIORemoteIOBackend
+{
+    AudioUnit _unit;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Session
+////////////////////////////////////////////////////////////////////////////////
+
+- (id)notificationSource
+{
+    return [AVAudioSession sharedInstance];
+}
+
+- (BOOL)setPreferredSampleRate:(double)sampleRate error:(NSError **)error
+{
+    return [[AVAudioSession sharedInstance] setPreferredSampleRate:sampleRate error:error];
+}
+
+- (BOOL)setCategory:(NSString *)category withOptions:(AVAudioSessionCategoryOptions)options error:(NSError **)error
+{
+    return [[AVAudioSession sharedInstance] setCategory:category withOptions:options error:error];
+}
+
+- (BOOL)setMode:(NSString *)mode error:(NSError **)error
+{
+    return [[AVAudioSession sharedInstance] setMode:mode error:error];
+}
+
+- (BOOL)setPreferredIOBufferDuration:(NSTimeInterval)duration error:(NSError **)error
+{
+    return [[AVAudioSession sharedInstance] setPreferredIOBufferDuration:duration error:error];
+}
+
+- (BOOL)setActive:(BOOL)active error:(NSError **)error
+{
+    return [[AVAudioSession sharedInstance] setActive:active error:error];
+}
+
+- (NSArray<NSString *> *)availableModes
+{
+    return [AVAudioSession sharedInstance].availableModes;
+}
+
+- (double)sampleRate
+{
+    return [AVAudioSession sharedInstance].sampleRate;
+}
+
+- (float)outputVolume
+{
+    return [AVAudioSession sharedInstance].outputVolume;
+}
+
+- (NSTimeInterval)inputLatency
+{
+    return [AVAudioSession sharedInstance].inputLatency;
+}
+
+- (NSTimeInterval)outputLatency
+{
+    return [AVAudioSession sharedInstance].outputLatency;
+}
+
+- (NSTimeInterval)IOBufferDuration
+{
+    return [AVAudioSession sharedInstance].IOBufferDuration;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Unit
+////////////////////////////////////////////////////////////////////////////////
+
+- (OSStatus)createUnit
+{
+    AudioComponentDescription desc;
+    desc.componentType = kAudioUnitType_Output;
+    desc.componentSubType = kAudioUnitSubType_RemoteIO;
+    desc.componentManufacturer = kAudioUnitManufacturer_Apple;
+    desc.componentFlags = 0;
+    desc.componentFlagsMask = 0;
+
+    AudioComponent comp = AudioComponentFindNext(NULL, &desc);
+    return AudioComponentInstanceNew(comp, &_unit);
+}
+
+- (OSStatus)initializeUnit
+{
+    return AudioUnitInitialize(_unit);
+}
+
+- (OSStatus)startUnit
+{
+    return AudioOutputUnitStart(_unit);
+}
+
+- (OSStatus)stopUnit
+{
+    return AudioOutputUnitStop(_unit);
+}
+
+- (OSStatus)uninitializeUnit
+{
+    return AudioUnitUninitialize(_unit);
+}
+
+- (OSStatus)disposeUnit
+{
+    OSStatus err = AudioComponentInstanceDispose(_unit);
+    _unit = NULL;
+    return err;
+}
+
+- (OSStatus)setUnitProperty:(AudioUnitPropertyID)property
+                      scope:(AudioUnitScope)scope
+                    element:(AudioUnitElement)element
+                       data:(const void *)data
+                       size:(UInt32)size
+{
+    return AudioUnitSetProperty(_unit, property, scope, element, data, size);
+}
+
+- (OSStatus)getUnitProperty:(AudioUnitPropertyID)property
+                      scope:(AudioUnitScope)scope
+                    element:(AudioUnitElement)element
+                       data:(void *)data
+                       size:(UInt32 *)size
+{
+    return AudioUnitGetProperty(_unit, property, scope, element, data, size);
+}
+
+- (BOOL)hasUnit
+{
+    return _unit != NULL;
+}
+
+- (AudioUnit)unit
+{
+    return _unit;
+}
+
+@end
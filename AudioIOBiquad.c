@@ -0,0 +1,486 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOBiquad
+ *
+ *  Structure-of-arrays biquad filter bank.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOBiquad.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*----------------------------------------------------------------------------*
+ * Number of coefficients per section.
+ *----------------------------------------------------------------------------*/
+#define BIQUAD_COEFFICIENTS 5
+
+/*----------------------------------------------------------------------------*
+ * Coefficient arrays, each num_stages x num_padded, indexed by
+ * stage * num_padded + filter.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    float  *b0;
+    float  *b1;
+    float  *b2;
+    float  *a1;
+    float  *a2;
+} biquad_coefficient_arrays_t;
+
+struct audio_biquad_bank
+{
+    int                         num_filters;
+    int                         num_stages;
+    int                         num_padded;
+
+    /*------------------------------------------------------------------------*
+     * Requested coefficients, written under a sequence lock: `version` is
+     * odd while a write is in progress, and the audio thread need only
+     * scan for changes when it moves. Writers take `writer_lock` first, as
+     * the sequence lock allows only one at a time.
+     *-----------------------------------------------------------------------*/
+    pthread_mutex_t             writer_lock;
+    _Atomic float              *requested;
+    atomic_uint                 version;
+    atomic_int                  reset_requested;
+
+    /*------------------------------------------------------------------------*
+     * Audio thread state: the coefficients in use, their per-sample ramp
+     * steps while interpolating, and the filter state.
+     *-----------------------------------------------------------------------*/
+    unsigned int                applied_version;
+    biquad_coefficient_arrays_t current;
+    biquad_coefficient_arrays_t target;
+    biquad_coefficient_arrays_t step;
+    float                      *s1;
+    float                      *s2;
+};
+
+audio_biquad_coefficients_t audio_biquad_bypass(void)
+{
+    audio_biquad_coefficients_t c = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    return c;
+}
+
+audio_biquad_coefficients_t audio_biquad_design(audio_biquad_type_t type,
+                                                float frequency,
+                                                float q,
+                                                float gain_db,
+                                                int samplerate)
+{
+    double nyquist = 0.5 * samplerate;
+    double f = fmin(fmax(frequency, 1.0), 0.999 * nyquist);
+    double w0 = 2.0 * M_PI * f / samplerate;
+    double cos_w0 = cos(w0);
+    double alpha = sin(w0) / (2.0 * (q > 0.0f ? q : 0.707));
+    double A = pow(10.0, gain_db / 40.0);
+    double sqrt_A = sqrt(A);
+
+    double b0 = 1, b1 = 0, b2 = 0, a0 = 1, a1 = 0, a2 = 0;
+
+    switch (type)
+    {
+        case AUDIO_BIQUAD_LOWPASS:
+            b0 = (1 - cos_w0) / 2; b1 = 1 - cos_w0; b2 = (1 - cos_w0) / 2;
+            a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+            break;
+
+        case AUDIO_BIQUAD_HIGHPASS:
+            b0 = (1 + cos_w0) / 2; b1 = -(1 + cos_w0); b2 = (1 + cos_w0) / 2;
+            a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+            break;
+
+        case AUDIO_BIQUAD_BANDPASS:
+            b0 = alpha; b1 = 0; b2 = -alpha;
+            a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+            break;
+
+        case AUDIO_BIQUAD_NOTCH:
+            b0 = 1; b1 = -2 * cos_w0; b2 = 1;
+            a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+            break;
+
+        case AUDIO_BIQUAD_PEAK:
+            b0 = 1 + alpha * A; b1 = -2 * cos_w0; b2 = 1 - alpha * A;
+            a0 = 1 + alpha / A; a1 = -2 * cos_w0; a2 = 1 - alpha / A;
+            break;
+
+        case AUDIO_BIQUAD_LOW_SHELF:
+            b0 = A * ((A + 1) - (A - 1) * cos_w0 + 2 * sqrt_A * alpha);
+            b1 = 2 * A * ((A - 1) - (A + 1) * cos_w0);
+            b2 = A * ((A + 1) - (A - 1) * cos_w0 - 2 * sqrt_A * alpha);
+            a0 = (A + 1) + (A - 1) * cos_w0 + 2 * sqrt_A * alpha;
+            a1 = -2 * ((A - 1) + (A + 1) * cos_w0);
+            a2 = (A + 1) + (A - 1) * cos_w0 - 2 * sqrt_A * alpha;
+            break;
+
+        case AUDIO_BIQUAD_HIGH_SHELF:
+            b0 = A * ((A + 1) + (A - 1) * cos_w0 + 2 * sqrt_A * alpha);
+            b1 = -2 * A * ((A - 1) + (A + 1) * cos_w0);
+            b2 = A * ((A + 1) + (A - 1) * cos_w0 - 2 * sqrt_A * alpha);
+            a0 = (A + 1) - (A - 1) * cos_w0 + 2 * sqrt_A * alpha;
+            a1 = 2 * ((A - 1) - (A + 1) * cos_w0);
+            a2 = (A + 1) - (A - 1) * cos_w0 - 2 * sqrt_A * alpha;
+            break;
+
+        case AUDIO_BIQUAD_ALLPASS:
+            b0 = 1 - alpha; b1 = -2 * cos_w0; b2 = 1 + alpha;
+            a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+            break;
+    }
+
+    audio_biquad_coefficients_t c;
+    c.b0 = (float) (b0 / a0);
+    c.b1 = (float) (b1 / a0);
+    c.b2 = (float) (b2 / a0);
+    c.a1 = (float) (a1 / a0);
+    c.a2 = (float) (a2 / a0);
+    return c;
+}
+
+static int biquad_alloc_arrays(biquad_coefficient_arrays_t *arrays, size_t count)
+{
+    arrays->b0 = calloc(count, sizeof(float));
+    arrays->b1 = calloc(count, sizeof(float));
+    arrays->b2 = calloc(count, sizeof(float));
+    arrays->a1 = calloc(count, sizeof(float));
+    arrays->a2 = calloc(count, sizeof(float));
+    return (arrays->b0 && arrays->b1 && arrays->b2 && arrays->a1 && arrays->a2) ? 0 : -1;
+}
+
+static void biquad_free_arrays(biquad_coefficient_arrays_t *arrays)
+{
+    free(arrays->b0);
+    free(arrays->b1);
+    free(arrays->b2);
+    free(arrays->a1);
+    free(arrays->a2);
+}
+
+audio_biquad_bank_t *audio_biquad_bank_create(int num_filters, int num_stages)
+{
+    if (num_filters <= 0 || num_stages <= 0)
+        return NULL;
+
+    audio_biquad_bank_t *bank = calloc(1, sizeof(audio_biquad_bank_t));
+    if (!bank) return NULL;
+
+    if (pthread_mutex_init(&bank->writer_lock, NULL) != 0)
+    {
+        free(bank);
+        return NULL;
+    }
+
+    bank->num_filters = num_filters;
+    bank->num_stages = num_stages;
+    bank->num_padded = (num_filters + AUDIO_BIQUAD_LANES - 1) / AUDIO_BIQUAD_LANES * AUDIO_BIQUAD_LANES;
+
+    size_t sections = (size_t) num_stages * bank->num_padded;
+    bank->requested = calloc((size_t) num_stages * num_filters * BIQUAD_COEFFICIENTS, sizeof(_Atomic float));
+    bank->s1 = calloc(sections, sizeof(float));
+    bank->s2 = calloc(sections, sizeof(float));
+
+    if (!bank->requested || !bank->s1 || !bank->s2 ||
+        biquad_alloc_arrays(&bank->current, sections) ||
+        biquad_alloc_arrays(&bank->target, sections) ||
+        biquad_alloc_arrays(&bank->step, sections))
+    {
+        audio_biquad_bank_destroy(bank);
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------------*
+     * Bypass every section, including the padding lanes.
+     *-----------------------------------------------------------------------*/
+    for (size_t i = 0; i < sections; i++)
+    {
+        bank->current.b0[i] = 1.0f;
+        bank->target.b0[i] = 1.0f;
+    }
+
+    audio_biquad_coefficients_t bypass = audio_biquad_bypass();
+    float values[BIQUAD_COEFFICIENTS] = { bypass.b0, bypass.b1, bypass.b2, bypass.a1, bypass.a2 };
+    for (int i = 0; i < num_stages * num_filters; i++)
+    {
+        for (int k = 0; k < BIQUAD_COEFFICIENTS; k++)
+            atomic_init(&bank->requested[i * BIQUAD_COEFFICIENTS + k], values[k]);
+    }
+
+    atomic_init(&bank->version, 0);
+    atomic_init(&bank->reset_requested, 0);
+
+    return bank;
+}
+
+void audio_biquad_bank_destroy(audio_biquad_bank_t *bank)
+{
+    if (!bank) return;
+
+    free(bank->requested);
+    free(bank->s1);
+    free(bank->s2);
+    biquad_free_arrays(&bank->current);
+    biquad_free_arrays(&bank->target);
+    biquad_free_arrays(&bank->step);
+    pthread_mutex_destroy(&bank->writer_lock);
+    free(bank);
+}
+
+void audio_biquad_set(audio_biquad_bank_t *bank, int filter, int stage, audio_biquad_coefficients_t coefficients)
+{
+    if (filter < 0 || filter >= bank->num_filters || stage < 0 || stage >= bank->num_stages)
+        return;
+
+    pthread_mutex_lock(&bank->writer_lock);
+
+    unsigned int version = atomic_load_explicit(&bank->version, memory_order_relaxed);
+    atomic_store_explicit(&bank->version, version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    _Atomic float *requested = bank->requested + (stage * bank->num_filters + filter) * BIQUAD_COEFFICIENTS;
+    atomic_store_explicit(&requested[0], coefficients.b0, memory_order_relaxed);
+    atomic_store_explicit(&requested[1], coefficients.b1, memory_order_relaxed);
+    atomic_store_explicit(&requested[2], coefficients.b2, memory_order_relaxed);
+    atomic_store_explicit(&requested[3], coefficients.a1, memory_order_relaxed);
+    atomic_store_explicit(&requested[4], coefficients.a2, memory_order_relaxed);
+
+    atomic_store_explicit(&bank->version, version + 2, memory_order_release);
+
+    pthread_mutex_unlock(&bank->writer_lock);
+}
+
+void audio_biquad_bank_reset(audio_biquad_bank_t *bank)
+{
+    atomic_store_explicit(&bank->reset_requested, 1, memory_order_relaxed);
+}
+
+/*----------------------------------------------------------------------------*
+ * Take up requested coefficients, and work out the steps that ramp to
+ * them over `num_frames`. Returns nonzero if any section is ramping.
+ *
+ * If a write is in progress, or one begins while reading, the requests
+ * are left for a later block: a half-written section could be unstable.
+ *----------------------------------------------------------------------------*/
+static int biquad_update(audio_biquad_bank_t *bank, int num_frames)
+{
+    unsigned int version = atomic_load_explicit(&bank->version, memory_order_acquire);
+    if ((version & 1) || version == bank->applied_version)
+        return 0;
+
+    float scale = 1.0f / num_frames;
+    int ramping = 0;
+
+    for (int stage = 0; stage < bank->num_stages; stage++)
+    {
+        for (int f = 0; f < bank->num_filters; f++)
+        {
+            const _Atomic float *requested = bank->requested + (stage * bank->num_filters + f) * BIQUAD_COEFFICIENTS;
+            int i = stage * bank->num_padded + f;
+
+            float *target[BIQUAD_COEFFICIENTS] = { bank->target.b0, bank->target.b1, bank->target.b2, bank->target.a1, bank->target.a2 };
+            float *current[BIQUAD_COEFFICIENTS] = { bank->current.b0, bank->current.b1, bank->current.b2, bank->current.a1, bank->current.a2 };
+            float *step[BIQUAD_COEFFICIENTS] = { bank->step.b0, bank->step.b1, bank->step.b2, bank->step.a1, bank->step.a2 };
+
+            for (int k = 0; k < BIQUAD_COEFFICIENTS; k++)
+            {
+                target[k][i] = atomic_load_explicit(&requested[k], memory_order_relaxed);
+                step[k][i] = (target[k][i] - current[k][i]) * scale;
+                ramping |= (step[k][i] != 0.0f);
+            }
+        }
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&bank->version, memory_order_relaxed) != version)
+    {
+        size_t sections = (size_t) bank->num_stages * bank->num_padded;
+        memcpy(bank->target.b0, bank->current.b0, sections * sizeof(float));
+        memcpy(bank->target.b1, bank->current.b1, sections * sizeof(float));
+        memcpy(bank->target.b2, bank->current.b2, sections * sizeof(float));
+        memcpy(bank->target.a1, bank->current.a1, sections * sizeof(float));
+        memcpy(bank->target.a2, bank->current.a2, sections * sizeof(float));
+        return 0;
+    }
+
+    bank->applied_version = version;
+    return ramping;
+}
+
+/*----------------------------------------------------------------------------*
+ * Frames run through each section at a time. The chunk is interleaved by
+ * lane on the stack, so that a section's coefficients and state can be
+ * held in registers across it, rather than reloaded for every sample.
+ *----------------------------------------------------------------------------*/
+#define BIQUAD_CHUNK_FRAMES 64
+
+/*----------------------------------------------------------------------------*
+ * Run one group of AUDIO_BIQUAD_LANES filters over a block. Each chunk is
+ * gathered from the filters' inputs into lane vectors, passed through
+ * every section in turn, and scattered to their outputs.
+ *----------------------------------------------------------------------------*/
+static void biquad_process_group(audio_biquad_bank_t *bank,
+                                 int group,
+                                 const float **input,
+                                 float **output,
+                                 int num_frames,
+                                 int ramping)
+{
+    int lanes = bank->num_filters - group;
+    if (lanes > AUDIO_BIQUAD_LANES)
+        lanes = AUDIO_BIQUAD_LANES;
+
+    float x[BIQUAD_CHUNK_FRAMES][AUDIO_BIQUAD_LANES];
+
+    for (int start = 0; start < num_frames; start += BIQUAD_CHUNK_FRAMES)
+    {
+        int chunk = num_frames - start;
+        if (chunk > BIQUAD_CHUNK_FRAMES)
+            chunk = BIQUAD_CHUNK_FRAMES;
+
+        for (int n = 0; n < chunk; n++)
+        {
+            for (int l = 0; l < AUDIO_BIQUAD_LANES; l++)
+                x[n][l] = l < lanes ? input[group + l][start + n] : 0.0f;
+        }
+
+        for (int stage = 0; stage < bank->num_stages; stage++)
+        {
+            int offset = stage * bank->num_padded + group;
+            float b0[AUDIO_BIQUAD_LANES], b1[AUDIO_BIQUAD_LANES], b2[AUDIO_BIQUAD_LANES];
+            float a1[AUDIO_BIQUAD_LANES], a2[AUDIO_BIQUAD_LANES];
+            float s1[AUDIO_BIQUAD_LANES], s2[AUDIO_BIQUAD_LANES];
+
+            for (int l = 0; l < AUDIO_BIQUAD_LANES; l++)
+            {
+                b0[l] = bank->current.b0[offset + l];
+                b1[l] = bank->current.b1[offset + l];
+                b2[l] = bank->current.b2[offset + l];
+                a1[l] = bank->current.a1[offset + l];
+                a2[l] = bank->current.a2[offset + l];
+                s1[l] = bank->s1[offset + l];
+                s2[l] = bank->s2[offset + l];
+            }
+
+            if (ramping)
+            {
+                float db0[AUDIO_BIQUAD_LANES], db1[AUDIO_BIQUAD_LANES], db2[AUDIO_BIQUAD_LANES];
+                float da1[AUDIO_BIQUAD_LANES], da2[AUDIO_BIQUAD_LANES];
+
+                for (int l = 0; l < AUDIO_BIQUAD_LANES; l++)
+                {
+                    db0[l] = bank->step.b0[offset + l];
+                    db1[l] = bank->step.b1[offset + l];
+                    db2[l] = bank->step.b2[offset + l];
+                    da1[l] = bank->step.a1[offset + l];
+                    da2[l] = bank->step.a2[offset + l];
+                }
+
+                for (int n = 0; n < chunk; n++)
+                {
+                    for (int l = 0; l < AUDIO_BIQUAD_LANES; l++)
+                    {
+                        b0[l] += db0[l];
+                        b1[l] += db1[l];
+                        b2[l] += db2[l];
+                        a1[l] += da1[l];
+                        a2[l] += da2[l];
+
+                        float in = x[n][l];
+                        float y = b0[l] * in + s1[l];
+                        s1[l] = b1[l] * in - a1[l] * y + s2[l];
+                        s2[l] = b2[l] * in - a2[l] * y;
+                        x[n][l] = y;
+                    }
+                }
+
+                for (int l = 0; l < AUDIO_BIQUAD_LANES; l++)
+                {
+                    bank->current.b0[offset + l] = b0[l];
+                    bank->current.b1[offset + l] = b1[l];
+                    bank->current.b2[offset + l] = b2[l];
+                    bank->current.a1[offset + l] = a1[l];
+                    bank->current.a2[offset + l] = a2[l];
+                }
+            }
+            else
+            {
+                for (int n = 0; n < chunk; n++)
+                {
+                    for (int l = 0; l < AUDIO_BIQUAD_LANES; l++)
+                    {
+                        float in = x[n][l];
+                        float y = b0[l] * in + s1[l];
+                        s1[l] = b1[l] * in - a1[l] * y + s2[l];
+                        s2[l] = b2[l] * in - a2[l] * y;
+                        x[n][l] = y;
+                    }
+                }
+            }
+
+            for (int l = 0; l < AUDIO_BIQUAD_LANES; l++)
+            {
+                bank->s1[offset + l] = s1[l];
+                bank->s2[offset + l] = s2[l];
+            }
+        }
+
+        for (int l = 0; l < lanes; l++)
+        {
+            for (int n = 0; n < chunk; n++)
+                output[group + l][start + n] = x[n][l];
+        }
+    }
+}
+
+void audio_biquad_bank_process(audio_biquad_bank_t *bank,
+                               const float **input,
+                               float **output,
+                               int num_frames)
+{
+    if (num_frames <= 0)
+        return;
+
+    if (atomic_exchange_explicit(&bank->reset_requested, 0, memory_order_relaxed))
+    {
+        size_t sections = (size_t) bank->num_stages * bank->num_padded;
+        memset(bank->s1, 0, sections * sizeof(float));
+        memset(bank->s2, 0, sections * sizeof(float));
+    }
+
+    int ramping = biquad_update(bank, num_frames);
+
+    for (int group = 0; group < bank->num_filters; group += AUDIO_BIQUAD_LANES)
+        biquad_process_group(bank, group, input, output, num_frames, ramping);
+
+    /*------------------------------------------------------------------------*
+     * Land exactly on the targets, and stop ramping.
+     *-----------------------------------------------------------------------*/
+    if (ramping)
+    {
+        size_t sections = (size_t) bank->num_stages * bank->num_padded;
+        memcpy(bank->current.b0, bank->target.b0, sections * sizeof(float));
+        memcpy(bank->current.b1, bank->target.b1, sections * sizeof(float));
+        memcpy(bank->current.b2, bank->target.b2, sections * sizeof(float));
+        memcpy(bank->current.a1, bank->target.a1, sections * sizeof(float));
+        memcpy(bank->current.a2, bank->target.a2, sections * sizeof(float));
+    }
+}
+
+int audio_biquad_bank_num_filters(audio_biquad_bank_t *bank)
+{
+    return bank->num_filters;
+}
+
+int audio_biquad_bank_num_stages(audio_biquad_bank_t *bank)
+{
+    return bank->num_stages;
+}
@@ -0,0 +1,134 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOBiquad
+ *
+ *  A bank of cascaded biquad (second-order IIR) filters, processed in
+ *  parallel: one filter per channel, or several filters over the same
+ *  input (eg, a band-splitting filter bank).
+ *
+ *  Coefficients and state are stored as structures of arrays, in groups
+ *  of AUDIO_BIQUAD_LANES filters, so that each section of the cascade is
+ *  computed for all filters in a group at once and the compiler
+ *  vectorises across filters. Sections use the transposed direct form II.
+ *
+ *  Coefficients may be changed from any other thread at any time. Changes
+ *  are taken up at the start of the next block and interpolated across
+ *  it, so filters can be modulated without zipper noise. Writers are
+ *  serialised by a lock that the audio thread never takes.
+ *
+ *  Example usage:
+ *
+ *  audio_biquad_bank_t *eq = audio_biquad_bank_create(2, 3);
+ *  audio_biquad_coefficients_t low = audio_biquad_design(AUDIO_BIQUAD_LOW_SHELF, 200, 0.707, 3.0, 44100);
+ *  audio_biquad_set(eq, 0, 0, low);
+ *  audio_biquad_set(eq, 1, 0, low);
+ *  ...
+ *  audio_biquad_bank_process(eq, (const float **) data, data, num_frames);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_BIQUAD_H
+#define AUDIO_IO_BIQUAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Filters are processed in groups of this many.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_BIQUAD_LANES 8
+
+typedef enum
+{
+    AUDIO_BIQUAD_LOWPASS = 0,
+    AUDIO_BIQUAD_HIGHPASS,
+    AUDIO_BIQUAD_BANDPASS,
+    AUDIO_BIQUAD_NOTCH,
+    AUDIO_BIQUAD_PEAK,
+    AUDIO_BIQUAD_LOW_SHELF,
+    AUDIO_BIQUAD_HIGH_SHELF,
+    AUDIO_BIQUAD_ALLPASS
+} audio_biquad_type_t;
+
+/**-----------------------------------------------------------------------------
+ * Coefficients of one section, normalised so that a0 = 1:
+ *
+ *  y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    float   b0;
+    float   b1;
+    float   b2;
+    float   a1;
+    float   a2;
+} audio_biquad_coefficients_t;
+
+typedef struct audio_biquad_bank audio_biquad_bank_t;
+
+/**-----------------------------------------------------------------------------
+ * Design a section, after the Audio EQ Cookbook (R. Bristow-Johnson).
+ *
+ * @param frequency     Cutoff or centre frequency (Hz).
+ * @param q             Quality factor; 0.707 for a Butterworth response.
+ * @param gain_db       Gain for peak and shelf filters; otherwise ignored.
+ *----------------------------------------------------------------------------*/
+audio_biquad_coefficients_t audio_biquad_design(audio_biquad_type_t type,
+                                                float frequency,
+                                                float q,
+                                                float gain_db,
+                                                int samplerate);
+
+/**-----------------------------------------------------------------------------
+ * Returns the coefficients of a section that passes its input unchanged.
+ *----------------------------------------------------------------------------*/
+audio_biquad_coefficients_t audio_biquad_bypass(void);
+
+/**-----------------------------------------------------------------------------
+ * Create a new bank, with every section bypassed.
+ *
+ * @param num_filters   Number of filters run in parallel.
+ * @param num_stages    Number of sections cascaded in each filter.
+ *----------------------------------------------------------------------------*/
+audio_biquad_bank_t *audio_biquad_bank_create(int num_filters, int num_stages);
+
+/**-----------------------------------------------------------------------------
+ * Free a bank.
+ *----------------------------------------------------------------------------*/
+void audio_biquad_bank_destroy(audio_biquad_bank_t *bank);
+
+/**-----------------------------------------------------------------------------
+ * Set the coefficients of one section of one filter. They are ramped to
+ * over the next block processed. May be called from any non-audio
+ * thread. Not realtime-safe.
+ *----------------------------------------------------------------------------*/
+void audio_biquad_set(audio_biquad_bank_t *bank, int filter, int stage, audio_biquad_coefficients_t coefficients);
+
+/**-----------------------------------------------------------------------------
+ * Clear every filter's state at the start of the next block.
+ * May be called from any thread.
+ *----------------------------------------------------------------------------*/
+void audio_biquad_bank_reset(audio_biquad_bank_t *bank);
+
+/**-----------------------------------------------------------------------------
+ * Filter a block. Filter `f` reads `input[f]` and writes `output[f]`.
+ * An output may be the same buffer as its own input, but must not be any
+ * other filter's input. Realtime-safe.
+ *----------------------------------------------------------------------------*/
+void audio_biquad_bank_process(audio_biquad_bank_t *bank,
+                               const float **input,
+                               float **output,
+                               int num_frames);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of filters, and sections per filter.
+ *----------------------------------------------------------------------------*/
+int audio_biquad_bank_num_filters(audio_biquad_bank_t *bank);
+int audio_biquad_bank_num_stages(audio_biquad_bank_t *bank);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOBufferController
+ *
+ *  Adaptive I/O buffer size, driven by overruns and load.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOBufferController.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*----------------------------------------------------------------------------*
+ * Each time a decrease is undone within its headroom period, the headroom
+ * required before the next decrease doubles, up to this factor.
+ *----------------------------------------------------------------------------*/
+#define BUFFER_CONTROLLER_MAX_BACKOFF 8
+
+struct audio_buffer_controller
+{
+    audio_buffer_controller_config_t config;
+
+    /*------------------------------------------------------------------------*
+     * Written by the audio thread, and taken by each update.
+     *-----------------------------------------------------------------------*/
+    atomic_uint_least64_t   blocks;
+    atomic_uint_least64_t   overruns;
+    _Atomic float           peak_load;
+
+    /*------------------------------------------------------------------------*
+     * Owned by the thread calling update.
+     *-----------------------------------------------------------------------*/
+    int                     frames;
+    int                     window_overruns;
+    double                  window_start;
+    double                  headroom_start;
+    double                  last_decrease;
+    int                     backoff;
+    _Atomic float           last_peak_load;
+};
+
+audio_buffer_controller_config_t audio_buffer_controller_config_default(void)
+{
+    audio_buffer_controller_config_t config;
+    config.min_frames = 64;
+    config.max_frames = 1024;
+    config.overruns_to_increase = 2;
+    config.overrun_window = 5.0;
+    config.load_to_decrease = 0.35;
+    config.headroom_duration = 30.0;
+    return config;
+}
+
+audio_buffer_controller_t *audio_buffer_controller_create(audio_buffer_controller_config_t config)
+{
+    if (config.min_frames <= 0 || config.max_frames < config.min_frames || config.overruns_to_increase <= 0)
+        return NULL;
+
+    audio_buffer_controller_t *controller = calloc(1, sizeof(audio_buffer_controller_t));
+    if (!controller) return NULL;
+
+    controller->config = config;
+    controller->frames = config.min_frames;
+    controller->window_start = -1;
+    controller->headroom_start = -1;
+    controller->last_decrease = -1;
+    controller->backoff = 1;
+    atomic_init(&controller->blocks, 0);
+    atomic_init(&controller->overruns, 0);
+    atomic_init(&controller->peak_load, 0.0f);
+    atomic_init(&controller->last_peak_load, 0.0f);
+
+    return controller;
+}
+
+void audio_buffer_controller_destroy(audio_buffer_controller_t *controller)
+{
+    free(controller);
+}
+
+void audio_buffer_controller_observe(audio_buffer_controller_t *controller, float load, int overrun)
+{
+    atomic_fetch_add_explicit(&controller->blocks, 1, memory_order_relaxed);
+    if (overrun)
+        atomic_fetch_add_explicit(&controller->overruns, 1, memory_order_relaxed);
+
+    /*------------------------------------------------------------------------*
+     * The update thread may reset the peak at any moment; retry rather
+     * than overwrite a reset with a stale maximum.
+     *-----------------------------------------------------------------------*/
+    float peak = atomic_load_explicit(&controller->peak_load, memory_order_relaxed);
+    while (load > peak &&
+           !atomic_compare_exchange_weak_explicit(&controller->peak_load, &peak, load,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+static void buffer_controller_resize(audio_buffer_controller_t *controller, int frames, double now)
+{
+    if (frames < controller->config.min_frames)
+        frames = controller->config.min_frames;
+    if (frames > controller->config.max_frames)
+        frames = controller->config.max_frames;
+
+    controller->frames = frames;
+    controller->window_start = now;
+    controller->window_overruns = 0;
+    controller->headroom_start = now;
+}
+
+audio_buffer_decision_t audio_buffer_controller_update(audio_buffer_controller_t *controller, double now)
+{
+    audio_buffer_controller_config_t *config = &controller->config;
+
+    uint64_t blocks = atomic_exchange_explicit(&controller->blocks, 0, memory_order_relaxed);
+    uint64_t overruns = atomic_exchange_explicit(&controller->overruns, 0, memory_order_relaxed);
+    float peak = atomic_exchange_explicit(&controller->peak_load, 0.0f, memory_order_relaxed);
+    atomic_store_explicit(&controller->last_peak_load, peak, memory_order_relaxed);
+
+    if (controller->window_start < 0 || now - controller->window_start > config->overrun_window)
+    {
+        controller->window_start = now;
+        controller->window_overruns = 0;
+    }
+    if (controller->headroom_start < 0)
+        controller->headroom_start = now;
+
+    controller->window_overruns += (int) overruns;
+
+    /*------------------------------------------------------------------------*
+     * Too many overruns: step up. If that undoes a recent step down, be
+     * slower to step down next time.
+     *-----------------------------------------------------------------------*/
+    if (controller->window_overruns >= config->overruns_to_increase &&
+        controller->frames < config->max_frames)
+    {
+        if (controller->last_decrease >= 0 &&
+            now - controller->last_decrease < config->headroom_duration * controller->backoff &&
+            controller->backoff < BUFFER_CONTROLLER_MAX_BACKOFF)
+            controller->backoff *= 2;
+
+        buffer_controller_resize(controller, controller->frames * 2, now);
+        return AUDIO_BUFFER_INCREASE;
+    }
+
+    /*------------------------------------------------------------------------*
+     * Any overrun or heavy block restarts the headroom period, as does an
+     * interval with no audio, which gives no evidence either way.
+     *-----------------------------------------------------------------------*/
+    if (blocks == 0 || overruns > 0 || peak >= config->load_to_decrease)
+    {
+        controller->headroom_start = now;
+        return AUDIO_BUFFER_HOLD;
+    }
+
+    if (controller->frames > config->min_frames &&
+        now - controller->headroom_start >= config->headroom_duration * controller->backoff)
+    {
+        buffer_controller_resize(controller, controller->frames / 2, now);
+        controller->last_decrease = now;
+        return AUDIO_BUFFER_DECREASE;
+    }
+
+    return AUDIO_BUFFER_HOLD;
+}
+
+int audio_buffer_controller_frames(audio_buffer_controller_t *controller)
+{
+    return controller->frames;
+}
+
+void audio_buffer_controller_set_frames(audio_buffer_controller_t *controller, int frames)
+{
+    if (frames > 0)
+        controller->frames = frames;
+}
+
+float audio_buffer_controller_peak_load(audio_buffer_controller_t *controller)
+{
+    return atomic_load_explicit(&controller->last_peak_load, memory_order_relaxed);
+}
@@ -0,0 +1,123 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOBufferController
+ *
+ *  Chooses the I/O buffer size from how the audio thread copes with it:
+ *  starting at the smallest size allowed, doubling it when deadline
+ *  overruns occur, and cautiously halving it again after a sustained
+ *  period with headroom to spare.
+ *
+ *  The audio thread reports each block's load (the fraction of the period
+ *  its processing took) and whether it overran. A control thread then
+ *  calls audio_buffer_controller_update() periodically to reach
+ *  decisions. Decisions depend only on the observations and the times
+ *  passed in, so the controller can be driven by a synthetic clock.
+ *
+ *  Example usage:
+ *
+ *  audio_buffer_controller_t *controller = audio_buffer_controller_create(audio_buffer_controller_config_default());
+ *
+ *  // audio thread
+ *  audio_buffer_controller_observe(controller, render_time / period, overran);
+ *
+ *  // control thread, every half second or so
+ *  if (audio_buffer_controller_update(controller, now) != AUDIO_BUFFER_HOLD)
+ *      set_buffer_size(audio_buffer_controller_frames(controller));
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_BUFFER_CONTROLLER_H
+#define AUDIO_IO_BUFFER_CONTROLLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    /*------------------------------------------------------------------------*
+     * Range of buffer sizes (frames). The controller starts at the
+     * smallest, and moves between sizes a factor of two apart.
+     *-----------------------------------------------------------------------*/
+    int     min_frames;
+    int     max_frames;
+
+    /*------------------------------------------------------------------------*
+     * The buffer size is doubled once this many overruns occur within
+     * `overrun_window` seconds.
+     *-----------------------------------------------------------------------*/
+    int     overruns_to_increase;
+    double  overrun_window;
+
+    /*------------------------------------------------------------------------*
+     * The buffer size is halved after `headroom_duration` seconds without
+     * overruns, and with every block's load below `load_to_decrease`.
+     * Halving the buffer at least doubles the load, so this should be well
+     * under 0.5.
+     *-----------------------------------------------------------------------*/
+    double  load_to_decrease;
+    double  headroom_duration;
+} audio_buffer_controller_config_t;
+
+typedef enum
+{
+    AUDIO_BUFFER_HOLD = 0,
+    AUDIO_BUFFER_INCREASE,
+    AUDIO_BUFFER_DECREASE
+} audio_buffer_decision_t;
+
+typedef struct audio_buffer_controller audio_buffer_controller_t;
+
+/**-----------------------------------------------------------------------------
+ * Returns the default configuration: 64 to 1024 frames; up after 2
+ * overruns within 5s; down after 30s with load below 0.35.
+ *----------------------------------------------------------------------------*/
+audio_buffer_controller_config_t audio_buffer_controller_config_default(void);
+
+/**-----------------------------------------------------------------------------
+ * Create a new controller, at the smallest buffer size.
+ *----------------------------------------------------------------------------*/
+audio_buffer_controller_t *audio_buffer_controller_create(audio_buffer_controller_config_t config);
+
+/**-----------------------------------------------------------------------------
+ * Free a controller.
+ *----------------------------------------------------------------------------*/
+void audio_buffer_controller_destroy(audio_buffer_controller_t *controller);
+
+/**-----------------------------------------------------------------------------
+ * Record one block's load, and whether it overran. Realtime-safe.
+ *----------------------------------------------------------------------------*/
+void audio_buffer_controller_observe(audio_buffer_controller_t *controller, float load, int overrun);
+
+/**-----------------------------------------------------------------------------
+ * Take in the blocks observed since the last update, and decide whether
+ * to change the buffer size.
+ *
+ * @param now   The current time, in seconds, on any monotonic clock.
+ *
+ * @returns The decision. The new size is given by
+ *          audio_buffer_controller_frames().
+ *----------------------------------------------------------------------------*/
+audio_buffer_decision_t audio_buffer_controller_update(audio_buffer_controller_t *controller, double now);
+
+/**-----------------------------------------------------------------------------
+ * Returns the buffer size decided on (frames).
+ *----------------------------------------------------------------------------*/
+int audio_buffer_controller_frames(audio_buffer_controller_t *controller);
+
+/**-----------------------------------------------------------------------------
+ * Tell the controller the buffer size actually in use, if the hardware
+ * did not grant the size decided on.
+ *----------------------------------------------------------------------------*/
+void audio_buffer_controller_set_frames(audio_buffer_controller_t *controller, int frames);
+
+/**-----------------------------------------------------------------------------
+ * Returns the highest load seen between the last two updates.
+ *----------------------------------------------------------------------------*/
+float audio_buffer_controller_peak_load(audio_buffer_controller_t *controller);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
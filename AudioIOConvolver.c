@@ -0,0 +1,668 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOConvolver
+ *
+ *  Two-stage partitioned FFT convolution, with the tail on a worker.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOConvolver.h"
+#include "AudioIOFFT.h"
+#include "AudioIOTrace.h"
+
+#ifdef __APPLE__
+#include <Accelerate/Accelerate.h>
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*----------------------------------------------------------------------------*
+ * Number of tail blocks in flight between the audio thread and the
+ * worker, and the weight given to each new timing in the averages.
+ *----------------------------------------------------------------------------*/
+#define CONVOLVER_TAIL_SLOTS 4
+#define CONVOLVER_TIME_SMOOTHING 0.05
+
+#define CONVOLVER_MIN_BLOCK_SIZE 16
+
+/*----------------------------------------------------------------------------*
+ * Bins multiplied at a time by the portable loops, so that the compiler
+ * can vectorize them without a cost model that allows for a remainder.
+ *----------------------------------------------------------------------------*/
+#define CONVOLVER_VECTOR_BINS 4
+
+/*----------------------------------------------------------------------------*
+ * Spectra in vDSP's split, packed format (see AudioIOFFT.h).
+ *----------------------------------------------------------------------------*/
+#ifdef __APPLE__
+typedef DSPSplitComplex convolver_split_t;
+#else
+typedef struct
+{
+    float *realp;
+    float *imagp;
+} convolver_split_t;
+#endif
+
+/*----------------------------------------------------------------------------*
+ * One uniformly partitioned stage: the impulse response segment split
+ * into partitions of `size` frames, and for each channel a frequency-
+ * domain delay line holding the spectra of the last `num_partitions`
+ * input blocks. Blocks are convolved by overlap-save with FFTs of twice
+ * the partition size.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    int                 size;
+    int                 num_partitions;
+    audio_fft_t        *fft;
+
+    convolver_split_t  *filter;
+    float              *filter_memory;
+
+    float              *frame[AUDIO_CONVOLVER_MAX_CHANNELS];
+    convolver_split_t  *spectra[AUDIO_CONVOLVER_MAX_CHANNELS];
+    float              *spectra_memory[AUDIO_CONVOLVER_MAX_CHANNELS];
+    int                 newest[AUDIO_CONVOLVER_MAX_CHANNELS];
+
+    /*------------------------------------------------------------------------*
+     * Workspace, used by whichever thread runs the stage.
+     *-----------------------------------------------------------------------*/
+    convolver_split_t   accumulator;
+    float              *accumulator_memory;
+    float              *output;
+} convolver_stage_t;
+
+struct audio_convolver
+{
+    int                     block_size;
+    int                     tail_block_size;
+    int                     blocks_per_tail;
+    int                     num_channels;
+
+    convolver_stage_t       head;
+    convolver_stage_t       tail;
+
+    /*------------------------------------------------------------------------*
+     * Audio thread: input gathered into the current head block, output of
+     * the previous one, and the number of head blocks processed.
+     *-----------------------------------------------------------------------*/
+    float                  *head_input[AUDIO_CONVOLVER_MAX_CHANNELS];
+    float                  *head_output[AUDIO_CONVOLVER_MAX_CHANNELS];
+    int                     fill;
+    uint64_t                head_blocks;
+    int                     skipping_tail_block;
+
+    /*------------------------------------------------------------------------*
+     * Tail blocks in flight, CONVOLVER_TAIL_SLOTS per channel. The audio
+     * thread fills input slots and publishes `tail_ready`; the worker
+     * fills output slots and publishes `tail_done`.
+     *-----------------------------------------------------------------------*/
+    float                  *tail_input[AUDIO_CONVOLVER_MAX_CHANNELS];
+    float                  *tail_output[AUDIO_CONVOLVER_MAX_CHANNELS];
+    atomic_uint_least64_t   tail_ready;
+    atomic_uint_least64_t   tail_done;
+
+    pthread_t               worker;
+    int                     has_worker;
+    atomic_int              quit;
+#ifdef __APPLE__
+    dispatch_semaphore_t    wake;
+#else
+    sem_t                   wake;
+    int                     has_wake;
+#endif
+
+    _Atomic double          head_block_time;
+    _Atomic double          tail_block_time;
+    atomic_uint_least64_t   late_blocks;
+};
+
+audio_convolver_config_t audio_convolver_config_default(void)
+{
+    audio_convolver_config_t config;
+    config.block_size = 256;
+    config.tail_block_size = 2048;
+    return config;
+}
+
+static double convolver_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void convolver_update_time(_Atomic double *average, double seconds)
+{
+    double value = atomic_load_explicit(average, memory_order_relaxed);
+    value = (value == 0.0) ? seconds : value + (seconds - value) * CONVOLVER_TIME_SMOOTHING;
+    atomic_store_explicit(average, value, memory_order_relaxed);
+}
+
+static int is_power_of_two(int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+/*----------------------------------------------------------------------------*
+ * The worker's wake-up: a dispatch semaphore on Apple's platforms, which
+ * don't implement unnamed POSIX semaphores, and a POSIX one elsewhere.
+ * sem_post() is async-signal-safe, so doesn't block the audio thread.
+ *----------------------------------------------------------------------------*/
+static int convolver_wake_create(audio_convolver_t *convolver)
+{
+#ifdef __APPLE__
+    convolver->wake = dispatch_semaphore_create(0);
+    return convolver->wake ? 0 : -1;
+#else
+    convolver->has_wake = sem_init(&convolver->wake, 0, 0) == 0;
+    return convolver->has_wake ? 0 : -1;
+#endif
+}
+
+static void convolver_wake_destroy(audio_convolver_t *convolver)
+{
+#ifdef __APPLE__
+    if (convolver->wake)
+        dispatch_release(convolver->wake);
+#else
+    if (convolver->has_wake)
+        sem_destroy(&convolver->wake);
+#endif
+}
+
+static void convolver_wake_signal(audio_convolver_t *convolver)
+{
+#ifdef __APPLE__
+    dispatch_semaphore_signal(convolver->wake);
+#else
+    sem_post(&convolver->wake);
+#endif
+}
+
+static void convolver_wake_wait(audio_convolver_t *convolver)
+{
+#ifdef __APPLE__
+    dispatch_semaphore_wait(convolver->wake, DISPATCH_TIME_FOREVER);
+#else
+    while (sem_wait(&convolver->wake) != 0)
+        ;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Uniformly partitioned stage
+////////////////////////////////////////////////////////////////////////////////
+
+static void convolver_stage_free(convolver_stage_t *stage)
+{
+    free(stage->filter);
+    free(stage->filter_memory);
+    for (int c = 0; c < AUDIO_CONVOLVER_MAX_CHANNELS; c++)
+    {
+        free(stage->frame[c]);
+        free(stage->spectra[c]);
+        free(stage->spectra_memory[c]);
+    }
+    free(stage->accumulator_memory);
+    free(stage->output);
+    audio_fft_destroy(stage->fft);
+}
+
+static convolver_split_t *convolver_split_array(float *memory, int count, int size)
+{
+    convolver_split_t *array = calloc(count, sizeof(convolver_split_t));
+    if (!array) return NULL;
+
+    for (int i = 0; i < count; i++)
+    {
+        array[i].realp = memory + (size_t) 2 * i * size;
+        array[i].imagp = memory + (size_t) 2 * i * size + size;
+    }
+    return array;
+}
+
+/*----------------------------------------------------------------------------*
+ * Set up a stage for `length` samples of impulse response, split into
+ * partitions of `size` frames. Each partition's spectrum is scaled to
+ * undo the forward (2x) and inverse (N x) FFT gains.
+ *----------------------------------------------------------------------------*/
+static int convolver_stage_init(convolver_stage_t *stage,
+                                int size,
+                                const float *impulse_response,
+                                int length,
+                                int num_channels)
+{
+    stage->size = size;
+    stage->num_partitions = (length + size - 1) / size;
+    stage->fft = audio_fft_create(2 * size);
+
+    int partitions = stage->num_partitions;
+    stage->filter_memory = calloc((size_t) 2 * partitions * size, sizeof(float));
+    stage->filter = stage->filter_memory ? convolver_split_array(stage->filter_memory, partitions, size) : NULL;
+    stage->accumulator_memory = calloc(2 * size, sizeof(float));
+    stage->output = calloc(2 * size, sizeof(float));
+    if (!stage->fft || !stage->filter || !stage->accumulator_memory || !stage->output)
+        return -1;
+
+    stage->accumulator.realp = stage->accumulator_memory;
+    stage->accumulator.imagp = stage->accumulator_memory + size;
+
+    for (int c = 0; c < num_channels; c++)
+    {
+        stage->frame[c] = calloc(2 * size, sizeof(float));
+        stage->spectra_memory[c] = calloc((size_t) 2 * partitions * size, sizeof(float));
+        stage->spectra[c] = stage->spectra_memory[c] ? convolver_split_array(stage->spectra_memory[c], partitions, size) : NULL;
+        if (!stage->frame[c] || !stage->spectra[c])
+            return -1;
+    }
+
+    float scale = 1.0f / (4.0f * 2 * size);
+    for (int j = 0; j < partitions; j++)
+    {
+        int segment = length - j * size;
+        if (segment > size)
+            segment = size;
+
+        memset(stage->output, 0, 2 * size * sizeof(float));
+        memcpy(stage->output, impulse_response + (size_t) j * size, segment * sizeof(float));
+
+        audio_fft_forward(stage->fft, stage->output, stage->filter[j].realp, stage->filter[j].imagp);
+#ifdef __APPLE__
+        vDSP_vsmul(stage->filter[j].realp, 1, &scale, stage->filter[j].realp, 1, size);
+        vDSP_vsmul(stage->filter[j].imagp, 1, &scale, stage->filter[j].imagp, 1, size);
+#else
+        for (int i = 0; i < size; i++)
+        {
+            stage->filter[j].realp[i] *= scale;
+            stage->filter[j].imagp[i] *= scale;
+        }
+#endif
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ * Add the product of two packed spectra to the accumulator, bin by bin,
+ * leaving the first bin, which holds the real-valued DC and Nyquist
+ * terms, to the caller. The portable loop runs over every bin, as `size`
+ * is a multiple of CONVOLVER_VECTOR_BINS, and the first is overwritten.
+ *----------------------------------------------------------------------------*/
+static void convolver_multiply_accumulate(const float *restrict x_real,
+                                          const float *restrict x_imag,
+                                          const float *restrict h_real,
+                                          const float *restrict h_imag,
+                                          float *restrict a_real,
+                                          float *restrict a_imag,
+                                          int size)
+{
+#ifdef __APPLE__
+    DSPSplitComplex x_bins = { (float *) x_real + 1, (float *) x_imag + 1 };
+    DSPSplitComplex h_bins = { (float *) h_real + 1, (float *) h_imag + 1 };
+    DSPSplitComplex bins = { a_real + 1, a_imag + 1 };
+    vDSP_zvma(&x_bins, 1, &h_bins, 1, &bins, 1, &bins, 1, size - 1);
+#else
+    for (int i = 0; i < size; i += CONVOLVER_VECTOR_BINS)
+    {
+        for (int k = 0; k < CONVOLVER_VECTOR_BINS; k++)
+        {
+            a_real[i + k] += x_real[i + k] * h_real[i + k] - x_imag[i + k] * h_imag[i + k];
+            a_imag[i + k] += x_real[i + k] * h_imag[i + k] + x_imag[i + k] * h_real[i + k];
+        }
+    }
+#endif
+}
+
+/*----------------------------------------------------------------------------*
+ * Convolve one block of `size` frames on one channel.
+ *----------------------------------------------------------------------------*/
+static void convolver_stage_process(convolver_stage_t *stage,
+                                    int channel,
+                                    const float *input,
+                                    float *output)
+{
+    int size = stage->size;
+    int partitions = stage->num_partitions;
+    float *frame = stage->frame[channel];
+
+    /*------------------------------------------------------------------------*
+     * Slide the input frame along, and push its spectrum onto the delay
+     * line.
+     *-----------------------------------------------------------------------*/
+    memcpy(frame, frame + size, size * sizeof(float));
+    memcpy(frame + size, input, size * sizeof(float));
+
+    int newest = stage->newest[channel] + 1;
+    if (newest == partitions)
+        newest = 0;
+    stage->newest[channel] = newest;
+
+    convolver_split_t *spectra = stage->spectra[channel];
+    audio_fft_forward(stage->fft, frame, spectra[newest].realp, spectra[newest].imagp);
+
+    /*------------------------------------------------------------------------*
+     * Multiply-accumulate each past input spectrum with its partition.
+     * The packed format keeps the real-valued DC and Nyquist terms in the
+     * first real and imaginary slots, which are multiplied separately.
+     *-----------------------------------------------------------------------*/
+    convolver_split_t *accumulator = &stage->accumulator;
+    memset(accumulator->realp, 0, size * sizeof(float));
+    memset(accumulator->imagp, 0, size * sizeof(float));
+    float dc = 0.0f;
+    float nyquist = 0.0f;
+
+    int index = newest;
+    for (int j = 0; j < partitions; j++)
+    {
+        const convolver_split_t *x = &spectra[index];
+        const convolver_split_t *h = &stage->filter[j];
+        dc += x->realp[0] * h->realp[0];
+        nyquist += x->imagp[0] * h->imagp[0];
+
+        convolver_multiply_accumulate(x->realp, x->imagp, h->realp, h->imagp,
+                                      accumulator->realp, accumulator->imagp, size);
+
+        index = (index == 0) ? partitions - 1 : index - 1;
+    }
+
+    accumulator->realp[0] = dc;
+    accumulator->imagp[0] = nyquist;
+
+    /*------------------------------------------------------------------------*
+     * Back to the time domain; the second half is the valid output.
+     *-----------------------------------------------------------------------*/
+    audio_fft_inverse(stage->fft, accumulator->realp, accumulator->imagp, stage->output);
+    memcpy(output, stage->output + size, size * sizeof(float));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Worker
+////////////////////////////////////////////////////////////////////////////////
+
+static void *convolver_worker(void *context)
+{
+    audio_convolver_t *convolver = context;
+    int size = convolver->tail_block_size;
+    uint64_t next = 0;
+
+#ifdef __APPLE__
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+#endif
+
+    for (;;)
+    {
+        convolver_wake_wait(convolver);
+        if (atomic_load_explicit(&convolver->quit, memory_order_relaxed))
+            break;
+
+        uint64_t ready = atomic_load_explicit(&convolver->tail_ready, memory_order_acquire);
+        while (next < ready)
+        {
+            size_t slot = (size_t) (next % CONVOLVER_TAIL_SLOTS) * size;
+            double start = convolver_now();
+            AUDIO_TRACE_BEGIN("convolver tail");
+
+            for (int c = 0; c < convolver->num_channels; c++)
+                convolver_stage_process(&convolver->tail, c,
+                                        convolver->tail_input[c] + slot,
+                                        convolver->tail_output[c] + slot);
+
+            AUDIO_TRACE_END("convolver tail");
+            convolver_update_time(&convolver->tail_block_time, convolver_now() - start);
+            next++;
+            atomic_store_explicit(&convolver->tail_done, next, memory_order_release);
+        }
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Convolver
+////////////////////////////////////////////////////////////////////////////////
+
+audio_convolver_t *audio_convolver_create(audio_convolver_config_t config,
+                                          const float *impulse_response,
+                                          int length,
+                                          int num_channels)
+{
+    int block_size = config.block_size;
+    int tail_block_size = config.tail_block_size < block_size ? block_size : config.tail_block_size;
+
+    if (!impulse_response || length <= 0 ||
+        num_channels <= 0 || num_channels > AUDIO_CONVOLVER_MAX_CHANNELS ||
+        !is_power_of_two(block_size) || block_size < CONVOLVER_MIN_BLOCK_SIZE ||
+        !is_power_of_two(tail_block_size) || tail_block_size > AUDIO_CONVOLVER_MAX_BLOCK_SIZE)
+        return NULL;
+
+    audio_convolver_t *convolver = calloc(1, sizeof(audio_convolver_t));
+    if (!convolver) return NULL;
+
+    convolver->block_size = block_size;
+    convolver->tail_block_size = tail_block_size;
+    convolver->blocks_per_tail = tail_block_size / block_size;
+    convolver->num_channels = num_channels;
+    atomic_init(&convolver->tail_ready, 0);
+    atomic_init(&convolver->tail_done, 0);
+    atomic_init(&convolver->quit, 0);
+    atomic_init(&convolver->head_block_time, 0.0);
+    atomic_init(&convolver->tail_block_time, 0.0);
+    atomic_init(&convolver->late_blocks, 0);
+
+    /*------------------------------------------------------------------------*
+     * The head covers two tail blocks: the one being gathered, and the one
+     * the worker is computing.
+     *-----------------------------------------------------------------------*/
+    int head_length = 2 * tail_block_size;
+    if (head_length > length)
+        head_length = length;
+    int tail_length = length - head_length;
+
+    int failed = convolver_stage_init(&convolver->head, block_size, impulse_response, head_length, num_channels);
+
+    for (int c = 0; c < num_channels && !failed; c++)
+    {
+        convolver->head_input[c] = calloc(block_size, sizeof(float));
+        convolver->head_output[c] = calloc(block_size, sizeof(float));
+        failed = !convolver->head_input[c] || !convolver->head_output[c];
+    }
+
+    if (!failed && tail_length > 0)
+    {
+        failed = convolver_stage_init(&convolver->tail, tail_block_size,
+                                      impulse_response + head_length, tail_length, num_channels);
+
+        for (int c = 0; c < num_channels && !failed; c++)
+        {
+            convolver->tail_input[c] = calloc((size_t) CONVOLVER_TAIL_SLOTS * tail_block_size, sizeof(float));
+            convolver->tail_output[c] = calloc((size_t) CONVOLVER_TAIL_SLOTS * tail_block_size, sizeof(float));
+            failed = !convolver->tail_input[c] || !convolver->tail_output[c];
+        }
+
+        if (!failed)
+        {
+            failed = convolver_wake_create(convolver) != 0 ||
+                     pthread_create(&convolver->worker, NULL, convolver_worker, convolver) != 0;
+            convolver->has_worker = !failed;
+        }
+    }
+
+    if (failed)
+    {
+        audio_convolver_destroy(convolver);
+        return NULL;
+    }
+
+    return convolver;
+}
+
+void audio_convolver_destroy(audio_convolver_t *convolver)
+{
+    if (!convolver) return;
+
+    if (convolver->has_worker)
+    {
+        atomic_store_explicit(&convolver->quit, 1, memory_order_relaxed);
+        convolver_wake_signal(convolver);
+        pthread_join(convolver->worker, NULL);
+    }
+    convolver_wake_destroy(convolver);
+
+    convolver_stage_free(&convolver->head);
+    convolver_stage_free(&convolver->tail);
+    for (int c = 0; c < AUDIO_CONVOLVER_MAX_CHANNELS; c++)
+    {
+        free(convolver->head_input[c]);
+        free(convolver->head_output[c]);
+        free(convolver->tail_input[c]);
+        free(convolver->tail_output[c]);
+    }
+    free(convolver);
+}
+
+/*----------------------------------------------------------------------------*
+ * Process the head block just gathered: convolve it with the head, hand it
+ * to the worker as part of the current tail block, and add in the tail's
+ * contribution, computed from input two tail blocks ago.
+ *----------------------------------------------------------------------------*/
+static void convolver_process_block(audio_convolver_t *convolver)
+{
+    double start = convolver_now();
+    int size = convolver->block_size;
+    uint64_t block = convolver->head_blocks++;
+
+    for (int c = 0; c < convolver->num_channels; c++)
+        convolver_stage_process(&convolver->head, c, convolver->head_input[c], convolver->head_output[c]);
+
+    if (convolver->has_worker)
+    {
+        uint64_t per_tail = convolver->blocks_per_tail;
+        size_t tail_size = convolver->tail_block_size;
+
+        size_t slot = (size_t) ((block / per_tail) % CONVOLVER_TAIL_SLOTS) * tail_size;
+        size_t offset = (size_t) (block % per_tail) * size;
+        for (int c = 0; c < convolver->num_channels; c++)
+            memcpy(convolver->tail_input[c] + slot + offset, convolver->head_input[c], size * sizeof(float));
+
+        if (block % per_tail == per_tail - 1)
+        {
+            atomic_store_explicit(&convolver->tail_ready, block / per_tail + 1, memory_order_release);
+            convolver_wake_signal(convolver);
+        }
+
+        if (block >= 2 * per_tail)
+        {
+            uint64_t tail_block = (block - 2 * per_tail) / per_tail;
+            offset = (size_t) ((block - 2 * per_tail) % per_tail) * size;
+
+            /*----------------------------------------------------------------*
+             * Decide once per tail block whether it arrived in time, so that
+             * a late block is dropped whole rather than cut in part way.
+             *---------------------------------------------------------------*/
+            if (offset == 0)
+            {
+                convolver->skipping_tail_block = atomic_load_explicit(&convolver->tail_done, memory_order_acquire) <= tail_block;
+                if (convolver->skipping_tail_block)
+                    atomic_fetch_add_explicit(&convolver->late_blocks, 1, memory_order_relaxed);
+            }
+
+            if (!convolver->skipping_tail_block)
+            {
+                slot = (size_t) (tail_block % CONVOLVER_TAIL_SLOTS) * tail_size;
+                for (int c = 0; c < convolver->num_channels; c++)
+                {
+#ifdef __APPLE__
+                    vDSP_vadd(convolver->head_output[c], 1, convolver->tail_output[c] + slot + offset, 1,
+                              convolver->head_output[c], 1, size);
+#else
+                    const float *tail_output = convolver->tail_output[c] + slot + offset;
+                    for (int i = 0; i < size; i++)
+                        convolver->head_output[c][i] += tail_output[i];
+#endif
+                }
+            }
+        }
+    }
+
+    convolver_update_time(&convolver->head_block_time, convolver_now() - start);
+}
+
+void audio_convolver_process(audio_convolver_t *convolver,
+                             float **channels,
+                             int num_channels,
+                             int num_frames)
+{
+    if (num_channels > convolver->num_channels)
+        num_channels = convolver->num_channels;
+
+    int done = 0;
+    while (done < num_frames)
+    {
+        int fill = convolver->fill;
+        int length = convolver->block_size - fill;
+        if (length > num_frames - done)
+            length = num_frames - done;
+
+        /*--------------------------------------------------------------------*
+         * Output lags input by one block: take in this block's input, and
+         * give out the previous block's output in its place.
+         *-------------------------------------------------------------------*/
+        for (int c = 0; c < convolver->num_channels; c++)
+        {
+            if (c < num_channels)
+            {
+                memcpy(convolver->head_input[c] + fill, channels[c] + done, length * sizeof(float));
+                memcpy(channels[c] + done, convolver->head_output[c] + fill, length * sizeof(float));
+            }
+            else
+            {
+                memset(convolver->head_input[c] + fill, 0, length * sizeof(float));
+            }
+        }
+
+        convolver->fill += length;
+        done += length;
+
+        if (convolver->fill == convolver->block_size)
+        {
+            convolver_process_block(convolver);
+            convolver->fill = 0;
+        }
+    }
+}
+
+int audio_convolver_latency(audio_convolver_t *convolver)
+{
+    return convolver->block_size;
+}
+
+int audio_convolver_head_partitions(audio_convolver_t *convolver)
+{
+    return convolver->head.num_partitions;
+}
+
+int audio_convolver_tail_partitions(audio_convolver_t *convolver)
+{
+    return convolver->tail.num_partitions;
+}
+
+audio_convolver_stats_t audio_convolver_stats(audio_convolver_t *convolver)
+{
+    audio_convolver_stats_t stats;
+    stats.head_block_time = atomic_load_explicit(&convolver->head_block_time, memory_order_relaxed);
+    stats.tail_block_time = atomic_load_explicit(&convolver->tail_block_time, memory_order_relaxed);
+    stats.late_blocks = atomic_load_explicit(&convolver->late_blocks, memory_order_relaxed);
+    return stats;
+}
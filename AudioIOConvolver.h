@@ -0,0 +1,135 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOConvolver
+ *
+ *  Low-latency convolution with long impulse responses (reverbs, room
+ *  correction), using non-uniformly partitioned FFT convolution in two
+ *  stages:
+ *
+ *   - the head of the impulse response, up to twice the tail block size,
+ *     is split into partitions of `block_size` frames and convolved on
+ *     the audio thread, one block at a time;
+ *
+ *   - the rest (the tail) is split into partitions of `tail_block_size`
+ *     frames and convolved on a background worker thread, which has one
+ *     tail block's worth of time to deliver each result before it is
+ *     needed.
+ *
+ *  The output lags the input by one block, `block_size` frames, whatever
+ *  the length of the impulse response and however many frames each call
+ *  processes. That is on top of the I/O buffer's own latency: with
+ *  `block_size` equal to the buffer size, the convolver adds one more
+ *  buffer's worth.
+ *
+ *  If the worker falls behind, the late part of the tail is dropped
+ *  (and counted) rather than stalling the audio thread.
+ *
+ *  Example usage:
+ *
+ *  audio_convolver_t *reverb = audio_convolver_create(audio_convolver_config_default(), ir, ir_length, 2);
+ *  ...
+ *  audio_convolver_process(reverb, data, num_channels, num_frames);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_CONVOLVER_H
+#define AUDIO_IO_CONVOLVER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Largest channel count, and largest partition size (frames).
+ *----------------------------------------------------------------------------*/
+#define AUDIO_CONVOLVER_MAX_CHANNELS 8
+#define AUDIO_CONVOLVER_MAX_BLOCK_SIZE 32768
+
+typedef struct
+{
+    /*------------------------------------------------------------------------*
+     * Partition size of the head, processed on the audio thread, which is
+     * also the latency (frames). A power of two.
+     *-----------------------------------------------------------------------*/
+    int     block_size;
+
+    /*------------------------------------------------------------------------*
+     * Partition size of the tail, processed by the worker (frames). A
+     * power of two; rounded up to at least `block_size`. Larger sizes cut
+     * the worker's cost, but move more of the impulse response onto the
+     * audio thread.
+     *-----------------------------------------------------------------------*/
+    int     tail_block_size;
+} audio_convolver_config_t;
+
+/**-----------------------------------------------------------------------------
+ * CPU cost, as exponential moving averages of the time taken to process
+ * one head block (on the audio thread) and one tail block (on the worker),
+ * in seconds; and the number of tail blocks that were not ready in time.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    double      head_block_time;
+    double      tail_block_time;
+    uint64_t    late_blocks;
+} audio_convolver_stats_t;
+
+typedef struct audio_convolver audio_convolver_t;
+
+/**-----------------------------------------------------------------------------
+ * Returns the default configuration: 256-frame head blocks and
+ * 2048-frame tail blocks.
+ *----------------------------------------------------------------------------*/
+audio_convolver_config_t audio_convolver_config_default(void);
+
+/**-----------------------------------------------------------------------------
+ * Create a new convolver, and start its worker if the impulse response
+ * has a tail. Each channel is convolved with the same impulse response.
+ *
+ * @param impulse_response  Impulse response samples, which are copied.
+ *
+ * @returns The convolver, or NULL if the configuration is invalid or
+ *          memory could not be allocated.
+ *----------------------------------------------------------------------------*/
+audio_convolver_t *audio_convolver_create(audio_convolver_config_t config,
+                                          const float *impulse_response,
+                                          int length,
+                                          int num_channels);
+
+/**-----------------------------------------------------------------------------
+ * Stop the worker and free a convolver. Audio must no longer be using it.
+ *----------------------------------------------------------------------------*/
+void audio_convolver_destroy(audio_convolver_t *convolver);
+
+/**-----------------------------------------------------------------------------
+ * Convolve a block of audio, in place. Realtime-safe.
+ * Channels beyond the convolver's channel count are left untouched.
+ *----------------------------------------------------------------------------*/
+void audio_convolver_process(audio_convolver_t *convolver,
+                             float **channels,
+                             int num_channels,
+                             int num_frames);
+
+/**-----------------------------------------------------------------------------
+ * Returns the delay between input and output, in frames.
+ *----------------------------------------------------------------------------*/
+int audio_convolver_latency(audio_convolver_t *convolver);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of head and tail partitions.
+ *----------------------------------------------------------------------------*/
+int audio_convolver_head_partitions(audio_convolver_t *convolver);
+int audio_convolver_tail_partitions(audio_convolver_t *convolver);
+
+/**-----------------------------------------------------------------------------
+ * Returns CPU cost and lateness statistics. May be called from any thread.
+ *----------------------------------------------------------------------------*/
+audio_convolver_stats_t audio_convolver_stats(audio_convolver_t *convolver);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
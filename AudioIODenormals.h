@@ -0,0 +1,106 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIODenormals
+ *
+ *  Helpers to protect audio processing against denormal (subnormal)
+ *  floating-point values. Recursive filters and reverb tails decay into
+ *  denormals on quiet input, which many CPUs process an order of magnitude
+ *  more slowly than normal values.
+ *
+ *  Two strategies are provided:
+ *
+ *   - Flush-to-zero: set the CPU's floating-point control register so
+ *     denormals are treated as zero (FPCR/FPSCR on ARM, MXCSR FTZ and DAZ
+ *     on x86). This is what the render callback does by default.
+ *
+ *   - Offset injection: add an inaudibly small offset to the signal so
+ *     that recursive state never decays to the denormal range. For code
+ *     which must run with flush-to-zero disabled. The offset's sign
+ *     alternates from block to block: a constant offset is DC, which any
+ *     DC blocker or high-pass filter in the chain removes, leaving the
+ *     state after it to decay into denormals regardless.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_DENORMALS_H
+#define AUDIO_IO_DENORMALS_H
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+/*----------------------------------------------------------------------------*
+ * An offset well below the smallest audible level (around -360dB), but
+ * far above the denormal range.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_ANTI_DENORMAL_OFFSET 1e-18f
+
+typedef uint64_t audio_fp_state_t;
+
+/**-----------------------------------------------------------------------------
+ * Enable flush-to-zero on the current thread.
+ *
+ * @return The previous floating-point state, to pass to
+ *         audio_denormals_flush_end().
+ *----------------------------------------------------------------------------*/
+static inline audio_fp_state_t audio_denormals_flush_begin(void)
+{
+    audio_fp_state_t state = 0;
+
+#if defined(__arm64__) || defined(__aarch64__)
+    /*------------------------------------------------------------------------*
+     * FPCR bit 24 (FZ) flushes denormal inputs and outputs to zero.
+     *-----------------------------------------------------------------------*/
+    __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (state));
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (state | (1ULL << 24)));
+#elif defined(__arm__) && defined(__VFP_FP__) && !defined(__SOFTFP__)
+    uint32_t fpscr;
+    __asm__ __volatile__ ("vmrs %0, fpscr" : "=r" (fpscr));
+    __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" (fpscr | (1U << 24)));
+    state = fpscr;
+#elif defined(__x86_64__) || defined(__i386__)
+    /*------------------------------------------------------------------------*
+     * MXCSR bit 15 (FTZ) flushes denormal outputs, bit 6 (DAZ) denormal
+     * inputs.
+     *-----------------------------------------------------------------------*/
+    unsigned int csr = _mm_getcsr();
+    _mm_setcsr(csr | 0x8040);
+    state = csr;
+#endif
+
+    return state;
+}
+
+/**-----------------------------------------------------------------------------
+ * Restore the floating-point state saved by audio_denormals_flush_begin().
+ *----------------------------------------------------------------------------*/
+static inline void audio_denormals_flush_end(audio_fp_state_t state)
+{
+#if defined(__arm64__) || defined(__aarch64__)
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (state));
+#elif defined(__arm__) && defined(__VFP_FP__) && !defined(__SOFTFP__)
+    uint32_t fpscr = (uint32_t) state;
+    __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" (fpscr));
+#elif defined(__x86_64__) || defined(__i386__)
+    _mm_setcsr((unsigned int) state);
+#else
+    (void) state;
+#endif
+}
+
+/**-----------------------------------------------------------------------------
+ * Add AUDIO_ANTI_DENORMAL_OFFSET to every sample of a buffer, negated on
+ * odd blocks. Pass a count that advances once per block, so that the
+ * offset forms a square wave at half the block rate, which survives DC
+ * blockers.
+ *----------------------------------------------------------------------------*/
+static inline void audio_denormals_inject_offset(float *samples, int num_frames, unsigned int block)
+{
+    float offset = (block & 1) ? -AUDIO_ANTI_DENORMAL_OFFSET : AUDIO_ANTI_DENORMAL_OFFSET;
+    for (int i = 0; i < num_frames; i++)
+        samples[i] += offset;
+}
+
+#endif
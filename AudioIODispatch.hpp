@@ -0,0 +1,212 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIODispatch
+ *
+ *  Render dispatch to processors specialised, at compile time, for their
+ *  channel count and block size (C++ only).
+ *
+ *  A processor declares the channel counts and block sizes it is
+ *  specialised for, and implements a templated process() for them, plus
+ *  a generic one for everything else. With the shape known at compile
+ *  time, inner loops have constant trip counts and can be fully unrolled
+ *  and vectorised.
+ *
+ *  The dispatcher builds a table of the specialised instantiations, one
+ *  per (channels, frames) pair, and selects one when the block shape is
+ *  first seen or changes; blocks of the same shape then go straight to
+ *  it. Blocks of any other shape (eg, after a sample rate conversion)
+ *  fall back to the generic process().
+ *
+ *  Example usage:
+ *
+ *  struct Gain
+ *  {
+ *      using channel_counts = audio_io::sizes<1, 2>;
+ *      using block_sizes = audio_io::sizes<64, 128, 256, 512>;
+ *
+ *      float gain = 0.5f;
+ *
+ *      template <int Channels, int Frames>
+ *      void process(float **data, int samplerate)
+ *      {
+ *          const float g = gain;
+ *          for (int c = 0; c < Channels; c++)
+ *          {
+ *              float *samples = data[c];
+ *              for (int i = 0; i < Frames; i++)
+ *                  samples[i] *= g;
+ *          }
+ *      }
+ *
+ *      void process(float **data, int num_channels, int num_frames, int samplerate)
+ *      {
+ *          const float g = gain;
+ *          for (int c = 0; c < num_channels; c++)
+ *          {
+ *              float *samples = data[c];
+ *              for (int i = 0; i < num_frames; i++)
+ *                  samples[i] *= g;
+ *          }
+ *      }
+ *  };
+ *
+ *  Copy members and channel pointers into locals, as here: otherwise a
+ *  store to data[c][i] might change them, and the loops can't vectorise.
+ *
+ *  static Gain gain;
+ *  static audio_io::render_dispatcher<Gain> dispatcher(gain);
+ *
+ *  dispatcher.prepare(1, AUDIO_BUFFER_SIZE);
+ *  AudioIOManager *manager = [[AudioIOManager alloc] initWithCallback:dispatcher.callback
+ *                                                             context:&dispatcher];
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_DISPATCH_HPP
+#define AUDIO_IO_DISPATCH_HPP
+
+#include <array>
+#include <cstddef>
+
+namespace audio_io
+{
+
+/**-----------------------------------------------------------------------------
+ * A list of channel counts or block sizes.
+ *----------------------------------------------------------------------------*/
+template <int... Values>
+struct sizes
+{
+    static constexpr std::size_t count = sizeof...(Values);
+};
+
+template <class Processor>
+class render_dispatcher
+{
+public:
+    using channel_counts = typename Processor::channel_counts;
+    using block_sizes = typename Processor::block_sizes;
+
+    /**-------------------------------------------------------------------------
+     * Create a dispatcher for a processor, which must outlive it.
+     *------------------------------------------------------------------------*/
+    explicit render_dispatcher(Processor &processor)
+        : processor_(processor)
+    {
+        std::size_t index = 0;
+        fill_table(index, channel_counts());
+        select(0, 0);
+    }
+
+    /**-------------------------------------------------------------------------
+     * Select the instantiation for a block shape ahead of time, so that the
+     * first callback does not have to. Call before audio starts.
+     *------------------------------------------------------------------------*/
+    void prepare(int num_channels, int num_frames)
+    {
+        select(num_channels, num_frames);
+    }
+
+    /**-------------------------------------------------------------------------
+     * Process a block, through the specialised instantiation for its shape
+     * if there is one. Realtime-safe.
+     *------------------------------------------------------------------------*/
+    void operator()(float **data, int num_channels, int num_frames, int samplerate)
+    {
+        if (num_channels != channels_ || num_frames != frames_)
+            select(num_channels, num_frames);
+
+        render_(processor_, data, num_channels, num_frames, samplerate);
+    }
+
+    /**-------------------------------------------------------------------------
+     * An audio_context_callback_t, to be passed a pointer to the dispatcher.
+     *------------------------------------------------------------------------*/
+    static void callback(void *context, float **data, int num_channels, int num_frames, int samplerate)
+    {
+        (*static_cast<render_dispatcher *>(context))(data, num_channels, num_frames, samplerate);
+    }
+
+    /**-------------------------------------------------------------------------
+     * Returns true if the most recent block shape has a specialised
+     * instantiation.
+     *------------------------------------------------------------------------*/
+    bool is_specialized() const
+    {
+        return render_ != &render_generic;
+    }
+
+private:
+    using render_function = void (*)(Processor &, float **, int, int, int);
+
+    struct entry
+    {
+        int             channels;
+        int             frames;
+        render_function render;
+    };
+
+    template <int Channels, int Frames>
+    static void render_specialized(Processor &processor, float **data, int, int, int samplerate)
+    {
+        processor.template process<Channels, Frames>(data, samplerate);
+    }
+
+    static void render_generic(Processor &processor, float **data, int num_channels, int num_frames, int samplerate)
+    {
+        processor.process(data, num_channels, num_frames, samplerate);
+    }
+
+    /*------------------------------------------------------------------------*
+     * Fill the table with one entry per (channels, frames) pair: a row of
+     * block sizes for each channel count.
+     *-----------------------------------------------------------------------*/
+    template <int... Channels>
+    void fill_table(std::size_t &index, sizes<Channels...>)
+    {
+        int expand[] = { 0, (fill_row<Channels>(index, block_sizes()), 0)... };
+        (void) expand;
+    }
+
+    template <int Channels, int... Frames>
+    void fill_row(std::size_t &index, sizes<Frames...>)
+    {
+        int expand[] = { 0, (table_[index++] = entry { Channels, Frames, &render_specialized<Channels, Frames> }, 0)... };
+        (void) expand;
+    }
+
+    /*------------------------------------------------------------------------*
+     * Look up a block shape. The table is small enough that a linear scan
+     * beats anything cleverer.
+     *-----------------------------------------------------------------------*/
+    void select(int num_channels, int num_frames)
+    {
+        channels_ = num_channels;
+        frames_ = num_frames;
+        render_ = &render_generic;
+
+        for (const entry &candidate : table_)
+        {
+            if (candidate.channels == num_channels && candidate.frames == num_frames)
+            {
+                render_ = candidate.render;
+                break;
+            }
+        }
+    }
+
+    Processor &processor_;
+    std::array<entry, channel_counts::count * block_sizes::count> table_;
+
+    /*------------------------------------------------------------------------*
+     * The current block shape and its instantiation. Written by prepare()
+     * before audio starts, and thereafter only on the audio thread.
+     *-----------------------------------------------------------------------*/
+    int             channels_;
+    int             frames_;
+    render_function render_;
+};
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOErrorCounter
+ *
+ *  Per-code error counts, written by one thread and read by any.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOErrorCounter.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+typedef struct
+{
+    atomic_int_least32_t    code;
+    atomic_uint_least64_t   count;
+    atomic_uint_least64_t   first_time;
+    atomic_uint_least64_t   last_time;
+} error_entry_t;
+
+struct audio_error_counter
+{
+    /*------------------------------------------------------------------------*
+     * Entries in use. An entry is filled in before `num_codes` is raised
+     * to include it, so readers never see a partly claimed entry.
+     *-----------------------------------------------------------------------*/
+    atomic_int              num_codes;
+    error_entry_t           entries[AUDIO_ERROR_COUNTER_MAX_CODES];
+
+    atomic_uint_least64_t   total;
+    atomic_uint_least64_t   consecutive;
+
+    /*------------------------------------------------------------------------*
+     * The entry last recorded to, which a persistent failure will most
+     * likely hit again. Only touched by the recording thread.
+     *-----------------------------------------------------------------------*/
+    int                     last_entry;
+};
+
+audio_error_counter_t *audio_error_counter_create(void)
+{
+    audio_error_counter_t *counter = calloc(1, sizeof(audio_error_counter_t));
+    if (!counter) return NULL;
+
+    atomic_init(&counter->num_codes, 0);
+    for (int i = 0; i < AUDIO_ERROR_COUNTER_MAX_CODES; i++)
+    {
+        atomic_init(&counter->entries[i].code, 0);
+        atomic_init(&counter->entries[i].count, 0);
+        atomic_init(&counter->entries[i].first_time, 0);
+        atomic_init(&counter->entries[i].last_time, 0);
+    }
+    atomic_init(&counter->total, 0);
+    atomic_init(&counter->consecutive, 0);
+
+    return counter;
+}
+
+void audio_error_counter_destroy(audio_error_counter_t *counter)
+{
+    free(counter);
+}
+
+/*----------------------------------------------------------------------------*
+ * Find the entry for a code, claiming a new one if it hasn't occurred
+ * before. Returns NULL if every entry is taken.
+ *----------------------------------------------------------------------------*/
+static error_entry_t *error_counter_entry(audio_error_counter_t *counter, int32_t code, uint64_t time)
+{
+    int num_codes = atomic_load_explicit(&counter->num_codes, memory_order_relaxed);
+
+    if (counter->last_entry < num_codes &&
+        atomic_load_explicit(&counter->entries[counter->last_entry].code, memory_order_relaxed) == code)
+        return &counter->entries[counter->last_entry];
+
+    for (int i = 0; i < num_codes; i++)
+    {
+        if (atomic_load_explicit(&counter->entries[i].code, memory_order_relaxed) == code)
+        {
+            counter->last_entry = i;
+            return &counter->entries[i];
+        }
+    }
+
+    if (num_codes == AUDIO_ERROR_COUNTER_MAX_CODES)
+        return NULL;
+
+    error_entry_t *entry = &counter->entries[num_codes];
+    atomic_store_explicit(&entry->code, code, memory_order_relaxed);
+    atomic_store_explicit(&entry->first_time, time, memory_order_relaxed);
+    atomic_store_explicit(&entry->last_time, time, memory_order_relaxed);
+    atomic_store_explicit(&counter->num_codes, num_codes + 1, memory_order_release);
+
+    counter->last_entry = num_codes;
+    return entry;
+}
+
+void audio_error_counter_record(audio_error_counter_t *counter, int32_t code, uint64_t time)
+{
+    if (code == 0)
+    {
+        if (atomic_load_explicit(&counter->consecutive, memory_order_relaxed))
+            atomic_store_explicit(&counter->consecutive, 0, memory_order_relaxed);
+        return;
+    }
+
+    /*------------------------------------------------------------------------*
+     * There is only one writer, so plain increments suffice.
+     *-----------------------------------------------------------------------*/
+    uint64_t total = atomic_load_explicit(&counter->total, memory_order_relaxed);
+    atomic_store_explicit(&counter->total, total + 1, memory_order_relaxed);
+    uint64_t consecutive = atomic_load_explicit(&counter->consecutive, memory_order_relaxed);
+    atomic_store_explicit(&counter->consecutive, consecutive + 1, memory_order_relaxed);
+
+    error_entry_t *entry = error_counter_entry(counter, code, time);
+    if (!entry) return;
+
+    uint64_t count = atomic_load_explicit(&entry->count, memory_order_relaxed);
+    atomic_store_explicit(&entry->last_time, time, memory_order_relaxed);
+    atomic_store_explicit(&entry->count, count + 1, memory_order_release);
+}
+
+int audio_error_counter_read(audio_error_counter_t *counter, audio_error_count_t *counts, int max_counts)
+{
+    int num_codes = atomic_load_explicit(&counter->num_codes, memory_order_acquire);
+    if (num_codes > max_counts)
+        num_codes = max_counts;
+
+    for (int i = 0; i < num_codes; i++)
+    {
+        error_entry_t *entry = &counter->entries[i];
+        counts[i].count = atomic_load_explicit(&entry->count, memory_order_acquire);
+        counts[i].code = atomic_load_explicit(&entry->code, memory_order_relaxed);
+        counts[i].first_time = atomic_load_explicit(&entry->first_time, memory_order_relaxed);
+        counts[i].last_time = atomic_load_explicit(&entry->last_time, memory_order_relaxed);
+    }
+
+    return num_codes > 0 ? num_codes : 0;
+}
+
+uint64_t audio_error_counter_total(audio_error_counter_t *counter)
+{
+    return atomic_load_explicit(&counter->total, memory_order_relaxed);
+}
+
+uint64_t audio_error_counter_consecutive(audio_error_counter_t *counter)
+{
+    return atomic_load_explicit(&counter->consecutive, memory_order_relaxed);
+}
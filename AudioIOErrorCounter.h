@@ -0,0 +1,100 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOErrorCounter
+ *
+ *  Counts the error codes returned by a realtime operation, such as
+ *  pulling input with AudioUnitRender(), so that failures which would
+ *  otherwise pass unnoticed can be monitored.
+ *
+ *  For each distinct code, the counter keeps the number of occurrences
+ *  and the times of the first and last of them. It also keeps the total
+ *  number of failures, and the length of the current run of consecutive
+ *  failures, which shows whether a failure is persistent.
+ *
+ *  One thread records the result of every attempt; any other thread may
+ *  read the counts at any time. Neither side ever blocks.
+ *
+ *  Example usage:
+ *
+ *  audio_error_count_t counts[AUDIO_ERROR_COUNTER_MAX_CODES];
+ *  int n = audio_error_counter_read(counter, counts, AUDIO_ERROR_COUNTER_MAX_CODES);
+ *  for (int i = 0; i < n; i++)
+ *      printf("error %d: %llu times\n", counts[i].code, counts[i].count);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_ERROR_COUNTER_H
+#define AUDIO_IO_ERROR_COUNTER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Maximum number of distinct codes counted individually. Further codes
+ * are counted in the total only.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_ERROR_COUNTER_MAX_CODES 16
+
+/**-----------------------------------------------------------------------------
+ * Occurrences of one error code. Times are as passed to
+ * audio_error_counter_record().
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    int32_t     code;
+    uint64_t    count;
+    uint64_t    first_time;
+    uint64_t    last_time;
+} audio_error_count_t;
+
+typedef struct audio_error_counter audio_error_counter_t;
+
+/**-----------------------------------------------------------------------------
+ * Create a new error counter.
+ *----------------------------------------------------------------------------*/
+audio_error_counter_t *audio_error_counter_create(void);
+
+/**-----------------------------------------------------------------------------
+ * Free an error counter.
+ *----------------------------------------------------------------------------*/
+void audio_error_counter_destroy(audio_error_counter_t *counter);
+
+/**-----------------------------------------------------------------------------
+ * Record the result of one attempt: a nonzero error code, or zero for
+ * success, which ends any run of consecutive failures. Realtime-safe.
+ * Must only be called from one thread.
+ *
+ * @param time  When the attempt was made, in any units, typically
+ *              mach_absolute_time().
+ *----------------------------------------------------------------------------*/
+void audio_error_counter_record(audio_error_counter_t *counter, int32_t code, uint64_t time);
+
+/**-----------------------------------------------------------------------------
+ * Read the counts of up to `max_counts` codes, in the order each code
+ * first occurred. May be called from any thread. A code's count and
+ * times may be read while they are being updated, and be one occurrence
+ * apart.
+ *
+ * @return The number of codes read.
+ *----------------------------------------------------------------------------*/
+int audio_error_counter_read(audio_error_counter_t *counter, audio_error_count_t *counts, int max_counts);
+
+/**-----------------------------------------------------------------------------
+ * Returns the total number of failures since creation.
+ *----------------------------------------------------------------------------*/
+uint64_t audio_error_counter_total(audio_error_counter_t *counter);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of consecutive failures up to the latest attempt,
+ * or 0 if it succeeded.
+ *----------------------------------------------------------------------------*/
+uint64_t audio_error_counter_consecutive(audio_error_counter_t *counter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,114 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOEventQueue
+ *
+ *  Collects session events (volume changes, route changes, interruptions)
+ *  from whichever thread posts them, and delivers them in batches on a
+ *  chosen dispatch queue.
+ *
+ *  Each event carries the host time at which it was posted and, if audio
+ *  was running, the corresponding position on the audio sample clock, so
+ *  that it can be lined up against the audio stream.
+ *
+ *  An event of the same kind as the event immediately before it in the
+ *  pending batch replaces it rather than being appended, so a flood of
+ *  volume changes while the user holds a volume button is delivered as a
+ *  single event carrying the final volume.
+ *
+ *  Example usage:
+ *
+ *  AudioIOEventQueue *events = [[AudioIOEventQueue alloc] initWithQueue:dispatch_get_main_queue()
+ *                                                               handler:^(NSArray<AudioIOEvent *> *batch) {
+ *      for (AudioIOEvent *event in batch)
+ *          NSLog(@"%@", event);
+ *  }];
+ *  [events postEvent:[AudioIOEvent volumeChangeEvent:0.5 sampleTime:-1]];
+ *
+ *----------------------------------------------------------------------------*/
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(NSInteger, AudioIOEventType)
+{
+    AudioIOEventTypeVolumeChange,
+    AudioIOEventTypeRouteChange,
+    AudioIOEventTypeInterruptionBegan,
+    AudioIOEventTypeInterruptionEnded,
+    AudioIOEventTypeMediaServicesReset
+};
+
+@interface AudioIOEvent : NSObject
+
+/**-----------------------------------------------------------------------------
+ * Create an event, timestamped now.
+ *
+ * @param sampleTime The position of the audio sample clock now, or a
+ *                   negative value if not known.
+ *----------------------------------------------------------------------------*/
++ (instancetype) eventWithType:(AudioIOEventType)type sampleTime:(double)sampleTime;
++ (instancetype) volumeChangeEvent:(float)volume sampleTime:(double)sampleTime;
++ (instancetype) routeChangeEvent:(NSUInteger)reason sampleTime:(double)sampleTime;
+
+@property (readonly) AudioIOEventType type;
+
+/**-----------------------------------------------------------------------------
+ * When the event was posted, in mach_absolute_time() units. For coalesced
+ * events, when the most recent of them was posted.
+ *----------------------------------------------------------------------------*/
+@property (readonly) uint64_t hostTime;
+
+/**-----------------------------------------------------------------------------
+ * Position of the audio sample clock when the event was posted, in frames
+ * at the audio callback's sample rate, or -1 if audio was not running.
+ *----------------------------------------------------------------------------*/
+@property (readonly) double sampleTime;
+
+/**-----------------------------------------------------------------------------
+ * The new output volume, for volume changes.
+ *----------------------------------------------------------------------------*/
+@property (readonly) float volume;
+
+/**-----------------------------------------------------------------------------
+ * The AVAudioSessionRouteChangeReason, for route changes.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSUInteger routeChangeReason;
+
+/**-----------------------------------------------------------------------------
+ * Number of posted events this event stands for: greater than one if
+ * redundant events were coalesced into it.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSUInteger count;
+
+@end
+
+
+@interface AudioIOEventQueue : NSObject
+
+/**-----------------------------------------------------------------------------
+ * Create a new event queue.
+ *
+ * @param queue     The dispatch queue on which to call the handler.
+ * @param handler   Called with each batch of events, oldest first.
+ *----------------------------------------------------------------------------*/
+- (id) initWithQueue:(dispatch_queue_t)queue handler:(void (^)(NSArray<AudioIOEvent *> *events))handler;
+
+/**-----------------------------------------------------------------------------
+ * Queue an event for delivery. May be called from any thread, but not
+ * from the audio thread.
+ *----------------------------------------------------------------------------*/
+- (void) postEvent:(AudioIOEvent *)event;
+
+/**-----------------------------------------------------------------------------
+ * Longest time an event waits before its batch is delivered.
+ * Defaults to 0.05s.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSTimeInterval batchInterval;
+
+/**-----------------------------------------------------------------------------
+ * Number of events posted, and number of events delivered after
+ * coalescing.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSUInteger eventsPosted;
+@property (readonly) NSUInteger eventsDelivered;
+
+@end
@@ -0,0 +1,149 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOEventQueue
+ *
+ *  Batched, coalescing delivery of session events.
+ *
+ *----------------------------------------------------------------------------*/
+
+#import "AudioIOEventQueue.h"
+#import <mach/mach_time.h>
+
+/*----------------------------------------------------------------------------*
+ * Default batch interval (seconds).
+ *----------------------------------------------------------------------------*/
+#define AUDIO_EVENT_BATCH_INTERVAL 0.05
+
+@interface AudioIOEvent ()
+@property (readwrite) AudioIOEventType type;
+@property (readwrite) uint64_t hostTime;
+@property (readwrite) double sampleTime;
+@property (readwrite) float volume;
+@property (readwrite) NSUInteger routeChangeReason;
+@property (readwrite) NSUInteger count;
+@end
+
+@implementation AudioIOEvent
+
++ (instancetype)eventWithType:(AudioIOEventType)type sampleTime:(double)sampleTime
+{
+    AudioIOEvent *event = [self new];
+    event.type = type;
+    event.hostTime = mach_absolute_time();
+    event.sampleTime = (sampleTime < 0) ? -1 : sampleTime;
+    event.count = 1;
+    return event;
+}
+
++ (instancetype)volumeChangeEvent:(float)volume sampleTime:(double)sampleTime
+{
+    AudioIOEvent *event = [self eventWithType:AudioIOEventTypeVolumeChange sampleTime:sampleTime];
+    event.volume = volume;
+    return event;
+}
+
++ (instancetype)routeChangeEvent:(NSUInteger)reason sampleTime:(double)sampleTime
+{
+    AudioIOEvent *event = [self eventWithType:AudioIOEventTypeRouteChange sampleTime:sampleTime];
+    event.routeChangeReason = reason;
+    return event;
+}
+
+/*----------------------------------------------------------------------------*
+ * Returns YES if `event` makes this event redundant.
+ *----------------------------------------------------------------------------*/
+- (BOOL)isSupersededBy:(AudioIOEvent *)event
+{
+    return event.type == self.type && event.routeChangeReason == self.routeChangeReason;
+}
+
+- (NSString *)description
+{
+    static NSString *names[] = { @"volume change", @"route change", @"interruption began",
+                                 @"interruption ended", @"media services reset" };
+    return [NSString stringWithFormat:@"<AudioIOEvent: %@ at sample %.0f (x%lu)>",
+            names[self.type], self.sampleTime, (unsigned long) self.count];
+}
+
+@end
+
+
+@interface AudioIOEventQueue ()
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, copy) void (^handler)(NSArray<AudioIOEvent *> *events);
+@property (nonatomic, strong) NSMutableArray<AudioIOEvent *> *pending;
+@property (nonatomic, assign) BOOL deliveryScheduled;
+@property (readwrite) NSUInteger eventsPosted;
+@property (readwrite) NSUInteger eventsDelivered;
+@end
+
+@implementation AudioIOEventQueue
+
+- (id)initWithQueue:(dispatch_queue_t)queue handler:(void (^)(NSArray<AudioIOEvent *> *events))handler
+{
+    self = [super init];
+    if (!self) return nil;
+
+    self.queue = queue;
+    self.handler = handler;
+    self.pending = [NSMutableArray array];
+    self.batchInterval = AUDIO_EVENT_BATCH_INTERVAL;
+
+    return self;
+}
+
+- (void)postEvent:(AudioIOEvent *)event
+{
+    @synchronized (self)
+    {
+        self.eventsPosted++;
+
+        /*---------------------------------------------------------------------*
+         * Coalesce with the previous pending event only, so that events of
+         * different kinds stay in the order they happened.
+         *--------------------------------------------------------------------*/
+        AudioIOEvent *last = self.pending.lastObject;
+        if (last && [last isSupersededBy:event])
+        {
+            event.count += last.count;
+            [self.pending replaceObjectAtIndex:self.pending.count - 1 withObject:event];
+        }
+        else
+        {
+            [self.pending addObject:event];
+        }
+
+        /*---------------------------------------------------------------------*
+         * The first event of a batch schedules its delivery; later events
+         * ride along, so no event waits longer than batchInterval.
+         *--------------------------------------------------------------------*/
+        if (!self.deliveryScheduled)
+        {
+            self.deliveryScheduled = YES;
+            __weak AudioIOEventQueue *weakSelf = self;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t) (self.batchInterval * NSEC_PER_SEC)), self.queue, ^{
+                [weakSelf deliver];
+            });
+        }
+    }
+}
+
+- (void)deliver
+{
+    NSArray<AudioIOEvent *> *events;
+
+    @synchronized (self)
+    {
+        events = self.pending;
+        self.pending = [NSMutableArray array];
+        self.deliveryScheduled = NO;
+        self.eventsDelivered += events.count;
+    }
+
+    if (events.count && self.handler)
+    {
+        self.handler(events);
+    }
+}
+
+@end
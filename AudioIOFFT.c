@@ -0,0 +1,279 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOFFT
+ *
+ *  Packed real FFTs, with vDSP or a portable fallback.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOFFT.h"
+
+#ifdef __APPLE__
+#include <Accelerate/Accelerate.h>
+#endif
+#include <stdlib.h>
+#include <math.h>
+
+struct audio_fft
+{
+    int             size;
+
+#ifdef __APPLE__
+    vDSP_Length     log2n;
+    FFTSetup        setup;
+#else
+    /*------------------------------------------------------------------------*
+     * A real FFT of `size` runs as a complex FFT of half the size, over the
+     * even samples as real parts and the odd samples as imaginary parts,
+     * and is then untangled.
+     *
+     * `bit_reversed` gives each complex element's position after the
+     * radix-2 reordering. The twiddles for the pass that combines
+     * transforms of length n into transforms of length 2n are stored
+     * contiguously from index n - 1, so that each pass reads them in
+     * order. `untangle` holds e^(-2 pi i k / size) for k up to size / 4.
+     *-----------------------------------------------------------------------*/
+    int            *bit_reversed;
+    float          *twiddle_cos;
+    float          *twiddle_sin;
+    float          *untangle_cos;
+    float          *untangle_sin;
+#endif
+};
+
+audio_fft_t *audio_fft_create(int size)
+{
+    if (size < 4 || (size & (size - 1)))
+        return NULL;
+
+    audio_fft_t *fft = calloc(1, sizeof(audio_fft_t));
+    if (!fft) return NULL;
+
+    fft->size = size;
+
+#ifdef __APPLE__
+    while ((1 << fft->log2n) < size)
+        fft->log2n++;
+
+    fft->setup = vDSP_create_fftsetup(fft->log2n, kFFTRadix2);
+    if (!fft->setup)
+    {
+        audio_fft_destroy(fft);
+        return NULL;
+    }
+#else
+    int half_size = size / 2;
+
+    fft->bit_reversed = calloc(half_size, sizeof(int));
+    fft->twiddle_cos = calloc(half_size, sizeof(float));
+    fft->twiddle_sin = calloc(half_size, sizeof(float));
+    fft->untangle_cos = calloc(half_size / 2 + 1, sizeof(float));
+    fft->untangle_sin = calloc(half_size / 2 + 1, sizeof(float));
+
+    if (!fft->bit_reversed || !fft->twiddle_cos || !fft->twiddle_sin ||
+        !fft->untangle_cos || !fft->untangle_sin)
+    {
+        audio_fft_destroy(fft);
+        return NULL;
+    }
+
+    int bits = 0;
+    while ((1 << bits) < half_size)
+        bits++;
+    for (int i = 0; i < half_size; i++)
+    {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++)
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        fft->bit_reversed[i] = reversed;
+    }
+
+    for (int n = 1; n < half_size; n *= 2)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            double angle = -M_PI * j / n;
+            fft->twiddle_cos[n - 1 + j] = (float) cos(angle);
+            fft->twiddle_sin[n - 1 + j] = (float) sin(angle);
+        }
+    }
+
+    for (int k = 0; k <= half_size / 2; k++)
+    {
+        double angle = -2.0 * M_PI * k / size;
+        fft->untangle_cos[k] = (float) cos(angle);
+        fft->untangle_sin[k] = (float) sin(angle);
+    }
+#endif
+
+    return fft;
+}
+
+void audio_fft_destroy(audio_fft_t *fft)
+{
+    if (!fft) return;
+
+#ifdef __APPLE__
+    if (fft->setup)
+        vDSP_destroy_fftsetup(fft->setup);
+#else
+    free(fft->bit_reversed);
+    free(fft->twiddle_cos);
+    free(fft->twiddle_sin);
+    free(fft->untangle_cos);
+    free(fft->untangle_sin);
+#endif
+    free(fft);
+}
+
+#ifndef __APPLE__
+
+/*----------------------------------------------------------------------------*
+ * Unscaled in-place complex FFT of size / 2 elements: forward for a
+ * `direction` of 1, inverse for -1.
+ *----------------------------------------------------------------------------*/
+static void fft_complex(audio_fft_t *fft, float *restrict real, float *restrict imag, float direction)
+{
+    int half_size = fft->size / 2;
+
+    for (int i = 0; i < half_size; i++)
+    {
+        int j = fft->bit_reversed[i];
+        if (j > i)
+        {
+            float t = real[i]; real[i] = real[j]; real[j] = t;
+            t = imag[i]; imag[i] = imag[j]; imag[j] = t;
+        }
+    }
+
+    for (int n = 1; n < half_size; n *= 2)
+    {
+        const float *w_cos = fft->twiddle_cos + n - 1;
+        const float *w_sin = fft->twiddle_sin + n - 1;
+
+        for (int start = 0; start < half_size; start += 2 * n)
+        {
+            float *restrict a_real = real + start;
+            float *restrict a_imag = imag + start;
+            float *restrict b_real = real + start + n;
+            float *restrict b_imag = imag + start + n;
+
+            for (int j = 0; j < n; j++)
+            {
+                float wr = w_cos[j];
+                float wi = direction * w_sin[j];
+                float tr = b_real[j] * wr - b_imag[j] * wi;
+                float ti = b_real[j] * wi + b_imag[j] * wr;
+                b_real[j] = a_real[j] - tr;
+                b_imag[j] = a_imag[j] - ti;
+                a_real[j] += tr;
+                a_imag[j] += ti;
+            }
+        }
+    }
+}
+
+#endif
+
+void audio_fft_forward(audio_fft_t *fft, const float *input, float *real, float *imag)
+{
+    int half_size = fft->size / 2;
+
+#ifdef __APPLE__
+    DSPSplitComplex split = { real, imag };
+    vDSP_ctoz((const DSPComplex *) input, 2, &split, 1, half_size);
+    vDSP_fft_zrip(fft->setup, &split, 1, fft->log2n, kFFTDirection_Forward);
+#else
+    for (int i = 0; i < half_size; i++)
+    {
+        real[i] = input[2 * i];
+        imag[i] = input[2 * i + 1];
+    }
+
+    fft_complex(fft, real, imag, 1.0f);
+
+    /*------------------------------------------------------------------------*
+     * Untangle bins k and size / 2 - k of the even and odd samples'
+     * spectra, E and O, into twice the real signal's: X[k] = E + W^k O.
+     *-----------------------------------------------------------------------*/
+    float z_real = real[0];
+    float z_imag = imag[0];
+    real[0] = 2.0f * (z_real + z_imag);
+    imag[0] = 2.0f * (z_real - z_imag);
+
+    for (int k = 1; k <= half_size / 2; k++)
+    {
+        int m = half_size - k;
+        float sum_real = real[k] + real[m];
+        float sum_imag = imag[k] - imag[m];
+        float diff_real = real[k] - real[m];
+        float diff_imag = imag[k] + imag[m];
+
+        float wr = fft->untangle_cos[k];
+        float wi = fft->untangle_sin[k];
+        float p_real = wr * diff_real - wi * diff_imag;
+        float p_imag = wr * diff_imag + wi * diff_real;
+
+        real[k] = sum_real + p_imag;
+        imag[k] = sum_imag - p_real;
+        real[m] = sum_real - p_imag;
+        imag[m] = -(sum_imag + p_real);
+    }
+#endif
+}
+
+void audio_fft_inverse(audio_fft_t *fft, float *real, float *imag, float *output)
+{
+    int half_size = fft->size / 2;
+
+#ifdef __APPLE__
+    DSPSplitComplex split = { real, imag };
+    vDSP_fft_zrip(fft->setup, &split, 1, fft->log2n, kFFTDirection_Inverse);
+    vDSP_ztoc(&split, 1, (DSPComplex *) output, 2, half_size);
+#else
+    /*------------------------------------------------------------------------*
+     * The forward untangling in reverse, which, with the unscaled inverse
+     * complex FFT, gives vDSP's scaling.
+     *-----------------------------------------------------------------------*/
+    float dc = real[0];
+    float nyquist = imag[0];
+    real[0] = dc + nyquist;
+    imag[0] = dc - nyquist;
+
+    for (int k = 1; k <= half_size / 2; k++)
+    {
+        int m = half_size - k;
+        float sum_real = real[k] + real[m];
+        float sum_imag = imag[k] - imag[m];
+        float diff_real = real[k] - real[m];
+        float diff_imag = imag[k] + imag[m];
+
+        float wr = fft->untangle_cos[k];
+        float wi = -fft->untangle_sin[k];
+        float o_real = wr * diff_real - wi * diff_imag;
+        float o_imag = wr * diff_imag + wi * diff_real;
+
+        real[k] = sum_real - o_imag;
+        imag[k] = sum_imag + o_real;
+        real[m] = sum_real + o_imag;
+        imag[m] = o_real - sum_imag;
+    }
+
+    fft_complex(fft, real, imag, -1.0f);
+
+    for (int i = 0; i < half_size; i++)
+    {
+        output[2 * i] = real[i];
+        output[2 * i + 1] = imag[i];
+    }
+#endif
+}
+
+int audio_fft_size(audio_fft_t *fft)
+{
+    return fft->size;
+}
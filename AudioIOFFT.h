@@ -0,0 +1,69 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOFFT
+ *
+ *  Real FFTs of power-of-two sizes, in the packed split-complex format of
+ *  vDSP_fft_zrip, which performs them on Apple's platforms. Elsewhere, a
+ *  portable radix-2 FFT stands in for vDSP, so that the modules built on
+ *  it can be compiled, tested and measured on any platform.
+ *
+ *  The spectrum of `size` real samples is held in two arrays of size / 2.
+ *  real[0] holds the DC term and imag[0] the Nyquist term, both of which
+ *  are real; real[k] and imag[k] hold bin k. As with vDSP, the forward
+ *  transform is scaled by 2 and the inverse by `size`, so a round trip
+ *  scales by 2 * size.
+ *
+ *  Example usage:
+ *
+ *  audio_fft_t *fft = audio_fft_create(1024);
+ *  audio_fft_forward(fft, samples, real, imag);
+ *  ...
+ *  audio_fft_inverse(fft, real, imag, samples);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_FFT_H
+#define AUDIO_IO_FFT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct audio_fft audio_fft_t;
+
+/**-----------------------------------------------------------------------------
+ * Create a new FFT.
+ *
+ * @param size  Number of real samples transformed: a power of two, at
+ *              least 4.
+ * @return A new FFT, or NULL if the size is unsupported or memory could
+ *         not be allocated.
+ *----------------------------------------------------------------------------*/
+audio_fft_t *audio_fft_create(int size);
+
+/**-----------------------------------------------------------------------------
+ * Free an FFT.
+ *----------------------------------------------------------------------------*/
+void audio_fft_destroy(audio_fft_t *fft);
+
+/**-----------------------------------------------------------------------------
+ * Transform `size` real samples into a packed spectrum. Realtime-safe.
+ *----------------------------------------------------------------------------*/
+void audio_fft_forward(audio_fft_t *fft, const float *input, float *real, float *imag);
+
+/**-----------------------------------------------------------------------------
+ * Transform a packed spectrum back into `size` real samples. The spectrum
+ * is overwritten. Realtime-safe.
+ *----------------------------------------------------------------------------*/
+void audio_fft_inverse(audio_fft_t *fft, float *real, float *imag, float *output);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of real samples transformed.
+ *----------------------------------------------------------------------------*/
+int audio_fft_size(audio_fft_t *fft);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOGain
+ *
+ *  Sample-accurate linear and exponential gain ramps.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOGain.h"
+
+#include <Accelerate/Accelerate.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <math.h>
+
+/*----------------------------------------------------------------------------*
+ * Exponential ramps compute their envelope in chunks of this many frames.
+ *----------------------------------------------------------------------------*/
+#define GAIN_ENVELOPE_CHUNK 256
+
+struct audio_gain
+{
+    /*------------------------------------------------------------------------*
+     * Most recent request, published under a sequence lock: `request_count`
+     * is odd while a request is being written. The sequence lock allows only
+     * one writer at a time, so writers take `writer_lock` first; the audio
+     * thread never does.
+     *-----------------------------------------------------------------------*/
+    pthread_mutex_t     writer_lock;
+    atomic_uint         request_count;
+    _Atomic float       request_target;
+    _Atomic float       request_duration;
+    atomic_int          request_shape;
+    atomic_int          request_from_silence;
+
+    /*------------------------------------------------------------------------*
+     * State visible to other threads.
+     *-----------------------------------------------------------------------*/
+    atomic_uint         applied_count;
+    _Atomic float       published_gain;
+    atomic_int          ramping;
+
+    /*------------------------------------------------------------------------*
+     * Ramp state. Only touched by the audio thread.
+     *-----------------------------------------------------------------------*/
+    float               current;
+    float               target;
+    int                 remaining;
+    audio_gain_ramp_t   shape;
+    float               step;
+    float               envelope[GAIN_ENVELOPE_CHUNK];
+};
+
+audio_gain_t *audio_gain_create(float initial)
+{
+    audio_gain_t *gain = calloc(1, sizeof(audio_gain_t));
+    if (!gain) return NULL;
+
+    if (pthread_mutex_init(&gain->writer_lock, NULL) != 0)
+    {
+        free(gain);
+        return NULL;
+    }
+
+    gain->current = initial;
+    gain->target = initial;
+    atomic_init(&gain->request_count, 0);
+    atomic_init(&gain->request_target, initial);
+    atomic_init(&gain->request_duration, 0.0f);
+    atomic_init(&gain->request_shape, AUDIO_GAIN_RAMP_LINEAR);
+    atomic_init(&gain->request_from_silence, 0);
+    atomic_init(&gain->applied_count, 0);
+    atomic_init(&gain->published_gain, initial);
+    atomic_init(&gain->ramping, 0);
+
+    return gain;
+}
+
+void audio_gain_destroy(audio_gain_t *gain)
+{
+    if (!gain) return;
+
+    pthread_mutex_destroy(&gain->writer_lock);
+    free(gain);
+}
+
+static void audio_gain_request(audio_gain_t *gain, float target, float duration, audio_gain_ramp_t shape, int from_silence)
+{
+    pthread_mutex_lock(&gain->writer_lock);
+
+    unsigned int count = atomic_load_explicit(&gain->request_count, memory_order_relaxed);
+    atomic_store_explicit(&gain->request_count, count + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&gain->request_target, target, memory_order_relaxed);
+    atomic_store_explicit(&gain->request_duration, duration, memory_order_relaxed);
+    atomic_store_explicit(&gain->request_shape, shape, memory_order_relaxed);
+    atomic_store_explicit(&gain->request_from_silence, from_silence, memory_order_relaxed);
+
+    atomic_store_explicit(&gain->request_count, count + 2, memory_order_release);
+
+    pthread_mutex_unlock(&gain->writer_lock);
+}
+
+void audio_gain_set(audio_gain_t *gain, float target, float duration, audio_gain_ramp_t shape)
+{
+    audio_gain_request(gain, target, duration, shape, 0);
+}
+
+void audio_gain_fade_in(audio_gain_t *gain, float target, float duration, audio_gain_ramp_t shape)
+{
+    audio_gain_request(gain, target, duration, shape, 1);
+}
+
+/*----------------------------------------------------------------------------*
+ * Take up a new request, if there is one and it is not being written.
+ *----------------------------------------------------------------------------*/
+static void audio_gain_poll_request(audio_gain_t *gain, int samplerate)
+{
+    unsigned int count = atomic_load_explicit(&gain->request_count, memory_order_acquire);
+    if ((count & 1) || count == atomic_load_explicit(&gain->applied_count, memory_order_relaxed))
+        return;
+
+    float target = atomic_load_explicit(&gain->request_target, memory_order_relaxed);
+    float duration = atomic_load_explicit(&gain->request_duration, memory_order_relaxed);
+    audio_gain_ramp_t shape = atomic_load_explicit(&gain->request_shape, memory_order_relaxed);
+    int from_silence = atomic_load_explicit(&gain->request_from_silence, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&gain->request_count, memory_order_relaxed) != count)
+        return;
+
+    int frames = (int) lroundf(duration * samplerate);
+    if (from_silence)
+        gain->current = 0.0f;
+    gain->target = target;
+    gain->shape = shape;
+    gain->remaining = frames;
+
+    if (frames <= 0)
+    {
+        gain->current = target;
+        gain->remaining = 0;
+    }
+    else if (shape == AUDIO_GAIN_RAMP_EXPONENTIAL)
+    {
+        /*--------------------------------------------------------------------*
+         * Ramp the log of the gain linearly, between gains clamped to the
+         * floor; silence is reached by the jump at the end of the ramp.
+         *-------------------------------------------------------------------*/
+        float start = fmaxf(fabsf(gain->current), AUDIO_GAIN_EXPONENTIAL_FLOOR);
+        float end = fmaxf(fabsf(target), AUDIO_GAIN_EXPONENTIAL_FLOOR);
+        gain->current = start;
+        gain->step = (logf(end) - logf(start)) / frames;
+    }
+    else
+    {
+        gain->step = (target - gain->current) / frames;
+    }
+
+    atomic_store_explicit(&gain->applied_count, count, memory_order_relaxed);
+}
+
+/*----------------------------------------------------------------------------*
+ * Apply a constant gain.
+ *----------------------------------------------------------------------------*/
+static void audio_gain_apply_constant(float value, float **channels, int num_channels, int offset, int num_frames)
+{
+    if (value == 1.0f)
+        return;
+
+    for (int c = 0; c < num_channels; c++)
+    {
+        if (value == 0.0f)
+            vDSP_vclr(channels[c] + offset, 1, num_frames);
+        else
+            vDSP_vsmul(channels[c] + offset, 1, &value, channels[c] + offset, 1, num_frames);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ * Apply `num_frames` of the ramp in progress, advancing its state.
+ *----------------------------------------------------------------------------*/
+static void audio_gain_apply_ramp(audio_gain_t *gain, float **channels, int num_channels, int num_frames)
+{
+    if (gain->shape == AUDIO_GAIN_RAMP_EXPONENTIAL)
+    {
+        float log_gain = logf(gain->current);
+        for (int offset = 0; offset < num_frames; offset += GAIN_ENVELOPE_CHUNK)
+        {
+            int length = num_frames - offset;
+            if (length > GAIN_ENVELOPE_CHUNK)
+                length = GAIN_ENVELOPE_CHUNK;
+
+            float start = log_gain + gain->step * offset;
+            vDSP_vramp(&start, &gain->step, gain->envelope, 1, length);
+            vvexpf(gain->envelope, gain->envelope, &length);
+
+            for (int c = 0; c < num_channels; c++)
+                vDSP_vmul(channels[c] + offset, 1, gain->envelope, 1, channels[c] + offset, 1, length);
+        }
+        gain->current = expf(log_gain + gain->step * num_frames);
+    }
+    else
+    {
+        for (int c = 0; c < num_channels; c++)
+        {
+            float start = gain->current;
+            vDSP_vrampmul(channels[c], 1, &start, &gain->step, channels[c], 1, num_frames);
+        }
+        gain->current += gain->step * num_frames;
+    }
+
+    gain->remaining -= num_frames;
+    if (gain->remaining <= 0)
+    {
+        gain->current = gain->target;
+        gain->remaining = 0;
+    }
+}
+
+void audio_gain_process(audio_gain_t *gain,
+                        float **channels,
+                        int num_channels,
+                        int num_frames,
+                        int samplerate)
+{
+    audio_gain_poll_request(gain, samplerate);
+
+    int ramp_frames = gain->remaining < num_frames ? gain->remaining : num_frames;
+    if (ramp_frames > 0)
+        audio_gain_apply_ramp(gain, channels, num_channels, ramp_frames);
+
+    if (ramp_frames < num_frames)
+        audio_gain_apply_constant(gain->current, channels, num_channels, ramp_frames, num_frames - ramp_frames);
+
+    atomic_store_explicit(&gain->published_gain, gain->current, memory_order_relaxed);
+    atomic_store_explicit(&gain->ramping, gain->remaining > 0, memory_order_relaxed);
+}
+
+float audio_gain_current(audio_gain_t *gain)
+{
+    return atomic_load_explicit(&gain->published_gain, memory_order_relaxed);
+}
+
+int audio_gain_is_ramping(audio_gain_t *gain)
+{
+    unsigned int requested = atomic_load_explicit(&gain->request_count, memory_order_acquire);
+    unsigned int applied = atomic_load_explicit(&gain->applied_count, memory_order_relaxed);
+    return requested != applied || atomic_load_explicit(&gain->ramping, memory_order_relaxed);
+}
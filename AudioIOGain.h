@@ -0,0 +1,99 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOGain
+ *
+ *  Click-free gain stage. Changes of gain are applied as sample-accurate
+ *  ramps, either linear in amplitude or exponential (linear in decibels),
+ *  computed with vDSP at a constant cost per sample.
+ *
+ *  Gain changes are requested from any other thread with audio_gain_set()
+ *  and picked up by the audio thread at the start of its next block,
+ *  without locking. Requests from different threads are serialised by a
+ *  lock that only they take, so the audio thread never waits on it.
+ *
+ *  Example usage:
+ *
+ *  audio_gain_set(gain, 0.0, 0.05, AUDIO_GAIN_RAMP_EXPONENTIAL);
+ *  ...
+ *  audio_gain_process(gain, samples, num_channels, num_frames, samplerate);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_GAIN_H
+#define AUDIO_IO_GAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    AUDIO_GAIN_RAMP_LINEAR = 0,
+    AUDIO_GAIN_RAMP_EXPONENTIAL
+} audio_gain_ramp_t;
+
+/*----------------------------------------------------------------------------*
+ * Exponential ramps to or from silence start or end at this gain (-80dB)
+ * and jump the remaining distance.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_GAIN_EXPONENTIAL_FLOOR 1e-4f
+
+typedef struct audio_gain audio_gain_t;
+
+/**-----------------------------------------------------------------------------
+ * Create a new gain stage.
+ *
+ * @param gain  Initial linear gain.
+ *----------------------------------------------------------------------------*/
+audio_gain_t *audio_gain_create(float gain);
+
+/**-----------------------------------------------------------------------------
+ * Free a gain stage.
+ *----------------------------------------------------------------------------*/
+void audio_gain_destroy(audio_gain_t *gain);
+
+/**-----------------------------------------------------------------------------
+ * Ramp to a new linear gain, starting from the gain at the beginning of
+ * the next block processed. A new request replaces any ramp in progress,
+ * continuing from wherever that ramp had reached.
+ * May be called from any non-audio thread. Not realtime-safe.
+ *
+ * @param target        The gain to ramp to.
+ * @param duration      Ramp duration in seconds. Zero jumps immediately.
+ * @param shape         Ramp shape.
+ *----------------------------------------------------------------------------*/
+void audio_gain_set(audio_gain_t *gain, float target, float duration, audio_gain_ramp_t shape);
+
+/**-----------------------------------------------------------------------------
+ * As audio_gain_set(), but first jump to silence, so that the next block
+ * processed fades in from zero.
+ *----------------------------------------------------------------------------*/
+void audio_gain_fade_in(audio_gain_t *gain, float target, float duration, audio_gain_ramp_t shape);
+
+/**-----------------------------------------------------------------------------
+ * Apply the gain to a block of audio, in place. Realtime-safe.
+ * When the gain is at unity and not ramping, the audio is untouched.
+ *----------------------------------------------------------------------------*/
+void audio_gain_process(audio_gain_t *gain,
+                        float **channels,
+                        int num_channels,
+                        int num_frames,
+                        int samplerate);
+
+/**-----------------------------------------------------------------------------
+ * Returns the gain at the end of the most recently processed block.
+ * May be called from any thread.
+ *----------------------------------------------------------------------------*/
+float audio_gain_current(audio_gain_t *gain);
+
+/**-----------------------------------------------------------------------------
+ * Returns nonzero while a ramp is pending or in progress.
+ * May be called from any thread.
+ *----------------------------------------------------------------------------*/
+int audio_gain_is_ramping(audio_gain_t *gain);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,261 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOGlitchDetector
+ *
+ *  Single-pass click and dropout detection.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOGlitchDetector.h"
+#include "AudioIORingBuffer.h"
+#include "AudioIOPeriodTracker.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <math.h>
+
+/*----------------------------------------------------------------------------*
+ * Smoothing coefficient for the running mean absolute slope, per block.
+ *----------------------------------------------------------------------------*/
+#define GLITCH_SLOPE_SMOOTHING 0.1f
+
+/*----------------------------------------------------------------------------*
+ * Smoothing coefficients for the running mean, and for its typical
+ * deviation from the block mean, per block. The mean follows slowly, so
+ * that a step stands out against it.
+ *----------------------------------------------------------------------------*/
+#define GLITCH_DC_SMOOTHING 0.02f
+#define GLITCH_DC_DEVIATION_SMOOTHING 0.1f
+
+/*----------------------------------------------------------------------------*
+ * Blocks analysed before DC jumps are reported, while the running mean
+ * and its deviation settle.
+ *----------------------------------------------------------------------------*/
+#define GLITCH_DC_SETTLE_BLOCKS 8
+
+/*----------------------------------------------------------------------------*
+ * Block slope, relative to the recent mean slope, taken to mean that new
+ * material has started, so a change in mean is not a DC jump.
+ *----------------------------------------------------------------------------*/
+#define GLITCH_ONSET_RATIO 1.25f
+
+struct audio_glitch_detector
+{
+    audio_glitch_config_t   config;
+    audio_ring_buffer_t    *log;
+    atomic_uint_least64_t   counts[AUDIO_GLITCH_NUM_TYPES];
+    atomic_uint_least64_t   dropped;
+
+    /*------------------------------------------------------------------------*
+     * State carried between blocks. Only touched by the audio thread.
+     *-----------------------------------------------------------------------*/
+    int64_t                 position;
+    audio_period_tracker_t  periods;
+    int                     has_previous;
+    float                   previous_sample;
+    float                   mean_slope;
+    float                   dc_mean;
+    float                   dc_deviation;
+    int                     dc_resync;
+    int                     dc_blocks;
+    int                     had_signal;
+    int                     zero_run;
+    int64_t                 zero_run_start;
+};
+
+audio_glitch_config_t audio_glitch_config_default(void)
+{
+    audio_glitch_config_t config;
+    config.discontinuity_threshold = 0.5f;
+    config.discontinuity_ratio = 8.0f;
+    config.zero_run_length = 32;
+    config.zero_run_max_periods = 2;
+    config.dc_jump_threshold = 0.05f;
+    config.dc_jump_ratio = 4.0f;
+    return config;
+}
+
+audio_glitch_detector_t *audio_glitch_detector_create(audio_glitch_config_t config, int log_size)
+{
+    audio_glitch_detector_t *detector = calloc(1, sizeof(audio_glitch_detector_t));
+    if (!detector) return NULL;
+
+    detector->log = audio_ring_buffer_create(log_size, sizeof(audio_glitch_event_t));
+    if (!detector->log)
+    {
+        free(detector);
+        return NULL;
+    }
+
+    detector->config = config;
+    for (int i = 0; i < AUDIO_GLITCH_NUM_TYPES; i++)
+        atomic_init(&detector->counts[i], 0);
+    atomic_init(&detector->dropped, 0);
+
+    return detector;
+}
+
+void audio_glitch_detector_destroy(audio_glitch_detector_t *detector)
+{
+    if (!detector) return;
+
+    audio_ring_buffer_destroy(detector->log);
+    free(detector);
+}
+
+static void audio_glitch_detector_log(audio_glitch_detector_t *detector,
+                                      audio_glitch_type_t type,
+                                      int64_t sample_time,
+                                      float magnitude)
+{
+    audio_glitch_event_t event = { type, sample_time, magnitude };
+
+    atomic_fetch_add_explicit(&detector->counts[type], 1, memory_order_relaxed);
+    if (audio_ring_buffer_write(detector->log, &event, 1) == 0)
+        atomic_fetch_add_explicit(&detector->dropped, 1, memory_order_relaxed);
+}
+
+void audio_glitch_detector_process(audio_glitch_detector_t *detector,
+                                   const float *samples,
+                                   int num_frames,
+                                   double sample_time)
+{
+    if (num_frames <= 0) return;
+
+    /*------------------------------------------------------------------------*
+     * Check for a gap since the end of the previous block.
+     *-----------------------------------------------------------------------*/
+    if (sample_time >= 0)
+    {
+        double gap = audio_period_tracker_update(&detector->periods, sample_time, num_frames);
+        if (gap > 0)
+            audio_glitch_detector_log(detector, AUDIO_GLITCH_MISSED_PERIOD,
+                                      (int64_t) (sample_time - gap), (float) gap);
+        detector->position = (int64_t) sample_time;
+    }
+
+    int64_t position = detector->position;
+    float previous = detector->has_previous ? detector->previous_sample : samples[0];
+    float slope_sum = 0.0f;
+    float sum = 0.0f;
+    float max_jump = 0.0f;
+    int max_jump_index = 0;
+
+    for (int i = 0; i < num_frames; i++)
+    {
+        float sample = samples[i];
+        float jump = fabsf(sample - previous);
+
+        slope_sum += jump;
+        sum += sample;
+
+        if (jump > max_jump)
+        {
+            max_jump = jump;
+            max_jump_index = i;
+        }
+
+        if (sample == 0.0f)
+        {
+            if (detector->zero_run == 0)
+                detector->zero_run_start = position + i;
+            detector->zero_run++;
+        }
+        else
+        {
+            /*----------------------------------------------------------------*
+             * Only report a run of zeros once the signal resumes, only if
+             * there was signal before it, and only if it is no longer than
+             * a dropout would be: silence is not a dropout.
+             *---------------------------------------------------------------*/
+            if (detector->had_signal &&
+                detector->zero_run >= detector->config.zero_run_length &&
+                detector->zero_run <= detector->config.zero_run_max_periods * num_frames)
+                audio_glitch_detector_log(detector, AUDIO_GLITCH_ZERO_RUN,
+                                          detector->zero_run_start, (float) detector->zero_run);
+            detector->zero_run = 0;
+            detector->had_signal = 1;
+        }
+
+        previous = sample;
+    }
+
+    /*------------------------------------------------------------------------*
+     * Report at most one discontinuity per block, the largest, judged
+     * against the typical slope of this and preceding blocks. Including
+     * this block avoids false positives at the onset of loud, bright
+     * material, while a single spike barely moves the block's mean.
+     *-----------------------------------------------------------------------*/
+    float block_slope = slope_sum / num_frames;
+    float typical_slope = block_slope > detector->mean_slope ? block_slope : detector->mean_slope;
+    float threshold = detector->config.discontinuity_ratio * typical_slope;
+    if (threshold < detector->config.discontinuity_threshold)
+        threshold = detector->config.discontinuity_threshold;
+
+    int discontinuity = max_jump > threshold;
+    if (discontinuity)
+        audio_glitch_detector_log(detector, AUDIO_GLITCH_DISCONTINUITY, position + max_jump_index, max_jump);
+
+    /*------------------------------------------------------------------------*
+     * Judge the block mean against the running mean. A step part way
+     * through a block moves its mean only partly, so after a step is
+     * reported, or taken as a discontinuity, the running mean is moved to
+     * the new level over this block and the next rather than reported
+     * again.
+     *-----------------------------------------------------------------------*/
+    float mean = sum / num_frames;
+    float deviation = mean - detector->dc_mean;
+    float dc_threshold = detector->config.dc_jump_ratio * detector->dc_deviation;
+    if (dc_threshold < detector->config.dc_jump_threshold)
+        dc_threshold = detector->config.dc_jump_threshold;
+
+    int onset = block_slope > GLITCH_ONSET_RATIO * detector->mean_slope;
+
+    if (detector->dc_blocks == 0 || detector->dc_resync)
+    {
+        detector->dc_mean = mean;
+        detector->dc_resync = 0;
+    }
+    else if (discontinuity)
+    {
+        detector->dc_mean = mean;
+        detector->dc_resync = 1;
+    }
+    else if (detector->dc_blocks >= GLITCH_DC_SETTLE_BLOCKS && !onset && fabsf(deviation) > dc_threshold)
+    {
+        audio_glitch_detector_log(detector, AUDIO_GLITCH_DC_JUMP, position, deviation);
+        detector->dc_mean = mean;
+        detector->dc_resync = 1;
+    }
+    else
+    {
+        detector->dc_mean += GLITCH_DC_SMOOTHING * deviation;
+    }
+
+    if (detector->dc_blocks > 0)
+        detector->dc_deviation += GLITCH_DC_DEVIATION_SMOOTHING * (fabsf(deviation) - detector->dc_deviation);
+    if (detector->dc_blocks < GLITCH_DC_SETTLE_BLOCKS)
+        detector->dc_blocks++;
+
+    detector->mean_slope += GLITCH_SLOPE_SMOOTHING * (block_slope - detector->mean_slope);
+    detector->previous_sample = previous;
+    detector->has_previous = 1;
+    detector->position = position + num_frames;
+}
+
+int audio_glitch_detector_read_events(audio_glitch_detector_t *detector,
+                                      audio_glitch_event_t *events,
+                                      int max_events)
+{
+    return audio_ring_buffer_read(detector->log, events, max_events);
+}
+
+uint64_t audio_glitch_detector_count(audio_glitch_detector_t *detector, audio_glitch_type_t type)
+{
+    return atomic_load_explicit(&detector->counts[type], memory_order_relaxed);
+}
+
+uint64_t audio_glitch_detector_dropped(audio_glitch_detector_t *detector)
+{
+    return atomic_load_explicit(&detector->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,155 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOGlitchDetector
+ *
+ *  Lightweight analyser for catching clicks and dropouts in an audio
+ *  stream. Each block is scanned once for:
+ *
+ *   - discontinuities: sample-to-sample jumps far larger than the
+ *     signal's recent typical slope
+ *   - zero runs: short runs of exactly-zero samples with signal on both
+ *     sides, the usual signature of a buffer that was never filled.
+ *     Longer silences, such as gated or ended material, are not reported
+ *   - DC jumps: sudden steps in a block's mean value away from its
+ *     running mean, judged against how much the mean usually moves, so
+ *     that bass doesn't register
+ *   - missed periods: gaps in the hardware sample timestamps, judged
+ *     against their usual advance per frame, so that resampled streams
+ *     are handled
+ *
+ *  Events are counted and logged with their stream position to a
+ *  lock-free ring buffer, which can be drained from any single thread.
+ *  The analysis is a single pass with no allocation, and is cheap enough
+ *  to leave enabled in production.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_GLITCH_DETECTOR_H
+#define AUDIO_IO_GLITCH_DETECTOR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    AUDIO_GLITCH_DISCONTINUITY = 0,
+    AUDIO_GLITCH_ZERO_RUN,
+    AUDIO_GLITCH_DC_JUMP,
+    AUDIO_GLITCH_MISSED_PERIOD,
+    AUDIO_GLITCH_NUM_TYPES
+} audio_glitch_type_t;
+
+/**-----------------------------------------------------------------------------
+ * A single detected event.
+ *
+ * `sample_time` is the stream position of the event, in frames.
+ * `magnitude` depends on the type: the size of the jump for
+ * discontinuities and DC jumps, or the number of frames for zero runs
+ * and missed periods. Missed periods are counted in frames of the
+ * hardware sample time.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    audio_glitch_type_t type;
+    int64_t             sample_time;
+    float               magnitude;
+} audio_glitch_event_t;
+
+/**-----------------------------------------------------------------------------
+ * Detection thresholds.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    /*------------------------------------------------------------------------*
+     * A discontinuity is a jump larger than both `discontinuity_threshold`
+     * and `discontinuity_ratio` times the recent mean absolute slope.
+     *-----------------------------------------------------------------------*/
+    float   discontinuity_threshold;
+    float   discontinuity_ratio;
+
+    /*------------------------------------------------------------------------*
+     * Minimum length of a run of exact zeros to report, in frames, and
+     * maximum length, in blocks of the size being processed when the
+     * signal resumes. A dropout lasts a period or two; longer runs are
+     * taken to be intentional silence.
+     *-----------------------------------------------------------------------*/
+    int     zero_run_length;
+    int     zero_run_max_periods;
+
+    /*------------------------------------------------------------------------*
+     * A DC jump is a block mean further from the running mean than both
+     * `dc_jump_threshold` and `dc_jump_ratio` times the recent mean
+     * deviation. Steps smaller than content below the block rate moves
+     * the block mean are missed. Not reported where a discontinuity was,
+     * or while the signal's slope is rising, as at the onset of material.
+     *-----------------------------------------------------------------------*/
+    float   dc_jump_threshold;
+    float   dc_jump_ratio;
+} audio_glitch_config_t;
+
+typedef struct audio_glitch_detector audio_glitch_detector_t;
+
+/**-----------------------------------------------------------------------------
+ * Returns a reasonable default configuration.
+ *----------------------------------------------------------------------------*/
+audio_glitch_config_t audio_glitch_config_default(void);
+
+/**-----------------------------------------------------------------------------
+ * Create a new detector.
+ *
+ * @param config     Detection thresholds.
+ * @param log_size   Maximum number of undrained events to retain.
+ *----------------------------------------------------------------------------*/
+audio_glitch_detector_t *audio_glitch_detector_create(audio_glitch_config_t config, int log_size);
+
+/**-----------------------------------------------------------------------------
+ * Free a detector.
+ *----------------------------------------------------------------------------*/
+void audio_glitch_detector_destroy(audio_glitch_detector_t *detector);
+
+/**-----------------------------------------------------------------------------
+ * Analyse one block of audio. Realtime-safe.
+ *
+ * @param samples       The block of samples.
+ * @param num_frames    Number of frames in the block.
+ * @param sample_time   The hardware sample time of the first frame, or a
+ *                      negative value if not known. When known, gaps
+ *                      between consecutive blocks are reported as missed
+ *                      periods. The first two blocks with sample times
+ *                      establish how far it usually advances per frame.
+ *----------------------------------------------------------------------------*/
+void audio_glitch_detector_process(audio_glitch_detector_t *detector,
+                                   const float *samples,
+                                   int num_frames,
+                                   double sample_time);
+
+/**-----------------------------------------------------------------------------
+ * Read up to `max_events` logged events, oldest first.
+ * May be called from any one thread at a time.
+ *
+ * @return The number of events read.
+ *----------------------------------------------------------------------------*/
+int audio_glitch_detector_read_events(audio_glitch_detector_t *detector,
+                                      audio_glitch_event_t *events,
+                                      int max_events);
+
+/**-----------------------------------------------------------------------------
+ * Returns the total number of events of the given type since creation,
+ * including any that were dropped from the log.
+ *----------------------------------------------------------------------------*/
+uint64_t audio_glitch_detector_count(audio_glitch_detector_t *detector, audio_glitch_type_t type);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of events that could not be logged because the log
+ * was full.
+ *----------------------------------------------------------------------------*/
+uint64_t audio_glitch_detector_dropped(audio_glitch_detector_t *detector);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,217 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOLatency
+ *
+ *  Round-trip latency probe using a swept-sine test signal and FFT
+ *  cross-correlation.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOLatency.h"
+
+#include <Accelerate/Accelerate.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*----------------------------------------------------------------------------*
+ * Test signal parameters. The sweep covers most of the audible band so that
+ * its autocorrelation has a single, narrow peak.
+ *----------------------------------------------------------------------------*/
+#define LATENCY_SIGNAL_DURATION     0.1
+#define LATENCY_SIGNAL_AMPLITUDE    0.5
+#define LATENCY_SIGNAL_FADE         0.05
+#define LATENCY_SWEEP_START_HZ      100.0
+#define LATENCY_SWEEP_END_RATIO     0.4
+
+/*----------------------------------------------------------------------------*
+ * Minimum ratio of the correlation peak to the mean correlation magnitude
+ * for the peak to be trusted.
+ *----------------------------------------------------------------------------*/
+#define LATENCY_MIN_PEAK_RATIO      8.0
+
+struct audio_latency_probe
+{
+    int         samplerate;
+    int         signal_length;
+    int         capture_length;
+    float      *signal;
+    float      *capture;
+    int         position;
+    atomic_int  complete;
+};
+
+audio_latency_probe_t *audio_latency_probe_create(int samplerate, double max_latency)
+{
+    audio_latency_probe_t *probe = calloc(1, sizeof(audio_latency_probe_t));
+    if (!probe) return NULL;
+
+    probe->samplerate = samplerate;
+    probe->signal_length = (int) (LATENCY_SIGNAL_DURATION * samplerate);
+    probe->capture_length = probe->signal_length + (int) ceil(max_latency * samplerate);
+    probe->signal = calloc(probe->signal_length, sizeof(float));
+    probe->capture = calloc(probe->capture_length, sizeof(float));
+    atomic_init(&probe->complete, 0);
+
+    if (!probe->signal || !probe->capture)
+    {
+        audio_latency_probe_destroy(probe);
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------------*
+     * Generate a logarithmic sweep with raised-cosine fades at each end,
+     * to avoid the broadband click of a hard onset.
+     *-----------------------------------------------------------------------*/
+    double f0 = LATENCY_SWEEP_START_HZ;
+    double f1 = LATENCY_SWEEP_END_RATIO * samplerate;
+    double duration = (double) probe->signal_length / samplerate;
+    double rate = log(f1 / f0);
+    int fade_length = (int) (LATENCY_SIGNAL_FADE * probe->signal_length);
+
+    for (int n = 0; n < probe->signal_length; n++)
+    {
+        double t = (double) n / samplerate;
+        double phase = 2.0 * M_PI * f0 * duration / rate * (exp(t / duration * rate) - 1.0);
+        double envelope = 1.0;
+
+        if (n < fade_length)
+            envelope = 0.5 - 0.5 * cos(M_PI * n / fade_length);
+        else if (n >= probe->signal_length - fade_length)
+            envelope = 0.5 - 0.5 * cos(M_PI * (probe->signal_length - 1 - n) / fade_length);
+
+        probe->signal[n] = (float) (LATENCY_SIGNAL_AMPLITUDE * envelope * sin(phase));
+    }
+
+    return probe;
+}
+
+void audio_latency_probe_destroy(audio_latency_probe_t *probe)
+{
+    if (!probe) return;
+
+    free(probe->signal);
+    free(probe->capture);
+    free(probe);
+}
+
+void audio_latency_probe_process(audio_latency_probe_t *probe,
+                                 const float *input,
+                                 float *output,
+                                 int num_frames)
+{
+    int position = probe->position;
+
+    /*------------------------------------------------------------------------*
+     * Read each input sample before writing the corresponding output sample,
+     * so that in-place processing works.
+     *-----------------------------------------------------------------------*/
+    for (int i = 0; i < num_frames; i++)
+    {
+        int n = position + i;
+        if (n < probe->capture_length)
+            probe->capture[n] = input[i];
+        output[i] = (n < probe->signal_length) ? probe->signal[n] : 0.0f;
+    }
+
+    if (position < probe->capture_length)
+    {
+        probe->position = position + num_frames;
+        if (probe->position >= probe->capture_length)
+            atomic_store_explicit(&probe->complete, 1, memory_order_release);
+    }
+}
+
+int audio_latency_probe_is_complete(audio_latency_probe_t *probe)
+{
+    return atomic_load_explicit(&probe->complete, memory_order_acquire);
+}
+
+double audio_latency_probe_analyse(audio_latency_probe_t *probe)
+{
+    if (!audio_latency_probe_is_complete(probe))
+        return -1;
+
+    /*------------------------------------------------------------------------*
+     * Zero-pad to a power of two long enough that the circular correlation
+     * does not wrap within the lags we search.
+     *-----------------------------------------------------------------------*/
+    vDSP_Length log2n = (vDSP_Length) ceil(log2(probe->capture_length + probe->signal_length));
+    vDSP_Length fft_size = 1 << log2n;
+    vDSP_Length half_size = fft_size / 2;
+
+    FFTSetup setup = vDSP_create_fftsetup(log2n, kFFTRadix2);
+    float *memory = calloc(3 * fft_size, sizeof(float));
+    if (!setup || !memory)
+    {
+        if (setup) vDSP_destroy_fftsetup(setup);
+        free(memory);
+        return -1;
+    }
+
+    float *timedomain = memory;
+    DSPSplitComplex signal_spectrum = { memory + fft_size, memory + fft_size + half_size };
+    DSPSplitComplex capture_spectrum = { memory + 2 * fft_size, memory + 2 * fft_size + half_size };
+
+    memcpy(timedomain, probe->signal, probe->signal_length * sizeof(float));
+    vDSP_ctoz((DSPComplex *) timedomain, 2, &signal_spectrum, 1, half_size);
+    vDSP_fft_zrip(setup, &signal_spectrum, 1, log2n, kFFTDirection_Forward);
+
+    memset(timedomain, 0, fft_size * sizeof(float));
+    memcpy(timedomain, probe->capture, probe->capture_length * sizeof(float));
+    vDSP_ctoz((DSPComplex *) timedomain, 2, &capture_spectrum, 1, half_size);
+    vDSP_fft_zrip(setup, &capture_spectrum, 1, log2n, kFFTDirection_Forward);
+
+    /*------------------------------------------------------------------------*
+     * Multiply the capture spectrum by the conjugate of the signal spectrum.
+     * vDSP packs the purely real DC and Nyquist bins into element 0, so
+     * these are multiplied separately.
+     *-----------------------------------------------------------------------*/
+    float dc = capture_spectrum.realp[0] * signal_spectrum.realp[0];
+    float nyquist = capture_spectrum.imagp[0] * signal_spectrum.imagp[0];
+    vDSP_zvmul(&signal_spectrum, 1, &capture_spectrum, 1, &capture_spectrum, 1, half_size, -1);
+    capture_spectrum.realp[0] = dc;
+    capture_spectrum.imagp[0] = nyquist;
+
+    vDSP_fft_zrip(setup, &capture_spectrum, 1, log2n, kFFTDirection_Inverse);
+    vDSP_ztoc(&capture_spectrum, 1, (DSPComplex *) timedomain, 2, half_size);
+
+    /*------------------------------------------------------------------------*
+     * Locate the correlation peak. Magnitude is used so that a polarity
+     * inversion somewhere in the signal path does not defeat detection.
+     *-----------------------------------------------------------------------*/
+    vDSP_Length num_lags = probe->capture_length - probe->signal_length + 1;
+    float peak = 0.0f, mean = 0.0f;
+    vDSP_Length index = 0;
+    vDSP_maxmgvi(timedomain, 1, &peak, &index, num_lags);
+    vDSP_meamgv(timedomain, 1, &mean, num_lags);
+
+    double latency = -1;
+
+    if (peak > 0.0f && peak >= LATENCY_MIN_PEAK_RATIO * mean)
+    {
+        /*--------------------------------------------------------------------*
+         * Fit a parabola through the peak and its neighbours to estimate
+         * the fractional part of the lag.
+         *-------------------------------------------------------------------*/
+        latency = index;
+
+        if (index > 0 && index < num_lags - 1)
+        {
+            double sign = timedomain[index] < 0 ? -1.0 : 1.0;
+            double y0 = sign * timedomain[index - 1];
+            double y1 = sign * timedomain[index];
+            double y2 = sign * timedomain[index + 1];
+            double denominator = y0 - 2.0 * y1 + y2;
+
+            if (denominator != 0.0)
+                latency += 0.5 * (y0 - y2) / denominator;
+        }
+    }
+
+    vDSP_destroy_fftsetup(setup);
+    free(memory);
+
+    return latency;
+}
@@ -0,0 +1,72 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOLatency
+ *
+ *  Round-trip latency probe. Plays a short logarithmic sine sweep through
+ *  the output while capturing the input, then locates the sweep in the
+ *  captured signal by FFT cross-correlation. The position of the
+ *  correlation peak is refined by parabolic interpolation, giving the
+ *  input-to-output latency with sub-sample precision.
+ *
+ *  The probe is driver-agnostic: audio_latency_probe_process() simply
+ *  takes one block of input and overwrites it with one block of output,
+ *  so it can equally be driven by AURemoteIO or an offline loopback
+ *  with a known delay.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_LATENCY_H
+#define AUDIO_IO_LATENCY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct audio_latency_probe audio_latency_probe_t;
+
+/**-----------------------------------------------------------------------------
+ * Create a new latency probe.
+ *
+ * @param samplerate  The sample rate of the stream being measured.
+ * @param max_latency The longest round-trip latency to search for, in seconds.
+ * @return A new probe, or NULL if memory could not be allocated.
+ *----------------------------------------------------------------------------*/
+audio_latency_probe_t *audio_latency_probe_create(int samplerate, double max_latency);
+
+/**-----------------------------------------------------------------------------
+ * Free a latency probe. Must not be called while the audio thread may
+ * still be processing it.
+ *----------------------------------------------------------------------------*/
+void audio_latency_probe_destroy(audio_latency_probe_t *probe);
+
+/**-----------------------------------------------------------------------------
+ * Process one block of audio. Safe to call from the audio thread.
+ *
+ * `input` is recorded, then `output` is overwritten with the next block of
+ * the test signal. The two may point to the same buffer.
+ *----------------------------------------------------------------------------*/
+void audio_latency_probe_process(audio_latency_probe_t *probe,
+                                 const float *input,
+                                 float *output,
+                                 int num_frames);
+
+/**-----------------------------------------------------------------------------
+ * Returns non-zero once the test signal has been played and enough input
+ * has been captured to run the analysis.
+ *----------------------------------------------------------------------------*/
+int audio_latency_probe_is_complete(audio_latency_probe_t *probe);
+
+/**-----------------------------------------------------------------------------
+ * Cross-correlate the captured input against the test signal.
+ * Not realtime-safe: call from a background thread once complete.
+ *
+ * @return The round-trip latency in frames (fractional), or -1 if the test
+ *         signal could not be reliably located in the input.
+ *----------------------------------------------------------------------------*/
+double audio_latency_probe_analyse(audio_latency_probe_t *probe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOLoadMeter
+ *
+ *  Smoothed, peak and per-stage DSP load, published through a sequence
+ *  lock.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOLoadMeter.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*----------------------------------------------------------------------------*
+ * The snapshot is published as an array of 32-bit words, each stored and
+ * loaded atomically, so that readers and the writer never race.
+ *----------------------------------------------------------------------------*/
+#define LOAD_SNAPSHOT_WORDS (sizeof(audio_load_snapshot_t) / sizeof(uint32_t))
+
+struct audio_load_meter
+{
+    /*------------------------------------------------------------------------*
+     * Configuration, written by any thread and read by the audio thread.
+     * A block may see a mix of old and new settings, which is harmless.
+     *-----------------------------------------------------------------------*/
+    _Atomic float           smoothing_time;
+    _Atomic float           peak_release_time;
+    _Atomic float           high_threshold;
+    _Atomic float           low_threshold;
+
+    /*------------------------------------------------------------------------*
+     * Meter state. Only touched by the audio thread.
+     *-----------------------------------------------------------------------*/
+    audio_load_snapshot_t   state;
+
+    /*------------------------------------------------------------------------*
+     * Published snapshot. `sequence` is odd while a publication is in
+     * progress.
+     *-----------------------------------------------------------------------*/
+    atomic_uint             sequence;
+    atomic_uint             snapshot[LOAD_SNAPSHOT_WORDS];
+};
+
+audio_load_config_t audio_load_config_default(void)
+{
+    audio_load_config_t config;
+    config.smoothing_time = 0.3f;
+    config.peak_release_time = 1.5f;
+    config.high_threshold = 0.8f;
+    config.low_threshold = 0.6f;
+    return config;
+}
+
+audio_load_meter_t *audio_load_meter_create(audio_load_config_t config)
+{
+    audio_load_meter_t *meter = calloc(1, sizeof(audio_load_meter_t));
+    if (!meter) return NULL;
+
+    audio_load_meter_set_config(meter, config);
+    atomic_init(&meter->sequence, 0);
+    for (size_t i = 0; i < LOAD_SNAPSHOT_WORDS; i++)
+        atomic_init(&meter->snapshot[i], 0);
+
+    return meter;
+}
+
+void audio_load_meter_destroy(audio_load_meter_t *meter)
+{
+    free(meter);
+}
+
+void audio_load_meter_set_config(audio_load_meter_t *meter, audio_load_config_t config)
+{
+    atomic_store_explicit(&meter->smoothing_time, config.smoothing_time, memory_order_relaxed);
+    atomic_store_explicit(&meter->peak_release_time, config.peak_release_time, memory_order_relaxed);
+    atomic_store_explicit(&meter->high_threshold, config.high_threshold, memory_order_relaxed);
+    atomic_store_explicit(&meter->low_threshold, config.low_threshold, memory_order_relaxed);
+}
+
+/*----------------------------------------------------------------------------*
+ * Per-block decay coefficient for an exponential with the given time
+ * constant. A non-positive time constant means no smoothing.
+ *----------------------------------------------------------------------------*/
+static float audio_load_decay(float time_constant, double period)
+{
+    if (time_constant <= 0.0f)
+        return 0.0f;
+    return expf(-(float) period / time_constant);
+}
+
+static void audio_load_meter_publish(audio_load_meter_t *meter)
+{
+    uint32_t words[LOAD_SNAPSHOT_WORDS];
+    memcpy(words, &meter->state, sizeof(words));
+
+    unsigned int sequence = atomic_load_explicit(&meter->sequence, memory_order_relaxed);
+    atomic_store_explicit(&meter->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < LOAD_SNAPSHOT_WORDS; i++)
+        atomic_store_explicit(&meter->snapshot[i], words[i], memory_order_relaxed);
+
+    atomic_store_explicit(&meter->sequence, sequence + 2, memory_order_release);
+}
+
+void audio_load_meter_process(audio_load_meter_t *meter,
+                              double time,
+                              const double *stage_times,
+                              int num_stages,
+                              double period)
+{
+    if (period <= 0.0) return;
+    if (!stage_times || num_stages < 0)
+        num_stages = 0;
+    if (num_stages > AUDIO_LOAD_MAX_STAGES)
+        num_stages = AUDIO_LOAD_MAX_STAGES;
+
+    audio_load_snapshot_t *state = &meter->state;
+    float decay = audio_load_decay(atomic_load_explicit(&meter->smoothing_time, memory_order_relaxed), period);
+    float peak_decay = audio_load_decay(atomic_load_explicit(&meter->peak_release_time, memory_order_relaxed), period);
+
+    float load = (float) (time / period);
+    state->load = load + (state->load - load) * decay;
+    state->peak = fmaxf(load, state->peak * peak_decay);
+
+    /*------------------------------------------------------------------------*
+     * Stages that drop out of the chain decay away rather than vanish.
+     *-----------------------------------------------------------------------*/
+    if (num_stages > state->num_stages)
+        state->num_stages = num_stages;
+    for (int s = 0; s < state->num_stages; s++)
+    {
+        float stage_load = (s < num_stages) ? (float) (stage_times[s] / period) : 0.0f;
+        state->stages[s] = stage_load + (state->stages[s] - stage_load) * decay;
+    }
+
+    if (!state->high && state->load >= atomic_load_explicit(&meter->high_threshold, memory_order_relaxed))
+    {
+        state->high = 1;
+        state->high_count++;
+    }
+    else if (state->high && state->load < atomic_load_explicit(&meter->low_threshold, memory_order_relaxed))
+    {
+        state->high = 0;
+    }
+
+    audio_load_meter_publish(meter);
+}
+
+void audio_load_meter_read(audio_load_meter_t *meter, audio_load_snapshot_t *snapshot)
+{
+    uint32_t words[LOAD_SNAPSHOT_WORDS];
+    unsigned int before, after;
+
+    do
+    {
+        before = atomic_load_explicit(&meter->sequence, memory_order_acquire);
+        for (size_t i = 0; i < LOAD_SNAPSHOT_WORDS; i++)
+            words[i] = atomic_load_explicit(&meter->snapshot[i], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&meter->sequence, memory_order_relaxed);
+    }
+    while ((before & 1) || before != after);
+
+    memcpy(snapshot, words, sizeof(words));
+}
@@ -0,0 +1,121 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOLoadMeter
+ *
+ *  DSP load meter: the fraction of each I/O period spent rendering, as
+ *  shown by the "CPU" readout of audio hosts. A load of 1 means a block
+ *  took its whole period to render; above that, the deadline was missed.
+ *
+ *  The audio thread times each block, and optionally each stage of its
+ *  processing, and calls audio_load_meter_process(); any other thread may
+ *  read a consistent snapshot at any time with audio_load_meter_read().
+ *  As with AudioIOMeter, snapshots are published through a sequence
+ *  lock, so the audio thread never waits for readers.
+ *
+ *  Ballistics:
+ *   - load:    exponentially-weighted mean over `smoothing_time`
+ *   - peak:    instant attack, exponential release over `peak_release_time`
+ *   - stages:  each stage's share of the period, smoothed as the load
+ *
+ *  The smoothed load is also compared against a pair of thresholds, with
+ *  hysteresis: the meter goes high when the load reaches `high_threshold`,
+ *  and back to normal when it falls below `low_threshold`.
+ *
+ *  Example usage:
+ *
+ *  audio_load_snapshot_t load;
+ *  audio_load_meter_read(meter, &load);
+ *  printf("DSP %.0f%% (peak %.0f%%)\n", load.load * 100, load.peak * 100);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_LOAD_METER_H
+#define AUDIO_IO_LOAD_METER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Maximum number of stages timed. Further stages are ignored.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_LOAD_MAX_STAGES 8
+
+/**-----------------------------------------------------------------------------
+ * Ballistics and thresholds. Times are in seconds; thresholds are loads.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    float   smoothing_time;
+    float   peak_release_time;
+    float   high_threshold;
+    float   low_threshold;
+} audio_load_config_t;
+
+/**-----------------------------------------------------------------------------
+ * Load as a fraction of the period: overall, its recent peak, and per
+ * stage. `high` is nonzero while the load is above the thresholds, and
+ * `high_count` is the number of times it has gone high since creation.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    float       load;
+    float       peak;
+    int32_t     num_stages;
+    float       stages[AUDIO_LOAD_MAX_STAGES];
+    int32_t     high;
+    uint32_t    high_count;
+} audio_load_snapshot_t;
+
+typedef struct audio_load_meter audio_load_meter_t;
+
+/**-----------------------------------------------------------------------------
+ * Returns a reasonable default configuration: 300ms smoothing, 1.5s peak
+ * release, high at 80% load and normal again below 60%.
+ *----------------------------------------------------------------------------*/
+audio_load_config_t audio_load_config_default(void);
+
+/**-----------------------------------------------------------------------------
+ * Create a new load meter.
+ *----------------------------------------------------------------------------*/
+audio_load_meter_t *audio_load_meter_create(audio_load_config_t config);
+
+/**-----------------------------------------------------------------------------
+ * Free a load meter.
+ *----------------------------------------------------------------------------*/
+void audio_load_meter_destroy(audio_load_meter_t *meter);
+
+/**-----------------------------------------------------------------------------
+ * Change the meter's configuration. May be called from any thread; takes
+ * effect from the next block.
+ *----------------------------------------------------------------------------*/
+void audio_load_meter_set_config(audio_load_meter_t *meter, audio_load_config_t config);
+
+/**-----------------------------------------------------------------------------
+ * Record the time taken to render one block, and publish the result.
+ * Realtime-safe. Must only be called from one thread.
+ *
+ * @param time          Time taken to render the block (seconds).
+ * @param stage_times   Time taken by each stage (seconds), or NULL.
+ * @param num_stages    Number of stages.
+ * @param period        Duration of the block (seconds).
+ *----------------------------------------------------------------------------*/
+void audio_load_meter_process(audio_load_meter_t *meter,
+                              double time,
+                              const double *stage_times,
+                              int num_stages,
+                              double period);
+
+/**-----------------------------------------------------------------------------
+ * Read the most recently published load. May be called from any thread,
+ * and never blocks the audio thread.
+ *----------------------------------------------------------------------------*/
+void audio_load_meter_read(audio_load_meter_t *meter, audio_load_snapshot_t *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
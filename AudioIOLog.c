@@ -0,0 +1,366 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOLog
+ *
+ *  Lock-free message queue, formatted and written on a background thread.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOLog.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+/*----------------------------------------------------------------------------*
+ * How often the logger's thread looks for new messages. Polling keeps the
+ * audio thread from ever having to wake it.
+ *----------------------------------------------------------------------------*/
+#define LOG_POLL_INTERVAL_NS 20000000
+
+typedef struct
+{
+    uint64_t        time;
+    const char     *format;
+    int             num_args;
+    audio_log_arg_t args[AUDIO_LOG_MAX_ARGS];
+} log_record_t;
+
+/*----------------------------------------------------------------------------*
+ * A bounded multi-producer queue, as described by Dmitry Vyukov. Each
+ * slot's `sequence` says whose turn it is: it equals the write position
+ * when the slot is free for that write, and the write position + 1 once
+ * the record is complete and ready to be read.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    atomic_size_t   sequence;
+    log_record_t    record;
+} log_slot_t;
+
+static log_slot_t              *log_slots;
+static size_t                   log_capacity;
+static atomic_size_t            log_write_position;
+static size_t                   log_read_position;
+static atomic_int               log_running;
+static atomic_uint_least64_t    log_dropped;
+static uint64_t                 log_start_time;
+
+static pthread_t                log_thread;
+static audio_log_writer_t       log_writer;
+static void                    *log_writer_context;
+
+static inline uint64_t log_now(void)
+{
+#ifdef __APPLE__
+    return mach_absolute_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static double log_ticks_to_seconds(uint64_t ticks)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    return (double) ticks * timebase.numer / timebase.denom / 1e9;
+#else
+    return (double) ticks / 1e9;
+#endif
+}
+
+void audio_log_write(const char *format, int num_args, ...)
+{
+    if (!atomic_load_explicit(&log_running, memory_order_acquire))
+        return;
+
+    /*------------------------------------------------------------------------*
+     * Claim the next free slot, or drop the message if there is none.
+     *-----------------------------------------------------------------------*/
+    size_t position = atomic_load_explicit(&log_write_position, memory_order_relaxed);
+    log_slot_t *slot;
+    for (;;)
+    {
+        slot = &log_slots[position & (log_capacity - 1)];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+
+        if (difference == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&log_write_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+        {
+            atomic_fetch_add_explicit(&log_dropped, 1, memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            position = atomic_load_explicit(&log_write_position, memory_order_relaxed);
+        }
+    }
+
+    log_record_t *record = &slot->record;
+    record->time = log_now();
+    record->format = format;
+    record->num_args = num_args < AUDIO_LOG_MAX_ARGS ? num_args : AUDIO_LOG_MAX_ARGS;
+
+    va_list args;
+    va_start(args, num_args);
+    for (int i = 0; i < record->num_args; i++)
+        record->args[i] = va_arg(args, audio_log_arg_t);
+    va_end(args);
+
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+}
+
+uint64_t audio_log_dropped(void)
+{
+    return atomic_load_explicit(&log_dropped, memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Formatting
+////////////////////////////////////////////////////////////////////////////////
+
+/*----------------------------------------------------------------------------*
+ * Format one conversion, given its specification without any length
+ * modifier, and its argument. The argument is converted to suit the
+ * conversion where possible, so that a mismatched argument can't misread
+ * memory.
+ *----------------------------------------------------------------------------*/
+static int log_format_argument(char *output, size_t size, char *spec, size_t length, char conversion,
+                               const audio_log_arg_t *arg)
+{
+    switch (conversion)
+    {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+        {
+            int64_t value = arg->type == AUDIO_LOG_ARG_DOUBLE ? (int64_t) arg->value.d :
+                            arg->type == AUDIO_LOG_ARG_INT ? arg->value.i : (int64_t) (intptr_t) arg->value.p;
+            if (conversion == 'c')
+            {
+                memcpy(spec + length, "c", 2);
+                return snprintf(output, size, spec, (int) value);
+            }
+            spec[length] = 'l';
+            spec[length + 1] = 'l';
+            spec[length + 2] = conversion;
+            spec[length + 3] = '\0';
+            if (conversion == 'd' || conversion == 'i')
+                return snprintf(output, size, spec, (long long) value);
+            return snprintf(output, size, spec, (unsigned long long) value);
+        }
+
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        {
+            double value = arg->type == AUDIO_LOG_ARG_DOUBLE ? arg->value.d :
+                           arg->type == AUDIO_LOG_ARG_INT ? (double) arg->value.i : 0.0;
+            spec[length] = conversion;
+            spec[length + 1] = '\0';
+            return snprintf(output, size, spec, value);
+        }
+
+        case 's':
+        {
+            const char *value = arg->type == AUDIO_LOG_ARG_STRING && arg->value.s ? arg->value.s : "(?)";
+            spec[length] = 's';
+            spec[length + 1] = '\0';
+            return snprintf(output, size, spec, value);
+        }
+
+        case 'p':
+        {
+            const void *value = arg->type == AUDIO_LOG_ARG_INT ? (const void *) (intptr_t) arg->value.i :
+                                arg->type == AUDIO_LOG_ARG_DOUBLE ? NULL : arg->value.p;
+            spec[length] = 'p';
+            spec[length + 1] = '\0';
+            return snprintf(output, size, spec, value);
+        }
+
+        default:
+            return -1;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ * Format a record as printf would have. Conversions that can't be
+ * formatted, such as those with `*` widths or with no argument left, are
+ * copied out as they are.
+ *----------------------------------------------------------------------------*/
+static void log_format(const log_record_t *record, char *output, size_t size)
+{
+    const char *format = record->format;
+    size_t used = 0;
+    int next = 0;
+
+    while (*format && used + 1 < size)
+    {
+        if (*format != '%')
+        {
+            output[used++] = *format++;
+            continue;
+        }
+        if (format[1] == '%')
+        {
+            output[used++] = '%';
+            format += 2;
+            continue;
+        }
+
+        /*--------------------------------------------------------------------*
+         * Copy the flags, width and precision, and skip any length modifier,
+         * which log_format_argument() chooses for itself.
+         *-------------------------------------------------------------------*/
+        char spec[32];
+        size_t length = 0;
+        const char *c = format + 1;
+        while (*c && strchr("-+ #0123456789.", *c) && length < sizeof(spec) - 5)
+            spec[length++] = *c++;
+        while (*c && strchr("hlLqjzt", *c))
+            c++;
+
+        int written = -1;
+        if (*c && next < record->num_args)
+        {
+            memmove(spec + 1, spec, length);
+            spec[0] = '%';
+            written = log_format_argument(output + used, size - used, spec, length + 1, *c, &record->args[next]);
+        }
+
+        if (written < 0)
+        {
+            size_t n = (size_t) (c - format) + (*c ? 1 : 0);
+            if (n > size - used - 1)
+                n = size - used - 1;
+            memcpy(output + used, format, n);
+            used += n;
+        }
+        else
+        {
+            next++;
+            used += (size_t) written;
+            if (used > size - 1)
+                used = size - 1;
+        }
+        format = *c ? c + 1 : c;
+    }
+
+    output[used] = '\0';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Logger thread
+////////////////////////////////////////////////////////////////////////////////
+
+static void log_write_to_stderr(void *context, double time, const char *message)
+{
+    (void) context;
+    fprintf(stderr, "[%.6f] %s\n", time, message);
+}
+
+/*----------------------------------------------------------------------------*
+ * Format and write every complete record in the queue. Records are
+ * copied out first, so that their slots are freed as soon as possible.
+ *----------------------------------------------------------------------------*/
+static void log_drain(void)
+{
+    char message[AUDIO_LOG_MESSAGE_SIZE];
+
+    for (;;)
+    {
+        log_slot_t *slot = &log_slots[log_read_position & (log_capacity - 1)];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence != log_read_position + 1)
+            break;
+
+        log_record_t record = slot->record;
+        atomic_store_explicit(&slot->sequence, log_read_position + log_capacity, memory_order_release);
+        log_read_position++;
+
+        log_format(&record, message, sizeof(message));
+        double time = record.time >= log_start_time ? log_ticks_to_seconds(record.time - log_start_time) : 0;
+        log_writer(log_writer_context, time, message);
+    }
+}
+
+static void *log_thread_main(void *context)
+{
+    (void) context;
+    struct timespec interval = { 0, LOG_POLL_INTERVAL_NS };
+
+    while (atomic_load_explicit(&log_running, memory_order_relaxed))
+    {
+        log_drain();
+        nanosleep(&interval, NULL);
+    }
+    log_drain();
+
+    return NULL;
+}
+
+int audio_log_start(int capacity, audio_log_writer_t writer, void *context)
+{
+    if (atomic_load(&log_running))
+        return 0;
+
+    if (!log_slots)
+    {
+        size_t slots = 1;
+        while (slots < (size_t) (capacity > 0 ? capacity : AUDIO_LOG_DEFAULT_CAPACITY))
+            slots <<= 1;
+
+        /*--------------------------------------------------------------------*
+         * calloc'd memory may not be backed yet; touch it now, so that the
+         * first messages logged on the audio thread don't fault.
+         *-------------------------------------------------------------------*/
+        log_slots = malloc(slots * sizeof(log_slot_t));
+        if (!log_slots) return -1;
+        memset(log_slots, 0, slots * sizeof(log_slot_t));
+
+        for (size_t i = 0; i < slots; i++)
+            atomic_init(&log_slots[i].sequence, i);
+        atomic_init(&log_write_position, 0);
+        log_read_position = 0;
+        log_capacity = slots;
+    }
+
+    log_writer = writer ? writer : log_write_to_stderr;
+    log_writer_context = context;
+    log_start_time = log_now();
+
+    atomic_store(&log_running, 1);
+    if (pthread_create(&log_thread, NULL, log_thread_main, NULL) != 0)
+    {
+        atomic_store(&log_running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void audio_log_stop(void)
+{
+    if (!atomic_load(&log_running))
+        return;
+
+    atomic_store(&log_running, 0);
+    pthread_join(log_thread, NULL);
+}
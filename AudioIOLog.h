@@ -0,0 +1,211 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOLog
+ *
+ *  Realtime-safe deferred logging, for diagnosing problems on the audio
+ *  thread, where NSLog and printf must never be called: they take locks,
+ *  allocate and do I/O.
+ *
+ *  Logging a message does none of these. It copies the format string
+ *  pointer and the binary values of its arguments into a fixed-size
+ *  record, and pushes the record onto a lock-free queue. A background
+ *  thread later pops the records, formats them and hands them to a
+ *  writer. If the queue is full, the message is dropped and counted
+ *  instead.
+ *
+ *  Messages are logged with the AUDIO_LOG macro, which takes a printf
+ *  format and up to AUDIO_LOG_MAX_ARGS integer, floating-point, pointer
+ *  or string arguments. Formats and string arguments are not copied, so
+ *  they must outlive the logger: in practice, they should be literals.
+ *  Build with AUDIO_LOG_ENABLED defined to 0 to compile the macro out
+ *  entirely.
+ *
+ *  Example usage:
+ *
+ *  audio_log_start(AUDIO_LOG_DEFAULT_CAPACITY, NULL, NULL);
+ *  ...
+ *  AUDIO_LOG("Render failed: %d at sample %.0f", (int) err, sampleTime);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_LOG_H
+#define AUDIO_IO_LOG_H
+
+#include <stdint.h>
+
+#ifndef AUDIO_LOG_ENABLED
+#define AUDIO_LOG_ENABLED 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Largest number of arguments per message. Default number of messages
+ * queued. Longest formatted message, including the terminator; longer
+ * messages are truncated.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_LOG_MAX_ARGS 6
+#define AUDIO_LOG_DEFAULT_CAPACITY 1024
+#define AUDIO_LOG_MESSAGE_SIZE 256
+
+typedef enum
+{
+    AUDIO_LOG_ARG_INT = 0,
+    AUDIO_LOG_ARG_DOUBLE,
+    AUDIO_LOG_ARG_STRING,
+    AUDIO_LOG_ARG_POINTER
+} audio_log_arg_type_t;
+
+/*----------------------------------------------------------------------------*
+ * One argument's binary value. Use the audio_log_arg_* constructors below.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    audio_log_arg_type_t type;
+    union
+    {
+        int64_t     i;
+        double      d;
+        const char *s;
+        const void *p;
+    } value;
+} audio_log_arg_t;
+
+/**-----------------------------------------------------------------------------
+ * Called on the logger's thread with each formatted message, and the
+ * time at which it was logged, in seconds since audio_log_start().
+ *----------------------------------------------------------------------------*/
+typedef void (*audio_log_writer_t)(void *context, double time, const char *message);
+
+/**-----------------------------------------------------------------------------
+ * Start the logger's thread, which writes messages to `writer`, or to
+ * stderr if `writer` is NULL. The first start allocates a queue of
+ * `capacity` messages (rounded up to a power of two); later starts reuse
+ * it. Does nothing if already started. Not realtime-safe.
+ *
+ * @returns 0 on success, or -1 if memory or the thread could not be
+ *          allocated.
+ *----------------------------------------------------------------------------*/
+int audio_log_start(int capacity, audio_log_writer_t writer, void *context);
+
+/**-----------------------------------------------------------------------------
+ * Write any messages still queued, then stop the logger's thread.
+ * Messages logged while stopped are discarded. Not realtime-safe.
+ *----------------------------------------------------------------------------*/
+void audio_log_stop(void);
+
+/**-----------------------------------------------------------------------------
+ * Queue a message, if started. `num_args` arguments of type
+ * audio_log_arg_t follow. Realtime-safe, and may be called from any
+ * number of threads; use AUDIO_LOG rather than calling directly.
+ *----------------------------------------------------------------------------*/
+void audio_log_write(const char *format, int num_args, ...);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of messages dropped since the first start because
+ * the queue was full.
+ *----------------------------------------------------------------------------*/
+uint64_t audio_log_dropped(void);
+
+static inline audio_log_arg_t audio_log_arg_int(int64_t value)
+{
+    audio_log_arg_t arg;
+    arg.type = AUDIO_LOG_ARG_INT;
+    arg.value.i = value;
+    return arg;
+}
+
+static inline audio_log_arg_t audio_log_arg_double(double value)
+{
+    audio_log_arg_t arg;
+    arg.type = AUDIO_LOG_ARG_DOUBLE;
+    arg.value.d = value;
+    return arg;
+}
+
+static inline audio_log_arg_t audio_log_arg_string(const char *value)
+{
+    audio_log_arg_t arg;
+    arg.type = AUDIO_LOG_ARG_STRING;
+    arg.value.s = value;
+    return arg;
+}
+
+static inline audio_log_arg_t audio_log_arg_pointer(const void *value)
+{
+    audio_log_arg_t arg;
+    arg.type = AUDIO_LOG_ARG_POINTER;
+    arg.value.p = value;
+    return arg;
+}
+
+#ifdef __cplusplus
+}
+
+static inline audio_log_arg_t audio_log_arg(bool value)                 { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(char value)                 { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(signed char value)          { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(unsigned char value)        { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(short value)                { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(unsigned short value)       { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(int value)                  { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(unsigned int value)         { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(long value)                 { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(unsigned long value)        { return audio_log_arg_int((int64_t) value); }
+static inline audio_log_arg_t audio_log_arg(long long value)            { return audio_log_arg_int(value); }
+static inline audio_log_arg_t audio_log_arg(unsigned long long value)   { return audio_log_arg_int((int64_t) value); }
+static inline audio_log_arg_t audio_log_arg(float value)                { return audio_log_arg_double(value); }
+static inline audio_log_arg_t audio_log_arg(double value)               { return audio_log_arg_double(value); }
+static inline audio_log_arg_t audio_log_arg(const char *value)          { return audio_log_arg_string(value); }
+static inline audio_log_arg_t audio_log_arg(const void *value)          { return audio_log_arg_pointer(value); }
+#else
+#define audio_log_arg(x) _Generic((x),                      \
+    _Bool:              audio_log_arg_int,                  \
+    char:               audio_log_arg_int,                  \
+    signed char:        audio_log_arg_int,                  \
+    unsigned char:      audio_log_arg_int,                  \
+    short:              audio_log_arg_int,                  \
+    unsigned short:     audio_log_arg_int,                  \
+    int:                audio_log_arg_int,                  \
+    unsigned int:       audio_log_arg_int,                  \
+    long:               audio_log_arg_int,                  \
+    unsigned long:      audio_log_arg_int,                  \
+    long long:          audio_log_arg_int,                  \
+    unsigned long long: audio_log_arg_int,                  \
+    float:              audio_log_arg_double,               \
+    double:             audio_log_arg_double,               \
+    char *:             audio_log_arg_string,               \
+    const char *:       audio_log_arg_string,               \
+    default:            audio_log_arg_pointer)(x)
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Count the arguments after the format, and wrap each of them in an
+ * audio_log_arg_t. The format is counted along with them, so that no
+ * variadic argument list is ever empty.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_LOG_FORMAT(...) AUDIO_LOG_FORMAT_(__VA_ARGS__, 0)
+#define AUDIO_LOG_FORMAT_(format, ...) format
+#define AUDIO_LOG_COUNT(...) AUDIO_LOG_COUNT_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0, 0)
+#define AUDIO_LOG_COUNT_(format, _1, _2, _3, _4, _5, _6, n, ...) n
+#define AUDIO_LOG_CONCAT(a, b) AUDIO_LOG_CONCAT_(a, b)
+#define AUDIO_LOG_CONCAT_(a, b) a##b
+#define AUDIO_LOG_ARGS_0(format)
+#define AUDIO_LOG_ARGS_1(format, a)                 , audio_log_arg(a)
+#define AUDIO_LOG_ARGS_2(format, a, b)              AUDIO_LOG_ARGS_1(format, a) AUDIO_LOG_ARGS_1(format, b)
+#define AUDIO_LOG_ARGS_3(format, a, b, c)           AUDIO_LOG_ARGS_2(format, a, b) AUDIO_LOG_ARGS_1(format, c)
+#define AUDIO_LOG_ARGS_4(format, a, b, c, d)        AUDIO_LOG_ARGS_3(format, a, b, c) AUDIO_LOG_ARGS_1(format, d)
+#define AUDIO_LOG_ARGS_5(format, a, b, c, d, e)     AUDIO_LOG_ARGS_4(format, a, b, c, d) AUDIO_LOG_ARGS_1(format, e)
+#define AUDIO_LOG_ARGS_6(format, a, b, c, d, e, f)  AUDIO_LOG_ARGS_5(format, a, b, c, d, e) AUDIO_LOG_ARGS_1(format, f)
+
+#if AUDIO_LOG_ENABLED
+#define AUDIO_LOG(...)                                                          \
+    audio_log_write(AUDIO_LOG_FORMAT(__VA_ARGS__), AUDIO_LOG_COUNT(__VA_ARGS__) \
+                    AUDIO_LOG_CONCAT(AUDIO_LOG_ARGS_, AUDIO_LOG_COUNT(__VA_ARGS__))(__VA_ARGS__))
+#else
+#define AUDIO_LOG(...)                      ((void) 0)
+#endif
+
+#endif
@@ -39,6 +39,19 @@
 #import <AudioToolbox/AudioToolbox.h>
 #import <AVFoundation/AVFoundation.h>
 
+#import "AudioIOBackend.h"
+#import "AudioIOGlitchDetector.h"
+#import "AudioIOArena.h"
+#import "AudioIOMeter.h"
+#import "AudioIOSpectrum.h"
+#import "AudioIOEventQueue.h"
+#import "AudioIOMixer.h"
+#import "AudioIOConvolver.h"
+#import "AudioIOBufferController.h"
+#import "AudioIOLoadMeter.h"
+#import "AudioIOLog.h"
+#import "AudioIOErrorCounter.h"
+
 #define AUDIO_BUFFER_SIZE 256
 #define AUDIO_PREFERRED_SAMPLE_RATE 44100
 #define AUDIO_PREFERRED_SESSION_MODE AVAudioSessionModeMeasurement
@@ -48,10 +61,129 @@
  *
  * When this function is called, `data` contains input samples.
  * To write output samples, overwrite the contents of `data`.
+ * Without input (see AudioIODirection), `data` contains silence; without
+ * output, anything written to `data` is discarded.
  *----------------------------------------------------------------------------*/
 typedef void (*audio_data_callback_t)(float **data, int num_channels, int num_frames, int samplerate);
+
+/**-----------------------------------------------------------------------------
+ * Typedef for an audio data I/O callback that is passed a context pointer
+ * (eg, a C++ object; see AudioIODispatch.hpp). Otherwise as above.
+ *----------------------------------------------------------------------------*/
+typedef void (*audio_context_callback_t)(void *context, float **data, int num_channels, int num_frames, int samplerate);
 typedef void (*audio_volume_change_callback_t)(float volume);
 
+/**-----------------------------------------------------------------------------
+ * Returns the render arena, from which the audio callback may take scratch
+ * buffers with audio_arena_scratch_alloc() instead of allocating memory.
+ * Scratch buffers are released automatically when the callback returns.
+ * NULL while the audio chain is not initialised.
+ *
+ * The arena holds renderScratchBuffers buffers of the largest block size
+ * per channel, less any in use by the manager itself.
+ *----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C"
+#endif
+audio_arena_t *audio_io_render_arena(void);
+
+/**-----------------------------------------------------------------------------
+ * Strategies for avoiding denormal slowdowns in the audio callback.
+ *
+ * FlushToZero:  denormals are flushed to zero in hardware for the duration
+ *               of the callback (the default).
+ * InjectOffset: flush-to-zero is left as-is, and an inaudible offset is
+ *               added to the input before the callback, so that recursive
+ *               filter state never decays into the denormal range. Its
+ *               sign alternates every buffer, so DC blockers don't remove
+ *               it.
+ * None:         no protection.
+ *----------------------------------------------------------------------------*/
+typedef NS_ENUM(NSInteger, AudioIODenormalMode)
+{
+    AudioIODenormalModeFlushToZero,
+    AudioIODenormalModeInjectOffset,
+    AudioIODenormalModeNone
+};
+
+/**-----------------------------------------------------------------------------
+ * Quality of the sample rate converter between the hardware and the
+ * audio callback.
+ *
+ * Other than None, these are hints, passed to AURemoteIO as its converter
+ * complexity (linear, normal and mastering respectively). The unit may
+ * reject a hint, in which case its default converter is used (see
+ * resamplerQualityApplied), or accept it and convert as it sees fit; the
+ * cost and latency of each have not been measured.
+ *
+ * None:   no conversion; the callback runs at whatever rate the hardware
+ *         settles on, which may differ from AUDIO_PREFERRED_SAMPLE_RATE.
+ * Low:    asks for the cheapest conversion.
+ * Medium: asks for the system's normal conversion.
+ * High:   asks for the system's highest quality conversion.
+ *----------------------------------------------------------------------------*/
+typedef NS_ENUM(NSInteger, AudioIOResamplerQuality)
+{
+    AudioIOResamplerQualityNone,
+    AudioIOResamplerQualityLow,
+    AudioIOResamplerQualityMedium,
+    AudioIOResamplerQualityHigh
+};
+
+
+/**-----------------------------------------------------------------------------
+ * Which directions of audio the I/O unit carries. Enabling only what is
+ * needed avoids pulling input that is never used (and, for output-only,
+ * the microphone permission prompt), and selects the matching session
+ * category.
+ *
+ * Duplex:      input and output (PlayAndRecord category).
+ * InputOnly:   input only (Record category); the callback's output is
+ *              discarded.
+ * OutputOnly:  output only (Playback category); the callback is given
+ *              silence as input.
+ *----------------------------------------------------------------------------*/
+typedef NS_ENUM(NSInteger, AudioIODirection)
+{
+    AudioIODirectionDuplex,
+    AudioIODirectionInputOnly,
+    AudioIODirectionOutputOnly
+};
+
+
+/**-----------------------------------------------------------------------------
+ * Shape of output gain ramps.
+ *
+ * Linear:      linear in amplitude.
+ * Exponential: linear in decibels, which sounds even to the ear. Ramps to
+ *              and from silence pass through -80dB.
+ *----------------------------------------------------------------------------*/
+typedef NS_ENUM(NSInteger, AudioIOGainRamp)
+{
+    AudioIOGainRampLinear,
+    AudioIOGainRampExponential
+};
+
+
+/**-----------------------------------------------------------------------------
+ * Stages of the render chain, in order, timed separately for dspLoad.
+ *
+ * Input:       pulling input from the unit, input metering and analysis.
+ * Callback:    the audio callback, or the latency probe.
+ * Mixer:       mixing the mixer's sources into the output.
+ * Convolver:   convolution with the impulse response.
+ * Output:      output gain, metering and glitch detection.
+ *----------------------------------------------------------------------------*/
+typedef NS_ENUM(NSInteger, AudioIOLoadStage)
+{
+    AudioIOLoadStageInput,
+    AudioIOLoadStageCallback,
+    AudioIOLoadStageMixer,
+    AudioIOLoadStageConvolver,
+    AudioIOLoadStageOutput,
+    AudioIOLoadStageCount
+};
+
 
 /**-----------------------------------------------------------------------------
  * Protocol for delegates to follow.
@@ -66,10 +198,28 @@ typedef void (*audio_volume_change_callback_t)(float volume);
             numFrames:(UInt32)numFrames;
 
 /**-----------------------------------------------------------------------------
- * Called when the IO port is changed (eg, from speaker to headphones)
+ * Called when the IO port is changed (eg, from speaker to headphones).
+ *
+ * The audio unit is stopped during this call, so it is safe to reallocate
+ * memory used by the audio thread. Implementing this method therefore
+ * briefly interrupts audio, with a fade, on every route change; implement
+ * audioIORouteChanged instead if that isn't needed.
+ *
+ * Called on the manager's internal control queue, not the main thread.
  *----------------------------------------------------------------------------*/
 - (void) audioIOPortChanged;
 
+/**-----------------------------------------------------------------------------
+ * Called after every route change, once the audio unit is running again.
+ * Audio is only stopped for a route change if the client sample rate had
+ * to be renegotiated, or the delegate implements audioIOPortChanged; the
+ * channel count and sample format are fixed, and never change. Memory used
+ * by the audio thread must not be reallocated during this call.
+ *
+ * Called on the manager's internal control queue, not the main thread.
+ *----------------------------------------------------------------------------*/
+- (void) audioIORouteChanged;
+
 @end
 
 
@@ -99,6 +249,14 @@ typedef void (*audio_volume_change_callback_t)(float volume);
  *----------------------------------------------------------------------------*/
 - (id)          initWithCallback:(audio_data_callback_t)callback;
 
+/**-----------------------------------------------------------------------------
+ * Create a new audio I/O unit.
+ *
+ * @param callback A pure C function called when an audio buffer is available.
+ * @param context  Pointer passed to each call, which must outlive the manager.
+ *----------------------------------------------------------------------------*/
+- (id)          initWithCallback:(audio_context_callback_t)callback context:(void *)context;
+
 /**-----------------------------------------------------------------------------
  * Create a new audio I/O unit.
  *
@@ -124,10 +282,77 @@ typedef void (*audio_volume_change_callback_t)(float volume);
 - (OSStatus)    start;
 
 /**-----------------------------------------------------------------------------
- * Stop audio.
+ * Asynchronous equivalents of setup and start. Session activation and unit
+ * initialisation can take tens of milliseconds or more; these perform them
+ * on the manager's control queue rather than the calling thread.
+ *
+ * @param completion Called on the main queue once complete. May be nil.
+ *----------------------------------------------------------------------------*/
+- (void)        setupWithCompletion:(void (^)(BOOL success))completion;
+- (void)        startWithCompletion:(void (^)(OSStatus error))completion;
+
+/**-----------------------------------------------------------------------------
+ * Time from the most recent request to start audio (start or
+ * startWithCompletion:, while stopped) to the first audio callback that
+ * followed it, in seconds. Zero if no callback has happened since.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSTimeInterval timeToFirstCallback;
+
+/**-----------------------------------------------------------------------------
+ * Duration of the audio callback: the first call after audio was started,
+ * and a running average of the calls since, in seconds. A first call much
+ * slower than the average indicates cold-start costs (see warmUpCallbacks).
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSTimeInterval firstCallbackDuration;
+@property (readonly) NSTimeInterval steadyStateCallbackDuration;
+
+/**-----------------------------------------------------------------------------
+ * Number of times the audio callback is run on silent buffers during
+ * setup, before audio starts, so that the code and memory it uses are
+ * paged in and cached. Output from these calls is discarded. The callback
+ * must therefore tolerate being called before audio starts. Each call
+ * is for the configured buffer size, at the client sample rate.
+ * Defaults to 0, so that warm-up is opt-in; 4 is usually enough.
+ * Must be set prior to initializing the audio chain.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSUInteger warmUpCallbacks;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to lock the render arena and callback data into memory with mlock,
+ * so that they cannot be paged out. Defaults to NO.
+ * Must be set prior to initializing the audio chain.
+ *----------------------------------------------------------------------------*/
+@property (assign) BOOL locksRenderMemory;
+
+/**-----------------------------------------------------------------------------
+ * Size of the render arena, in buffers of the largest block the hardware
+ * may request, per channel. Defaults to 8.
+ * Must be set prior to initializing the audio chain.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSUInteger renderScratchBuffers;
+
+/**-----------------------------------------------------------------------------
+ * Size of the render arena, and the most of it ever in use at once,
+ * in bytes. Zero while the audio chain is not initialised.
+ *----------------------------------------------------------------------------*/
+@property (readonly) size_t renderArenaSize;
+@property (readonly) size_t renderArenaHighWaterMark;
+
+/**-----------------------------------------------------------------------------
+ * Stop audio. Waits for the fade out (see startStopFadeDuration) to be
+ * played, so blocks the calling thread for about that long plus an I/O
+ * period or two. stopWithCompletion: doesn't block.
  *----------------------------------------------------------------------------*/
 - (OSStatus)    stop;
 
+/**-----------------------------------------------------------------------------
+ * Asynchronous equivalent of stop, performed on the manager's control
+ * queue.
+ *
+ * @param completion Called on the main queue once stopped. May be nil.
+ *----------------------------------------------------------------------------*/
+- (void)        stopWithCompletion:(void (^)(OSStatus error))completion;
+
 /**-----------------------------------------------------------------------------
  * Tear down audio IO.
  *----------------------------------------------------------------------------*/
@@ -138,11 +363,333 @@ typedef void (*audio_volume_change_callback_t)(float volume);
  *----------------------------------------------------------------------------*/
 - (double)      sampleRate;
 
+/**-----------------------------------------------------------------------------
+ * Returns the sample rate seen by the audio callback. This is always
+ * AUDIO_PREFERRED_SAMPLE_RATE when resampling is enabled, and the
+ * hardware sample rate otherwise. The latency added by sample rate
+ * conversion isn't reported by the system; it is included in the round
+ * trip found by measureLatencyWithCompletion:.
+ *----------------------------------------------------------------------------*/
+- (double)      clientSampleRate;
+
+/**-----------------------------------------------------------------------------
+ * Returns the time taken by the most recent reconfiguration of the audio
+ * unit following a route change, in seconds.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSTimeInterval lastReconfigurationDuration;
+
+/**-----------------------------------------------------------------------------
+ * Route changes, interruptions and foreground events arriving within this
+ * interval of each other are coalesced into a single reconfiguration of
+ * the audio chain, performed off the main thread. Defaults to 0.1s.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSTimeInterval reconfigurationCoalescingInterval;
+
+/**-----------------------------------------------------------------------------
+ * Number of session events received, and number of reconfigurations
+ * actually performed in response.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSUInteger reconfigurationEventsReceived;
+@property (readonly) NSUInteger reconfigurationsPerformed;
+
+/**-----------------------------------------------------------------------------
+ * Receive volume changes, route changes, interruptions and media services
+ * resets as AudioIOEvents, timestamped against the audio sample clock and
+ * delivered in batches. Consecutive events of the same kind are coalesced.
+ *
+ * @param handler   Called with each batch of events, or nil to stop
+ *                  receiving events.
+ * @param queue     The queue on which to call the handler. Defaults to the
+ *                  main queue if nil.
+ *----------------------------------------------------------------------------*/
+- (void) setEventHandler:(void (^)(NSArray<AudioIOEvent *> *events))handler queue:(dispatch_queue_t)queue;
+
+/**-----------------------------------------------------------------------------
+ * The queue through which events are delivered, or nil if there is no
+ * event handler. Use to adjust the batch interval or read statistics.
+ *----------------------------------------------------------------------------*/
+@property (readonly) AudioIOEventQueue *eventQueue;
+
+/**-----------------------------------------------------------------------------
+ * Returns the position of the audio sample clock at the given host time
+ * (see mach_absolute_time), extrapolated from the most recent audio
+ * callback, in the units of the callback's time stamps: frames at the
+ * hardware sample rate, which differs from the callback's when resampling.
+ * Returns -1 if audio is not running.
+ *----------------------------------------------------------------------------*/
+- (double) sampleTimeAtHostTime:(uint64_t)hostTime;
+- (double) currentSampleTime;
+
 /**-----------------------------------------------------------------------------
  * Returns the current session's hardware output volume [0, 1]
  *----------------------------------------------------------------------------*/
 - (double)      volume;
 
+/**-----------------------------------------------------------------------------
+ * Returns the round-trip latency reported by the current session:
+ * input latency + output latency + one I/O buffer, in seconds.
+ *----------------------------------------------------------------------------*/
+- (NSTimeInterval) reportedLatency;
+
+/**-----------------------------------------------------------------------------
+ * Returns the I/O buffer size in use, in frames at the session sample rate.
+ *----------------------------------------------------------------------------*/
+- (NSUInteger) bufferSize;
+
+/**-----------------------------------------------------------------------------
+ * Number of deadline overruns since audio was last started: callbacks
+ * whose time stamp shows that one or more I/O periods were missed.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSUInteger overrunCount;
+
+/**-----------------------------------------------------------------------------
+ * Errors returned by AudioUnitRender() when pulling input, counted by code
+ * with the mach_absolute_time() of each code's first and last occurrence.
+ * Use audio_error_counter_read() for the counts, and
+ * audio_error_counter_consecutive() to tell a persistent failure from a
+ * passing one.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, readonly) audio_error_counter_t *renderErrors;
+
+/**-----------------------------------------------------------------------------
+ * Total number of AudioUnitRender() errors when pulling input.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSUInteger renderErrorCount;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to pass silence to the audio callback in place of any block
+ * of input that couldn't be pulled, rather than whatever the buffers held.
+ * Defaults to NO. May be changed at any time.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) BOOL silencesInputErrors;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to adapt the I/O buffer size to what the device sustains,
+ * rather than using AUDIO_BUFFER_SIZE: start at the smallest size in
+ * bufferControllerConfig, double it on repeated overruns, and halve it
+ * again after a sustained period with headroom. Defaults to NO.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) BOOL adaptsBufferSize;
+
+/**-----------------------------------------------------------------------------
+ * Sizes and thresholds for adaptsBufferSize. Set before enabling it.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) audio_buffer_controller_config_t bufferControllerConfig;
+
+/**-----------------------------------------------------------------------------
+ * Called when adaptsBufferSize changes the buffer size, with the new size
+ * (frames), the resulting reportedLatency, and the decision that led to
+ * it. Called on the manager's internal control queue.
+ *----------------------------------------------------------------------------*/
+@property (copy) void (^bufferSizeChangedBlock)(NSUInteger bufferSize, NSTimeInterval latency, audio_buffer_decision_t decision);
+
+/**-----------------------------------------------------------------------------
+ * Measure the actual round-trip latency from output to input.
+ *
+ * A short sine sweep is played through the output and located in the input
+ * by cross-correlation. The audio callback is suspended and the output is
+ * replaced by the test signal for the duration of the measurement, which
+ * typically takes under a second. The output gain and mute don't apply to
+ * the test signal.
+ *
+ * Audio must already be started, and the output must be audible to the
+ * input (eg, speaker and built-in mic, or a loopback cable).
+ *
+ * @param completion Called on the main queue with the measured latency in
+ *                   seconds, or -1 if the measurement failed.
+ *----------------------------------------------------------------------------*/
+- (void) measureLatencyWithCompletion:(void (^)(NSTimeInterval latency))completion;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to scan the output for clicks, dropouts and missed periods.
+ * Cheap enough to leave enabled in production. Has no effect when the
+ * direction is AudioIODirectionInputOnly.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) BOOL detectsGlitches;
+
+/**-----------------------------------------------------------------------------
+ * The glitch detector, or NULL if glitch detection has never been enabled.
+ * Use audio_glitch_detector_read_events() and audio_glitch_detector_count()
+ * to retrieve detected glitches.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, readonly) audio_glitch_detector_t *glitchDetector;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to mix the mixer's sources into the output, after the audio
+ * callback. Sources are added to whatever the callback leaves in the
+ * buffers: silence with AudioIODirectionOutputOnly, or if the callback
+ * clears them.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) BOOL mixesSources;
+
+/**-----------------------------------------------------------------------------
+ * The mixer, or NULL if mixing has never been enabled. Add sources with
+ * audio_mixer_add_source().
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, readonly) audio_mixer_t *mixer;
+
+/**-----------------------------------------------------------------------------
+ * Convolve the output with an impulse response (eg, a reverb or room
+ * correction), after the mixer and before the output gain. The response
+ * is copied; pass NULL to stop convolving. May be called while running.
+ *
+ * Long responses are convolved partly on a background thread. The output
+ * is delayed by the I/O buffer size rounded down to a power of two, and
+ * the convolver is rebuilt whenever the buffer size changes (eg, with
+ * adaptsBufferSize).
+ *
+ * @returns NO if the convolver could not be created.
+ *----------------------------------------------------------------------------*/
+- (BOOL) setConvolutionImpulseResponse:(const float *)impulseResponse length:(int)length;
+
+/**-----------------------------------------------------------------------------
+ * The convolver, or NULL if there is no impulse response. Use
+ * audio_convolver_stats() to read its CPU cost.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, readonly) audio_convolver_t *convolver;
+
+/**-----------------------------------------------------------------------------
+ * Linear gain applied to the output after the audio callback. Changes are
+ * ramped over gainRampDuration, so never click. Defaults to 1.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) float outputGain;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to fade the output to silence; NO to fade it back in.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) BOOL muted;
+
+/**-----------------------------------------------------------------------------
+ * Duration and shape of ramps on changes to outputGain, muted and the
+ * hardware volume. Default to 20ms, exponential.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSTimeInterval gainRampDuration;
+@property (assign) AudioIOGainRamp gainRampShape;
+
+/**-----------------------------------------------------------------------------
+ * Duration of the fade in after start, and the fade out before stop
+ * (which delays stop by about this long plus one or two I/O periods, or
+ * by at most two periods if audio has stopped rendering, eg during an
+ * interruption). Defaults to 10ms; 0 disables.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSTimeInterval startStopFadeDuration;
+
+/**-----------------------------------------------------------------------------
+ * Optional software compensation for the hardware volume: given the
+ * current hardware volume [0, 1], returns a factor to apply to the
+ * output gain. Re-evaluated, and the gain ramped, on each volume change.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, copy) float (^volumeGainCurve)(float volume);
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to meter peak, RMS and clipping on the input (before the
+ * audio callback) and the output (after it).
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) BOOL metersLevels;
+
+/**-----------------------------------------------------------------------------
+ * The input and output meters, or NULL if metering has never been enabled.
+ * Use audio_meter_read() to retrieve levels, from any thread.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, readonly) audio_meter_t *inputMeter;
+@property (nonatomic, readonly) audio_meter_t *outputMeter;
+
+/**-----------------------------------------------------------------------------
+ * Meter ballistics and clip threshold. May be changed at any time.
+ * Defaults to audio_meter_config_default().
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) audio_meter_config_t meterConfig;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to measure the DSP load: the fraction of each I/O period
+ * spent in the render callback, overall and per AudioIOLoadStage.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) BOOL measuresLoad;
+
+/**-----------------------------------------------------------------------------
+ * The current DSP load: smoothed, peak, and per stage (indexed by
+ * AudioIOLoadStage). Zero if load has never been measured.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, readonly) audio_load_snapshot_t dspLoad;
+
+/**-----------------------------------------------------------------------------
+ * The load meter, or NULL if load has never been measured. Use
+ * audio_load_meter_read() to retrieve the load from C, on any thread.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, readonly) audio_load_meter_t *loadMeter;
+
+/**-----------------------------------------------------------------------------
+ * Load smoothing, peak release and thresholds. May be changed at any time.
+ * Defaults to audio_load_config_default().
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) audio_load_config_t loadConfig;
+
+/**-----------------------------------------------------------------------------
+ * Called when the smoothed load goes above loadConfig's high threshold,
+ * with high = YES, and when it falls back below the low threshold, with
+ * high = NO. The load is checked ten times a second, on the manager's
+ * internal control queue.
+ *----------------------------------------------------------------------------*/
+@property (copy) void (^loadThresholdBlock)(BOOL high, audio_load_snapshot_t load);
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to compute live spectra of the input. Input blocks are
+ * passed to a background worker, which runs Hann-windowed FFTs with 75%
+ * overlap; the audio thread only copies samples.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) BOOL analysesSpectrum;
+
+/**-----------------------------------------------------------------------------
+ * FFT size for spectrum analysis: a power of two from 256 to 16384.
+ * Defaults to 2048. Must be set before analysesSpectrum is first enabled.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) NSUInteger spectrumSize;
+
+/**-----------------------------------------------------------------------------
+ * The spectrum analyser, or NULL if analysis has never been enabled.
+ * Use audio_spectrum_read() to retrieve the latest magnitude spectrum.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, readonly) audio_spectrum_t *spectrumAnalyser;
+
+/**-----------------------------------------------------------------------------
+ * How the audio callback is protected against denormal slowdowns.
+ * Defaults to AudioIODenormalModeFlushToZero. May be changed at any time.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) AudioIODenormalMode denormalMode;
+
+/**-----------------------------------------------------------------------------
+ * Set to a quality other than AudioIOResamplerQualityNone to have the audio
+ * callback always run at AUDIO_PREFERRED_SAMPLE_RATE, converting to and
+ * from the hardware rate if necessary. When converting, the number of
+ * frames per callback may vary slightly from one callback to the next.
+ * Must be set prior to initializing the audio chain.
+ *----------------------------------------------------------------------------*/
+@property (assign) AudioIOResamplerQuality resamplerQuality;
+
+/**-----------------------------------------------------------------------------
+ * YES if the audio unit accepted resamplerQuality's hint when the audio
+ * chain was initialised: it took the converter complexity and reports it
+ * back. NO if resampling is disabled, or the unit's default converter is
+ * in use instead.
+ *----------------------------------------------------------------------------*/
+@property (readonly) BOOL resamplerQualityApplied;
+
+/**-----------------------------------------------------------------------------
+ * Which directions of audio to carry. Defaults to AudioIODirectionDuplex.
+ * Latency measurement requires duplex; routeToSpeaker only applies to
+ * duplex, and mixWithOtherAudio only to duplex and output-only.
+ * Must be set prior to initializing the audio chain.
+ *----------------------------------------------------------------------------*/
+@property (assign) AudioIODirection direction;
+
+/**-----------------------------------------------------------------------------
+ * The interface to the audio session and I/O unit. Defaults to an
+ * AudioIORemoteIOBackend; replace with an AudioIOMockBackend to run
+ * without audio hardware.
+ * Must be set prior to initializing the audio chain.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, strong) id<AudioIOBackend> backend;
+
 /**-----------------------------------------------------------------------------
  * Set to YES to route output audio to the device's speaker.
  * Must be set prior to initializing the audio chain.
@@ -174,4 +721,17 @@ typedef void (*audio_volume_change_callback_t)(float volume);
     #endif
 #endif
 
+/**-----------------------------------------------------------------------------
+ * Realtime-safe counterpart of DLog, for the audio thread. Takes a C format
+ * string and up to AUDIO_LOG_MAX_ARGS plain arguments (no %@); messages
+ * are written to the console later, from a background thread.
+ *----------------------------------------------------------------------------*/
+#ifndef ALog
+    #ifdef DEBUG
+        #define ALog(...) AUDIO_LOG(__VA_ARGS__)
+    #else
+        #define ALog(...)
+    #endif
+#endif
+
 @end
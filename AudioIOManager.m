@@ -8,18 +8,149 @@
  *----------------------------------------------------------------------------*/
 
 #import "AudioIOManager.h"
+#import "AudioIOLatency.h"
+#import "AudioIODenormals.h"
+#import "AudioIOArena.h"
+#import "AudioIOMeter.h"
+#import "AudioIOSpectrum.h"
+#import "AudioIOEventQueue.h"
+#import "AudioIOGain.h"
+#import "AudioIOMixer.h"
+#import "AudioIOConvolver.h"
+#import "AudioIOBufferController.h"
+#import "AudioIOPeriodTracker.h"
+#import "AudioIOLoadMeter.h"
+#import "AudioIOTrace.h"
+#import "AudioIOErrorCounter.h"
 #import <UIKit/UIKit.h>
+#import <Accelerate/Accelerate.h>
+#import <mach/mach_time.h>
+#import <sched.h>
+#import <stdatomic.h>
+#import <sys/mman.h>
 
 /*----------------------------------------------------------------------------*
  * Helper macro to check the return values of CoreAudio functions.
  *----------------------------------------------------------------------------*/
 #define XThrowIfError(error, operation)	if (error) { @throw [NSException exceptionWithName:@"AudioIOException" reason:operation userInfo:nil]; }
 
+/*----------------------------------------------------------------------------*
+ * Longest round-trip latency that a latency measurement will search for,
+ * and how often to check whether the measurement has completed (seconds).
+ *----------------------------------------------------------------------------*/
+#define AUDIO_LATENCY_MAX_DURATION 0.5
+#define AUDIO_LATENCY_POLL_INTERVAL 0.05
+
+/*----------------------------------------------------------------------------*
+ * Number of undrained glitch events retained by the glitch detector.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_GLITCH_LOG_SIZE 256
+
+/*----------------------------------------------------------------------------*
+ * Default spectrum analysis size, how often the analysis worker runs
+ * (seconds), and the least input it buffers (frames).
+ *----------------------------------------------------------------------------*/
+#define AUDIO_SPECTRUM_DEFAULT_SIZE 2048
+#define AUDIO_SPECTRUM_UPDATE_INTERVAL (1.0 / 60.0)
+#define AUDIO_SPECTRUM_MIN_BUFFER_FRAMES 16384
+
+/*----------------------------------------------------------------------------*
+ * Duration of the fade-in applied when audio resumes after the I/O unit
+ * has been reconfigured for a new route, and the defaults for gain ramps
+ * and for fades around start and stop (seconds).
+ *----------------------------------------------------------------------------*/
+#define AUDIO_ROUTE_CHANGE_FADE_DURATION 0.01
+#define AUDIO_GAIN_RAMP_DURATION 0.02
+#define AUDIO_START_STOP_FADE_DURATION 0.01
+
+/*----------------------------------------------------------------------------*
+ * Default window within which session events are coalesced into a single
+ * reconfiguration, and the leeway allowed to the timer (seconds, ns).
+ *----------------------------------------------------------------------------*/
+#define AUDIO_RECONFIGURATION_COALESCING_INTERVAL 0.1
+#define AUDIO_RECONFIGURATION_TIMER_LEEWAY (5 * NSEC_PER_MSEC)
+
+/*----------------------------------------------------------------------------*
+ * How often the adaptive buffer size is reviewed (seconds).
+ *----------------------------------------------------------------------------*/
+#define AUDIO_BUFFER_CONTROLLER_INTERVAL 0.5
+
+/*----------------------------------------------------------------------------*
+ * How often the DSP load is checked against its thresholds (seconds).
+ *----------------------------------------------------------------------------*/
+#define AUDIO_LOAD_WATCH_INTERVAL 0.1
+
+/*----------------------------------------------------------------------------*
+ * Default number of times the callback is run on silence at setup. Off by
+ * default, as the callback may not expect to be called before audio starts.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_WARM_UP_CALLBACKS 0
+
+/*----------------------------------------------------------------------------*
+ * Largest block to provision for if the unit doesn't report one (frames),
+ * and the default render arena size in maximum-size blocks per channel.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_DEFAULT_MAXIMUM_FRAMES 4096
+#define AUDIO_RENDER_SCRATCH_BUFFERS 8
+
+/*----------------------------------------------------------------------------*
+ * Weight given to each new callback duration in the steady-state average.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_CALLBACK_DURATION_SMOOTHING 16
+
+/*----------------------------------------------------------------------------*
+ * Key used to identify the control queue (see runOnControlQueue:).
+ *----------------------------------------------------------------------------*/
+static void *AudioIOControlQueueKey = &AudioIOControlQueueKey;
+
+/*----------------------------------------------------------------------------*
+ * Session events awaiting a reconfiguration.
+ *----------------------------------------------------------------------------*/
+typedef NS_OPTIONS(NSUInteger, AudioIOPendingEvent)
+{
+    AudioIOPendingEventRouteChange  = 1 << 0,
+    AudioIOPendingEventSuspend      = 1 << 1,
+    AudioIOPendingEventResume       = 1 << 2
+};
+
 /*----------------------------------------------------------------------------*
  * Local storage to translate between AudioBufferList and a 2D array of floats.
  *----------------------------------------------------------------------------*/
 static float *channel_pointers[32];
 
+/*----------------------------------------------------------------------------*
+ * Writes messages logged with ALog on the audio thread (see AudioIOLog).
+ *----------------------------------------------------------------------------*/
+#ifdef DEBUG
+static void logToConsole(void *context, double time, const char *message)
+{
+    NSLog(@"%s", message);
+}
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Timebase of mach_absolute_time(). Read once when the first manager is
+ * created, before audio can start, so that the audio thread never calls
+ * into the kernel for it nor races to initialise it.
+ *----------------------------------------------------------------------------*/
+static mach_timebase_info_data_t host_timebase;
+
+static void host_timebase_init(void)
+{
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        mach_timebase_info(&host_timebase);
+    });
+}
+
+/*----------------------------------------------------------------------------*
+ * Convert a mach_absolute_time() interval to seconds.
+ *----------------------------------------------------------------------------*/
+static NSTimeInterval host_ticks_to_seconds(uint64_t ticks)
+{
+    return (double) ticks * host_timebase.numer / host_timebase.denom / NSEC_PER_SEC;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 #pragma mark - Audio I/O callbacks
 ////////////////////////////////////////////////////////////////////////////////
@@ -32,16 +163,101 @@ struct CallbackData
     AudioUnit               audioIOUnit;
     BOOL*                   isBeingReconstructed;
     audio_data_callback_t   callback;
+    audio_context_callback_t contextCallback;
+    void                    *callbackContext;
     int                     samplerate;
     __unsafe_unretained id  delegate;
+    _Atomic(audio_latency_probe_t *) latencyProbe;
+    atomic_uint             latencyProbeCycle;
+    audio_glitch_detector_t *glitchDetector;
+    AudioIODenormalMode     denormalMode;
+    unsigned int            denormalBlock;
+    audio_gain_t            *gain;
+    audio_mixer_t           *mixer;
+    _Atomic(audio_convolver_t *) convolver;
+    atomic_uint             convolverCycle;
+    audio_buffer_controller_t *bufferController;
+    audio_period_tracker_t  periodTracker;
+    atomic_uint             overruns;
+    OSStatus                lastRenderError;
+    audio_error_counter_t   *renderErrors;
+    BOOL                    silencesInputErrors;
+    audio_load_meter_t      *loadMeter;
+    BOOL                    hasInput;
+    BOOL                    hasOutput;
+    AudioBufferList         *inputBuffers;
+    UInt32                  inputBytesPerFrame;
+    _Atomic uint64_t        firstRenderHostTime;
+    atomic_uint             renderCount;
+    _Atomic(void *)         fadeSemaphore;
+    unsigned int            fadeDrainRenders;
+    uint32_t                callbacksSinceStart;
+    _Atomic uint64_t        firstCallbackTicks;
+    _Atomic uint64_t        steadyCallbackTicks;
+    audio_arena_t           *arena;
+    audio_meter_t           *inputMeter;
+    audio_meter_t           *outputMeter;
+    audio_spectrum_t        *spectrum;
+    atomic_uint             clockSequence;
+    _Atomic double          clockSampleTime;
+    _Atomic uint64_t        clockHostTime;
+    _Atomic double          clockRate;
 } cd;
 
+/*----------------------------------------------------------------------------*
+ * Call whichever form of callback was given.
+ *----------------------------------------------------------------------------*/
+static inline void runCallback(float **data, int num_channels, int num_frames)
+{
+    if (cd.contextCallback)
+        cd.contextCallback(cd.callbackContext, data, num_channels, num_frames, cd.samplerate);
+    else
+        cd.callback(data, num_channels, num_frames, cd.samplerate);
+}
+
+/*----------------------------------------------------------------------------*
+ * Returns YES if I/O periods were missed before this callback: if its
+ * sample time has moved on further than the previous block's length
+ * accounts for (see AudioIOPeriodTracker.h).
+ *----------------------------------------------------------------------------*/
+static BOOL detectOverrun(const AudioTimeStamp *inTimeStamp, UInt32 inNumberFrames)
+{
+    if (!(inTimeStamp->mFlags & kAudioTimeStampSampleTimeValid))
+        return NO;
+    
+    BOOL overran = audio_period_tracker_update(&cd.periodTracker, inTimeStamp->mSampleTime, inNumberFrames) > 0;
+    
+    if (overran)
+    {
+        atomic_fetch_add_explicit(&cd.overruns, 1, memory_order_relaxed);
+        ALog("Overrun before sample time %.0f", inTimeStamp->mSampleTime);
+    }
+    return overran;
+}
+
 /*----------------------------------------------------------------------------*
  * Universal render function.
+ * Record the time of the first callback following a start request,
+ * publish the callback's time stamp, and check it for overruns.
  * If audio chain is ready:
+ *  - pull input from the unit, counting any error, or clear the buffers
+ *    if there is no input, or if pulling it failed and silencesInputErrors
+ *    is set
+ *  - enable flush-to-zero for the duration of the callback, or add an
+ *    anti-denormal offset to the input, depending on the denormal mode
  *  - render the input audio to a local buffer
  *  - translate AudioBufferList pointers to a float**
- *  - call the user-specified callback
+ *  - if enabled, meter the input and queue it for spectrum analysis
+ *  - call the user-specified callback, or the latency probe if a latency
+ *    measurement is in progress
+ *  - if enabled, mix the mixer's sources into the output
+ *  - if enabled, convolve the output with the impulse response
+ *  - apply the output gain, ramping any change
+ *  - if enabled, meter the output
+ *  - if enabled, scan the output for glitches
+ *  - release any scratch memory taken from the render arena
+ *  - if enabled, record the time taken by the block and each stage, and
+ *    if the buffer size is adaptive, report the block's load
  *----------------------------------------------------------------------------*/
 static OSStatus	performRender (void                         *inRefCon,
                                AudioUnitRenderActionFlags 	*ioActionFlags,
@@ -51,23 +267,260 @@ static OSStatus	performRender (void                         *inRefCon,
                                AudioBufferList              *ioData)
 {
     OSStatus err = noErr;
+    uint64_t renderStart = mach_absolute_time();
+    AUDIO_TRACE_BEGIN("render");
+    
+    /*----------------------------------------------------------------------------*
+     * Timestamp the first callback after a start request (see
+     * timeToFirstCallback).
+     *----------------------------------------------------------------------------*/
+    if (atomic_load_explicit(&cd.firstRenderHostTime, memory_order_relaxed) == 0)
+        atomic_store_explicit(&cd.firstRenderHostTime, renderStart, memory_order_relaxed);
+    atomic_fetch_add_explicit(&cd.renderCount, 1, memory_order_relaxed);
+    
+    BOOL overran = detectOverrun(inTimeStamp, inNumberFrames);
+    
+    /*----------------------------------------------------------------------------*
+     * Publish this callback's time stamp as a reference point for the sample
+     * clock, with the rate at which the sample time advances, under a
+     * sequence lock (see sampleTimeAtHostTime:). When resampling, that is
+     * the hardware rate rather than the callback's, as learnt by
+     * detectOverrun.
+     *----------------------------------------------------------------------------*/
+    UInt32 clockFlags = kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid;
+    if ((inTimeStamp->mFlags & clockFlags) == clockFlags)
+    {
+        double perFrame = cd.periodTracker.sample_time_per_frame;
+        double rate = cd.samplerate * (perFrame > 0 ? perFrame : 1.0);
+        unsigned int sequence = atomic_load_explicit(&cd.clockSequence, memory_order_relaxed);
+        atomic_store_explicit(&cd.clockSequence, sequence + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        atomic_store_explicit(&cd.clockSampleTime, inTimeStamp->mSampleTime, memory_order_relaxed);
+        atomic_store_explicit(&cd.clockHostTime, inTimeStamp->mHostTime, memory_order_relaxed);
+        atomic_store_explicit(&cd.clockRate, rate, memory_order_relaxed);
+        atomic_store_explicit(&cd.clockSequence, sequence + 2, memory_order_release);
+    }
+    
+    if (overran)
+        AUDIO_TRACE_INSTANT("overrun");
     
     if (*cd.isBeingReconstructed == NO)
     {
-        err = AudioUnitRender(cd.audioIOUnit, ioActionFlags, inTimeStamp, 1, inNumberFrames, ioData);
+        /*----------------------------------------------------------------------------*
+         * Time stamps at the end of each stage, if the load is measured.
+         *----------------------------------------------------------------------------*/
+        audio_load_meter_t *loadMeter = cd.loadMeter;
+        uint64_t stageEnd[AudioIOLoadStageCount];
+        
+        size_t scratchMark = cd.arena ? audio_arena_scratch_mark(cd.arena) : 0;
+        
+        AudioIODenormalMode denormalMode = cd.denormalMode;
+        audio_fp_state_t fpState = 0;
+        if (denormalMode == AudioIODenormalModeFlushToZero)
+            fpState = audio_denormals_flush_begin();
+        
+        /*----------------------------------------------------------------------------*
+         * Backends without an AudioUnit supply input directly in ioData.
+         *----------------------------------------------------------------------------*/
+        BOOL hasInput = cd.hasInput;
+        if (hasInput && cd.audioIOUnit)
+        {
+            err = AudioUnitRender(cd.audioIOUnit, ioActionFlags, inTimeStamp, 1, inNumberFrames, ioData);
+            if (cd.renderErrors)
+                audio_error_counter_record(cd.renderErrors, err, renderStart);
+            if (err != cd.lastRenderError)
+            {
+                if (err != noErr)
+                    ALog("AudioUnitRender failed: %d", (int) err);
+                cd.lastRenderError = err;
+            }
+        }
+        
+        /*----------------------------------------------------------------------------*
+         * If pulling the input failed, the buffers hold whatever was left
+         * in them; optionally, pass on silence instead.
+         *----------------------------------------------------------------------------*/
+        BOOL silenceInput = !hasInput || (err != noErr && cd.silencesInputErrors);
+        for (UInt32 c = 0; c < ioData->mNumberBuffers; ++c)
+        {
+            channel_pointers[c] = (float *) ioData->mBuffers[c].mData;
+            if (silenceInput)
+                memset(ioData->mBuffers[c].mData, 0, ioData->mBuffers[c].mDataByteSize);
+        }
+        
+        if (cd.inputMeter && hasInput)
+            audio_meter_process(cd.inputMeter, channel_pointers, ioData->mNumberBuffers, inNumberFrames, cd.samplerate);
         
-        if (cd.callback)
+        if (cd.spectrum && hasInput)
+            audio_spectrum_write(cd.spectrum, channel_pointers[0], inNumberFrames);
+        
+        if (denormalMode == AudioIODenormalModeInjectOffset)
         {
             for (UInt32 c = 0; c < ioData->mNumberBuffers; ++c)
-                channel_pointers[c] = (float *) ioData->mBuffers[c].mData;
-            cd.callback(channel_pointers, ioData->mNumberBuffers, inNumberFrames, cd.samplerate);
+                audio_denormals_inject_offset((float *) ioData->mBuffers[c].mData, inNumberFrames, cd.denormalBlock);
+            cd.denormalBlock++;
+        }
+        
+        if (loadMeter)
+            stageEnd[AudioIOLoadStageInput] = mach_absolute_time();
+        
+        /*----------------------------------------------------------------------------*
+         * The probe records the first input channel and replaces the output
+         * with its test signal, on every channel. Its cycle count is odd
+         * while it may be in use, as the convolver's is below.
+         *----------------------------------------------------------------------------*/
+        atomic_fetch_add(&cd.latencyProbeCycle, 1);
+        audio_latency_probe_t *probe = atomic_load(&cd.latencyProbe);
+        if (probe)
+        {
+            float *buffer = (float *) ioData->mBuffers[0].mData;
+            audio_latency_probe_process(probe, buffer, buffer, inNumberFrames);
+            for (UInt32 c = 1; c < ioData->mNumberBuffers; ++c)
+                memcpy(ioData->mBuffers[c].mData, buffer, inNumberFrames * sizeof(float));
+        }
+        atomic_fetch_add_explicit(&cd.latencyProbeCycle, 1, memory_order_release);
+        
+        if (!probe && (cd.callback || cd.contextCallback))
+        {
+            uint64_t callbackStart = mach_absolute_time();
+            runCallback(channel_pointers, ioData->mNumberBuffers, inNumberFrames);
+            uint64_t ticks = mach_absolute_time() - callbackStart;
+            
+            /*----------------------------------------------------------------------------*
+             * Keep the first callback's duration apart from the running average
+             * of those that follow, so that cold-start costs are visible.
+             *----------------------------------------------------------------------------*/
+            if (cd.callbacksSinceStart++ == 0)
+            {
+                atomic_store_explicit(&cd.firstCallbackTicks, ticks, memory_order_relaxed);
+            }
+            else
+            {
+                int64_t average = (int64_t) atomic_load_explicit(&cd.steadyCallbackTicks, memory_order_relaxed);
+                average = (average == 0) ? (int64_t) ticks : average + ((int64_t) ticks - average) / AUDIO_CALLBACK_DURATION_SMOOTHING;
+                atomic_store_explicit(&cd.steadyCallbackTicks, (uint64_t) average, memory_order_relaxed);
+            }
+        }
+        
+        if (loadMeter)
+            stageEnd[AudioIOLoadStageCallback] = mach_absolute_time();
+        
+        if (cd.mixer && cd.hasOutput && !probe)
+            audio_mixer_process(cd.mixer, channel_pointers, ioData->mNumberBuffers, inNumberFrames, cd.samplerate);
+        
+        if (loadMeter)
+            stageEnd[AudioIOLoadStageMixer] = mach_absolute_time();
+        
+        /*----------------------------------------------------------------------------*
+         * The cycle count is odd while the convolver may be in use, so that
+         * a replaced convolver is only freed once the audio thread is done
+         * with it.
+         *----------------------------------------------------------------------------*/
+        atomic_fetch_add(&cd.convolverCycle, 1);
+        audio_convolver_t *convolver = atomic_load(&cd.convolver);
+        if (convolver && cd.hasOutput && !probe)
+            audio_convolver_process(convolver, channel_pointers, ioData->mNumberBuffers, inNumberFrames);
+        atomic_fetch_add_explicit(&cd.convolverCycle, 1, memory_order_release);
+        
+        if (loadMeter)
+            stageEnd[AudioIOLoadStageConvolver] = mach_absolute_time();
+        
+        /*----------------------------------------------------------------------------*
+         * The probe's test signal goes out as it is: any gain, fade or mute
+         * would distort the measurement, and it isn't the app's output.
+         *----------------------------------------------------------------------------*/
+        if (cd.gain && cd.hasOutput && !probe)
+            audio_gain_process(cd.gain, channel_pointers, ioData->mNumberBuffers, inNumberFrames, cd.samplerate);
+        
+        /*----------------------------------------------------------------------------*
+         * A stop is waiting for its fade out. Wake it once the block that
+         * ended the fade has been played, by which time the hardware has
+         * asked for two more. Taking the semaphore with a swap lets the
+         * waiter tell whether it will still be signalled.
+         *----------------------------------------------------------------------------*/
+        void *fadeSemaphore = atomic_load_explicit(&cd.fadeSemaphore, memory_order_acquire);
+        if (fadeSemaphore && cd.gain && !audio_gain_is_ramping(cd.gain) && cd.fadeDrainRenders++ > 0)
+        {
+            if (atomic_compare_exchange_strong(&cd.fadeSemaphore, &fadeSemaphore, NULL))
+                dispatch_semaphore_signal((__bridge dispatch_semaphore_t) fadeSemaphore);
+        }
+        
+        if (cd.outputMeter && cd.hasOutput && !probe)
+            audio_meter_process(cd.outputMeter, channel_pointers, ioData->mNumberBuffers, inNumberFrames, cd.samplerate);
+        
+        if (cd.glitchDetector && cd.hasOutput)
+        {
+            double sampleTime = (inTimeStamp->mFlags & kAudioTimeStampSampleTimeValid) ? inTimeStamp->mSampleTime : -1;
+            audio_glitch_detector_process(cd.glitchDetector, (float *) ioData->mBuffers[0].mData, inNumberFrames, sampleTime);
+        }
+        
+        if (denormalMode == AudioIODenormalModeFlushToZero)
+            audio_denormals_flush_end(fpState);
+        
+        if (cd.arena)
+            audio_arena_scratch_release(cd.arena, scratchMark);
+        
+        if (loadMeter || cd.bufferController)
+        {
+            uint64_t renderEnd = mach_absolute_time();
+            NSTimeInterval period = (NSTimeInterval) inNumberFrames / cd.samplerate;
+            NSTimeInterval renderTime = host_ticks_to_seconds(renderEnd - renderStart);
+            
+            if (loadMeter)
+            {
+                stageEnd[AudioIOLoadStageOutput] = renderEnd;
+                
+                double stageTimes[AudioIOLoadStageCount];
+                uint64_t stageStart = renderStart;
+                for (int s = 0; s < AudioIOLoadStageCount; s++)
+                {
+                    stageTimes[s] = host_ticks_to_seconds(stageEnd[s] - stageStart);
+                    stageStart = stageEnd[s];
+                }
+                audio_load_meter_process(loadMeter, renderTime, stageTimes, AudioIOLoadStageCount, period);
+            }
+            
+            if (cd.bufferController)
+                audio_buffer_controller_observe(cd.bufferController, renderTime / period, overran);
         }
-
     }
     
+    AUDIO_TRACE_END("render");
     return err;
 }
 
+/*----------------------------------------------------------------------------*
+ * Input callback, used when there is no output. The unit supplies no
+ * buffers, so render into buffers preallocated in the render arena, then
+ * process them as performRender would on the output.
+ *----------------------------------------------------------------------------*/
+static OSStatus performInput (void                          *inRefCon,
+                              AudioUnitRenderActionFlags    *ioActionFlags,
+                              const AudioTimeStamp          *inTimeStamp,
+                              UInt32                        inBusNumber,
+                              UInt32                        inNumberFrames,
+                              AudioBufferList               *ioData)
+{
+    AudioBufferList *buffers = cd.inputBuffers;
+    if (!buffers)
+        return noErr;
+    
+    for (UInt32 c = 0; c < buffers->mNumberBuffers; ++c)
+        buffers->mBuffers[c].mDataByteSize = inNumberFrames * cd.inputBytesPerFrame;
+    
+    /*----------------------------------------------------------------------------*
+     * Backends without an AudioUnit don't render input; give the callback
+     * silence rather than the previous block.
+     *----------------------------------------------------------------------------*/
+    if (!cd.audioIOUnit)
+    {
+        for (UInt32 c = 0; c < buffers->mNumberBuffers; ++c)
+            memset(buffers->mBuffers[c].mData, 0, buffers->mBuffers[c].mDataByteSize);
+    }
+    
+    return performRender(inRefCon, ioActionFlags, inTimeStamp, inBusNumber, inNumberFrames, buffers);
+}
+
 @interface AudioIOManager ()
 
 /**-----------------------------------------------------------------------------
@@ -75,11 +528,8 @@ static OSStatus	performRender (void                         *inRefCon,
  *----------------------------------------------------------------------------*/
 @property (assign) audio_volume_change_callback_t volumeBlock;
 @property (assign) audio_data_callback_t callback;
-
-/**-----------------------------------------------------------------------------
- * AudioUnit object for input and output.
- *----------------------------------------------------------------------------*/
-@property (nonatomic, assign) AudioUnit audioIOUnit;
+@property (assign) audio_context_callback_t contextCallback;
+@property (assign) void *callbackContext;
 
 /**-----------------------------------------------------------------------------
  * Used internally to track whether we're rebuilding our audio chain.
@@ -90,6 +540,75 @@ static OSStatus	performRender (void                         *inRefCon,
  * Used internally to track whether the AVAudioSession has been activated.
  *----------------------------------------------------------------------------*/
 @property (nonatomic, assign) BOOL isAudioSessionActive;
+
+/**-----------------------------------------------------------------------------
+ * Duration of the most recent reconfiguration (see reconfigureIOUnit).
+ *----------------------------------------------------------------------------*/
+@property (assign) NSTimeInterval lastReconfigurationDuration;
+@property (assign) BOOL resamplerQualityApplied;
+
+/**-----------------------------------------------------------------------------
+ * Serial queue on which the audio chain is set up, torn down and
+ * reconfigured.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, strong) dispatch_queue_t controlQueue;
+
+/**-----------------------------------------------------------------------------
+ * Session events accumulated since the last reconfiguration, and the
+ * timer that triggers it.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) AudioIOPendingEvent pendingEvents;
+@property (nonatomic, strong) dispatch_source_t reconfigurationTimer;
+
+@property (assign) NSUInteger reconfigurationEventsReceived;
+@property (assign) NSUInteger reconfigurationsPerformed;
+
+/**-----------------------------------------------------------------------------
+ * Host time at which audio was last requested to start, or zero.
+ *----------------------------------------------------------------------------*/
+@property (assign) uint64_t startRequestHostTime;
+
+/**-----------------------------------------------------------------------------
+ * Layout of the largest block the unit may render: frames, number of
+ * buffers, and bytes per buffer.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) UInt32 maximumFramesPerSlice;
+@property (nonatomic, assign) UInt32 renderBufferCount;
+@property (nonatomic, assign) size_t renderBufferSize;
+
+/**-----------------------------------------------------------------------------
+ * YES if the callback data has been locked with mlock.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) BOOL renderMemoryLocked;
+
+/**-----------------------------------------------------------------------------
+ * Queue and timer on which spectrum analysis runs.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, strong) dispatch_queue_t analysisQueue;
+@property (nonatomic, strong) dispatch_source_t analysisTimer;
+
+/**-----------------------------------------------------------------------------
+ * Adaptive buffer size controller, and the timer on which it is reviewed.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, assign) audio_buffer_controller_t *bufferController;
+@property (nonatomic, strong) dispatch_source_t bufferControllerTimer;
+
+/**-----------------------------------------------------------------------------
+ * Copy of the impulse response, kept so that the convolver can be rebuilt
+ * when the buffer size changes, and the block size it was built with.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, strong) NSData *impulseResponse;
+@property (nonatomic, assign) int convolverBlockSize;
+
+/**-----------------------------------------------------------------------------
+ * Timer on which the DSP load is checked against its thresholds, and the
+ * state last reported.
+ *----------------------------------------------------------------------------*/
+@property (nonatomic, strong) dispatch_source_t loadWatchTimer;
+@property (nonatomic, assign) BOOL loadWasHigh;
+@property (nonatomic, assign) uint32_t loadHighCount;
+
+@property (strong) AudioIOEventQueue *eventQueue;
 @end
 
 @implementation AudioIOManager
@@ -109,6 +628,18 @@ static OSStatus	performRender (void                         *inRefCon,
 
 }
 
+- (id)initWithCallback:(audio_context_callback_t)callback context:(void *)context
+{
+    self = [super init];
+    if (!self) return nil;
+    
+    [self resetProperties];
+    self.contextCallback = callback;
+    self.callbackContext = context;
+    
+    return self;
+}
+
 - (id)initWithDelegate:(id<AudioIODelegate>)delegate
 {
     self = [super init];
@@ -127,12 +658,61 @@ static OSStatus	performRender (void                         *inRefCon,
 
 - (void)resetProperties
 {
+    host_timebase_init();
+    
+    if (!self.controlQueue)
+    {
+        self.controlQueue = dispatch_queue_create("AudioIOManager.control", DISPATCH_QUEUE_SERIAL);
+        dispatch_queue_set_specific(self.controlQueue, AudioIOControlQueueKey, (__bridge void *) self, NULL);
+    }
+    
+    if (!cd.gain)
+    {
+        cd.gain = audio_gain_create(1.0f);
+    }
+    
+    if (!cd.renderErrors)
+    {
+        cd.renderErrors = audio_error_counter_create();
+    }
+    
+#ifdef DEBUG
+    audio_log_start(AUDIO_LOG_DEFAULT_CAPACITY, logToConsole, NULL);
+#endif
+    
+    self.backend = [AudioIORemoteIOBackend new];
+    self.gainRampDuration = AUDIO_GAIN_RAMP_DURATION;
+    self.gainRampShape = AudioIOGainRampExponential;
+    self.startStopFadeDuration = AUDIO_START_STOP_FADE_DURATION;
+    self.volumeGainCurve = nil;
+    self.muted = NO;
+    self.outputGain = 1.0f;
+    self.reconfigurationCoalescingInterval = AUDIO_RECONFIGURATION_COALESCING_INTERVAL;
     self.mixWithOtherAudio = NO;
     self.routeToSpeaker = NO;
+    self.detectsGlitches = NO;
+    self.mixesSources = NO;
+    self.bufferControllerConfig = audio_buffer_controller_config_default();
+    self.adaptsBufferSize = NO;
+    self.meterConfig = audio_meter_config_default();
+    self.metersLevels = NO;
+    self.loadConfig = audio_load_config_default();
+    self.measuresLoad = NO;
+    self.spectrumSize = AUDIO_SPECTRUM_DEFAULT_SIZE;
+    self.analysesSpectrum = NO;
+    self.denormalMode = AudioIODenormalModeFlushToZero;
+    self.silencesInputErrors = NO;
+    self.resamplerQuality = AudioIOResamplerQualityNone;
+    self.direction = AudioIODirectionDuplex;
+    self.warmUpCallbacks = AUDIO_WARM_UP_CALLBACKS;
+    self.locksRenderMemory = NO;
+    self.renderScratchBuffers = AUDIO_RENDER_SCRATCH_BUFFERS;
     
     self.volumeBlock = nil;
     self.delegate = nil;
     self.callback = nil;
+    self.contextCallback = nil;
+    self.callbackContext = NULL;
     
     self.isInitialised = NO;
     self.isStarted = NO;
@@ -162,21 +742,18 @@ static OSStatus	performRender (void                         *inRefCon,
 - (void)handleMediaServicesReset:(NSNotification *)notification
 {
     DLog(@"Media services reset.");
+    AUDIO_TRACE_INSTANT("media services reset");
+    
+    if ([notification.name isEqualToString:AVAudioSessionMediaServicesWereResetNotification])
+    {
+        [self postEvent:[AudioIOEvent eventWithType:AudioIOEventTypeMediaServicesReset sampleTime:self.currentSampleTime]];
+    }
 }
 
 - (void)handleApplicationBecameActive:(NSNotification *)notification
 {
-    BOOL ok = [self activateAudioSession];
-    
-    if (ok)
-    {
-        [self setupIOUnit];
-    
-        if (self.isStarted)
-        {
-            [self start];
-        }
-    }
+    AUDIO_TRACE_INSTANT("application became active");
+    [self scheduleReconfiguration:AudioIOPendingEventResume];
 }
 
 - (void)handleInterruption:(NSNotification *)notification
@@ -186,29 +763,23 @@ static OSStatus	performRender (void                         *inRefCon,
         if ([[notification.userInfo valueForKey:AVAudioSessionInterruptionTypeKey] isEqualToNumber:@(AVAudioSessionInterruptionTypeBegan)])
         {
             DLog(@"AVAudioSessionInterruptionTypeBegan");
+            AUDIO_TRACE_INSTANT("interruption began");
+            [self postEvent:[AudioIOEvent eventWithType:AudioIOEventTypeInterruptionBegan sampleTime:self.currentSampleTime]];
+            
             /*----------------------------------------------------------------------------*
              * Interruption started. Stop our audio unit and deactivate the session.
              * We can then safely activate and restart when the service resumes.
              * However, InterruptionTypeEnded is often not called, so this is handled
              * in handleApplicationBecameActive.
              *----------------------------------------------------------------------------*/
-            [self teardownIOUnit];
-            [self deactivateAudioSession];
+            [self scheduleReconfiguration:AudioIOPendingEventSuspend];
         }
         else
         {
             DLog(@"AVAudioSessionInterruptionTypeEnded");
-            
-            if (!self.isAudioSessionActive)
-            {
-                [self activateAudioSession];
-                [self setupIOUnit];
-                
-                if (self.isStarted)
-                {
-                    [self start];
-                }
-            }
+            AUDIO_TRACE_INSTANT("interruption ended");
+            [self postEvent:[AudioIOEvent eventWithType:AudioIOEventTypeInterruptionEnded sampleTime:self.currentSampleTime]];
+            [self scheduleReconfiguration:AudioIOPendingEventResume];
         }
     }
 }
@@ -219,13 +790,15 @@ static OSStatus	performRender (void                         *inRefCon,
 
 - (void)handleRouteChange:(NSNotification *)notification
 {
+    AUDIO_TRACE_INSTANT("route change");
 
     UInt8 reasonValue = [notification.userInfo[AVAudioSessionRouteChangeReasonKey] intValue];
+    [self postEvent:[AudioIOEvent routeChangeEvent:reasonValue sampleTime:self.currentSampleTime]];
     
 #ifdef DEBUG
     AVAudioSessionPortDescription *port = [AVAudioSession sharedInstance].currentRoute.outputs.firstObject;
     DLog(@"Route changed, port type %@, new samplerate %.0fHz (reason: %d)\n",
-          port.portType, [AVAudioSession sharedInstance].sampleRate,
+          port.portType, self.backend.sampleRate,
           reasonValue);
 #endif
     
@@ -239,90 +812,291 @@ static OSStatus	performRender (void                         *inRefCon,
           * headphones plugged in, AVAudioSessionRouteChangeReasonOldDeviceUnavailable
           * when unplugged) or app-switching.
           *----------------------------------------------------------------------------*/
-         if (self.isAudioSessionActive)
-         {
-             DLog(@"Audio changed device, rebuilding audio chain");
-             [self teardown];
-             [self setup];
-             
-             if (self.delegate && [self.delegate respondsToSelector:@selector(audioIOPortChanged)])
-             {
-                 /*----------------------------------------------------------------------------*
-                  * If specified, trigger a delegate notification that the IO port has been
-                  * changed. The audio I/O unit has been stopped by this point so it's safe to
-                  * reallocate memory that may affect the audio I/O thread. Must do this
-                  * before restarting processing.
-                  *----------------------------------------------------------------------------*/
-                 [self.delegate audioIOPortChanged];
-             }
-             
-             if (self.isStarted)
-             {
-				 /*----------------------------------------------------------------------------*
-				  * The isStarted flag indicates that the audio session had been started
-				  * before this rebuild. Trigger the start method to resume playback.
-				  *----------------------------------------------------------------------------*/
-                 [self start];
-             }
-         }
-         else
-         {
-             /*----------------------------------------------------------------------------*
-              * Hardware may change when we don't have an active audio session
-              * (for example, during a call or other interruption).
-              *
-              * If this happens, don't try to rebuild the audio chain.
-              *----------------------------------------------------------------------------*/
-             DLog(@"Audio changed device when inactive, not rebuilding");
-         }
+         [self scheduleReconfiguration:AudioIOPendingEventRouteChange];
      }
 }
 
-
 ////////////////////////////////////////////////////////////////////////////////
-#pragma mark - Audio setup
+#pragma mark - Events
 ////////////////////////////////////////////////////////////////////////////////
 
-- (BOOL)setupAudioSession
+- (void)setEventHandler:(void (^)(NSArray<AudioIOEvent *> *events))handler queue:(dispatch_queue_t)queue
 {
-    NSAssert(!self.isInitialised, @"Audio session already initialised");
+    self.eventQueue = handler ? [[AudioIOEventQueue alloc] initWithQueue:(queue ?: dispatch_get_main_queue()) handler:handler] : nil;
+}
+
+- (void)postEvent:(AudioIOEvent *)event
+{
+    [self.eventQueue postEvent:event];
+}
+
+- (double)currentSampleTime
+{
+    return [self sampleTimeAtHostTime:mach_absolute_time()];
+}
+
+- (double)sampleTimeAtHostTime:(uint64_t)hostTime
+{
+    if (!self.isStarted)
+    {
+        return -1;
+    }
     
-    @try
+    double sampleTime;
+    uint64_t referenceHostTime;
+    double rate;
+    unsigned int before, after;
+    
+    do
     {
-        __block BOOL success = NO;
-        __block NSError *error = nil;
+        before = atomic_load_explicit(&cd.clockSequence, memory_order_acquire);
+        sampleTime = atomic_load_explicit(&cd.clockSampleTime, memory_order_relaxed);
+        referenceHostTime = atomic_load_explicit(&cd.clockHostTime, memory_order_relaxed);
+        rate = atomic_load_explicit(&cd.clockRate, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&cd.clockSequence, memory_order_relaxed);
+    }
+    while ((before & 1) || before != after);
+    
+    if (before == 0)
+    {
+        return -1;
+    }
+    
+    /*---------------------------------------------------------------------*
+     * Extrapolate from the most recent callback at the rate its time
+     * stamps advance.
+     *--------------------------------------------------------------------*/
+    double elapsed = (hostTime >= referenceHostTime) ?
+                     host_ticks_to_seconds(hostTime - referenceHostTime) :
+                     -host_ticks_to_seconds(referenceHostTime - hostTime);
+    return sampleTime + elapsed * rate;
+}
 
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Reconfiguration scheduling
+////////////////////////////////////////////////////////////////////////////////
+
+/*----------------------------------------------------------------------------*
+ * Session events tend to arrive in bursts (a Bluetooth device connecting
+ * can post several route changes in a row). Rather than rebuilding for
+ * each, events are accumulated and acted upon once no further event has
+ * arrived for reconfigurationCoalescingInterval, on the control queue.
+ *----------------------------------------------------------------------------*/
+
+- (void)scheduleReconfiguration:(AudioIOPendingEvent)event
+{
+    @synchronized (self)
+    {
+        self.reconfigurationEventsReceived++;
+        
         /*---------------------------------------------------------------------*
-         * Configure the audio session
+         * A suspend cancels any resume that preceded it, so that the final
+         * state follows the most recent interruption event.
          *--------------------------------------------------------------------*/
-        AVAudioSession *sessionInstance = [AVAudioSession sharedInstance];
+        if (event == AudioIOPendingEventSuspend)
+            self.pendingEvents = (self.pendingEvents | event) & ~AudioIOPendingEventResume;
+        else
+            self.pendingEvents |= event;
         
+        if (!self.reconfigurationTimer)
+        {
+            __weak AudioIOManager *weakSelf = self;
+            self.reconfigurationTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.controlQueue);
+            dispatch_source_set_event_handler(self.reconfigurationTimer, ^{
+                [weakSelf performPendingReconfiguration];
+            });
+            dispatch_source_set_timer(self.reconfigurationTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+            dispatch_resume(self.reconfigurationTimer);
+        }
         
         /*---------------------------------------------------------------------*
-         * Set preferred sample rate.
+         * Each event pushes the deadline back; the timer is one-shot.
          *--------------------------------------------------------------------*/
-        success = [sessionInstance setPreferredSampleRate:AUDIO_PREFERRED_SAMPLE_RATE error:&error];
-        XThrowIfError((OSStatus)error.code, @"Couldn't set session's preferred sample rate");
+        dispatch_time_t deadline = dispatch_time(DISPATCH_TIME_NOW, (int64_t) (self.reconfigurationCoalescingInterval * NSEC_PER_SEC));
+        dispatch_source_set_timer(self.reconfigurationTimer, deadline, DISPATCH_TIME_FOREVER, AUDIO_RECONFIGURATION_TIMER_LEEWAY);
+    }
+}
+
+- (void)performPendingReconfiguration
+{
+    AudioIOPendingEvent events;
+    
+    @synchronized (self)
+    {
+        events = self.pendingEvents;
+        self.pendingEvents = 0;
+    }
+    
+    if (!events || !self.isInitialised)
+    {
+        return;
+    }
+    
+    self.reconfigurationsPerformed++;
+    DLog(@"Reconfiguring after %lu events (%lu reconfigurations)",
+         (unsigned long) self.reconfigurationEventsReceived, (unsigned long) self.reconfigurationsPerformed);
+    AUDIO_TRACE_BEGIN("reconfigure");
+    
+    if (events & AudioIOPendingEventSuspend)
+    {
+        [self teardownIOUnit];
+        [self deactivateAudioSession];
+    }
+    
+    BOOL rebuilt = NO;
+    if (events & AudioIOPendingEventResume)
+    {
+        if ([self activateAudioSession])
+        {
+            rebuilt = !self.backend.hasUnit;
+            [self setupIOUnit];
+            
+            if (self.isStarted)
+            {
+                [self performStart];
+            }
+        }
+    }
+    
+    /*---------------------------------------------------------------------*
+     * A freshly created unit already matches the current route.
+     *--------------------------------------------------------------------*/
+    if ((events & AudioIOPendingEventRouteChange) && !rebuilt)
+    {
+        [self reconfigureForRouteChange];
+    }
+    
+    [self updateConvolverBlockSize];
+    AUDIO_TRACE_END("reconfigure");
+}
+
+- (void)reconfigureForRouteChange
+{
+    if (self.isAudioSessionActive && self.isInitialised)
+    {
+        /*----------------------------------------------------------------------------*
+         * The session and its observers survive a route change, so only the
+         * I/O unit's stream format may need to be renegotiated. This keeps
+         * audio running if nothing relevant has changed.
+         *----------------------------------------------------------------------------*/
+        DLog(@"Audio changed device, reconfiguring audio unit");
+        BOOL ok = [self reconfigureIOUnit];
+        
+        if (!ok)
+        {
+            DLog(@"Reconfiguration failed, rebuilding audio chain");
+            [self performTeardown];
+            [self performSetup];
+            [self notifyPortChanged];
+            [self notifyRouteChanged];
+            
+            if (self.isStarted)
+            {
+                /*----------------------------------------------------------------------------*
+                 * The isStarted flag indicates that the audio session had been started
+                 * before this rebuild. Trigger the start method to resume playback.
+                 *----------------------------------------------------------------------------*/
+                [self performStart];
+            }
+        }
+    }
+    else
+    {
+        /*----------------------------------------------------------------------------*
+         * Hardware may change when we don't have an active audio session
+         * (for example, during a call or other interruption).
+         *
+         * If this happens, don't try to rebuild the audio chain.
+         *----------------------------------------------------------------------------*/
+        DLog(@"Audio changed device when inactive, not rebuilding");
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ * Run a block on the control queue, synchronously. Runs the block directly
+ * if already on the control queue, so that calls may be nested.
+ *----------------------------------------------------------------------------*/
+- (void)runOnControlQueue:(dispatch_block_t)block
+{
+    if (dispatch_get_specific(AudioIOControlQueueKey) == (__bridge void *) self)
+    {
+        block();
+    }
+    else
+    {
+        dispatch_sync(self.controlQueue, block);
+    }
+}
+
+- (void)notifyPortChanged
+{
+    if (self.delegate && [self.delegate respondsToSelector:@selector(audioIOPortChanged)])
+    {
+        [self.delegate audioIOPortChanged];
+    }
+}
+
+- (void)notifyRouteChanged
+{
+    if (self.delegate && [self.delegate respondsToSelector:@selector(audioIORouteChanged)])
+    {
+        [self.delegate audioIORouteChanged];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Audio setup
+////////////////////////////////////////////////////////////////////////////////
+
+- (BOOL)setupAudioSession
+{
+    NSAssert(!self.isInitialised, @"Audio session already initialised");
+    
+    @try
+    {
+        __block BOOL success = NO;
+        __block NSError *error = nil;
+
+        /*---------------------------------------------------------------------*
+         * Configure the audio session
+         *--------------------------------------------------------------------*/
+        id<AudioIOBackend> sessionInstance = self.backend;
+        
+        
+        /*---------------------------------------------------------------------*
+         * Set preferred sample rate.
+         *--------------------------------------------------------------------*/
+        success = [sessionInstance setPreferredSampleRate:AUDIO_PREFERRED_SAMPLE_RATE error:&error];
+        XThrowIfError((OSStatus)error.code, @"Couldn't set session's preferred sample rate");
 
         /*---------------------------------------------------------------------*
          * Register for audio input and output.
          *--------------------------------------------------------------------*/
         NSUInteger options = 0;
+        AudioIODirection direction = self.direction;
         
-        if (self.mixWithOtherAudio)
+        if (self.mixWithOtherAudio && direction != AudioIODirectionInputOnly)
         {
             options |= AVAudioSessionCategoryOptionMixWithOthers;
         }
         
-        if (self.routeToSpeaker)
+        if (self.routeToSpeaker && direction == AudioIODirectionDuplex)
         {
             options |= AVAudioSessionCategoryOptionDefaultToSpeaker;
         }
         
         /*---------------------------------------------------------------------*
-         * At the moment, we only support the PlayAndRecord category.
+         * Use the narrowest category for the directions in use: Playback
+         * doesn't activate the microphone, or prompt for permission to.
          *--------------------------------------------------------------------*/
-        success = [sessionInstance setCategory:AVAudioSessionCategoryPlayAndRecord
+        NSString *category = AVAudioSessionCategoryPlayAndRecord;
+        if (direction == AudioIODirectionInputOnly)
+            category = AVAudioSessionCategoryRecord;
+        else if (direction == AudioIODirectionOutputOnly)
+            category = AVAudioSessionCategoryPlayback;
+        
+        success = [sessionInstance setCategory:category
                                    withOptions:options
                                          error:&error] && success;
         XThrowIfError((OSStatus)error.code, @"Couldn't set session's audio category");
@@ -339,7 +1113,7 @@ static OSStatus	performRender (void                         *inRefCon,
         /*---------------------------------------------------------------------*
          * Set up a low-latency buffer.
          *--------------------------------------------------------------------*/
-        NSTimeInterval bufferDuration = (float) AUDIO_BUFFER_SIZE / sessionInstance.sampleRate;
+        NSTimeInterval bufferDuration = (float) [self preferredBufferSize] / sessionInstance.sampleRate;
         success = [sessionInstance setPreferredIOBufferDuration:bufferDuration error:&error] && success;
         XThrowIfError((OSStatus)error.code, @"Couldn't set session's I/O buffer duration");
         
@@ -356,7 +1130,7 @@ static OSStatus	performRender (void                         *inRefCon,
         [notificationCenter addObserver:self
                                selector:@selector(handleInterruption:)
                                    name:AVAudioSessionInterruptionNotification
-                                 object:sessionInstance];
+                                 object:sessionInstance.notificationSource];
         
         /*---------------------------------------------------------------------*
          * Notify for change of route (eg. built-in speaker -> headphones)
@@ -364,7 +1138,7 @@ static OSStatus	performRender (void                         *inRefCon,
         [notificationCenter addObserver:self
                                selector:@selector(handleRouteChange:)
                                    name:AVAudioSessionRouteChangeNotification
-                                 object:sessionInstance];
+                                 object:sessionInstance.notificationSource];
 
         /*---------------------------------------------------------------------*
          * When media services are reset, we need to rebuild our audio chain.
@@ -372,7 +1146,7 @@ static OSStatus	performRender (void                         *inRefCon,
         [notificationCenter addObserver:self
                                selector:@selector(handleMediaServicesReset:)
                                    name:AVAudioSessionMediaServicesWereResetNotification
-                                 object:sessionInstance];
+                                 object:sessionInstance.notificationSource];
         
         /*---------------------------------------------------------------------*
          * When the app becomes active, we need to rebuild our audio chain.
@@ -394,10 +1168,10 @@ static OSStatus	performRender (void                         *inRefCon,
         /*---------------------------------------------------------------------*
          * Receive notification when system volume changed (via KVO)
          *--------------------------------------------------------------------*/
-        [sessionInstance addObserver:self
-                          forKeyPath:@"outputVolume"
-                             options:0
-                             context:nil];
+        [sessionInstance.notificationSource addObserver:self
+                                             forKeyPath:@"outputVolume"
+                                                options:0
+                                                context:nil];
         
         return success;
 
@@ -413,82 +1187,113 @@ static OSStatus	performRender (void                         *inRefCon,
 
 - (BOOL)setupIOUnit
 {
-    if (self.audioIOUnit)
+    if (self.backend.hasUnit)
     {
         return YES;
     }
     
     @try
     {
-        //DLog(@"Setting up audio unit, samplerate %fHz", [AVAudioSession sharedInstance].sampleRate);
+        //DLog(@"Setting up audio unit, samplerate %fHz", self.backend.sampleRate);
         
         /*---------------------------------------------------------------------*
          * Set up a remote IO unit.
          *--------------------------------------------------------------------*/
-        AudioComponentDescription desc;
-        desc.componentType = kAudioUnitType_Output;
-        desc.componentSubType = kAudioUnitSubType_RemoteIO;
-        desc.componentManufacturer = kAudioUnitManufacturer_Apple;
-        desc.componentFlags = 0;
-        desc.componentFlagsMask = 0;
-        
-        AudioComponent comp = AudioComponentFindNext(NULL, &desc);
-        XThrowIfError(AudioComponentInstanceNew(comp, &_audioIOUnit), @"Couldn't create a new instance of AURemoteIO");
+        XThrowIfError([self.backend createUnit], @"Couldn't create a new instance of AURemoteIO");
         
         /*---------------------------------------------------------------------*
          * Enable audio input (on input scope of input element)
-         * and output (on output scope of output element).
+         * and output (on output scope of output element), as needed.
          *--------------------------------------------------------------------*/
-        
-        UInt32 one = 1;
-        XThrowIfError(AudioUnitSetProperty(self.audioIOUnit, kAudioOutputUnitProperty_EnableIO, kAudioUnitScope_Input, 1, &one, sizeof(one)),
+        AudioIODirection direction = self.direction;
+        UInt32 enableInput = (direction != AudioIODirectionOutputOnly);
+        UInt32 enableOutput = (direction != AudioIODirectionInputOnly);
+        XThrowIfError([self.backend setUnitProperty:kAudioOutputUnitProperty_EnableIO scope:kAudioUnitScope_Input element:1 data:&enableInput size:sizeof(enableInput)],
                       @"Could not enable input on AURemoteIO");
-        XThrowIfError(AudioUnitSetProperty(self.audioIOUnit, kAudioOutputUnitProperty_EnableIO, kAudioUnitScope_Output, 0, &one, sizeof(one)),
+        XThrowIfError([self.backend setUnitProperty:kAudioOutputUnitProperty_EnableIO scope:kAudioUnitScope_Output element:0 data:&enableOutput size:sizeof(enableOutput)],
                       @"Could not enable output on AURemoteIO");
         
         /*---------------------------------------------------------------------*
          * Explicitly set the audio format to 32-bit float.
          *--------------------------------------------------------------------*/
-        AudioStreamBasicDescription audioFormat;
-        audioFormat.mSampleRate         = [AVAudioSession sharedInstance].sampleRate;
-        audioFormat.mFormatID           = kAudioFormatLinearPCM;
-        audioFormat.mFormatFlags        = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
-        audioFormat.mFramesPerPacket    = 1;
-        audioFormat.mChannelsPerFrame   = 1;
-        audioFormat.mBitsPerChannel     = 8 * sizeof(float);
-        audioFormat.mBytesPerFrame      = sizeof(float) * audioFormat.mChannelsPerFrame;
-        audioFormat.mBytesPerPacket     = audioFormat.mBytesPerFrame * audioFormat.mFramesPerPacket;
-
-        XThrowIfError(AudioUnitSetProperty(self.audioIOUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, 1, &audioFormat, sizeof(audioFormat)),
-                      @"Couldn't set the input client format on AURemoteIO");
-        XThrowIfError(AudioUnitSetProperty(self.audioIOUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, 0, &audioFormat, sizeof(audioFormat)),
-                      @"Couldn't set the output client format on AURemoteIO");
+        double clientSampleRate = [self preferredClientSampleRate];
+        [self setClientFormatWithSampleRate:clientSampleRate];
+        
+        if (self.resamplerQuality != AudioIOResamplerQualityNone)
+        {
+            UInt32 complexity = kAudioUnitSampleRateConverterComplexity_Normal;
+            if (self.resamplerQuality == AudioIOResamplerQualityLow)
+                complexity = kAudioUnitSampleRateConverterComplexity_Linear;
+            else if (self.resamplerQuality == AudioIOResamplerQualityHigh)
+                complexity = kAudioUnitSampleRateConverterComplexity_Mastering;
+            
+            /*---------------------------------------------------------------------*
+             * The complexity is only a hint: the unit may reject it, or
+             * accept it without using it. Read it back, so that at least a
+             * rejection is known; if so, the unit's default converter is
+             * used, which is not fatal.
+             *--------------------------------------------------------------------*/
+            OSStatus err = [self.backend setUnitProperty:kAudioUnitProperty_SampleRateConverterComplexity scope:kAudioUnitScope_Global element:0 data:&complexity size:sizeof(complexity)];
+            
+            UInt32 applied = 0;
+            UInt32 size = sizeof(applied);
+            if (!err)
+            {
+                err = [self.backend getUnitProperty:kAudioUnitProperty_SampleRateConverterComplexity scope:kAudioUnitScope_Global element:0 data:&applied size:&size];
+            }
+            
+            self.resamplerQualityApplied = (!err && applied == complexity);
+            if (!self.resamplerQualityApplied)
+            {
+                DLog(@"Sample rate converter complexity not applied (%d), using default", (int) err);
+            }
+        }
+        else
+        {
+            self.resamplerQualityApplied = NO;
+        }
 
         /*---------------------------------------------------------------------*
          * Create our callback data structure.
          * This is needed to pass the audio I/O unit to the lower-level
          * interface.
          *--------------------------------------------------------------------*/
-        cd.audioIOUnit = self.audioIOUnit;
+        cd.audioIOUnit = self.backend.unit;
         cd.isBeingReconstructed = &_isBeingReconstructed;
         cd.callback = self.callback;
+        cd.contextCallback = self.contextCallback;
+        cd.callbackContext = self.callbackContext;
         cd.delegate = self.delegate;
-        cd.samplerate = [AVAudioSession sharedInstance].sampleRate;
+        cd.samplerate = clientSampleRate;
+        cd.hasInput = enableInput;
+        cd.hasOutput = enableOutput;
+        
+        [self createRenderArena];
         
         /*---------------------------------------------------------------------*
-         * Set the render callback on AURemoteIO
+         * Set the render callback on AURemoteIO, or without output, the
+         * input callback.
          *--------------------------------------------------------------------*/
         AURenderCallbackStruct renderCallback;
-        renderCallback.inputProc = performRender;
         renderCallback.inputProcRefCon = NULL;
         
-        XThrowIfError(AudioUnitSetProperty(self.audioIOUnit, kAudioUnitProperty_SetRenderCallback, kAudioUnitScope_Input, 0, &renderCallback, sizeof(renderCallback)),
-                      @"Couldn't set render callback on AURemoteIO");
+        if (enableOutput)
+        {
+            renderCallback.inputProc = performRender;
+            XThrowIfError([self.backend setUnitProperty:kAudioUnitProperty_SetRenderCallback scope:kAudioUnitScope_Input element:0 data:&renderCallback size:sizeof(renderCallback)],
+                          @"Couldn't set render callback on AURemoteIO");
+        }
+        else
+        {
+            renderCallback.inputProc = performInput;
+            XThrowIfError([self.backend setUnitProperty:kAudioOutputUnitProperty_SetInputCallback scope:kAudioUnitScope_Global element:1 data:&renderCallback size:sizeof(renderCallback)],
+                          @"Couldn't set input callback on AURemoteIO");
+        }
         
         /*---------------------------------------------------------------------*
          * Initialize the AURemoteIO instance
          *--------------------------------------------------------------------*/
-        XThrowIfError(AudioUnitInitialize(self.audioIOUnit),
+        XThrowIfError([self.backend initializeUnit],
                       @"Couldn't initialize AURemoteIO instance");
         
         return YES;
@@ -501,7 +1306,139 @@ static OSStatus	performRender (void                         *inRefCon,
     }
 }
 
+- (double)preferredClientSampleRate
+{
+    /*---------------------------------------------------------------------*
+     * The session only takes our preferred sample rate as a hint. If
+     * resampling is enabled, ask AURemoteIO for our preferred rate
+     * regardless, and it will convert to and from the hardware rate.
+     *--------------------------------------------------------------------*/
+    if (self.resamplerQuality != AudioIOResamplerQualityNone)
+    {
+        return AUDIO_PREFERRED_SAMPLE_RATE;
+    }
+    
+    return self.backend.sampleRate;
+}
+
+- (void)setClientFormatWithSampleRate:(double)sampleRate
+{
+    AudioStreamBasicDescription audioFormat;
+    audioFormat.mSampleRate         = sampleRate;
+    audioFormat.mFormatID           = kAudioFormatLinearPCM;
+    audioFormat.mFormatFlags        = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
+    audioFormat.mFramesPerPacket    = 1;
+    audioFormat.mChannelsPerFrame   = 1;
+    audioFormat.mBitsPerChannel     = 8 * sizeof(float);
+    audioFormat.mBytesPerFrame      = sizeof(float) * audioFormat.mChannelsPerFrame;
+    audioFormat.mBytesPerPacket     = audioFormat.mBytesPerFrame * audioFormat.mFramesPerPacket;
+    
+    XThrowIfError([self.backend setUnitProperty:kAudioUnitProperty_StreamFormat scope:kAudioUnitScope_Output element:1 data:&audioFormat size:sizeof(audioFormat)],
+                  @"Couldn't set the input client format on AURemoteIO");
+    XThrowIfError([self.backend setUnitProperty:kAudioUnitProperty_StreamFormat scope:kAudioUnitScope_Input element:0 data:&audioFormat size:sizeof(audioFormat)],
+                  @"Couldn't set the output client format on AURemoteIO");
+}
+
+- (BOOL)reconfigureIOUnit
+{
+    /*---------------------------------------------------------------------*
+     * Bring the I/O unit in line with the current route, touching only
+     * what has changed. AURemoteIO follows route changes by itself, so
+     * if the client sample rate is unaffected, audio carries on
+     * undisturbed. Otherwise, audio fades out, the unit is briefly
+     * stopped and its sample rate updated, and audio resumes with a short
+     * fade-in. The unit is also stopped if the delegate implements
+     * audioIOPortChanged, which has always been called with audio
+     * stopped. The session, observers and all user DSP state are left
+     * intact throughout.
+     *--------------------------------------------------------------------*/
+    if (!self.backend.hasUnit)
+    {
+        return NO;
+    }
+    
+    CFTimeInterval startTime = CACurrentMediaTime();
+    double clientSampleRate = [self preferredClientSampleRate];
+    BOOL sampleRateChanged = clientSampleRate != cd.samplerate;
+    BOOL delegateNeedsStop = [self.delegate respondsToSelector:@selector(audioIOPortChanged)];
+    
+    if (sampleRateChanged || delegateNeedsStop)
+    {
+        @try
+        {
+            if (sampleRateChanged)
+                DLog(@"Client sample rate changed from %dHz to %.0fHz", cd.samplerate, clientSampleRate);
+            else
+                DLog(@"Stopping audio unit for the delegate's port change");
+            
+            /*---------------------------------------------------------------------*
+             * Fade out before cutting audio off, as stop does. The route has
+             * already changed, so this fades out on the new route.
+             *--------------------------------------------------------------------*/
+            if (self.isStarted && cd.hasOutput)
+            {
+                [self fadeOutBeforeStop:AUDIO_ROUTE_CHANGE_FADE_DURATION];
+            }
+            
+            self.isBeingReconstructed = YES;
+            [self.backend stopUnit];
+            
+            if (sampleRateChanged)
+            {
+                XThrowIfError([self.backend uninitializeUnit],
+                              @"Couldn't uninitialize AURemoteIO instance");
+                
+                [self setClientFormatWithSampleRate:clientSampleRate];
+                cd.samplerate = clientSampleRate;
+                audio_period_tracker_reset(&cd.periodTracker);
+                
+                XThrowIfError([self.backend initializeUnit],
+                              @"Couldn't initialize AURemoteIO instance");
+            }
+            
+            /*---------------------------------------------------------------------*
+             * The unit is stopped, so it's safe for the delegate to reallocate
+             * memory used by the audio thread before processing resumes.
+             *--------------------------------------------------------------------*/
+            [self notifyPortChanged];
+            
+            audio_gain_fade_in(cd.gain, [self effectiveGain], AUDIO_ROUTE_CHANGE_FADE_DURATION, (audio_gain_ramp_t) self.gainRampShape);
+            self.isBeingReconstructed = NO;
+            
+            if (self.isStarted)
+            {
+                XThrowIfError([self.backend startUnit],
+                              @"Couldn't restart AURemoteIO instance");
+            }
+        }
+        @catch (NSException *e)
+        {
+            DLog(@"Failed reconfiguring audio unit: %@", e);
+            self.isBeingReconstructed = NO;
+            return NO;
+        }
+    }
+    
+    [self notifyRouteChanged];
+    
+    self.lastReconfigurationDuration = CACurrentMediaTime() - startTime;
+    DLog(@"Reconfigured audio unit in %.1fms", self.lastReconfigurationDuration * 1000.0);
+    
+    return YES;
+}
+
 - (BOOL)setup
+{
+    __block BOOL ok;
+    [self runOnControlQueue:^{
+        AUDIO_TRACE_BEGIN("setup");
+        ok = [self performSetup];
+        AUDIO_TRACE_END("setup");
+    }];
+    return ok;
+}
+
+- (BOOL)performSetup
 {
     /*---------------------------------------------------------------------*
      * Initialise our audio chain:
@@ -520,12 +1457,185 @@ static OSStatus	performRender (void                         *inRefCon,
     ok = [self setupIOUnit];
     if (!ok) return NO;
     
+    [self warmUpRenderPath];
+    
     self.isBeingReconstructed = NO;
     self.isInitialised = YES;
 
     return YES;
 }
 
+/*----------------------------------------------------------------------------*
+ * Allocate the arena from which render-time buffers are taken, sized for
+ * the largest block the unit may request. Throws on failure.
+ *----------------------------------------------------------------------------*/
+- (void)createRenderArena
+{
+    UInt32 frames = 0;
+    UInt32 size = sizeof(frames);
+    if ([self.backend getUnitProperty:kAudioUnitProperty_MaximumFramesPerSlice scope:kAudioUnitScope_Global element:0 data:&frames size:&size] || frames == 0)
+    {
+        frames = AUDIO_DEFAULT_MAXIMUM_FRAMES;
+    }
+    
+    AudioStreamBasicDescription format = { 0 };
+    size = sizeof(format);
+    [self.backend getUnitProperty:kAudioUnitProperty_StreamFormat scope:kAudioUnitScope_Input element:0 data:&format size:&size];
+    BOOL nonInterleaved = (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+    UInt32 channels = MAX(format.mChannelsPerFrame, 1);
+    
+    self.maximumFramesPerSlice = frames;
+    self.renderBufferCount = nonInterleaved ? MIN(channels, 32) : 1;
+    self.renderBufferSize = (size_t) frames * (nonInterleaved ? 1 : channels) * sizeof(float);
+    
+    /*---------------------------------------------------------------------*
+     * Without output, the input callback renders into buffers of its own,
+     * which live in the arena alongside the scratch space.
+     *--------------------------------------------------------------------*/
+    UInt32 numBuffers = self.renderBufferCount;
+    size_t listSize = offsetof(AudioBufferList, mBuffers) + numBuffers * sizeof(AudioBuffer);
+    size_t inputSize = cd.hasOutput ? 0 : listSize + AUDIO_ARENA_ALIGNMENT + numBuffers * (self.renderBufferSize + AUDIO_ARENA_ALIGNMENT);
+    
+    /*---------------------------------------------------------------------*
+     * Warm-up takes its stand-ins for the hardware's buffers from the
+     * scratch space too, so reserve room for them on top of the callback's.
+     *--------------------------------------------------------------------*/
+    size_t warmUpSize = self.warmUpCallbacks ? numBuffers * (self.renderBufferSize + AUDIO_ARENA_ALIGNMENT) : 0;
+    
+    cd.inputBuffers = NULL;
+    audio_arena_destroy(cd.arena);
+    cd.arena = audio_arena_create(self.renderBufferSize * channels * self.renderScratchBuffers + inputSize + warmUpSize, self.locksRenderMemory);
+    XThrowIfError(cd.arena == NULL, @"Couldn't allocate render memory");
+    
+    if (!cd.hasOutput)
+    {
+        AudioBufferList *buffers = audio_arena_alloc(cd.arena, listSize);
+        buffers->mNumberBuffers = numBuffers;
+        for (UInt32 c = 0; c < numBuffers; c++)
+        {
+            buffers->mBuffers[c].mNumberChannels = (numBuffers > 1) ? 1 : channels;
+            buffers->mBuffers[c].mDataByteSize = (UInt32) self.renderBufferSize;
+            buffers->mBuffers[c].mData = audio_arena_alloc(cd.arena, self.renderBufferSize);
+        }
+        cd.inputBytesPerFrame = (UInt32) (self.renderBufferSize / frames);
+        cd.inputBuffers = buffers;
+    }
+    
+    if (self.locksRenderMemory && !audio_arena_is_locked(cd.arena))
+    {
+        DLog(@"Couldn't lock render memory: %s", strerror(errno));
+    }
+}
+
+- (void)destroyRenderArena
+{
+    cd.inputBuffers = NULL;
+    audio_arena_destroy(cd.arena);
+    cd.arena = NULL;
+}
+
+/*----------------------------------------------------------------------------*
+ * Run the callback on silence, so that the code and data it touches are
+ * paged in and cached before the first hardware period. Output is
+ * discarded. Buffers are taken from the render arena's scratch stack, so
+ * that real callbacks find them warm too.
+ *----------------------------------------------------------------------------*/
+- (void)warmUpRenderPath
+{
+    if (self.locksRenderMemory && !self.renderMemoryLocked)
+    {
+        /*---------------------------------------------------------------------*
+         * The arena is locked on creation; lock the other state the render
+         * callback touches. Failure is not fatal.
+         *--------------------------------------------------------------------*/
+        if (mlock(&cd, sizeof(cd)) || mlock(channel_pointers, sizeof(channel_pointers)))
+        {
+            DLog(@"Couldn't lock render memory: %s", strerror(errno));
+        }
+        self.renderMemoryLocked = YES;
+    }
+    
+    if ((!cd.callback && !cd.contextCallback) || !cd.arena || !self.warmUpCallbacks)
+    {
+        return;
+    }
+    
+    UInt32 numBuffers = self.renderBufferCount;
+    size_t bufferSize = self.renderBufferSize;
+    
+    size_t mark = audio_arena_scratch_mark(cd.arena);
+    for (UInt32 c = 0; c < numBuffers; c++)
+    {
+        channel_pointers[c] = audio_arena_scratch_alloc(cd.arena, bufferSize);
+        if (!channel_pointers[c])
+        {
+            DLog(@"Not enough render memory to warm up the render path");
+            audio_arena_scratch_release(cd.arena, mark);
+            return;
+        }
+    }
+    
+    /*---------------------------------------------------------------------*
+     * Run under the same floating-point mode as the render callback.
+     *--------------------------------------------------------------------*/
+    audio_fp_state_t fpState = 0;
+    if (cd.denormalMode == AudioIODenormalModeFlushToZero)
+        fpState = audio_denormals_flush_begin();
+    
+    /*---------------------------------------------------------------------*
+     * Warm up at the size the callback will actually be asked for, rather
+     * than maximumFramesPerSlice, which is typically several times larger.
+     *--------------------------------------------------------------------*/
+    NSUInteger numFrames = [self warmUpFrames];
+    
+    for (NSUInteger i = 0; i < self.warmUpCallbacks; i++)
+    {
+        for (UInt32 c = 0; c < numBuffers; c++)
+            memset(channel_pointers[c], 0, bufferSize);
+        
+        /*---------------------------------------------------------------------*
+         * As in performRender, the callback's own scratch allocations are
+         * released after each call.
+         *--------------------------------------------------------------------*/
+        size_t callbackMark = audio_arena_scratch_mark(cd.arena);
+        runCallback(channel_pointers, numBuffers, (UInt32) numFrames);
+        audio_arena_scratch_release(cd.arena, callbackMark);
+    }
+    
+    if (cd.denormalMode == AudioIODenormalModeFlushToZero)
+        audio_denormals_flush_end(fpState);
+    
+    audio_arena_scratch_release(cd.arena, mark);
+}
+
+/*----------------------------------------------------------------------------*
+ * Frames per warm-up call: the configured buffer size at the client sample
+ * rate, within maximumFramesPerSlice.
+ *----------------------------------------------------------------------------*/
+- (NSUInteger)warmUpFrames
+{
+    NSUInteger maximum = self.maximumFramesPerSlice;
+    double sampleRate = self.sampleRate;
+    NSUInteger bufferSize = self.bufferSize;
+    if (bufferSize == 0 || sampleRate <= 0)
+    {
+        return maximum;
+    }
+    
+    NSUInteger frames = (NSUInteger) lround(bufferSize * [self clientSampleRate] / sampleRate);
+    return MAX(MIN(frames, maximum), 1);
+}
+
+- (void)unlockRenderMemory
+{
+    if (self.renderMemoryLocked)
+    {
+        munlock(&cd, sizeof(cd));
+        munlock(channel_pointers, sizeof(channel_pointers));
+        self.renderMemoryLocked = NO;
+    }
+}
+
 - (BOOL)activateAudioSession
 {
     /*---------------------------------------------------------------------*
@@ -533,8 +1643,7 @@ static OSStatus	performRender (void                         *inRefCon,
      *--------------------------------------------------------------------*/
     
     NSError *error;
-    AVAudioSession *sessionInstance = [AVAudioSession sharedInstance];
-    [sessionInstance setActive:YES error:&error];
+    [self.backend setActive:YES error:&error];
     if (error)
     {
         DLog(@"Couldn't set session active: %@", error);
@@ -555,7 +1664,7 @@ static OSStatus	performRender (void                         *inRefCon,
     NSError *error;
     @try
     {
-        [[AVAudioSession sharedInstance] setActive:NO error:&error];
+        [self.backend setActive:NO error:&error];
         if (error)
         {
             ok = NO;
@@ -583,6 +1692,17 @@ static OSStatus	performRender (void                         *inRefCon,
 }
 
 - (BOOL) teardown
+{
+    __block BOOL ok;
+    [self runOnControlQueue:^{
+        AUDIO_TRACE_BEGIN("teardown");
+        ok = [self performTeardown];
+        AUDIO_TRACE_END("teardown");
+    }];
+    return ok;
+}
+
+- (BOOL) performTeardown
 {
     /*---------------------------------------------------------------------*
      * Tear down our audio chain:
@@ -603,6 +1723,8 @@ static OSStatus	performRender (void                         *inRefCon,
     
     ok = [self teardownAudioSession];
     if (!ok) return NO;
+    
+    [self unlockRenderMemory];
 
     self.isBeingReconstructed = NO;
     self.isInitialised = NO;
@@ -619,12 +1741,12 @@ static OSStatus	performRender (void                         *inRefCon,
     
     @try
     {
-        [[AVAudioSession sharedInstance] removeObserver:self forKeyPath:@"outputVolume"];
+        [self.backend.notificationSource removeObserver:self forKeyPath:@"outputVolume"];
     }
     @catch (NSException *exception)
     {
         /*---------------------------------------------------------------------*
-         * Not observing AVAudioSession sharedInstance
+         * Not observing the session
          *--------------------------------------------------------------------*/
     }
     
@@ -636,9 +1758,9 @@ static OSStatus	performRender (void                         *inRefCon,
     BOOL success = YES;
     
     /*---------------------------------------------------------------------*
-     * Uninitialize the AURemoteIO instance and zero its memory.
+     * Uninitialize and dispose of the AURemoteIO instance.
      *--------------------------------------------------------------------*/
-    if (self.audioIOUnit)
+    if (self.backend.hasUnit)
     {
         @try
         {
@@ -647,11 +1769,18 @@ static OSStatus	performRender (void                         *inRefCon,
              * any error result). "All I/O must be stopped or paused prior to
              * deactivating the audio session."
              *--------------------------------------------------------------------*/
-            AudioOutputUnitStop(self.audioIOUnit);
+            [self.backend stopUnit];
             
-            XThrowIfError(AudioUnitUninitialize(self.audioIOUnit),
+            XThrowIfError([self.backend uninitializeUnit],
                           @"Couldn't uninitialize AudioUnit instance");
-            self.audioIOUnit = NULL;
+            XThrowIfError([self.backend disposeUnit],
+                          @"Couldn't dispose of AudioUnit instance");
+            cd.audioIOUnit = NULL;
+            
+            /*---------------------------------------------------------------------*
+             * Only now that the unit is gone can nothing be rendering.
+             *--------------------------------------------------------------------*/
+            [self destroyRenderArena];
         }
         @catch (NSException *exception)
         {
@@ -753,20 +1882,84 @@ static OSStatus	performRender (void                         *inRefCon,
 
 - (void)dealloc
 {
-    [self teardown];
-}
-
-////////////////////////////////////////////////////////////////////////////////
-#pragma mark - Key-value observation
-////////////////////////////////////////////////////////////////////////////////
-
+    /*---------------------------------------------------------------------*
+     * Let any reconfiguration in progress finish, then tear down directly:
+     * self must not be captured by a block during dealloc. If the last
+     * reference was dropped on the control queue itself, nothing else can
+     * be running there, and waiting for it would deadlock.
+     *--------------------------------------------------------------------*/
+    if (_reconfigurationTimer)
+    {
+        dispatch_source_cancel(_reconfigurationTimer);
+    }
+    if (_bufferControllerTimer)
+    {
+        dispatch_source_cancel(_bufferControllerTimer);
+    }
+    if (_loadWatchTimer)
+    {
+        dispatch_source_cancel(_loadWatchTimer);
+    }
+    if (dispatch_get_specific(AudioIOControlQueueKey) != (__bridge void *) self)
+    {
+        dispatch_sync(_controlQueue, ^{});
+    }
+    [self performTeardown];
+    
+    cd.glitchDetector = NULL;
+    audio_glitch_detector_destroy(_glitchDetector);
+    
+    cd.mixer = NULL;
+    audio_mixer_destroy(_mixer);
+    
+    atomic_store(&cd.convolver, NULL);
+    audio_convolver_destroy(_convolver);
+    
+    cd.bufferController = NULL;
+    audio_buffer_controller_destroy(_bufferController);
+    
+    cd.loadMeter = NULL;
+    audio_load_meter_destroy(_loadMeter);
+    
+    cd.inputMeter = NULL;
+    cd.outputMeter = NULL;
+    audio_meter_destroy(_inputMeter);
+    audio_meter_destroy(_outputMeter);
+    
+    audio_gain_t *gain = cd.gain;
+    cd.gain = NULL;
+    audio_gain_destroy(gain);
+    
+    audio_error_counter_t *renderErrors = cd.renderErrors;
+    cd.renderErrors = NULL;
+    audio_error_counter_destroy(renderErrors);
+    
+    cd.spectrum = NULL;
+    if (_analysisTimer)
+    {
+        dispatch_source_cancel(_analysisTimer);
+        dispatch_sync(_analysisQueue, ^{});
+    }
+    audio_spectrum_destroy(_spectrumAnalyser);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Key-value observation
+////////////////////////////////////////////////////////////////////////////////
+
 
 - (void) observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context {
     
     if ([keyPath isEqual:@"outputVolume"])
     {
+        float volume = self.backend.outputVolume;
         if (self.volumeBlock)
-            self.volumeBlock([[AVAudioSession sharedInstance] outputVolume]);
+            self.volumeBlock(volume);
+        
+        if (self.volumeGainCurve)
+            [self updateGain];
+        
+        [self postEvent:[AudioIOEvent volumeChangeEvent:volume sampleTime:self.currentSampleTime]];
     }
     else
     {
@@ -779,16 +1972,125 @@ static OSStatus	performRender (void                         *inRefCon,
 ////////////////////////////////////////////////////////////////////////////////
 
 - (OSStatus)start
+{
+    [self markStartRequest];
+    
+    __block OSStatus err;
+    [self runOnControlQueue:^{
+        err = [self performStart];
+    }];
+    return err;
+}
+
+/*----------------------------------------------------------------------------*
+ * The asynchronous variants don't keep the manager alive: if it is freed
+ * before the control queue gets to them, they report failure.
+ *----------------------------------------------------------------------------*/
+- (void)setupWithCompletion:(void (^)(BOOL success))completion
+{
+    __weak AudioIOManager *weakSelf = self;
+    dispatch_async(self.controlQueue, ^{
+        AudioIOManager *strongSelf = weakSelf;
+        BOOL ok = strongSelf ? [strongSelf performSetup] : NO;
+        if (completion)
+        {
+            dispatch_async(dispatch_get_main_queue(), ^{ completion(ok); });
+        }
+    });
+}
+
+- (void)startWithCompletion:(void (^)(OSStatus error))completion
+{
+    [self markStartRequest];
+    
+    __weak AudioIOManager *weakSelf = self;
+    dispatch_async(self.controlQueue, ^{
+        AudioIOManager *strongSelf = weakSelf;
+        OSStatus err = strongSelf ? [strongSelf performStart] : kAudioUnitErr_Uninitialized;
+        if (completion)
+        {
+            dispatch_async(dispatch_get_main_queue(), ^{ completion(err); });
+        }
+    });
+}
+
+/*----------------------------------------------------------------------------*
+ * Begin timing a start request, unless audio is already running.
+ *----------------------------------------------------------------------------*/
+- (void)markStartRequest
+{
+    if (self.isStarted)
+    {
+        return;
+    }
+    
+    self.startRequestHostTime = mach_absolute_time();
+    atomic_store(&cd.firstRenderHostTime, 0);
+    
+    cd.callbacksSinceStart = 0;
+    atomic_store(&cd.firstCallbackTicks, 0);
+    atomic_store(&cd.steadyCallbackTicks, 0);
+    
+    audio_period_tracker_reset(&cd.periodTracker);
+    atomic_store(&cd.overruns, 0);
+    cd.lastRenderError = noErr;
+}
+
+- (size_t)renderArenaSize
+{
+    return cd.arena ? audio_arena_size(cd.arena) : 0;
+}
+
+- (size_t)renderArenaHighWaterMark
+{
+    return cd.arena ? audio_arena_high_water_mark(cd.arena) : 0;
+}
+
+- (NSTimeInterval)firstCallbackDuration
+{
+    return host_ticks_to_seconds(atomic_load(&cd.firstCallbackTicks));
+}
+
+- (NSTimeInterval)steadyStateCallbackDuration
+{
+    return host_ticks_to_seconds(atomic_load(&cd.steadyCallbackTicks));
+}
+
+- (NSTimeInterval)timeToFirstCallback
+{
+    uint64_t requestTime = self.startRequestHostTime;
+    uint64_t renderTime = atomic_load(&cd.firstRenderHostTime);
+    
+    if (!requestTime || renderTime < requestTime)
+    {
+        return 0;
+    }
+    
+    return host_ticks_to_seconds(renderTime - requestTime);
+}
+
+- (OSStatus)performStart
 {
     if (!self.isInitialised)
     {
-        [self setup];
+        [self performSetup];
     }
     
+    /*---------------------------------------------------------------------*
+     * Fade in from silence, or restore the gain if a previous stop faded
+     * out. Starting again while running leaves the output alone.
+     *--------------------------------------------------------------------*/
+    if (self.isStarted)
+        [self updateGain];
+    else if (self.startStopFadeDuration > 0)
+        audio_gain_fade_in(cd.gain, [self effectiveGain], self.startStopFadeDuration, (audio_gain_ramp_t) self.gainRampShape);
+    else
+        audio_gain_set(cd.gain, [self effectiveGain], 0, AUDIO_GAIN_RAMP_LINEAR);
+    
     /*---------------------------------------------------------------------*
      * Start audio processing.
      *--------------------------------------------------------------------*/
-    OSStatus err = AudioOutputUnitStart(self.audioIOUnit);
+    OSStatus err = [self.backend startUnit];
     if (err)
     {
         DLog(@"Couldn't start audio I/O: %d", (int) err);
@@ -796,11 +2098,79 @@ static OSStatus	performRender (void                         *inRefCon,
     }
     
     self.isStarted = YES;
+    [self updateConvolverBlockSize];
     
     return err;
 }
 
 - (OSStatus)stop
+{
+    __block OSStatus err;
+    [self runOnControlQueue:^{
+        err = [self performStop];
+    }];
+    return err;
+}
+
+- (void)stopWithCompletion:(void (^)(OSStatus error))completion
+{
+    __weak AudioIOManager *weakSelf = self;
+    dispatch_async(self.controlQueue, ^{
+        AudioIOManager *strongSelf = weakSelf;
+        OSStatus err = strongSelf ? [strongSelf performStop] : kAudioUnitErr_Uninitialized;
+        if (completion)
+        {
+            dispatch_async(dispatch_get_main_queue(), ^{ completion(err); });
+        }
+    });
+}
+
+/*----------------------------------------------------------------------------*
+ * Ramp the output to silence, and sleep until the audio thread signals
+ * that the ramp has been rendered and handed to the hardware. The wait is
+ * bounded, in case the audio thread is not running.
+ *----------------------------------------------------------------------------*/
+- (void)fadeOutBeforeStop:(NSTimeInterval)duration
+{
+    NSTimeInterval period = self.backend.IOBufferDuration;
+    audio_gain_set(cd.gain, 0, duration, (audio_gain_ramp_t) self.gainRampShape);
+    
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    cd.fadeDrainRenders = 0;
+    atomic_store(&cd.fadeSemaphore, (__bridge void *) done);
+    
+    /*---------------------------------------------------------------------*
+     * The fade only advances as the audio thread renders. If two periods
+     * pass without a render, it isn't running (eg, the session has been
+     * interrupted), so there is nothing to fade and no point waiting.
+     *--------------------------------------------------------------------*/
+    unsigned int renders = atomic_load_explicit(&cd.renderCount, memory_order_relaxed);
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:duration + 3 * period];
+    int64_t timeout = (int64_t) (2 * period * NSEC_PER_SEC);
+    
+    while (dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, timeout)))
+    {
+        unsigned int count = atomic_load_explicit(&cd.renderCount, memory_order_relaxed);
+        if (count != renders && [deadline timeIntervalSinceNow] > 0)
+        {
+            renders = count;
+            continue;
+        }
+        
+        /*---------------------------------------------------------------------*
+         * Give up, unless the audio thread has just taken the semaphore, in
+         * which case it is about to signal it and must find it alive.
+         *--------------------------------------------------------------------*/
+        void *expected = (__bridge void *) done;
+        if (!atomic_compare_exchange_strong(&cd.fadeSemaphore, &expected, NULL))
+        {
+            dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+        }
+        break;
+    }
+}
+
+- (OSStatus)performStop
 {
     if (!self.isInitialised)
     {
@@ -808,14 +2178,23 @@ static OSStatus	performRender (void                         *inRefCon,
         return 1;
     }
     
+    if (self.isStarted && cd.hasOutput && self.startStopFadeDuration > 0)
+    {
+        [self fadeOutBeforeStop:self.startStopFadeDuration];
+    }
+    
     /*---------------------------------------------------------------------*
      * Terminate audio processing.
      *--------------------------------------------------------------------*/
-    OSStatus err = AudioOutputUnitStop(self.audioIOUnit);
+    OSStatus err = [self.backend stopUnit];
     
     if (err)
     {
+        /*---------------------------------------------------------------------*
+         * Audio is still running, so bring back the output faded out above.
+         *--------------------------------------------------------------------*/
         DLog(@"Couldn't stop audio I/O: %d", (int) err);
+        [self updateGain];
         return err;
     }
     
@@ -830,12 +2209,22 @@ static OSStatus	performRender (void                         *inRefCon,
 
 - (double)sampleRate
 {
-    return [[AVAudioSession sharedInstance] sampleRate];
+    return self.backend.sampleRate;
+}
+
+- (double)clientSampleRate
+{
+    if (self.isInitialised)
+    {
+        return cd.samplerate;
+    }
+    
+    return (self.resamplerQuality == AudioIOResamplerQualityNone) ? self.sampleRate : AUDIO_PREFERRED_SAMPLE_RATE;
 }
 
 - (double)volume
 {
-	return [[AVAudioSession sharedInstance] outputVolume];
+	return self.backend.outputVolume;
 }
 
 - (void)setVolumeChangedBlock:(audio_volume_change_callback_t)block
@@ -843,5 +2232,614 @@ static OSStatus	performRender (void                         *inRefCon,
     self.volumeBlock = block;
 }
 
+- (void)setDetectsGlitches:(BOOL)detectsGlitches
+{
+    /*---------------------------------------------------------------------*
+     * The detector is created on first use and kept until dealloc, so that
+     * disabling detection never frees memory the audio thread may be using.
+     *--------------------------------------------------------------------*/
+    if (detectsGlitches && !_glitchDetector)
+    {
+        _glitchDetector = audio_glitch_detector_create(audio_glitch_config_default(), AUDIO_GLITCH_LOG_SIZE);
+    }
+    
+    _detectsGlitches = detectsGlitches;
+    cd.glitchDetector = detectsGlitches ? _glitchDetector : NULL;
+}
+
+- (void)setMixesSources:(BOOL)mixesSources
+{
+    /*---------------------------------------------------------------------*
+     * As with the glitch detector, the mixer lives until dealloc. Its
+     * sources stay registered while mixing is disabled.
+     *--------------------------------------------------------------------*/
+    if (mixesSources && !_mixer)
+    {
+        _mixer = audio_mixer_create(AUDIO_DEFAULT_MAXIMUM_FRAMES);
+    }
+    
+    _mixesSources = mixesSources;
+    cd.mixer = mixesSources ? _mixer : NULL;
+}
+
+- (BOOL)setConvolutionImpulseResponse:(const float *)impulseResponse length:(int)length
+{
+    NSData *response = (impulseResponse && length > 0) ? [NSData dataWithBytes:impulseResponse length:length * sizeof(float)] : nil;
+    
+    __block BOOL ok;
+    [self runOnControlQueue:^{
+        ok = [self installConvolverWithImpulseResponse:response blockSize:[self preferredConvolverBlockSize]];
+        if (ok)
+        {
+            self.impulseResponse = response;
+        }
+    }];
+    return ok;
+}
+
+/*----------------------------------------------------------------------------*
+ * Head blocks match the frames per callback (the buffer size, at the
+ * client sample rate), rounded down to a power of two, so that each
+ * callback completes at least one. The convolver delays its output by
+ * one head block, so this adds up to one buffer of latency, and no more.
+ *----------------------------------------------------------------------------*/
+- (int)preferredConvolverBlockSize
+{
+    double sampleRate = self.sampleRate;
+    NSUInteger bufferSize = self.bufferSize;
+    if (bufferSize == 0 || sampleRate <= 0)
+    {
+        return AUDIO_BUFFER_SIZE;
+    }
+    
+    int frames = (int) (bufferSize * [self clientSampleRate] / sampleRate);
+    int blockSize = 32;
+    while (blockSize * 2 <= frames && blockSize * 2 <= AUDIO_CONVOLVER_MAX_BLOCK_SIZE)
+    {
+        blockSize *= 2;
+    }
+    return blockSize;
+}
+
+/*----------------------------------------------------------------------------*
+ * Rebuild the convolver if the buffer size now calls for different head
+ * blocks. Runs on the control queue.
+ *----------------------------------------------------------------------------*/
+- (void)updateConvolverBlockSize
+{
+    int blockSize = [self preferredConvolverBlockSize];
+    if (self.impulseResponse && blockSize != self.convolverBlockSize)
+    {
+        DLog(@"Rebuilding convolver with %d-frame blocks", blockSize);
+        [self installConvolverWithImpulseResponse:self.impulseResponse blockSize:blockSize];
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ * Create a convolver for an impulse response, or none for nil, and swap it
+ * in for the current one. Runs on the control queue.
+ *----------------------------------------------------------------------------*/
+- (BOOL)installConvolverWithImpulseResponse:(NSData *)impulseResponse blockSize:(int)blockSize
+{
+    /*---------------------------------------------------------------------*
+     * The client format is mono.
+     *--------------------------------------------------------------------*/
+    audio_convolver_t *convolver = NULL;
+    if (impulseResponse)
+    {
+        int length = (int) (impulseResponse.length / sizeof(float));
+        audio_convolver_config_t config = audio_convolver_config_default();
+        config.block_size = blockSize;
+        convolver = audio_convolver_create(config, impulseResponse.bytes, length, 1);
+        if (!convolver)
+        {
+            DLog(@"Couldn't create a convolver for a %d-sample impulse response", length);
+            return NO;
+        }
+    }
+    self.convolverBlockSize = blockSize;
+    
+    /*---------------------------------------------------------------------*
+     * Swap in the new convolver, then wait for any render cycle that may
+     * still be using the old one before freeing it. The store and the load
+     * of the cycle count must not be reordered, so both are sequentially
+     * consistent, as are their counterparts on the audio thread.
+     *--------------------------------------------------------------------*/
+    audio_convolver_t *previous = _convolver;
+    _convolver = convolver;
+    atomic_store(&cd.convolver, convolver);
+    
+    if (previous)
+    {
+        unsigned int cycle = atomic_load(&cd.convolverCycle);
+        if (cycle & 1)
+        {
+            while (atomic_load(&cd.convolverCycle) == cycle)
+                sched_yield();
+        }
+        audio_convolver_destroy(previous);
+    }
+    
+    return YES;
+}
+
+- (void)setMetersLevels:(BOOL)metersLevels
+{
+    /*---------------------------------------------------------------------*
+     * As with the glitch detector, meters live until dealloc.
+     *--------------------------------------------------------------------*/
+    if (metersLevels && !_inputMeter)
+    {
+        _inputMeter = audio_meter_create(self.meterConfig);
+        _outputMeter = audio_meter_create(self.meterConfig);
+    }
+    
+    _metersLevels = metersLevels;
+    cd.inputMeter = metersLevels ? _inputMeter : NULL;
+    cd.outputMeter = metersLevels ? _outputMeter : NULL;
+}
+
+- (void)setMeasuresLoad:(BOOL)measuresLoad
+{
+    if (measuresLoad == _measuresLoad)
+    {
+        return;
+    }
+    
+    /*---------------------------------------------------------------------*
+     * As with the level meters, the load meter lives until dealloc; only
+     * the threshold watch comes and goes.
+     *--------------------------------------------------------------------*/
+    if (measuresLoad && !_loadMeter)
+    {
+        _loadMeter = audio_load_meter_create(self.loadConfig);
+        if (!_loadMeter)
+        {
+            DLog(@"Couldn't create load meter");
+            return;
+        }
+    }
+    
+    _measuresLoad = measuresLoad;
+    cd.loadMeter = measuresLoad ? _loadMeter : NULL;
+    
+    if (measuresLoad)
+    {
+        __weak AudioIOManager *weakSelf = self;
+        uint64_t interval = (uint64_t) (AUDIO_LOAD_WATCH_INTERVAL * NSEC_PER_SEC);
+        self.loadWatchTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.controlQueue);
+        dispatch_source_set_event_handler(self.loadWatchTimer, ^{
+            [weakSelf checkLoadThresholds];
+        });
+        dispatch_source_set_timer(self.loadWatchTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 4);
+        dispatch_resume(self.loadWatchTimer);
+    }
+    else
+    {
+        dispatch_source_cancel(self.loadWatchTimer);
+        self.loadWatchTimer = nil;
+    }
+}
+
+- (void)setLoadConfig:(audio_load_config_t)loadConfig
+{
+    _loadConfig = loadConfig;
+    if (_loadMeter)
+    {
+        audio_load_meter_set_config(_loadMeter, loadConfig);
+    }
+}
+
+- (audio_load_snapshot_t)dspLoad
+{
+    audio_load_snapshot_t load = { 0 };
+    if (_loadMeter)
+    {
+        audio_load_meter_read(_loadMeter, &load);
+    }
+    return load;
+}
+
+/*----------------------------------------------------------------------------*
+ * Report any threshold crossings since the last check, in order. A load
+ * that crossed and came back between checks is reported as both.
+ *----------------------------------------------------------------------------*/
+- (void)checkLoadThresholds
+{
+    audio_load_snapshot_t load = self.dspLoad;
+    BOOL high = load.high != 0;
+    BOOL wentHigh = load.high_count != self.loadHighCount;
+    
+    if (!wentHigh && high == self.loadWasHigh)
+    {
+        return;
+    }
+    
+    BOOL wasHigh = self.loadWasHigh;
+    self.loadWasHigh = high;
+    self.loadHighCount = load.high_count;
+    
+    void (^block)(BOOL, audio_load_snapshot_t) = self.loadThresholdBlock;
+    if (!block)
+    {
+        return;
+    }
+    
+    if (wentHigh && wasHigh)
+    {
+        block(NO, load);
+    }
+    if (wentHigh)
+    {
+        block(YES, load);
+    }
+    if (!high)
+    {
+        block(NO, load);
+    }
+}
+
+- (void)setAnalysesSpectrum:(BOOL)analysesSpectrum
+{
+    if (analysesSpectrum == _analysesSpectrum)
+    {
+        return;
+    }
+    
+    /*---------------------------------------------------------------------*
+     * The analyser is kept until dealloc, like the meters; only the
+     * worker timer comes and goes.
+     *--------------------------------------------------------------------*/
+    if (analysesSpectrum && !_spectrumAnalyser)
+    {
+        int size = (int) self.spectrumSize;
+        _spectrumAnalyser = audio_spectrum_create(size, size / 4, MAX(8 * size, AUDIO_SPECTRUM_MIN_BUFFER_FRAMES));
+        if (!_spectrumAnalyser)
+        {
+            DLog(@"Couldn't create spectrum analyser of size %d", size);
+            return;
+        }
+        
+        self.analysisQueue = dispatch_queue_create("AudioIOManager.analysis", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+    }
+    
+    _analysesSpectrum = analysesSpectrum;
+    cd.spectrum = analysesSpectrum ? _spectrumAnalyser : NULL;
+    
+    if (analysesSpectrum)
+    {
+        audio_spectrum_t *spectrum = _spectrumAnalyser;
+        uint64_t interval = (uint64_t) (AUDIO_SPECTRUM_UPDATE_INTERVAL * NSEC_PER_SEC);
+        self.analysisTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.analysisQueue);
+        dispatch_source_set_event_handler(self.analysisTimer, ^{
+            AUDIO_TRACE_BEGIN("spectrum analysis");
+            audio_spectrum_analyse(spectrum);
+            AUDIO_TRACE_END("spectrum analysis");
+        });
+        dispatch_source_set_timer(self.analysisTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 4);
+        dispatch_resume(self.analysisTimer);
+    }
+    else
+    {
+        dispatch_source_cancel(self.analysisTimer);
+        self.analysisTimer = nil;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ * The gain the output should settle at: outputGain, scaled by the volume
+ * compensation curve if any, or zero if muted.
+ *----------------------------------------------------------------------------*/
+- (float)effectiveGain
+{
+    if (self.muted)
+    {
+        return 0;
+    }
+    
+    float (^curve)(float volume) = self.volumeGainCurve;
+    return self.outputGain * (curve ? curve(self.backend.outputVolume) : 1.0f);
+}
+
+- (void)updateGain
+{
+    if (cd.gain)
+    {
+        audio_gain_set(cd.gain, [self effectiveGain], self.gainRampDuration, (audio_gain_ramp_t) self.gainRampShape);
+    }
+}
+
+- (void)setOutputGain:(float)outputGain
+{
+    _outputGain = outputGain;
+    [self updateGain];
+}
+
+- (void)setMuted:(BOOL)muted
+{
+    _muted = muted;
+    [self updateGain];
+}
+
+- (void)setVolumeGainCurve:(float (^)(float))volumeGainCurve
+{
+    _volumeGainCurve = [volumeGainCurve copy];
+    [self updateGain];
+}
+
+- (void)setMeterConfig:(audio_meter_config_t)meterConfig
+{
+    _meterConfig = meterConfig;
+    
+    if (_inputMeter)
+    {
+        audio_meter_set_config(_inputMeter, meterConfig);
+        audio_meter_set_config(_outputMeter, meterConfig);
+    }
+}
+
+- (void)setDenormalMode:(AudioIODenormalMode)denormalMode
+{
+    _denormalMode = denormalMode;
+    cd.denormalMode = denormalMode;
+}
+
+- (NSTimeInterval)reportedLatency
+{
+    id<AudioIOBackend> sessionInstance = self.backend;
+    return sessionInstance.inputLatency + sessionInstance.outputLatency + sessionInstance.IOBufferDuration;
+}
+
+- (NSUInteger)bufferSize
+{
+    id<AudioIOBackend> sessionInstance = self.backend;
+    return (NSUInteger) lround(sessionInstance.IOBufferDuration * sessionInstance.sampleRate);
+}
+
+- (NSUInteger)overrunCount
+{
+    return atomic_load_explicit(&cd.overruns, memory_order_relaxed);
+}
+
+- (audio_error_counter_t *)renderErrors
+{
+    return cd.renderErrors;
+}
+
+- (NSUInteger)renderErrorCount
+{
+    return cd.renderErrors ? (NSUInteger) audio_error_counter_total(cd.renderErrors) : 0;
+}
+
+- (void)setSilencesInputErrors:(BOOL)silencesInputErrors
+{
+    _silencesInputErrors = silencesInputErrors;
+    cd.silencesInputErrors = silencesInputErrors;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Adaptive buffer size
+////////////////////////////////////////////////////////////////////////////////
+
+/*----------------------------------------------------------------------------*
+ * The buffer size to ask the session for, in frames.
+ *----------------------------------------------------------------------------*/
+- (int)preferredBufferSize
+{
+    if (self.adaptsBufferSize && self.bufferController)
+    {
+        return audio_buffer_controller_frames(self.bufferController);
+    }
+    return AUDIO_BUFFER_SIZE;
+}
+
+- (void)setAdaptsBufferSize:(BOOL)adaptsBufferSize
+{
+    if (adaptsBufferSize == _adaptsBufferSize)
+    {
+        return;
+    }
+    
+    /*---------------------------------------------------------------------*
+     * As with the meters, the controller is kept until dealloc; only the
+     * review timer comes and goes.
+     *--------------------------------------------------------------------*/
+    if (adaptsBufferSize && !self.bufferController)
+    {
+        self.bufferController = audio_buffer_controller_create(self.bufferControllerConfig);
+        if (!self.bufferController)
+        {
+            DLog(@"Couldn't create buffer size controller");
+            return;
+        }
+    }
+    
+    _adaptsBufferSize = adaptsBufferSize;
+    cd.bufferController = adaptsBufferSize ? self.bufferController : NULL;
+    
+    if (adaptsBufferSize)
+    {
+        __weak AudioIOManager *weakSelf = self;
+        uint64_t interval = (uint64_t) (AUDIO_BUFFER_CONTROLLER_INTERVAL * NSEC_PER_SEC);
+        self.bufferControllerTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.controlQueue);
+        dispatch_source_set_event_handler(self.bufferControllerTimer, ^{
+            [weakSelf reviewBufferSize];
+        });
+        dispatch_source_set_timer(self.bufferControllerTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 4);
+        dispatch_resume(self.bufferControllerTimer);
+    }
+    else
+    {
+        dispatch_source_cancel(self.bufferControllerTimer);
+        self.bufferControllerTimer = nil;
+    }
+    
+    /*---------------------------------------------------------------------*
+     * Move to the controller's size, or back to the fixed one.
+     *--------------------------------------------------------------------*/
+    if (self.isInitialised)
+    {
+        [self runOnControlQueue:^{
+            [self applyBufferSize];
+        }];
+    }
+}
+
+- (void)applyBufferSize
+{
+    id<AudioIOBackend> sessionInstance = self.backend;
+    NSError *error = nil;
+    NSTimeInterval duration = (double) [self preferredBufferSize] / sessionInstance.sampleRate;
+    if (![sessionInstance setPreferredIOBufferDuration:duration error:&error])
+    {
+        DLog(@"Couldn't set the I/O buffer duration: %@", error);
+    }
+    
+    [self updateConvolverBlockSize];
+}
+
+/*----------------------------------------------------------------------------*
+ * Let the controller review the blocks rendered since the last review, and
+ * apply any change it decides on. Runs on the control queue.
+ *----------------------------------------------------------------------------*/
+- (void)reviewBufferSize
+{
+    if (!self.isStarted || !self.bufferController)
+    {
+        return;
+    }
+    
+    audio_buffer_controller_t *controller = self.bufferController;
+    audio_buffer_decision_t decision = audio_buffer_controller_update(controller, CACurrentMediaTime());
+    if (decision == AUDIO_BUFFER_HOLD)
+    {
+        return;
+    }
+    
+    AUDIO_TRACE_INSTANT("buffer size change");
+    NSUInteger previousSize = self.bufferSize;
+    [self applyBufferSize];
+    NSUInteger bufferSize = self.bufferSize;
+    
+    /*---------------------------------------------------------------------*
+     * The session may not grant the size asked for; carry on from the one
+     * it did.
+     *--------------------------------------------------------------------*/
+    if ((int) bufferSize != audio_buffer_controller_frames(controller))
+    {
+        audio_buffer_controller_set_frames(controller, (int) bufferSize);
+    }
+    
+    DLog(@"Buffer size %@ to %lu frames (peak load %.2f)",
+         decision == AUDIO_BUFFER_INCREASE ? @"increased" : @"decreased",
+         (unsigned long) bufferSize, audio_buffer_controller_peak_load(controller));
+    
+    void (^block)(NSUInteger, NSTimeInterval, audio_buffer_decision_t) = self.bufferSizeChangedBlock;
+    if (block && bufferSize != previousSize)
+    {
+        block(bufferSize, self.reportedLatency, decision);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Latency measurement
+////////////////////////////////////////////////////////////////////////////////
+
+- (void)measureLatencyWithCompletion:(void (^)(NSTimeInterval latency))completion
+{
+    if (!self.isStarted || self.direction != AudioIODirectionDuplex)
+    {
+        DLog(@"Can't measure latency: audio not started or not duplex");
+        dispatch_async(dispatch_get_main_queue(), ^{ completion(-1); });
+        return;
+    }
+    
+    audio_latency_probe_t *probe = audio_latency_probe_create(cd.samplerate, AUDIO_LATENCY_MAX_DURATION);
+    if (!probe)
+    {
+        dispatch_async(dispatch_get_main_queue(), ^{ completion(-1); });
+        return;
+    }
+    
+    /*---------------------------------------------------------------------*
+     * Allow the probe generous time to complete before giving up, in case
+     * audio is stopped or interrupted while the measurement is running.
+     *--------------------------------------------------------------------*/
+    NSTimeInterval timeout = 4 * (AUDIO_LATENCY_MAX_DURATION + self.reportedLatency) + 1.0;
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+    
+    /*---------------------------------------------------------------------*
+     * Install the probe only if no other measurement holds the slot, so
+     * that concurrent callers can't replace each other's probes.
+     *--------------------------------------------------------------------*/
+    audio_latency_probe_t *expected = NULL;
+    if (!atomic_compare_exchange_strong(&cd.latencyProbe, &expected, probe))
+    {
+        DLog(@"Can't measure latency: measurement already in progress");
+        audio_latency_probe_destroy(probe);
+        dispatch_async(dispatch_get_main_queue(), ^{ completion(-1); });
+        return;
+    }
+    
+    [self waitForLatencyProbe:probe samplerate:cd.samplerate deadline:deadline completion:completion];
+}
+
+- (void)waitForLatencyProbe:(audio_latency_probe_t *)probe
+                 samplerate:(int)samplerate
+                   deadline:(NSDate *)deadline
+                 completion:(void (^)(NSTimeInterval latency))completion
+{
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+    dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t) (AUDIO_LATENCY_POLL_INTERVAL * NSEC_PER_SEC));
+    
+    dispatch_after(when, queue, ^{
+        BOOL complete = audio_latency_probe_is_complete(probe);
+        
+        if (!complete && [deadline timeIntervalSinceNow] > 0)
+        {
+            [self waitForLatencyProbe:probe samplerate:samplerate deadline:deadline completion:completion];
+            return;
+        }
+        
+        /*---------------------------------------------------------------------*
+         * Take the probe back, leaving the slot alone if it somehow holds
+         * another measurement's, then wait for any render cycle that may
+         * still be using it before reading its recording.
+         *--------------------------------------------------------------------*/
+        audio_latency_probe_t *installed = probe;
+        atomic_compare_exchange_strong(&cd.latencyProbe, &installed, NULL);
+        unsigned int cycle = atomic_load(&cd.latencyProbeCycle);
+        if (cycle & 1)
+        {
+            while (atomic_load(&cd.latencyProbeCycle) == cycle)
+                sched_yield();
+        }
+        
+        NSTimeInterval latency = -1;
+        if (complete)
+        {
+            double frames = audio_latency_probe_analyse(probe);
+            if (frames >= 0)
+                latency = frames / samplerate;
+        }
+        else
+        {
+            DLog(@"Latency measurement timed out");
+        }
+        
+        audio_latency_probe_destroy(probe);
+        
+        dispatch_async(dispatch_get_main_queue(), ^{ completion(latency); });
+    });
+}
+
 @end
 
+
+/*----------------------------------------------------------------------------*
+ * C accessor for the audio callback.
+ *----------------------------------------------------------------------------*/
+audio_arena_t *audio_io_render_arena(void)
+{
+    return cd.arena;
+}
@@ -0,0 +1,216 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOMeter
+ *
+ *  Peak, RMS and clip metering, published through a sequence lock.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOMeter.h"
+
+#include <Accelerate/Accelerate.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*----------------------------------------------------------------------------*
+ * The snapshot is published as an array of 32-bit words, each stored and
+ * loaded atomically, so that readers and the writer never race.
+ *----------------------------------------------------------------------------*/
+#define METER_SNAPSHOT_WORDS (sizeof(audio_meter_snapshot_t) / sizeof(uint32_t))
+
+/*----------------------------------------------------------------------------*
+ * Lowest level reported by audio_meter_linear_to_db().
+ *----------------------------------------------------------------------------*/
+#define METER_MIN_DB -120.0f
+
+struct audio_meter
+{
+    /*------------------------------------------------------------------------*
+     * Configuration, written by any thread and read by the audio thread.
+     * A block may see a mix of old and new settings, which is harmless.
+     *-----------------------------------------------------------------------*/
+    _Atomic float           peak_release_time;
+    _Atomic float           peak_hold_time;
+    _Atomic float           rms_time;
+    _Atomic float           clip_threshold;
+    atomic_int              reset_requested;
+
+    /*------------------------------------------------------------------------*
+     * Meter state. Only touched by the audio thread.
+     *-----------------------------------------------------------------------*/
+    audio_meter_snapshot_t  state;
+    float                   mean_square[AUDIO_METER_MAX_CHANNELS];
+    float                   hold_remaining[AUDIO_METER_MAX_CHANNELS];
+
+    /*------------------------------------------------------------------------*
+     * Published snapshot. `sequence` is odd while a publication is in
+     * progress.
+     *-----------------------------------------------------------------------*/
+    atomic_uint             sequence;
+    atomic_uint             snapshot[METER_SNAPSHOT_WORDS];
+};
+
+audio_meter_config_t audio_meter_config_default(void)
+{
+    audio_meter_config_t config;
+    config.peak_release_time = 1.5f;
+    config.peak_hold_time = 1.0f;
+    config.rms_time = 0.3f;
+    config.clip_threshold = 1.0f;
+    return config;
+}
+
+audio_meter_t *audio_meter_create(audio_meter_config_t config)
+{
+    audio_meter_t *meter = calloc(1, sizeof(audio_meter_t));
+    if (!meter) return NULL;
+
+    audio_meter_set_config(meter, config);
+    atomic_init(&meter->reset_requested, 0);
+    atomic_init(&meter->sequence, 0);
+    for (size_t i = 0; i < METER_SNAPSHOT_WORDS; i++)
+        atomic_init(&meter->snapshot[i], 0);
+
+    return meter;
+}
+
+void audio_meter_destroy(audio_meter_t *meter)
+{
+    free(meter);
+}
+
+void audio_meter_set_config(audio_meter_t *meter, audio_meter_config_t config)
+{
+    atomic_store_explicit(&meter->peak_release_time, config.peak_release_time, memory_order_relaxed);
+    atomic_store_explicit(&meter->peak_hold_time, config.peak_hold_time, memory_order_relaxed);
+    atomic_store_explicit(&meter->rms_time, config.rms_time, memory_order_relaxed);
+    atomic_store_explicit(&meter->clip_threshold, config.clip_threshold, memory_order_relaxed);
+}
+
+/*----------------------------------------------------------------------------*
+ * Per-block decay coefficient for an exponential with the given time
+ * constant. A non-positive time constant means no smoothing.
+ *----------------------------------------------------------------------------*/
+static float audio_meter_decay(float time_constant, int num_frames, int samplerate)
+{
+    if (time_constant <= 0.0f || samplerate <= 0)
+        return 0.0f;
+    return expf(-(float) num_frames / (time_constant * samplerate));
+}
+
+static void audio_meter_publish(audio_meter_t *meter)
+{
+    uint32_t words[METER_SNAPSHOT_WORDS];
+    memcpy(words, &meter->state, sizeof(words));
+
+    unsigned int sequence = atomic_load_explicit(&meter->sequence, memory_order_relaxed);
+    atomic_store_explicit(&meter->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < METER_SNAPSHOT_WORDS; i++)
+        atomic_store_explicit(&meter->snapshot[i], words[i], memory_order_relaxed);
+
+    atomic_store_explicit(&meter->sequence, sequence + 2, memory_order_release);
+}
+
+void audio_meter_process(audio_meter_t *meter,
+                         float **channels,
+                         int num_channels,
+                         int num_frames,
+                         int samplerate)
+{
+    if (num_frames <= 0) return;
+    if (num_channels > AUDIO_METER_MAX_CHANNELS)
+        num_channels = AUDIO_METER_MAX_CHANNELS;
+
+    float block_duration = (samplerate > 0) ? (float) num_frames / samplerate : 0.0f;
+    float peak_decay = audio_meter_decay(atomic_load_explicit(&meter->peak_release_time, memory_order_relaxed), num_frames, samplerate);
+    float rms_decay = audio_meter_decay(atomic_load_explicit(&meter->rms_time, memory_order_relaxed), num_frames, samplerate);
+    float hold_time = atomic_load_explicit(&meter->peak_hold_time, memory_order_relaxed);
+    float clip_threshold = atomic_load_explicit(&meter->clip_threshold, memory_order_relaxed);
+    int reset = atomic_exchange_explicit(&meter->reset_requested, 0, memory_order_relaxed);
+
+    meter->state.num_channels = num_channels;
+
+    for (int c = 0; c < num_channels; c++)
+    {
+        audio_meter_channel_t *channel = &meter->state.channels[c];
+        const float *samples = channels[c];
+
+        float block_peak = 0.0f;
+        float block_mean_square = 0.0f;
+        vDSP_maxmgv(samples, 1, &block_peak, num_frames);
+        vDSP_measqv(samples, 1, &block_mean_square, num_frames);
+
+        if (reset)
+        {
+            channel->clip_count = 0;
+            channel->peak_hold = 0.0f;
+            meter->hold_remaining[c] = 0.0f;
+        }
+
+        /*--------------------------------------------------------------------*
+         * Clipping is rare, so only count individual samples when the
+         * block's peak says there is something to count.
+         *-------------------------------------------------------------------*/
+        if (block_peak >= clip_threshold)
+        {
+            uint32_t clips = 0;
+            for (int i = 0; i < num_frames; i++)
+                clips += (fabsf(samples[i]) >= clip_threshold);
+            channel->clip_count += clips;
+        }
+
+        channel->peak = (block_peak >= channel->peak) ? block_peak : channel->peak * peak_decay;
+
+        if (block_peak >= channel->peak_hold)
+        {
+            channel->peak_hold = block_peak;
+            meter->hold_remaining[c] = hold_time;
+        }
+        else
+        {
+            meter->hold_remaining[c] -= block_duration;
+            if (meter->hold_remaining[c] <= 0.0f)
+                channel->peak_hold = channel->peak;
+        }
+
+        meter->mean_square[c] = meter->mean_square[c] * rms_decay + block_mean_square * (1.0f - rms_decay);
+        channel->rms = sqrtf(meter->mean_square[c]);
+    }
+
+    audio_meter_publish(meter);
+}
+
+void audio_meter_read(audio_meter_t *meter, audio_meter_snapshot_t *snapshot)
+{
+    uint32_t words[METER_SNAPSHOT_WORDS];
+    unsigned int before, after;
+
+    do
+    {
+        before = atomic_load_explicit(&meter->sequence, memory_order_acquire);
+        for (size_t i = 0; i < METER_SNAPSHOT_WORDS; i++)
+            words[i] = atomic_load_explicit(&meter->snapshot[i], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&meter->sequence, memory_order_relaxed);
+    }
+    while ((before & 1) || before != after);
+
+    memcpy(snapshot, words, sizeof(words));
+}
+
+void audio_meter_reset_clips(audio_meter_t *meter)
+{
+    atomic_store_explicit(&meter->reset_requested, 1, memory_order_relaxed);
+}
+
+float audio_meter_linear_to_db(float level)
+{
+    if (level <= 0.0f)
+        return METER_MIN_DB;
+    float db = 20.0f * log10f(level);
+    return (db < METER_MIN_DB) ? METER_MIN_DB : db;
+}
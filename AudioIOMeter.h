@@ -0,0 +1,136 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOMeter
+ *
+ *  Per-channel level meter: peak, peak hold, RMS and clip counts, with
+ *  meter-style ballistics.
+ *
+ *  The audio thread calls audio_meter_process() on each block; any other
+ *  thread may read a consistent snapshot of all channels at any time with
+ *  audio_meter_read(). Snapshots are published through a sequence lock,
+ *  so the audio thread never waits for readers: a reader that overlaps a
+ *  publication simply retries.
+ *
+ *  Ballistics:
+ *   - peak:  instant attack, exponential release over `peak_release_time`
+ *   - hold:  the highest recent peak, held for `peak_hold_time`
+ *   - RMS:   exponentially-weighted mean square over `rms_time`
+ *
+ *  Example usage:
+ *
+ *  audio_meter_snapshot_t snapshot;
+ *  audio_meter_read(meter, &snapshot);
+ *  float level_db = audio_meter_linear_to_db(snapshot.channels[0].rms);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_METER_H
+#define AUDIO_IO_METER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Maximum number of channels metered. Further channels are ignored.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_METER_MAX_CHANNELS 8
+
+/**-----------------------------------------------------------------------------
+ * Ballistics and clip detection settings. Times are in seconds.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    float   peak_release_time;
+    float   peak_hold_time;
+    float   rms_time;
+
+    /*------------------------------------------------------------------------*
+     * Samples with an absolute value at or above this count as clipped.
+     *-----------------------------------------------------------------------*/
+    float   clip_threshold;
+} audio_meter_config_t;
+
+/**-----------------------------------------------------------------------------
+ * Levels for one channel. Levels are linear amplitudes.
+ * `clip_count` is the number of clipped samples since creation or the
+ * last call to audio_meter_reset_clips().
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    float       peak;
+    float       peak_hold;
+    float       rms;
+    uint32_t    clip_count;
+} audio_meter_channel_t;
+
+typedef struct
+{
+    int                     num_channels;
+    audio_meter_channel_t   channels[AUDIO_METER_MAX_CHANNELS];
+} audio_meter_snapshot_t;
+
+typedef struct audio_meter audio_meter_t;
+
+/**-----------------------------------------------------------------------------
+ * Returns a reasonable default configuration: 1.5s peak release, 1s
+ * hold, 300ms RMS integration, clipping at full scale.
+ *----------------------------------------------------------------------------*/
+audio_meter_config_t audio_meter_config_default(void);
+
+/**-----------------------------------------------------------------------------
+ * Create a new meter.
+ *----------------------------------------------------------------------------*/
+audio_meter_t *audio_meter_create(audio_meter_config_t config);
+
+/**-----------------------------------------------------------------------------
+ * Free a meter.
+ *----------------------------------------------------------------------------*/
+void audio_meter_destroy(audio_meter_t *meter);
+
+/**-----------------------------------------------------------------------------
+ * Change the meter's configuration. May be called from any thread; takes
+ * effect from the next block.
+ *----------------------------------------------------------------------------*/
+void audio_meter_set_config(audio_meter_t *meter, audio_meter_config_t config);
+
+/**-----------------------------------------------------------------------------
+ * Measure one block of audio and publish the result. Realtime-safe.
+ * Must only be called from one thread.
+ *
+ * @param channels      One buffer per channel.
+ * @param num_channels  Number of channels.
+ * @param num_frames    Number of frames in each buffer.
+ * @param samplerate    Sample rate, used to scale ballistics.
+ *----------------------------------------------------------------------------*/
+void audio_meter_process(audio_meter_t *meter,
+                         float **channels,
+                         int num_channels,
+                         int num_frames,
+                         int samplerate);
+
+/**-----------------------------------------------------------------------------
+ * Read the most recently published levels. May be called from any thread,
+ * and never blocks the audio thread.
+ *----------------------------------------------------------------------------*/
+void audio_meter_read(audio_meter_t *meter, audio_meter_snapshot_t *snapshot);
+
+/**-----------------------------------------------------------------------------
+ * Reset the clip counts and peak holds, from any thread. Takes effect
+ * from the next block.
+ *----------------------------------------------------------------------------*/
+void audio_meter_reset_clips(audio_meter_t *meter);
+
+/**-----------------------------------------------------------------------------
+ * Convert a linear level to decibels relative to full scale, with a
+ * floor of -120dB.
+ *----------------------------------------------------------------------------*/
+float audio_meter_linear_to_db(float level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
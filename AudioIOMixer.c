@@ -0,0 +1,344 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOMixer
+ *
+ *  Lock-free multi-source mixer.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOMixer.h"
+
+#ifdef __APPLE__
+#include <Accelerate/Accelerate.h>
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <math.h>
+
+typedef enum
+{
+    MIXER_SLOT_FREE = 0,
+    MIXER_SLOT_ACTIVE
+} mixer_slot_state_t;
+
+typedef struct
+{
+    /*------------------------------------------------------------------------*
+     * `render` and `context` are written while the slot is free, and
+     * published by storing MIXER_SLOT_ACTIVE to `state`.
+     *-----------------------------------------------------------------------*/
+    atomic_int              state;
+    audio_mixer_render_t    render;
+    void                   *context;
+    _Atomic float           gain;
+    _Atomic float           pan;
+
+    /*------------------------------------------------------------------------*
+     * Left and right gains applied at the end of the last block, from
+     * which changes are ramped. Only touched by the audio thread, once
+     * `started` is set.
+     *-----------------------------------------------------------------------*/
+    int                     started;
+    float                   applied[2];
+} mixer_slot_t;
+
+struct audio_mixer
+{
+    int                     max_frames;
+    float                  *buffer;
+    mixer_slot_t            slots[AUDIO_MIXER_MAX_SOURCES];
+
+    /*------------------------------------------------------------------------*
+     * One more than the highest slot ever used, to bound the audio
+     * thread's scan.
+     *-----------------------------------------------------------------------*/
+    atomic_int              num_slots;
+
+    /*------------------------------------------------------------------------*
+     * Incremented on entering and leaving audio_mixer_process(), so odd
+     * while the audio thread may be using a slot.
+     *-----------------------------------------------------------------------*/
+    atomic_uint             cycle;
+
+    atomic_int              num_sources;
+    atomic_int              num_audible;
+
+    /*------------------------------------------------------------------------*
+     * Serialises adding and removing sources. Never taken by the audio
+     * thread.
+     *-----------------------------------------------------------------------*/
+    pthread_mutex_t         lock;
+};
+
+audio_mixer_t *audio_mixer_create(int max_frames)
+{
+    if (max_frames <= 0)
+        return NULL;
+
+    audio_mixer_t *mixer = calloc(1, sizeof(audio_mixer_t));
+    if (!mixer) return NULL;
+
+    mixer->max_frames = max_frames;
+    mixer->buffer = calloc(max_frames, sizeof(float));
+    if (!mixer->buffer)
+    {
+        free(mixer);
+        return NULL;
+    }
+
+    for (int i = 0; i < AUDIO_MIXER_MAX_SOURCES; i++)
+    {
+        atomic_init(&mixer->slots[i].state, MIXER_SLOT_FREE);
+        atomic_init(&mixer->slots[i].gain, 0.0f);
+        atomic_init(&mixer->slots[i].pan, 0.0f);
+    }
+    atomic_init(&mixer->num_slots, 0);
+    atomic_init(&mixer->cycle, 0);
+    atomic_init(&mixer->num_sources, 0);
+    atomic_init(&mixer->num_audible, 0);
+    pthread_mutex_init(&mixer->lock, NULL);
+
+    return mixer;
+}
+
+void audio_mixer_destroy(audio_mixer_t *mixer)
+{
+    if (!mixer) return;
+
+    pthread_mutex_destroy(&mixer->lock);
+    free(mixer->buffer);
+    free(mixer);
+}
+
+int audio_mixer_add_source(audio_mixer_t *mixer,
+                           audio_mixer_render_t render,
+                           void *context,
+                           float gain,
+                           float pan)
+{
+    if (!render)
+        return -1;
+
+    pthread_mutex_lock(&mixer->lock);
+
+    int source = -1;
+    for (int i = 0; i < AUDIO_MIXER_MAX_SOURCES; i++)
+    {
+        if (atomic_load_explicit(&mixer->slots[i].state, memory_order_relaxed) == MIXER_SLOT_FREE)
+        {
+            source = i;
+            break;
+        }
+    }
+
+    if (source >= 0)
+    {
+        mixer_slot_t *slot = &mixer->slots[source];
+        slot->render = render;
+        slot->context = context;
+        slot->started = 0;
+        atomic_store_explicit(&slot->gain, gain, memory_order_relaxed);
+        atomic_store_explicit(&slot->pan, pan, memory_order_relaxed);
+        atomic_store_explicit(&slot->state, MIXER_SLOT_ACTIVE, memory_order_release);
+
+        if (source >= atomic_load_explicit(&mixer->num_slots, memory_order_relaxed))
+            atomic_store_explicit(&mixer->num_slots, source + 1, memory_order_release);
+        atomic_fetch_add_explicit(&mixer->num_sources, 1, memory_order_relaxed);
+    }
+
+    pthread_mutex_unlock(&mixer->lock);
+    return source;
+}
+
+void audio_mixer_remove_source(audio_mixer_t *mixer, int source)
+{
+    if (source < 0 || source >= AUDIO_MIXER_MAX_SOURCES)
+        return;
+
+    pthread_mutex_lock(&mixer->lock);
+
+    mixer_slot_t *slot = &mixer->slots[source];
+    if (atomic_load_explicit(&slot->state, memory_order_relaxed) == MIXER_SLOT_ACTIVE)
+    {
+        atomic_store(&slot->state, MIXER_SLOT_FREE);
+
+        /*--------------------------------------------------------------------*
+         * A block that began before the slot was freed may still be using
+         * it; wait for that block to end. Blocks that begin later see the
+         * slot free. The lock keeps the slot from being reused meanwhile.
+         *-------------------------------------------------------------------*/
+        unsigned int cycle = atomic_load(&mixer->cycle);
+        if (cycle & 1)
+        {
+            while (atomic_load(&mixer->cycle) == cycle)
+                sched_yield();
+        }
+
+        atomic_fetch_sub_explicit(&mixer->num_sources, 1, memory_order_relaxed);
+    }
+
+    pthread_mutex_unlock(&mixer->lock);
+}
+
+void audio_mixer_set_gain(audio_mixer_t *mixer, int source, float gain)
+{
+    if (source >= 0 && source < AUDIO_MIXER_MAX_SOURCES)
+        atomic_store_explicit(&mixer->slots[source].gain, gain, memory_order_relaxed);
+}
+
+void audio_mixer_set_pan(audio_mixer_t *mixer, int source, float pan)
+{
+    if (source >= 0 && source < AUDIO_MIXER_MAX_SOURCES)
+        atomic_store_explicit(&mixer->slots[source].pan, pan, memory_order_relaxed);
+}
+
+/*----------------------------------------------------------------------------*
+ * Frames summed at a time by the portable loops, so that the compiler can
+ * vectorize them without a cost model that allows for a remainder.
+ *----------------------------------------------------------------------------*/
+#define MIXER_VECTOR_FRAMES 4
+
+/*----------------------------------------------------------------------------*
+ * Add `samples`, scaled from `from` to `to` over the block, to `output`.
+ * Elsewhere than Apple's platforms, plain loops stand in for vDSP; the
+ * ramp's gain is computed from the frame index, rather than accumulated,
+ * so that its frames don't depend on one another.
+ *----------------------------------------------------------------------------*/
+static void mixer_accumulate(const float *restrict samples, float *restrict output, float from, float to, int num_frames)
+{
+    if (from == to)
+    {
+        if (to != 0.0f)
+        {
+#ifdef __APPLE__
+            vDSP_vsma(samples, 1, &to, output, 1, output, 1, num_frames);
+#else
+            int i = 0;
+            for (; i + MIXER_VECTOR_FRAMES <= num_frames; i += MIXER_VECTOR_FRAMES)
+            {
+                for (int k = 0; k < MIXER_VECTOR_FRAMES; k++)
+                    output[i + k] += samples[i + k] * to;
+            }
+            for (; i < num_frames; i++)
+                output[i] += samples[i] * to;
+#endif
+        }
+    }
+    else
+    {
+        float step = (to - from) / num_frames;
+#ifdef __APPLE__
+        vDSP_vrampmuladd(samples, 1, &from, &step, output, 1, num_frames);
+#else
+        int i = 0;
+        for (; i + MIXER_VECTOR_FRAMES <= num_frames; i += MIXER_VECTOR_FRAMES)
+        {
+            for (int k = 0; k < MIXER_VECTOR_FRAMES; k++)
+                output[i + k] += samples[i + k] * (from + step * (float) (i + k));
+        }
+        for (; i < num_frames; i++)
+            output[i] += samples[i] * (from + step * (float) i);
+#endif
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ * Mix one source into the output. Returns nonzero if it was audible.
+ *----------------------------------------------------------------------------*/
+static int mixer_process_slot(audio_mixer_t *mixer,
+                              mixer_slot_t *slot,
+                              float **channels,
+                              int num_channels,
+                              int offset,
+                              int num_frames,
+                              int samplerate)
+{
+    /*------------------------------------------------------------------------*
+     * Constant-power pan law; mono output takes the gain alone.
+     *-----------------------------------------------------------------------*/
+    float gain = atomic_load_explicit(&slot->gain, memory_order_relaxed);
+    float target[2] = { gain, gain };
+    if (num_channels > 1)
+    {
+        float pan = atomic_load_explicit(&slot->pan, memory_order_relaxed);
+        pan = fminf(fmaxf(pan, -1.0f), 1.0f);
+        float angle = (pan + 1.0f) * (float) M_PI_4;
+        target[0] = gain * cosf(angle);
+        target[1] = gain * sinf(angle);
+    }
+
+    if (!slot->started)
+    {
+        slot->applied[0] = target[0];
+        slot->applied[1] = target[1];
+        slot->started = 1;
+    }
+
+    /*------------------------------------------------------------------------*
+     * Always render, so that sources keep time while muted.
+     *-----------------------------------------------------------------------*/
+    int rendered = slot->render(slot->context, mixer->buffer, num_frames, samplerate);
+
+    int silent = !rendered || (target[0] == 0.0f && target[1] == 0.0f &&
+                               slot->applied[0] == 0.0f && slot->applied[1] == 0.0f);
+    if (!silent)
+    {
+        for (int c = 0; c < num_channels; c++)
+        {
+            int side = c & 1;
+            mixer_accumulate(mixer->buffer, channels[c] + offset, slot->applied[side], target[side], num_frames);
+        }
+    }
+
+    slot->applied[0] = target[0];
+    slot->applied[1] = target[1];
+    return !silent;
+}
+
+void audio_mixer_process(audio_mixer_t *mixer,
+                         float **channels,
+                         int num_channels,
+                         int num_frames,
+                         int samplerate)
+{
+    atomic_fetch_add(&mixer->cycle, 1);
+
+    int num_slots = atomic_load_explicit(&mixer->num_slots, memory_order_acquire);
+    int audible = 0;
+
+    for (int offset = 0; offset < num_frames; offset += mixer->max_frames)
+    {
+        int length = num_frames - offset;
+        if (length > mixer->max_frames)
+            length = mixer->max_frames;
+
+        audible = 0;
+        for (int i = 0; i < num_slots; i++)
+        {
+            mixer_slot_t *slot = &mixer->slots[i];
+            if (atomic_load(&slot->state) != MIXER_SLOT_ACTIVE)
+                continue;
+
+            audible += mixer_process_slot(mixer, slot, channels, num_channels, offset, length, samplerate);
+        }
+    }
+
+    atomic_store_explicit(&mixer->num_audible, audible, memory_order_relaxed);
+    atomic_fetch_add_explicit(&mixer->cycle, 1, memory_order_release);
+}
+
+int audio_mixer_num_sources(audio_mixer_t *mixer)
+{
+    return atomic_load_explicit(&mixer->num_sources, memory_order_relaxed);
+}
+
+int audio_mixer_num_audible(audio_mixer_t *mixer)
+{
+    return atomic_load_explicit(&mixer->num_audible, memory_order_relaxed);
+}
@@ -0,0 +1,121 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOMixer
+ *
+ *  Mixes any number of independent mono sources (UI sounds, synthesized
+ *  tones, streamed files...) into the output, each with its own gain and
+ *  stereo pan.
+ *
+ *  Each source is a render function, called on the audio thread once per
+ *  block to fill a mono buffer. The result is scaled and summed into each
+ *  output channel with vDSP, or with plain loops where Accelerate isn't
+ *  available. A source that reports silence for a block, or whose gain
+ *  is zero, costs its render call but no summing.
+ *
+ *  Sources may be added, removed and adjusted from a control thread at
+ *  any time. The audio thread never locks: sources live in a fixed table
+ *  of slots, each published with an atomic state.
+ *
+ *  Example usage:
+ *
+ *  int click_render(void *context, float *samples, int num_frames, int samplerate) { ... }
+ *
+ *  audio_mixer_t *mixer = audio_mixer_create(4096);
+ *  int click = audio_mixer_add_source(mixer, click_render, click_state, 0.5, -1.0);
+ *  ...
+ *  audio_mixer_process(mixer, data, num_channels, num_frames, samplerate);
+ *  ...
+ *  audio_mixer_remove_source(mixer, click);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_MIXER_H
+#define AUDIO_IO_MIXER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Number of source slots.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_MIXER_MAX_SOURCES 256
+
+/**-----------------------------------------------------------------------------
+ * Source render function. Called on the audio thread; must be
+ * realtime-safe.
+ *
+ * @param context       The context given to audio_mixer_add_source().
+ * @param samples       Buffer to fill with `num_frames` mono samples.
+ *
+ * @returns Nonzero if the buffer was filled; zero if the source is silent
+ *          for this block, in which case the buffer is ignored.
+ *----------------------------------------------------------------------------*/
+typedef int (*audio_mixer_render_t)(void *context, float *samples, int num_frames, int samplerate);
+
+typedef struct audio_mixer audio_mixer_t;
+
+/**-----------------------------------------------------------------------------
+ * Create a new mixer.
+ *
+ * @param max_frames    Largest block each source is asked to render.
+ *                      Longer blocks are mixed in several parts.
+ *----------------------------------------------------------------------------*/
+audio_mixer_t *audio_mixer_create(int max_frames);
+
+/**-----------------------------------------------------------------------------
+ * Free a mixer. Audio must no longer be using it.
+ *----------------------------------------------------------------------------*/
+void audio_mixer_destroy(audio_mixer_t *mixer);
+
+/**-----------------------------------------------------------------------------
+ * Add a source, which is mixed from the next block on.
+ *
+ * @param gain  Linear gain.
+ * @param pan   Stereo position, from -1 (left) to 1 (right). Ignored for
+ *              mono output.
+ *
+ * @returns The source's identifier, or -1 if all slots are in use.
+ *----------------------------------------------------------------------------*/
+int audio_mixer_add_source(audio_mixer_t *mixer,
+                           audio_mixer_render_t render,
+                           void *context,
+                           float gain,
+                           float pan);
+
+/**-----------------------------------------------------------------------------
+ * Remove a source. On return, its render function is not running and will
+ * not be called again, so its context may be freed. May block for up to
+ * one block if audio is running.
+ *----------------------------------------------------------------------------*/
+void audio_mixer_remove_source(audio_mixer_t *mixer, int source);
+
+/**-----------------------------------------------------------------------------
+ * Change a source's gain or pan. Changes are ramped over the next block.
+ * May be called from any thread.
+ *----------------------------------------------------------------------------*/
+void audio_mixer_set_gain(audio_mixer_t *mixer, int source, float gain);
+void audio_mixer_set_pan(audio_mixer_t *mixer, int source, float pan);
+
+/**-----------------------------------------------------------------------------
+ * Render every source and add it to a block of audio. Realtime-safe.
+ *----------------------------------------------------------------------------*/
+void audio_mixer_process(audio_mixer_t *mixer,
+                         float **channels,
+                         int num_channels,
+                         int num_frames,
+                         int samplerate);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of sources added and not removed, and the number
+ * that were audible (rendered, with nonzero gain) in the last block.
+ * May be called from any thread.
+ *----------------------------------------------------------------------------*/
+int audio_mixer_num_sources(audio_mixer_t *mixer);
+int audio_mixer_num_audible(audio_mixer_t *mixer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,116 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOMockBackend
+ *
+ *  A scriptable stand-in for AVAudioSession and AURemoteIO, for exercising
+ *  AudioIOManager's lifecycle without audio hardware (eg, in unit tests or
+ *  the simulator).
+ *
+ *  Once started, the mock calls the render callback from a background
+ *  queue at the rate real hardware would, with silent or looped-back
+ *  input. Session
+ *  events such as route changes and interruptions can be fired on demand.
+ *
+ *  Every backend call is checked against the unit's current state, and
+ *  calls that real hardware would reject or that indicate a lifecycle bug
+ *  (starting an uninitialized unit, rendering with an inactive session,
+ *  changing formats while initialized...) are counted in stateViolations.
+ *
+ *  Example usage:
+ *
+ *  AudioIOMockBackend *mock = [AudioIOMockBackend new];
+ *  AudioIOManager *manager = [[AudioIOManager alloc] initWithCallback:audio_callback];
+ *  manager.backend = mock;
+ *  [manager start];
+ *
+ *  mock.hardwareSampleRate = 44100;
+ *  [mock simulateRouteChange:AVAudioSessionRouteChangeReasonNewDeviceAvailable];
+ *  NSAssert(mock.stateViolations == 0, @"No lifecycle violations");
+ *
+ *----------------------------------------------------------------------------*/
+
+#import "AudioIOBackend.h"
+
+@interface AudioIOMockBackend : NSObject <AudioIOBackend>
+
+/**-----------------------------------------------------------------------------
+ * The sample rate the simulated hardware runs at. Defaults to 48000.
+ * Changing it does not post a route change; call simulateRouteChange:.
+ *----------------------------------------------------------------------------*/
+@property (assign) double hardwareSampleRate;
+
+/**-----------------------------------------------------------------------------
+ * The simulated hardware volume. Setting it notifies KVO observers.
+ *----------------------------------------------------------------------------*/
+@property (assign) float outputVolume;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to make subsequent session activations fail.
+ *----------------------------------------------------------------------------*/
+@property (assign) BOOL failsActivation;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to make subsequent unit initializations fail.
+ *----------------------------------------------------------------------------*/
+@property (assign) BOOL failsUnitInitialization;
+
+/**-----------------------------------------------------------------------------
+ * Time each render callback is made to take, in seconds, on top of the
+ * manager's own processing, to simulate load. When a callback takes longer
+ * than the period, the periods it overruns are skipped in the sample
+ * time, as on hardware. Defaults to zero.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSTimeInterval simulatedRenderTime;
+
+/**-----------------------------------------------------------------------------
+ * Set to YES to feed the output back to the input, delayed by
+ * loopbackDelay frames at the client sample rate, as a loopback cable
+ * would. Useful for checking latency measurements against a known delay.
+ * Output delayed by less than one period can't reach the input in time
+ * and is lost. Defaults to NO, giving silent input.
+ *----------------------------------------------------------------------------*/
+@property (assign) BOOL loopsBack;
+@property (assign) NSUInteger loopbackDelay;
+
+/**-----------------------------------------------------------------------------
+ * Post session and application events, as the system would.
+ * Notifications are delivered synchronously on the calling thread.
+ *----------------------------------------------------------------------------*/
+- (void) simulateRouteChange:(AVAudioSessionRouteChangeReason)reason;
+- (void) simulateInterruptionBegan;
+- (void) simulateInterruptionEnded;
+- (void) simulateApplicationBecameActive;
+
+/**-----------------------------------------------------------------------------
+ * YES while the session is active.
+ *----------------------------------------------------------------------------*/
+@property (readonly) BOOL isActive;
+
+/**-----------------------------------------------------------------------------
+ * YES while the unit is started.
+ *----------------------------------------------------------------------------*/
+@property (readonly) BOOL isRunning;
+
+/**-----------------------------------------------------------------------------
+ * Number of render callbacks made since creation.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSUInteger renderCount;
+
+/**-----------------------------------------------------------------------------
+ * Number of invalid backend calls since creation. Should remain zero.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSUInteger stateViolations;
+
+/**-----------------------------------------------------------------------------
+ * Time from the most recent startUnit to the first render callback that
+ * followed it, in seconds. Zero if no callback has happened since.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSTimeInterval lastTimeToFirstRender;
+
+/**-----------------------------------------------------------------------------
+ * When that first render callback happened, as given by
+ * CACurrentMediaTime(). Zero if no callback has happened since.
+ *----------------------------------------------------------------------------*/
+@property (readonly) CFTimeInterval lastFirstRenderTime;
+
+@end
@@ -0,0 +1,568 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOMockBackend
+ *
+ *  Scriptable stand-in for AVAudioSession and AURemoteIO.
+ *
+ *----------------------------------------------------------------------------*/
+
+#import "AudioIOMockBackend.h"
+#import <UIKit/UIKit.h>
+#import <mach/mach_time.h>
+
+/*----------------------------------------------------------------------------*
+ * Largest number of frames per render callback the mock will produce.
+ *----------------------------------------------------------------------------*/
+#define MOCK_MAX_FRAMES_PER_SLICE 4096
+
+/*----------------------------------------------------------------------------*
+ * Length of the loopback delay line, in frames. Must be a power of two.
+ *----------------------------------------------------------------------------*/
+#define MOCK_LOOPBACK_LENGTH 65536
+
+/*----------------------------------------------------------------------------*
+ * Key used to tell whether the calling thread is on the render queue.
+ *----------------------------------------------------------------------------*/
+static void *AudioIOMockRenderQueueKey = &AudioIOMockRenderQueueKey;
+
+typedef NS_ENUM(NSInteger, AudioIOMockUnitState)
+{
+    AudioIOMockUnitStateNone,
+    AudioIOMockUnitStateCreated,
+    AudioIOMockUnitStateInitialized,
+    AudioIOMockUnitStateStarted
+};
+
+@interface AudioIOMockBackend ()
+@property (readwrite) BOOL isActive;
+@property (readwrite) NSUInteger renderCount;
+@property (readwrite) NSUInteger stateViolations;
+@property (readwrite) NSTimeInterval lastTimeToFirstRender;
+@property (readwrite) CFTimeInterval lastFirstRenderTime;
+@end
+
+@implementation AudioIOMockBackend
+{
+    dispatch_queue_t            _renderQueue;
+    dispatch_source_t           _renderTimer;
+    AURenderCallbackStruct      _renderCallback;
+    AURenderCallbackStruct      _inputCallback;
+    BOOL                        _outputEnabled;
+    AudioStreamBasicDescription _clientFormat;
+    UInt32                      _converterComplexity;
+    NSTimeInterval              _preferredIOBufferDuration;
+    AudioIOMockUnitState        _unitState;
+    float                      *_buffer;
+    float                      *_loopback;
+    NSUInteger                  _loopbackPosition;
+    Float64                     _sampleTime;
+    CFTimeInterval              _startTime;
+    BOOL                        _awaitingFirstRender;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (!self) return nil;
+
+    _renderQueue = dispatch_queue_create("AudioIOMockBackend.render", DISPATCH_QUEUE_SERIAL);
+    dispatch_set_target_queue(_renderQueue, dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0));
+    dispatch_queue_set_specific(_renderQueue, AudioIOMockRenderQueueKey, (__bridge void *) self, NULL);
+    _buffer = calloc(MOCK_MAX_FRAMES_PER_SLICE, sizeof(float));
+    _loopback = calloc(MOCK_LOOPBACK_LENGTH, sizeof(float));
+    _preferredIOBufferDuration = 0.005;
+    _hardwareSampleRate = 48000;
+    _outputVolume = 1.0;
+
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_renderTimer)
+    {
+        dispatch_source_cancel(_renderTimer);
+    }
+    
+    /*------------------------------------------------------------------------*
+     * The render timer's handler may hold the last reference, in which case
+     * this is the render queue, and no render can be in progress.
+     *-----------------------------------------------------------------------*/
+    if (dispatch_get_specific(AudioIOMockRenderQueueKey) != (__bridge void *) self)
+    {
+        dispatch_sync(_renderQueue, ^{});
+    }
+    free(_buffer);
+    free(_loopback);
+}
+
+- (void)violation:(NSString *)reason
+{
+    @synchronized (self)
+    {
+        self.stateViolations++;
+    }
+    NSLog(@"AudioIOMockBackend: lifecycle violation: %@", reason);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Scripted events
+////////////////////////////////////////////////////////////////////////////////
+
+- (void)simulateRouteChange:(AVAudioSessionRouteChangeReason)reason
+{
+    [[NSNotificationCenter defaultCenter] postNotificationName:AVAudioSessionRouteChangeNotification
+                                                        object:self
+                                                      userInfo:@{ AVAudioSessionRouteChangeReasonKey : @(reason) }];
+}
+
+- (void)simulateInterruptionBegan
+{
+    /*------------------------------------------------------------------------*
+     * As on a device, the system stops I/O and deactivates the session
+     * before the app hears about it.
+     *-----------------------------------------------------------------------*/
+    [self stopRendering];
+    self.isActive = NO;
+
+    [[NSNotificationCenter defaultCenter] postNotificationName:AVAudioSessionInterruptionNotification
+                                                        object:self
+                                                      userInfo:@{ AVAudioSessionInterruptionTypeKey : @(AVAudioSessionInterruptionTypeBegan) }];
+}
+
+- (void)simulateInterruptionEnded
+{
+    [[NSNotificationCenter defaultCenter] postNotificationName:AVAudioSessionInterruptionNotification
+                                                        object:self
+                                                      userInfo:@{ AVAudioSessionInterruptionTypeKey : @(AVAudioSessionInterruptionTypeEnded),
+                                                                  AVAudioSessionInterruptionOptionKey : @(AVAudioSessionInterruptionOptionShouldResume) }];
+}
+
+- (void)simulateApplicationBecameActive
+{
+    [[NSNotificationCenter defaultCenter] postNotificationName:UIApplicationDidBecomeActiveNotification
+                                                        object:nil];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Session
+////////////////////////////////////////////////////////////////////////////////
+
+- (id)notificationSource
+{
+    return self;
+}
+
+- (BOOL)setPreferredSampleRate:(double)sampleRate error:(NSError **)error
+{
+    return YES;
+}
+
+- (BOOL)setCategory:(NSString *)category withOptions:(AVAudioSessionCategoryOptions)options error:(NSError **)error
+{
+    return YES;
+}
+
+- (BOOL)setMode:(NSString *)mode error:(NSError **)error
+{
+    return YES;
+}
+
+- (BOOL)setPreferredIOBufferDuration:(NSTimeInterval)duration error:(NSError **)error
+{
+    _preferredIOBufferDuration = duration;
+    
+    /*------------------------------------------------------------------------*
+     * As on hardware, the new duration takes effect while running.
+     *-----------------------------------------------------------------------*/
+    dispatch_sync(_renderQueue, ^{
+        if (self->_renderTimer)
+        {
+            uint64_t interval = (uint64_t) (duration * NSEC_PER_SEC);
+            dispatch_source_set_timer(self->_renderTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, 0);
+        }
+    });
+    return YES;
+}
+
+- (BOOL)setActive:(BOOL)active error:(NSError **)error
+{
+    if (active && self.failsActivation)
+    {
+        if (error) *error = [NSError errorWithDomain:NSOSStatusErrorDomain code:AVAudioSessionErrorCodeCannotInterruptOthers userInfo:nil];
+        return NO;
+    }
+
+    if (!active && self.isRunning)
+    {
+        [self violation:@"Session deactivated while I/O is running"];
+        if (error) *error = [NSError errorWithDomain:NSOSStatusErrorDomain code:AVAudioSessionErrorCodeIsBusy userInfo:nil];
+        return NO;
+    }
+
+    self.isActive = active;
+    return YES;
+}
+
+- (NSArray<NSString *> *)availableModes
+{
+    return @[ AVAudioSessionModeDefault, AVAudioSessionModeMeasurement ];
+}
+
+- (double)sampleRate
+{
+    return self.hardwareSampleRate;
+}
+
+- (NSTimeInterval)inputLatency
+{
+    return 0;
+}
+
+- (NSTimeInterval)outputLatency
+{
+    return 0;
+}
+
+- (NSTimeInterval)IOBufferDuration
+{
+    return _preferredIOBufferDuration;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Unit
+////////////////////////////////////////////////////////////////////////////////
+
+- (OSStatus)createUnit
+{
+    if (_unitState != AudioIOMockUnitStateNone)
+    {
+        [self violation:@"Unit created while one already exists"];
+    }
+
+    _unitState = AudioIOMockUnitStateCreated;
+    _renderCallback.inputProc = NULL;
+    _renderCallback.inputProcRefCon = NULL;
+    _inputCallback.inputProc = NULL;
+    _inputCallback.inputProcRefCon = NULL;
+    _outputEnabled = YES;
+    memset(&_clientFormat, 0, sizeof(_clientFormat));
+    _converterComplexity = 0;
+
+    return noErr;
+}
+
+- (OSStatus)initializeUnit
+{
+    if (_unitState != AudioIOMockUnitStateCreated)
+    {
+        [self violation:@"Unit initialized when not freshly created or uninitialized"];
+        return kAudioUnitErr_CannotDoInCurrentContext;
+    }
+
+    if (self.failsUnitInitialization)
+    {
+        return kAudioUnitErr_FailedInitialization;
+    }
+
+    _unitState = AudioIOMockUnitStateInitialized;
+    return noErr;
+}
+
+- (OSStatus)startUnit
+{
+    if (_unitState == AudioIOMockUnitStateStarted)
+    {
+        return noErr;
+    }
+
+    if (_unitState != AudioIOMockUnitStateInitialized)
+    {
+        [self violation:@"Unit started when not initialized"];
+        return kAudioUnitErr_Uninitialized;
+    }
+
+    if (!self.isActive)
+    {
+        [self violation:@"Unit started with inactive session"];
+        return kAudioUnitErr_CannotDoInCurrentContext;
+    }
+
+    _unitState = AudioIOMockUnitStateStarted;
+    _startTime = CACurrentMediaTime();
+    _awaitingFirstRender = YES;
+    self.lastTimeToFirstRender = 0;
+    self.lastFirstRenderTime = 0;
+
+    _renderTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _renderQueue);
+    uint64_t interval = (uint64_t) (self.IOBufferDuration * NSEC_PER_SEC);
+    dispatch_source_set_timer(_renderTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, 0);
+
+    __weak AudioIOMockBackend *weakSelf = self;
+    dispatch_source_set_event_handler(_renderTimer, ^{
+        [weakSelf render];
+    });
+    dispatch_resume(_renderTimer);
+
+    return noErr;
+}
+
+- (OSStatus)stopUnit
+{
+    if (_unitState == AudioIOMockUnitStateNone)
+    {
+        [self violation:@"Unit stopped when it does not exist"];
+        return kAudioUnitErr_Uninitialized;
+    }
+
+    [self stopRendering];
+    return noErr;
+}
+
+- (void)stopRendering
+{
+    /*------------------------------------------------------------------------*
+     * Cancel on the render queue itself, so that no render is in progress
+     * once this returns.
+     *-----------------------------------------------------------------------*/
+    dispatch_sync(_renderQueue, ^{
+        if (self->_renderTimer)
+        {
+            dispatch_source_cancel(self->_renderTimer);
+            self->_renderTimer = nil;
+        }
+        if (self->_unitState == AudioIOMockUnitStateStarted)
+        {
+            self->_unitState = AudioIOMockUnitStateInitialized;
+        }
+    });
+}
+
+- (OSStatus)uninitializeUnit
+{
+    if (_unitState == AudioIOMockUnitStateStarted)
+    {
+        [self violation:@"Unit uninitialized while running"];
+        [self stopRendering];
+    }
+    else if (_unitState == AudioIOMockUnitStateNone)
+    {
+        [self violation:@"Unit uninitialized when it does not exist"];
+        return kAudioUnitErr_Uninitialized;
+    }
+
+    _unitState = AudioIOMockUnitStateCreated;
+    return noErr;
+}
+
+- (OSStatus)disposeUnit
+{
+    if (_unitState == AudioIOMockUnitStateStarted || _unitState == AudioIOMockUnitStateInitialized)
+    {
+        [self violation:@"Unit disposed without being stopped and uninitialized"];
+        [self stopRendering];
+    }
+
+    _unitState = AudioIOMockUnitStateNone;
+    return noErr;
+}
+
+- (OSStatus)setUnitProperty:(AudioUnitPropertyID)property
+                      scope:(AudioUnitScope)scope
+                    element:(AudioUnitElement)element
+                       data:(const void *)data
+                       size:(UInt32)size
+{
+    if (_unitState == AudioIOMockUnitStateNone)
+    {
+        [self violation:@"Property set on a unit that does not exist"];
+        return kAudioUnitErr_Uninitialized;
+    }
+
+    switch (property)
+    {
+        case kAudioUnitProperty_StreamFormat:
+        case kAudioOutputUnitProperty_EnableIO:
+            if (_unitState != AudioIOMockUnitStateCreated)
+            {
+                [self violation:@"Format or I/O enabled on an initialized unit"];
+                return kAudioUnitErr_PropertyNotWritable;
+            }
+            if (property == kAudioUnitProperty_StreamFormat && scope == kAudioUnitScope_Input && element == 0)
+            {
+                memcpy(&_clientFormat, data, MIN(size, sizeof(_clientFormat)));
+            }
+            if (property == kAudioOutputUnitProperty_EnableIO && scope == kAudioUnitScope_Output && element == 0)
+            {
+                _outputEnabled = (*(const UInt32 *) data != 0);
+            }
+            break;
+
+        case kAudioUnitProperty_SetRenderCallback:
+            memcpy(&_renderCallback, data, MIN(size, sizeof(_renderCallback)));
+            break;
+
+        case kAudioOutputUnitProperty_SetInputCallback:
+            memcpy(&_inputCallback, data, MIN(size, sizeof(_inputCallback)));
+            break;
+
+        case kAudioUnitProperty_SampleRateConverterComplexity:
+            memcpy(&_converterComplexity, data, MIN(size, sizeof(_converterComplexity)));
+            break;
+
+        default:
+            break;
+    }
+
+    return noErr;
+}
+
+- (OSStatus)getUnitProperty:(AudioUnitPropertyID)property
+                      scope:(AudioUnitScope)scope
+                    element:(AudioUnitElement)element
+                       data:(void *)data
+                       size:(UInt32 *)size
+{
+    if (_unitState == AudioIOMockUnitStateNone)
+    {
+        [self violation:@"Property read from a unit that does not exist"];
+        return kAudioUnitErr_Uninitialized;
+    }
+
+    switch (property)
+    {
+        case kAudioUnitProperty_StreamFormat:
+            memcpy(data, &_clientFormat, MIN(*size, sizeof(_clientFormat)));
+            return noErr;
+
+        case kAudioUnitProperty_MaximumFramesPerSlice:
+        {
+            UInt32 frames = MOCK_MAX_FRAMES_PER_SLICE;
+            memcpy(data, &frames, MIN(*size, sizeof(frames)));
+            return noErr;
+        }
+
+        case kAudioUnitProperty_SampleRateConverterComplexity:
+            memcpy(data, &_converterComplexity, MIN(*size, sizeof(_converterComplexity)));
+            return noErr;
+
+        case kAudioUnitProperty_Latency:
+        {
+            Float64 latency = 0;
+            memcpy(data, &latency, MIN(*size, sizeof(latency)));
+            return noErr;
+        }
+
+        default:
+            return kAudioUnitErr_InvalidProperty;
+    }
+}
+
+- (BOOL)hasUnit
+{
+    return _unitState != AudioIOMockUnitStateNone;
+}
+
+- (AudioUnit)unit
+{
+    return NULL;
+}
+
+- (BOOL)isRunning
+{
+    return _unitState == AudioIOMockUnitStateStarted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Rendering
+////////////////////////////////////////////////////////////////////////////////
+
+- (void)render
+{
+    /*------------------------------------------------------------------------*
+     * With output disabled, AURemoteIO calls the input callback instead,
+     * without buffers.
+     *-----------------------------------------------------------------------*/
+    AURenderCallbackStruct callback = _outputEnabled ? _renderCallback : _inputCallback;
+    if (_unitState != AudioIOMockUnitStateStarted || !callback.inputProc)
+    {
+        return;
+    }
+
+    if (!self.isActive)
+    {
+        [self violation:@"Render callback with inactive session"];
+    }
+
+    /*------------------------------------------------------------------------*
+     * Produce one hardware period's worth of frames at the client rate,
+     * as AURemoteIO does when converting sample rates.
+     *-----------------------------------------------------------------------*/
+    double clientSampleRate = _clientFormat.mSampleRate > 0 ? _clientFormat.mSampleRate : self.hardwareSampleRate;
+    UInt32 channels = MAX(_clientFormat.mChannelsPerFrame, 1);
+    UInt32 frames = (UInt32) round(self.IOBufferDuration * clientSampleRate);
+    frames = MAX(1, MIN(frames, MOCK_MAX_FRAMES_PER_SLICE / channels));
+
+    memset(_buffer, 0, frames * channels * sizeof(float));
+
+    /*------------------------------------------------------------------------*
+     * The delay line holds the first channel of every output block, so
+     * looped-back input is whatever was output loopbackDelay frames ago.
+     *-----------------------------------------------------------------------*/
+    const NSUInteger mask = MOCK_LOOPBACK_LENGTH - 1;
+    if (self.loopsBack && _outputEnabled)
+    {
+        NSUInteger delay = MIN(self.loopbackDelay, MOCK_LOOPBACK_LENGTH - MOCK_MAX_FRAMES_PER_SLICE);
+        for (UInt32 i = 0; i < frames && i < delay; i++)
+        {
+            float sample = _loopback[(_loopbackPosition + i - delay) & mask];
+            for (UInt32 c = 0; c < channels; c++)
+                _buffer[i * channels + c] = sample;
+        }
+    }
+
+    AudioBufferList bufferList;
+    bufferList.mNumberBuffers = 1;
+    bufferList.mBuffers[0].mNumberChannels = channels;
+    bufferList.mBuffers[0].mDataByteSize = frames * channels * sizeof(float);
+    bufferList.mBuffers[0].mData = _buffer;
+
+    AudioTimeStamp timeStamp;
+    memset(&timeStamp, 0, sizeof(timeStamp));
+    timeStamp.mSampleTime = _sampleTime;
+    timeStamp.mHostTime = mach_absolute_time();
+    timeStamp.mFlags = kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid;
+
+    CFTimeInterval renderStart = CACurrentMediaTime();
+    AudioUnitRenderActionFlags flags = 0;
+    callback.inputProc(callback.inputProcRefCon, &flags, &timeStamp, _outputEnabled ? 0 : 1, frames, _outputEnabled ? &bufferList : NULL);
+
+    if (_outputEnabled)
+    {
+        for (UInt32 i = 0; i < frames; i++)
+            _loopback[(_loopbackPosition + i) & mask] = _buffer[i * channels];
+        _loopbackPosition += frames;
+    }
+
+    /*------------------------------------------------------------------------*
+     * Simulate load, and skip any periods the callback overran.
+     *-----------------------------------------------------------------------*/
+    NSTimeInterval renderTime = self.simulatedRenderTime;
+    while (CACurrentMediaTime() - renderStart < renderTime)
+        ;
+    
+    double period = frames / clientSampleRate;
+    double overrun = floor((CACurrentMediaTime() - renderStart) / period);
+    
+    _sampleTime += frames * (1 + overrun);
+    self.renderCount++;
+
+    if (_awaitingFirstRender)
+    {
+        self.lastFirstRenderTime = CACurrentMediaTime();
+        self.lastTimeToFirstRender = self.lastFirstRenderTime - _startTime;
+        _awaitingFirstRender = NO;
+    }
+}
+
+@end
@@ -0,0 +1,441 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOOscillator
+ *
+ *  Phasor sine banks and band-limited wavetable banks.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOOscillator.h"
+
+#ifdef __APPLE__
+#include <Accelerate/Accelerate.h>
+#endif
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*----------------------------------------------------------------------------*
+ * Number of harmonics in the first (lowest-frequency) wavetable.
+ *----------------------------------------------------------------------------*/
+#define OSCILLATOR_MAX_HARMONICS (AUDIO_OSCILLATOR_TABLE_SIZE / 4)
+
+struct audio_oscillator_bank
+{
+    audio_oscillator_waveform_t waveform;
+    int                         num_oscillators;
+    int                         num_padded;
+    int                         max_frames;
+
+    /*------------------------------------------------------------------------*
+     * Requested parameters, written by any thread.
+     *-----------------------------------------------------------------------*/
+    _Atomic float              *frequency;
+    _Atomic float              *amplitude;
+
+    /*------------------------------------------------------------------------*
+     * Audio thread state, as a structure of arrays padded to a multiple of
+     * AUDIO_OSCILLATOR_LANES. `gain` is the amplitude reached at the end
+     * of the last block, and ramps by `gain_step` per frame towards
+     * `target`.
+     *-----------------------------------------------------------------------*/
+    int                         samplerate;
+    float                      *applied_frequency;
+    float                      *gain;
+    float                      *gain_step;
+    float                      *target;
+
+    /*------------------------------------------------------------------------*
+     * Sine banks: each oscillator's phasor (cos, sin of its phase) and
+     * per-sample rotation.
+     *-----------------------------------------------------------------------*/
+    float                      *re;
+    float                      *im;
+    float                      *rotation_re;
+    float                      *rotation_im;
+
+    /*------------------------------------------------------------------------*
+     * Wavetable banks: phase in cycles [0, 1), increment per sample, the
+     * table level in use, the tables (each with a guard point repeating
+     * its first sample), and a render buffer.
+     *-----------------------------------------------------------------------*/
+    float                      *phase;
+    float                      *increment;
+    int                        *level;
+    float                      *tables;
+    float                      *buffer;
+};
+
+/*----------------------------------------------------------------------------*
+ * Fill the band-limited tables by additive synthesis, one per octave,
+ * each with half the harmonics of the one before, normalised to a peak
+ * of 1.
+ *----------------------------------------------------------------------------*/
+static int oscillator_build_tables(audio_oscillator_bank_t *bank)
+{
+    const int size = AUDIO_OSCILLATOR_TABLE_SIZE;
+
+    float *sine = malloc(size * sizeof(float));
+    if (!sine) return -1;
+    for (int i = 0; i < size; i++)
+        sine[i] = (float) sin(2.0 * M_PI * i / size);
+
+    for (int level = 0; level < AUDIO_OSCILLATOR_TABLE_LEVELS; level++)
+    {
+        float *table = bank->tables + level * (size + 1);
+        int harmonics = OSCILLATOR_MAX_HARMONICS >> level;
+        if (harmonics < 1)
+            harmonics = 1;
+
+        for (int h = 1; h <= harmonics; h++)
+        {
+            float coefficient = 0.0f;
+            switch (bank->waveform)
+            {
+                case AUDIO_OSCILLATOR_SAW:
+                    coefficient = 1.0f / h;
+                    break;
+                case AUDIO_OSCILLATOR_SQUARE:
+                    coefficient = (h & 1) ? 1.0f / h : 0.0f;
+                    break;
+                case AUDIO_OSCILLATOR_TRIANGLE:
+                    coefficient = (h & 1) ? (((h >> 1) & 1) ? -1.0f : 1.0f) / (h * h) : 0.0f;
+                    break;
+                default:
+                    break;
+            }
+
+            if (coefficient == 0.0f)
+                continue;
+
+            /*----------------------------------------------------------------*
+             * sin(2πhi/N) is sine[hi mod N]: exact, and no libm calls.
+             *---------------------------------------------------------------*/
+            for (int i = 0; i < size; i++)
+                table[i] += coefficient * sine[(int) (((long) h * i) % size)];
+        }
+
+        float peak = 0.0f;
+#ifdef __APPLE__
+        vDSP_maxmgv(table, 1, &peak, size);
+#else
+        for (int i = 0; i < size; i++)
+            peak = fmaxf(peak, fabsf(table[i]));
+#endif
+        if (peak > 0.0f)
+        {
+            float scale = 1.0f / peak;
+#ifdef __APPLE__
+            vDSP_vsmul(table, 1, &scale, table, 1, size);
+#else
+            for (int i = 0; i < size; i++)
+                table[i] *= scale;
+#endif
+        }
+        table[size] = table[0];
+    }
+
+    free(sine);
+    return 0;
+}
+
+audio_oscillator_bank_t *audio_oscillator_bank_create(audio_oscillator_waveform_t waveform,
+                                                      int num_oscillators,
+                                                      int max_frames)
+{
+    if (num_oscillators <= 0 || max_frames <= 0)
+        return NULL;
+
+    audio_oscillator_bank_t *bank = calloc(1, sizeof(audio_oscillator_bank_t));
+    if (!bank) return NULL;
+
+    int padded = (num_oscillators + AUDIO_OSCILLATOR_LANES - 1) / AUDIO_OSCILLATOR_LANES * AUDIO_OSCILLATOR_LANES;
+    bank->waveform = waveform;
+    bank->num_oscillators = num_oscillators;
+    bank->num_padded = padded;
+    bank->max_frames = max_frames;
+
+    bank->frequency = calloc(num_oscillators, sizeof(_Atomic float));
+    bank->amplitude = calloc(num_oscillators, sizeof(_Atomic float));
+    bank->applied_frequency = calloc(padded, sizeof(float));
+    bank->gain = calloc(padded, sizeof(float));
+    bank->gain_step = calloc(padded, sizeof(float));
+    bank->target = calloc(padded, sizeof(float));
+    int failed = !bank->frequency || !bank->amplitude || !bank->applied_frequency ||
+                 !bank->gain || !bank->gain_step || !bank->target;
+
+    if (waveform == AUDIO_OSCILLATOR_SINE)
+    {
+        bank->re = calloc(padded, sizeof(float));
+        bank->im = calloc(padded, sizeof(float));
+        bank->rotation_re = calloc(padded, sizeof(float));
+        bank->rotation_im = calloc(padded, sizeof(float));
+        failed = failed || !bank->re || !bank->im || !bank->rotation_re || !bank->rotation_im;
+    }
+    else
+    {
+        bank->phase = calloc(padded, sizeof(float));
+        bank->increment = calloc(padded, sizeof(float));
+        bank->level = calloc(padded, sizeof(int));
+        bank->tables = calloc(AUDIO_OSCILLATOR_TABLE_LEVELS * (AUDIO_OSCILLATOR_TABLE_SIZE + 1), sizeof(float));
+        bank->buffer = calloc(max_frames, sizeof(float));
+        failed = failed || !bank->phase || !bank->increment || !bank->level || !bank->tables || !bank->buffer;
+    }
+
+    if (failed || (bank->tables && oscillator_build_tables(bank)))
+    {
+        audio_oscillator_bank_destroy(bank);
+        return NULL;
+    }
+
+    for (int k = 0; k < num_oscillators; k++)
+    {
+        atomic_init(&bank->frequency[k], 0.0f);
+        atomic_init(&bank->amplitude[k], 0.0f);
+    }
+
+    /*------------------------------------------------------------------------*
+     * Phasors start at phase zero, and padding lanes never rotate.
+     *-----------------------------------------------------------------------*/
+    if (bank->re)
+    {
+        for (int k = 0; k < padded; k++)
+        {
+            bank->re[k] = 1.0f;
+            bank->rotation_re[k] = 1.0f;
+        }
+    }
+
+    return bank;
+}
+
+void audio_oscillator_bank_destroy(audio_oscillator_bank_t *bank)
+{
+    if (!bank) return;
+
+    free(bank->frequency);
+    free(bank->amplitude);
+    free(bank->applied_frequency);
+    free(bank->gain);
+    free(bank->gain_step);
+    free(bank->target);
+    free(bank->re);
+    free(bank->im);
+    free(bank->rotation_re);
+    free(bank->rotation_im);
+    free(bank->phase);
+    free(bank->increment);
+    free(bank->level);
+    free(bank->tables);
+    free(bank->buffer);
+    free(bank);
+}
+
+void audio_oscillator_set(audio_oscillator_bank_t *bank, int oscillator, float frequency, float amplitude)
+{
+    if (oscillator < 0 || oscillator >= bank->num_oscillators)
+        return;
+
+    atomic_store_explicit(&bank->frequency[oscillator], frequency > 0.0f ? frequency : 0.0f, memory_order_relaxed);
+    atomic_store_explicit(&bank->amplitude[oscillator], amplitude, memory_order_relaxed);
+}
+
+/*----------------------------------------------------------------------------*
+ * Take up requested parameters at the start of a block of `num_frames`.
+ * Returns the number of oscillators to process: one past the highest that
+ * is on or fading out.
+ *----------------------------------------------------------------------------*/
+static int oscillator_update(audio_oscillator_bank_t *bank, int num_frames, int samplerate)
+{
+    int rate_changed = (samplerate != bank->samplerate);
+    bank->samplerate = samplerate;
+
+    int num_active = 0;
+    for (int k = 0; k < bank->num_oscillators; k++)
+    {
+        float frequency = atomic_load_explicit(&bank->frequency[k], memory_order_relaxed);
+        float amplitude = atomic_load_explicit(&bank->amplitude[k], memory_order_relaxed);
+
+        if (frequency != bank->applied_frequency[k] || rate_changed)
+        {
+            bank->applied_frequency[k] = frequency;
+            float cycles = frequency / samplerate;
+
+            if (bank->waveform == AUDIO_OSCILLATOR_SINE)
+            {
+                bank->rotation_re[k] = cosf(2.0f * (float) M_PI * cycles);
+                bank->rotation_im[k] = sinf(2.0f * (float) M_PI * cycles);
+            }
+            else
+            {
+                /*------------------------------------------------------------*
+                 * Use the richest table with no harmonic above Nyquist.
+                 *-----------------------------------------------------------*/
+                int level = 0;
+                float allowed = (cycles > 0.0f) ? 0.5f / cycles : (float) OSCILLATOR_MAX_HARMONICS;
+                while (level < AUDIO_OSCILLATOR_TABLE_LEVELS - 1 && (OSCILLATOR_MAX_HARMONICS >> level) > allowed)
+                    level++;
+
+                bank->increment[k] = cycles;
+                bank->level[k] = level;
+            }
+        }
+
+        bank->target[k] = amplitude;
+        bank->gain_step[k] = (amplitude - bank->gain[k]) / num_frames;
+        if (amplitude != 0.0f || bank->gain[k] != 0.0f)
+            num_active = k + 1;
+    }
+
+    return num_active;
+}
+
+/*----------------------------------------------------------------------------*
+ * Rotate every phasor once per frame, summing their imaginary parts.
+ * Lanes are independent within each group, so the innermost loop
+ * vectorises; the lane sums are combined once per frame.
+ *----------------------------------------------------------------------------*/
+static void oscillator_render_sines(audio_oscillator_bank_t *bank, float *output, int num_frames, int num_active)
+{
+    int num_lanes = (num_active + AUDIO_OSCILLATOR_LANES - 1) / AUDIO_OSCILLATOR_LANES * AUDIO_OSCILLATOR_LANES;
+
+    for (int i = 0; i < num_frames; i++)
+    {
+        float sum[AUDIO_OSCILLATOR_LANES] = { 0 };
+
+        for (int g = 0; g < num_lanes; g += AUDIO_OSCILLATOR_LANES)
+        {
+            float *restrict re = bank->re + g;
+            float *restrict im = bank->im + g;
+            const float *restrict rotation_re = bank->rotation_re + g;
+            const float *restrict rotation_im = bank->rotation_im + g;
+            float *restrict gain = bank->gain + g;
+            const float *restrict gain_step = bank->gain_step + g;
+
+            for (int l = 0; l < AUDIO_OSCILLATOR_LANES; l++)
+            {
+                float r = re[l] * rotation_re[l] - im[l] * rotation_im[l];
+                float m = re[l] * rotation_im[l] + im[l] * rotation_re[l];
+                re[l] = r;
+                im[l] = m;
+                gain[l] += gain_step[l];
+                sum[l] += gain[l] * m;
+            }
+        }
+
+        float total = 0.0f;
+        for (int l = 0; l < AUDIO_OSCILLATOR_LANES; l++)
+            total += sum[l];
+        output[i] += total;
+    }
+
+    /*------------------------------------------------------------------------*
+     * Pull each phasor back onto the unit circle, against rounding drift
+     * (first-order correction of 1 / |z|).
+     *-----------------------------------------------------------------------*/
+    for (int k = 0; k < num_lanes; k++)
+    {
+        float correction = 1.5f - 0.5f * (bank->re[k] * bank->re[k] + bank->im[k] * bank->im[k]);
+        bank->re[k] *= correction;
+        bank->im[k] *= correction;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ * Look up each active oscillator's table over the block, with linear
+ * interpolation, and add it to the output, ramping its gain. Elsewhere
+ * than Apple's platforms, a plain loop stands in for vDSP's.
+ *----------------------------------------------------------------------------*/
+static void oscillator_render_tables(audio_oscillator_bank_t *bank, float *output, int num_frames, int num_active)
+{
+#ifdef __APPLE__
+    float scale = AUDIO_OSCILLATOR_TABLE_SIZE;
+    float offset = 0.0f;
+#endif
+
+    for (int k = 0; k < num_active; k++)
+    {
+        float phase = bank->phase[k];
+        float increment = bank->increment[k];
+
+        if (bank->gain[k] != 0.0f || bank->target[k] != 0.0f)
+        {
+            const float *table = bank->tables + bank->level[k] * (AUDIO_OSCILLATOR_TABLE_SIZE + 1);
+            float gain = bank->gain[k];
+
+#ifdef __APPLE__
+            vDSP_vramp(&phase, &increment, bank->buffer, 1, num_frames);
+            vDSP_vfrac(bank->buffer, 1, bank->buffer, 1, num_frames);
+            vDSP_vtabi(bank->buffer, 1, &scale, &offset, table, AUDIO_OSCILLATOR_TABLE_SIZE + 1, bank->buffer, 1, num_frames);
+            vDSP_vrampmuladd(bank->buffer, 1, &gain, &bank->gain_step[k], output, 1, num_frames);
+#else
+            float gain_step = bank->gain_step[k];
+            for (int i = 0; i < num_frames; i++)
+            {
+                float p = phase + increment * (float) i;
+                float position = (p - floorf(p)) * AUDIO_OSCILLATOR_TABLE_SIZE;
+                int index = (int) position;
+                if (index > AUDIO_OSCILLATOR_TABLE_SIZE - 1)
+                    index = AUDIO_OSCILLATOR_TABLE_SIZE - 1;
+                float fraction = position - (float) index;
+                float sample = table[index] + fraction * (table[index + 1] - table[index]);
+                output[i] += (gain + gain_step * (float) i) * sample;
+            }
+#endif
+        }
+
+        phase += increment * num_frames;
+        bank->phase[k] = phase - floorf(phase);
+    }
+}
+
+void audio_oscillator_bank_render(audio_oscillator_bank_t *bank,
+                                  float *output,
+                                  int num_frames,
+                                  int samplerate)
+{
+    for (int offset = 0; offset < num_frames; offset += bank->max_frames)
+    {
+        int length = num_frames - offset;
+        if (length > bank->max_frames)
+            length = bank->max_frames;
+
+        int num_active = oscillator_update(bank, length, samplerate);
+
+        if (bank->waveform == AUDIO_OSCILLATOR_SINE)
+            oscillator_render_sines(bank, output + offset, length, num_active);
+        else
+            oscillator_render_tables(bank, output + offset, length, num_active);
+
+        /*--------------------------------------------------------------------*
+         * Land exactly on the target amplitudes.
+         *-------------------------------------------------------------------*/
+        for (int k = 0; k < num_active; k++)
+            bank->gain[k] = bank->target[k];
+    }
+}
+
+int audio_oscillator_bank_mixer_render(void *context, float *samples, int num_frames, int samplerate)
+{
+    audio_oscillator_bank_t *bank = context;
+
+    memset(samples, 0, num_frames * sizeof(float));
+    audio_oscillator_bank_render(bank, samples, num_frames, samplerate);
+
+    for (int k = 0; k < bank->num_oscillators; k++)
+    {
+        if (bank->gain[k] != 0.0f)
+            return 1;
+    }
+    return 0;
+}
+
+int audio_oscillator_bank_size(audio_oscillator_bank_t *bank)
+{
+    return bank->num_oscillators;
+}
@@ -0,0 +1,112 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOOscillator
+ *
+ *  A bank of oscillators of one waveform, rendered and summed to a mono
+ *  buffer a block at a time, for much less than the cost of calling
+ *  sin() per sample.
+ *
+ *  Sine banks keep each oscillator as a unit phasor, rotated once per
+ *  sample. Oscillator state is stored as a structure of arrays in groups
+ *  of AUDIO_OSCILLATOR_LANES, so the compiler vectorises the rotation
+ *  across oscillators, with no transcendental functions in the inner
+ *  loop.
+ *
+ *  Saw, square and triangle banks play band-limited wavetables, with one
+ *  table per octave so that no harmonic exceeds the Nyquist frequency.
+ *  Each oscillator is rendered with table lookup and linear interpolation,
+ *  by vDSP where Accelerate is available.
+ *
+ *  Frequencies and amplitudes may be set from any thread at any time.
+ *  Amplitude changes are ramped over the next block; an oscillator at
+ *  zero amplitude is off, and costs nothing in wavetable banks.
+ *
+ *  Example usage:
+ *
+ *  audio_oscillator_bank_t *bank = audio_oscillator_bank_create(AUDIO_OSCILLATOR_SINE, 16, 4096);
+ *  audio_oscillator_set(bank, 0, 440.0, 0.5);
+ *  ...
+ *  audio_oscillator_bank_render(bank, samples, num_frames, samplerate);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_OSCILLATOR_H
+#define AUDIO_IO_OSCILLATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Sine oscillators are processed in groups of this many.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_OSCILLATOR_LANES 8
+
+/*----------------------------------------------------------------------------*
+ * Length of each wavetable, and the number of octave-spaced tables.
+ * The first table holds AUDIO_OSCILLATOR_TABLE_SIZE / 4 harmonics.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_OSCILLATOR_TABLE_SIZE 2048
+#define AUDIO_OSCILLATOR_TABLE_LEVELS 10
+
+typedef enum
+{
+    AUDIO_OSCILLATOR_SINE = 0,
+    AUDIO_OSCILLATOR_SAW,
+    AUDIO_OSCILLATOR_SQUARE,
+    AUDIO_OSCILLATOR_TRIANGLE
+} audio_oscillator_waveform_t;
+
+typedef struct audio_oscillator_bank audio_oscillator_bank_t;
+
+/**-----------------------------------------------------------------------------
+ * Create a new bank, with all oscillators off.
+ *
+ * @param waveform          Waveform of every oscillator in the bank.
+ * @param num_oscillators   Number of oscillators.
+ * @param max_frames        Largest block rendered in one pass. Longer
+ *                          blocks are rendered in several.
+ *----------------------------------------------------------------------------*/
+audio_oscillator_bank_t *audio_oscillator_bank_create(audio_oscillator_waveform_t waveform,
+                                                      int num_oscillators,
+                                                      int max_frames);
+
+/**-----------------------------------------------------------------------------
+ * Free a bank.
+ *----------------------------------------------------------------------------*/
+void audio_oscillator_bank_destroy(audio_oscillator_bank_t *bank);
+
+/**-----------------------------------------------------------------------------
+ * Set an oscillator's frequency (Hz) and peak amplitude. Set the amplitude
+ * to zero to turn the oscillator off. Phase is continuous across changes.
+ * May be called from any thread.
+ *----------------------------------------------------------------------------*/
+void audio_oscillator_set(audio_oscillator_bank_t *bank, int oscillator, float frequency, float amplitude);
+
+/**-----------------------------------------------------------------------------
+ * Render a block of every oscillator, adding the sum to `output`.
+ * Realtime-safe.
+ *----------------------------------------------------------------------------*/
+void audio_oscillator_bank_render(audio_oscillator_bank_t *bank,
+                                  float *output,
+                                  int num_frames,
+                                  int samplerate);
+
+/**-----------------------------------------------------------------------------
+ * As audio_oscillator_bank_render(), but overwriting `samples`, and
+ * returning nonzero if any oscillator is on. Matches audio_mixer_render_t,
+ * so that a bank can be added to an audio_mixer_t with the bank as
+ * context.
+ *----------------------------------------------------------------------------*/
+int audio_oscillator_bank_mixer_render(void *bank, float *samples, int num_frames, int samplerate);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of oscillators in the bank.
+ *----------------------------------------------------------------------------*/
+int audio_oscillator_bank_size(audio_oscillator_bank_t *bank);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOPeriodTracker
+ *
+ *  Detects missed I/O periods from the sample times of consecutive
+ *  blocks: a block whose sample time has moved on further than the
+ *  previous block's length accounts for follows one or more periods that
+ *  were never rendered.
+ *
+ *  Sample times run at the hardware rate, which differs from the blocks'
+ *  when the stream is resampled, so the usual advance per frame is learnt
+ *  from the blocks without gaps rather than assumed.
+ *
+ *  Shared by the render callback's overrun detection and the glitch
+ *  detector, so that both judge a gap the same way. A zero-initialised
+ *  tracker is ready to use.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_PERIOD_TRACKER_H
+#define AUDIO_IO_PERIOD_TRACKER_H
+
+/*----------------------------------------------------------------------------*
+ * Advance of the sample time per frame, relative to the usual advance,
+ * taken to mean that periods were missed.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_MISSED_PERIOD_RATIO 1.5
+
+typedef struct
+{
+    double  last_sample_time;
+    int     last_num_frames;
+
+    /*------------------------------------------------------------------------*
+     * The usual advance of the sample time per frame, or 0 until two
+     * consecutive blocks have been seen.
+     *-----------------------------------------------------------------------*/
+    double  sample_time_per_frame;
+} audio_period_tracker_t;
+
+/**-----------------------------------------------------------------------------
+ * Forget the previous block and the learnt advance per frame, as when the
+ * stream restarts or its sample rate changes.
+ *----------------------------------------------------------------------------*/
+static inline void audio_period_tracker_reset(audio_period_tracker_t *tracker)
+{
+    tracker->last_sample_time = 0;
+    tracker->last_num_frames = 0;
+    tracker->sample_time_per_frame = 0;
+}
+
+/**-----------------------------------------------------------------------------
+ * Take in the next block's sample time. Realtime-safe.
+ *
+ * @param sample_time   The hardware sample time of the block's first frame.
+ * @param num_frames    Number of frames in the block.
+ *
+ * @return The gap before this block, in units of the sample time, if
+ *         periods were missed since the previous block, or 0 if not. The
+ *         block was expected at `sample_time` minus the gap.
+ *----------------------------------------------------------------------------*/
+static inline double audio_period_tracker_update(audio_period_tracker_t *tracker,
+                                                 double sample_time,
+                                                 int num_frames)
+{
+    double gap = 0;
+
+    if (tracker->last_num_frames > 0)
+    {
+        double per_frame = (sample_time - tracker->last_sample_time) / tracker->last_num_frames;
+        double usual = tracker->sample_time_per_frame;
+        if (usual > 0 && per_frame > AUDIO_MISSED_PERIOD_RATIO * usual)
+            gap = sample_time - (tracker->last_sample_time + tracker->last_num_frames * usual);
+        else if (per_frame > 0)
+            tracker->sample_time_per_frame = per_frame;
+    }
+    tracker->last_sample_time = sample_time;
+    tracker->last_num_frames = num_frames;
+
+    return gap;
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIORingBuffer
+ *
+ *  Lock-free single-producer, single-consumer ring buffer.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIORingBuffer.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct audio_ring_buffer
+{
+    char           *data;
+    int             capacity;
+    int             mask;
+    int             element_size;
+
+    /*------------------------------------------------------------------------*
+     * Monotonically increasing element counts. Each is only ever modified
+     * by one side, and wraps harmlessly as the difference is what matters.
+     *-----------------------------------------------------------------------*/
+    atomic_uint     write_count;
+    atomic_uint     read_count;
+};
+
+audio_ring_buffer_t *audio_ring_buffer_create(int capacity, int element_size)
+{
+    int rounded = 1;
+    while (rounded < capacity)
+        rounded <<= 1;
+
+    audio_ring_buffer_t *buffer = calloc(1, sizeof(audio_ring_buffer_t));
+    if (!buffer) return NULL;
+
+    buffer->data = calloc(rounded, element_size);
+    if (!buffer->data)
+    {
+        free(buffer);
+        return NULL;
+    }
+
+    buffer->capacity = rounded;
+    buffer->mask = rounded - 1;
+    buffer->element_size = element_size;
+    atomic_init(&buffer->write_count, 0);
+    atomic_init(&buffer->read_count, 0);
+
+    return buffer;
+}
+
+void audio_ring_buffer_destroy(audio_ring_buffer_t *buffer)
+{
+    if (!buffer) return;
+
+    free(buffer->data);
+    free(buffer);
+}
+
+int audio_ring_buffer_read_available(audio_ring_buffer_t *buffer)
+{
+    unsigned int write_count = atomic_load_explicit(&buffer->write_count, memory_order_acquire);
+    unsigned int read_count = atomic_load_explicit(&buffer->read_count, memory_order_acquire);
+    return (int) (write_count - read_count);
+}
+
+int audio_ring_buffer_write_available(audio_ring_buffer_t *buffer)
+{
+    return buffer->capacity - audio_ring_buffer_read_available(buffer);
+}
+
+int audio_ring_buffer_write(audio_ring_buffer_t *buffer, const void *elements, int count)
+{
+    unsigned int write_count = atomic_load_explicit(&buffer->write_count, memory_order_relaxed);
+    unsigned int read_count = atomic_load_explicit(&buffer->read_count, memory_order_acquire);
+    int space = buffer->capacity - (int) (write_count - read_count);
+    if (count > space)
+        count = space;
+    if (count <= 0)
+        return 0;
+
+    /*------------------------------------------------------------------------*
+     * Copy in up to two segments, either side of the wrap point.
+     *-----------------------------------------------------------------------*/
+    int start = write_count & buffer->mask;
+    int first = buffer->capacity - start;
+    if (first > count)
+        first = count;
+
+    memcpy(buffer->data + start * buffer->element_size, elements, first * buffer->element_size);
+    memcpy(buffer->data, (const char *) elements + first * buffer->element_size, (count - first) * buffer->element_size);
+
+    atomic_store_explicit(&buffer->write_count, write_count + count, memory_order_release);
+
+    return count;
+}
+
+int audio_ring_buffer_read(audio_ring_buffer_t *buffer, void *elements, int count)
+{
+    unsigned int read_count = atomic_load_explicit(&buffer->read_count, memory_order_relaxed);
+    unsigned int write_count = atomic_load_explicit(&buffer->write_count, memory_order_acquire);
+    int available = (int) (write_count - read_count);
+    if (count > available)
+        count = available;
+    if (count <= 0)
+        return 0;
+
+    int start = read_count & buffer->mask;
+    int first = buffer->capacity - start;
+    if (first > count)
+        first = count;
+
+    memcpy(elements, buffer->data + start * buffer->element_size, first * buffer->element_size);
+    memcpy((char *) elements + first * buffer->element_size, buffer->data, (count - first) * buffer->element_size);
+
+    atomic_store_explicit(&buffer->read_count, read_count + count, memory_order_release);
+
+    return count;
+}
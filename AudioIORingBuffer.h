@@ -0,0 +1,66 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIORingBuffer
+ *
+ *  Lock-free single-producer, single-consumer ring buffer of fixed-size
+ *  elements, for passing data between the audio thread and other threads
+ *  without blocking either side.
+ *
+ *  Exactly one thread may write and exactly one thread may read at any
+ *  one time. Writes that do not fit are truncated rather than blocking.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_RING_BUFFER_H
+#define AUDIO_IO_RING_BUFFER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct audio_ring_buffer audio_ring_buffer_t;
+
+/**-----------------------------------------------------------------------------
+ * Create a new ring buffer.
+ *
+ * @param capacity      Number of elements. Rounded up to a power of two.
+ * @param element_size  Size of each element, in bytes.
+ * @return A new ring buffer, or NULL if memory could not be allocated.
+ *----------------------------------------------------------------------------*/
+audio_ring_buffer_t *audio_ring_buffer_create(int capacity, int element_size);
+
+/**-----------------------------------------------------------------------------
+ * Free a ring buffer.
+ *----------------------------------------------------------------------------*/
+void audio_ring_buffer_destroy(audio_ring_buffer_t *buffer);
+
+/**-----------------------------------------------------------------------------
+ * Write up to `count` elements. Realtime-safe.
+ *
+ * @return The number of elements written, which is less than `count` if
+ *         the buffer is full.
+ *----------------------------------------------------------------------------*/
+int audio_ring_buffer_write(audio_ring_buffer_t *buffer, const void *elements, int count);
+
+/**-----------------------------------------------------------------------------
+ * Read up to `count` elements. Realtime-safe.
+ *
+ * @return The number of elements read.
+ *----------------------------------------------------------------------------*/
+int audio_ring_buffer_read(audio_ring_buffer_t *buffer, void *elements, int count);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of elements available to read.
+ *----------------------------------------------------------------------------*/
+int audio_ring_buffer_read_available(audio_ring_buffer_t *buffer);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of elements that can currently be written.
+ *----------------------------------------------------------------------------*/
+int audio_ring_buffer_write_available(audio_ring_buffer_t *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
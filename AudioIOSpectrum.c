@@ -0,0 +1,252 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOSpectrum
+ *
+ *  Overlapped, windowed FFT analysis on a worker thread.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOSpectrum.h"
+#include "AudioIOFFT.h"
+#include "AudioIORingBuffer.h"
+
+#ifdef __APPLE__
+#include <Accelerate/Accelerate.h>
+#endif
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*----------------------------------------------------------------------------*
+ * Flag set on the triple buffer's shared index when it holds a spectrum
+ * the reader has not yet seen.
+ *----------------------------------------------------------------------------*/
+#define SPECTRUM_NEW_FRAME 4
+
+struct audio_spectrum
+{
+    int                     fft_size;
+    int                     hop_size;
+    int                     num_bins;
+    audio_fft_t            *fft;
+    audio_ring_buffer_t    *input;
+    atomic_uint_least64_t   dropped;
+    atomic_uint_least64_t   frames_analysed;
+
+    /*------------------------------------------------------------------------*
+     * Worker state: the current analysis frame, the window and its gain
+     * compensation, and FFT workspace.
+     *-----------------------------------------------------------------------*/
+    float                  *frame;
+    int                     frame_fill;
+    float                  *window;
+    float                  *windowed;
+    float                   scale;
+    float                  *real;
+    float                  *imag;
+
+    /*------------------------------------------------------------------------*
+     * Triple buffer of magnitude spectra. The worker owns `back`, the
+     * reader owns `front`, and `shared` is exchanged between them.
+     *-----------------------------------------------------------------------*/
+    float                  *magnitudes[3];
+    int                     back;
+    int                     front;
+    atomic_int              shared;
+};
+
+audio_spectrum_t *audio_spectrum_create(int fft_size, int hop_size, int buffer_size)
+{
+    if (fft_size < AUDIO_SPECTRUM_MIN_SIZE || fft_size > AUDIO_SPECTRUM_MAX_SIZE ||
+        (fft_size & (fft_size - 1)) || hop_size <= 0 || hop_size > fft_size)
+        return NULL;
+
+    audio_spectrum_t *spectrum = calloc(1, sizeof(audio_spectrum_t));
+    if (!spectrum) return NULL;
+
+    spectrum->fft_size = fft_size;
+    spectrum->hop_size = hop_size;
+    spectrum->num_bins = AUDIO_SPECTRUM_BINS(fft_size);
+
+    spectrum->fft = audio_fft_create(fft_size);
+    spectrum->input = audio_ring_buffer_create(buffer_size > fft_size ? buffer_size : fft_size, sizeof(float));
+    spectrum->frame = calloc(fft_size, sizeof(float));
+    spectrum->window = calloc(fft_size, sizeof(float));
+    spectrum->windowed = calloc(fft_size, sizeof(float));
+    spectrum->real = calloc(fft_size / 2, sizeof(float));
+    spectrum->imag = calloc(fft_size / 2, sizeof(float));
+    for (int i = 0; i < 3; i++)
+        spectrum->magnitudes[i] = calloc(spectrum->num_bins, sizeof(float));
+
+    if (!spectrum->fft || !spectrum->input || !spectrum->frame || !spectrum->window ||
+        !spectrum->windowed || !spectrum->real || !spectrum->imag ||
+        !spectrum->magnitudes[0] || !spectrum->magnitudes[1] || !spectrum->magnitudes[2])
+    {
+        audio_spectrum_destroy(spectrum);
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------------*
+     * A bin-centred sinusoid of amplitude A has a packed (zrip) magnitude of
+     * A times the window's sum, so scale by its inverse. The window's own
+     * scale is divided out, so the portable one needn't match vDSP's.
+     *-----------------------------------------------------------------------*/
+    float window_sum = 0.0f;
+#ifdef __APPLE__
+    vDSP_hann_window(spectrum->window, fft_size, vDSP_HANN_NORM);
+    vDSP_meanv(spectrum->window, 1, &window_sum, fft_size);
+    window_sum *= fft_size;
+#else
+    for (int i = 0; i < fft_size; i++)
+    {
+        spectrum->window[i] = 0.5f * (1.0f - (float) cos(2.0 * M_PI * i / fft_size));
+        window_sum += spectrum->window[i];
+    }
+#endif
+    spectrum->scale = 1.0f / window_sum;
+
+    spectrum->back = 0;
+    spectrum->front = 1;
+    atomic_init(&spectrum->shared, 2);
+    atomic_init(&spectrum->dropped, 0);
+    atomic_init(&spectrum->frames_analysed, 0);
+
+    return spectrum;
+}
+
+void audio_spectrum_destroy(audio_spectrum_t *spectrum)
+{
+    if (!spectrum) return;
+
+    audio_fft_destroy(spectrum->fft);
+    audio_ring_buffer_destroy(spectrum->input);
+    free(spectrum->frame);
+    free(spectrum->window);
+    free(spectrum->windowed);
+    free(spectrum->real);
+    free(spectrum->imag);
+    for (int i = 0; i < 3; i++)
+        free(spectrum->magnitudes[i]);
+    free(spectrum);
+}
+
+void audio_spectrum_write(audio_spectrum_t *spectrum, const float *samples, int num_frames)
+{
+    int written = audio_ring_buffer_write(spectrum->input, samples, num_frames);
+    if (written < num_frames)
+        atomic_fetch_add_explicit(&spectrum->dropped, num_frames - written, memory_order_relaxed);
+}
+
+/*----------------------------------------------------------------------------*
+ * Compute the magnitude spectrum of the current frame into the back buffer.
+ *----------------------------------------------------------------------------*/
+static void audio_spectrum_transform(audio_spectrum_t *spectrum)
+{
+    int half_size = spectrum->fft_size / 2;
+    float *magnitudes = spectrum->magnitudes[spectrum->back];
+
+#ifdef __APPLE__
+    vDSP_vmul(spectrum->frame, 1, spectrum->window, 1, spectrum->windowed, 1, spectrum->fft_size);
+#else
+    for (int i = 0; i < spectrum->fft_size; i++)
+        spectrum->windowed[i] = spectrum->frame[i] * spectrum->window[i];
+#endif
+    audio_fft_forward(spectrum->fft, spectrum->windowed, spectrum->real, spectrum->imag);
+
+    /*------------------------------------------------------------------------*
+     * The packed format stores the real-valued DC and Nyquist terms in the
+     * first real and imaginary slots; both are doubled relative to the
+     * one-sided bins in between.
+     *-----------------------------------------------------------------------*/
+    float dc = spectrum->real[0];
+    float nyquist = spectrum->imag[0];
+    spectrum->imag[0] = 0.0f;
+
+#ifdef __APPLE__
+    DSPSplitComplex split = { spectrum->real, spectrum->imag };
+    vDSP_zvabs(&split, 1, magnitudes, 1, half_size);
+#else
+    for (int k = 0; k < half_size; k++)
+        magnitudes[k] = sqrtf(spectrum->real[k] * spectrum->real[k] + spectrum->imag[k] * spectrum->imag[k]);
+#endif
+    magnitudes[0] = 0.5f * fabsf(dc);
+    magnitudes[half_size] = 0.5f * fabsf(nyquist);
+#ifdef __APPLE__
+    vDSP_vsmul(magnitudes, 1, &spectrum->scale, magnitudes, 1, spectrum->num_bins);
+#else
+    for (int k = 0; k < spectrum->num_bins; k++)
+        magnitudes[k] *= spectrum->scale;
+#endif
+}
+
+int audio_spectrum_analyse(audio_spectrum_t *spectrum)
+{
+    int frames = 0;
+
+    for (;;)
+    {
+        /*--------------------------------------------------------------------*
+         * Fill the frame up to fft_size samples; once full, it is analysed
+         * and slid along by hop_size.
+         *-------------------------------------------------------------------*/
+        int needed = spectrum->fft_size - spectrum->frame_fill;
+        int read = audio_ring_buffer_read(spectrum->input, spectrum->frame + spectrum->frame_fill, needed);
+        spectrum->frame_fill += read;
+        if (spectrum->frame_fill < spectrum->fft_size)
+            break;
+
+        audio_spectrum_transform(spectrum);
+        frames++;
+
+        memmove(spectrum->frame, spectrum->frame + spectrum->hop_size,
+                (spectrum->fft_size - spectrum->hop_size) * sizeof(float));
+        spectrum->frame_fill -= spectrum->hop_size;
+
+        /*--------------------------------------------------------------------*
+         * Publish after every frame rather than only the last, so that a
+         * reader is never starved by a long backlog.
+         *-------------------------------------------------------------------*/
+        int previous = atomic_exchange_explicit(&spectrum->shared, spectrum->back | SPECTRUM_NEW_FRAME, memory_order_acq_rel);
+        spectrum->back = previous & ~SPECTRUM_NEW_FRAME;
+    }
+
+    if (frames)
+        atomic_fetch_add_explicit(&spectrum->frames_analysed, frames, memory_order_relaxed);
+
+    return frames;
+}
+
+int audio_spectrum_read(audio_spectrum_t *spectrum, float *magnitudes)
+{
+    int is_new = 0;
+
+    if (atomic_load_explicit(&spectrum->shared, memory_order_relaxed) & SPECTRUM_NEW_FRAME)
+    {
+        int previous = atomic_exchange_explicit(&spectrum->shared, spectrum->front, memory_order_acq_rel);
+        spectrum->front = previous & ~SPECTRUM_NEW_FRAME;
+        is_new = 1;
+    }
+
+    memcpy(magnitudes, spectrum->magnitudes[spectrum->front], spectrum->num_bins * sizeof(float));
+    return is_new;
+}
+
+int audio_spectrum_size(audio_spectrum_t *spectrum)
+{
+    return spectrum->fft_size;
+}
+
+uint64_t audio_spectrum_frames_analysed(audio_spectrum_t *spectrum)
+{
+    return atomic_load_explicit(&spectrum->frames_analysed, memory_order_relaxed);
+}
+
+uint64_t audio_spectrum_samples_dropped(audio_spectrum_t *spectrum)
+{
+    return atomic_load_explicit(&spectrum->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,106 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOSpectrum
+ *
+ *  Spectrum analyser which keeps FFTs off the audio thread.
+ *
+ *  The audio thread passes each input block to audio_spectrum_write(),
+ *  which only copies it into a lock-free ring buffer. A worker thread
+ *  calls audio_spectrum_analyse() periodically to compute Hann-windowed
+ *  real FFTs over overlapping frames of the buffered signal, and publishes
+ *  magnitude spectra through a lock-free triple buffer. A reader on any
+ *  one thread fetches the latest spectrum with audio_spectrum_read().
+ *
+ *  Magnitudes are linear, scaled so that a full-scale sinusoid centred on
+ *  a bin reads 1.0.
+ *
+ *  Example usage:
+ *
+ *  float magnitudes[AUDIO_SPECTRUM_BINS(2048)];
+ *  if (audio_spectrum_read(spectrum, magnitudes))
+ *      update_display(magnitudes);
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_SPECTRUM_H
+#define AUDIO_IO_SPECTRUM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Number of magnitude bins for an FFT of the given size, DC to Nyquist.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_SPECTRUM_BINS(fft_size) ((fft_size) / 2 + 1)
+
+/*----------------------------------------------------------------------------*
+ * Supported FFT sizes.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_SPECTRUM_MIN_SIZE 256
+#define AUDIO_SPECTRUM_MAX_SIZE 16384
+
+typedef struct audio_spectrum audio_spectrum_t;
+
+/**-----------------------------------------------------------------------------
+ * Create a new spectrum analyser.
+ *
+ * @param fft_size      FFT size: a power of two between AUDIO_SPECTRUM_MIN_SIZE
+ *                      and AUDIO_SPECTRUM_MAX_SIZE.
+ * @param hop_size      Frames between the starts of consecutive analysis
+ *                      frames. fft_size / 4 gives 75% overlap.
+ * @param buffer_size   Frames of input buffered between the audio thread and
+ *                      the worker. Input that arrives while the buffer is
+ *                      full is dropped.
+ * @return A new analyser, or NULL if the sizes are invalid or memory could
+ *         not be allocated.
+ *----------------------------------------------------------------------------*/
+audio_spectrum_t *audio_spectrum_create(int fft_size, int hop_size, int buffer_size);
+
+/**-----------------------------------------------------------------------------
+ * Free an analyser. No other call may be in progress.
+ *----------------------------------------------------------------------------*/
+void audio_spectrum_destroy(audio_spectrum_t *spectrum);
+
+/**-----------------------------------------------------------------------------
+ * Queue a block of input for analysis. Realtime-safe.
+ * Must only be called from one thread.
+ *----------------------------------------------------------------------------*/
+void audio_spectrum_write(audio_spectrum_t *spectrum, const float *samples, int num_frames);
+
+/**-----------------------------------------------------------------------------
+ * Analyse all complete frames of queued input, publishing the spectrum of
+ * the most recent. Must only be called from one (worker) thread.
+ *
+ * @return The number of frames analysed.
+ *----------------------------------------------------------------------------*/
+int audio_spectrum_analyse(audio_spectrum_t *spectrum);
+
+/**-----------------------------------------------------------------------------
+ * Copy the most recently published spectrum into `magnitudes`, which must
+ * hold AUDIO_SPECTRUM_BINS(fft_size) values. Never blocks.
+ * Must only be called from one thread.
+ *
+ * @return Nonzero if a new spectrum has been published since the last read.
+ *----------------------------------------------------------------------------*/
+int audio_spectrum_read(audio_spectrum_t *spectrum, float *magnitudes);
+
+/**-----------------------------------------------------------------------------
+ * Returns the FFT size.
+ *----------------------------------------------------------------------------*/
+int audio_spectrum_size(audio_spectrum_t *spectrum);
+
+/**-----------------------------------------------------------------------------
+ * Returns the total number of frames analysed, and the number of input
+ * samples dropped because the worker fell behind.
+ *----------------------------------------------------------------------------*/
+uint64_t audio_spectrum_frames_analysed(audio_spectrum_t *spectrum);
+uint64_t audio_spectrum_samples_dropped(audio_spectrum_t *spectrum);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,102 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOStressTest
+ *
+ *  Drives an AudioIOManager against AudioIOMockBackend, firing storms of
+ *  route changes, interruptions and foreground events while it renders,
+ *  as happens when a Bluetooth device connects during a phone call.
+ *
+ *  Each storm is a burst of randomly chosen, randomly spaced events,
+ *  sometimes far enough apart for a reconfiguration to start mid-storm.
+ *  Every storm ends with an interruption and its end, so that audio is
+ *  stopped, and must be restored by the manager. The time from the last
+ *  event of the storm to the first render that follows is measured.
+ *
+ *  Once the storms are over, the mock's output is looped back to its
+ *  input with a known delay, and the manager's latency measurement must
+ *  find that delay.
+ *
+ *  The test passes if audio is restored after every storm, the mock saw
+ *  no lifecycle violations, and the latency measured was right.
+ *
+ *  Only one AudioIOManager may exist at a time, so no other manager may be
+ *  running while the test is.
+ *
+ *  Example usage:
+ *
+ *  AudioIOStressTest *test = [AudioIOStressTest new];
+ *  [test runWithCompletion:^(BOOL passed) {
+ *      NSLog(@"%@", test);
+ *      NSAssert(passed, @"Stress test passed");
+ *  }];
+ *
+ *----------------------------------------------------------------------------*/
+
+#import <Foundation/Foundation.h>
+#import "AudioIOManager.h"
+#import "AudioIOMockBackend.h"
+
+@interface AudioIOStressTest : NSObject
+
+/**-----------------------------------------------------------------------------
+ * Number of storms fired. Defaults to 20.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSUInteger storms;
+
+/**-----------------------------------------------------------------------------
+ * Number of events in each storm. Defaults to 50.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSUInteger eventsPerStorm;
+
+/**-----------------------------------------------------------------------------
+ * Longest gap between the events of a storm, in seconds. Defaults to
+ * 5ms. About one gap in ten is instead made longer than the manager's
+ * reconfigurationCoalescingInterval.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSTimeInterval maximumEventInterval;
+
+/**-----------------------------------------------------------------------------
+ * Time allowed for audio to be restored after each storm, in seconds.
+ * Defaults to 2.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSTimeInterval restoreTimeout;
+
+/**-----------------------------------------------------------------------------
+ * Seed for the choice and spacing of events, so that a failing run can be
+ * repeated. Defaults to 1.
+ *----------------------------------------------------------------------------*/
+@property (assign) uint32_t seed;
+
+/**-----------------------------------------------------------------------------
+ * Delay of the loopback used to check latency measurement, in frames at
+ * the client sample rate. Defaults to 300. Set to zero to skip the check.
+ *----------------------------------------------------------------------------*/
+@property (assign) NSUInteger loopbackDelay;
+
+/**-----------------------------------------------------------------------------
+ * The manager and mock under test. Their settings may be changed before
+ * the test is run.
+ *----------------------------------------------------------------------------*/
+@property (readonly) AudioIOManager *manager;
+@property (readonly) AudioIOMockBackend *backend;
+
+/**-----------------------------------------------------------------------------
+ * Start the manager, fire the storms from a background queue, and stop
+ * the manager again.
+ *
+ * @param completion Called on the main queue with YES if the test passed.
+ *----------------------------------------------------------------------------*/
+- (void) runWithCompletion:(void (^)(BOOL passed))completion;
+
+/**-----------------------------------------------------------------------------
+ * Results of the most recent run. Times are in seconds. measuredLatency
+ * is -1 if the measurement failed, and zero if it was skipped.
+ *----------------------------------------------------------------------------*/
+@property (readonly) NSUInteger eventsFired;
+@property (readonly) NSUInteger failedRestorations;
+@property (readonly) NSTimeInterval meanTimeToAudioRestored;
+@property (readonly) NSTimeInterval maximumTimeToAudioRestored;
+@property (readonly) NSUInteger stateViolations;
+@property (readonly) NSTimeInterval measuredLatency;
+
+@end
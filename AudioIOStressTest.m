@@ -0,0 +1,294 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOStressTest
+ *
+ *  Session event storms against AudioIOMockBackend.
+ *
+ *----------------------------------------------------------------------------*/
+
+#import "AudioIOStressTest.h"
+#import <QuartzCore/QuartzCore.h>
+
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+/*----------------------------------------------------------------------------*
+ * How often to check whether audio has been restored, in microseconds.
+ *----------------------------------------------------------------------------*/
+#define STRESS_POLL_INTERVAL_US 1000
+
+/*----------------------------------------------------------------------------*
+ * One gap in this many between events is made long enough for a
+ * reconfiguration to start.
+ *----------------------------------------------------------------------------*/
+#define STRESS_LONG_GAP_ODDS 10
+
+/*----------------------------------------------------------------------------*
+ * Largest error allowed in the measured latency, in frames, and time
+ * allowed for the measurement, in seconds.
+ *----------------------------------------------------------------------------*/
+#define STRESS_LATENCY_TOLERANCE 1.0
+#define STRESS_LATENCY_TIMEOUT 5.0
+
+typedef NS_ENUM(NSInteger, AudioIOStressEvent)
+{
+    AudioIOStressEventRouteChange,
+    AudioIOStressEventSampleRateChange,
+    AudioIOStressEventInterruptionBegan,
+    AudioIOStressEventInterruptionEnded,
+    AudioIOStressEventApplicationBecameActive,
+    AudioIOStressEventCount
+};
+
+static void stress_callback(float **samples, int num_channels, int num_frames, int samplerate)
+{
+    for (int c = 0; c < num_channels; c++)
+    {
+        memset(samples[c], 0, num_frames * sizeof(float));
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ * xorshift32: repeatable for a given seed, unlike arc4random().
+ *----------------------------------------------------------------------------*/
+static uint32_t stress_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+@interface AudioIOStressTest ()
+@property (readwrite) NSUInteger eventsFired;
+@property (readwrite) NSUInteger failedRestorations;
+@property (readwrite) NSTimeInterval meanTimeToAudioRestored;
+@property (readwrite) NSTimeInterval maximumTimeToAudioRestored;
+@property (readwrite) NSUInteger stateViolations;
+@property (readwrite) NSTimeInterval measuredLatency;
+@end
+
+@implementation AudioIOStressTest
+{
+    dispatch_queue_t    _queue;
+    uint32_t            _random;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (!self) return nil;
+
+    _backend = [AudioIOMockBackend new];
+    _manager = [[AudioIOManager alloc] initWithCallback:stress_callback];
+    _manager.backend = _backend;
+    _queue = dispatch_queue_create("AudioIOStressTest", DISPATCH_QUEUE_SERIAL);
+
+    self.storms = 20;
+    self.eventsPerStorm = 50;
+    self.maximumEventInterval = 0.005;
+    self.restoreTimeout = 2.0;
+    self.seed = 1;
+    self.loopbackDelay = 300;
+
+    return self;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"%lu events in %lu storms: audio restored in %.1fms on average, %.1fms at most; "
+                                      @"%lu restorations failed, %lu state violations; latency measured as %.2fms",
+            (unsigned long) self.eventsFired, (unsigned long) self.storms,
+            self.meanTimeToAudioRestored * 1000, self.maximumTimeToAudioRestored * 1000,
+            (unsigned long) self.failedRestorations, (unsigned long) self.stateViolations,
+            self.measuredLatency * 1000];
+}
+
+- (void)runWithCompletion:(void (^)(BOOL passed))completion
+{
+    dispatch_async(_queue, ^{
+        BOOL passed = [self run];
+        if (completion)
+        {
+            dispatch_async(dispatch_get_main_queue(), ^{ completion(passed); });
+        }
+    });
+}
+
+- (BOOL)run
+{
+    _random = self.seed ? self.seed : 1;
+    self.eventsFired = 0;
+    self.failedRestorations = 0;
+    self.meanTimeToAudioRestored = 0;
+    self.maximumTimeToAudioRestored = 0;
+    self.measuredLatency = 0;
+
+    NSUInteger violationsBefore = self.backend.stateViolations;
+    NSTimeInterval totalTime = 0;
+    NSUInteger restorations = 0;
+
+    OSStatus err = [self.manager start];
+    if (err)
+    {
+        NSLog(@"AudioIOStressTest: couldn't start audio: %d", (int) err);
+        return NO;
+    }
+
+    for (NSUInteger storm = 0; storm < self.storms; storm++)
+    {
+        CFTimeInterval end = [self fireStorm];
+        NSUInteger reconfigurations = self.manager.reconfigurationsPerformed;
+
+        NSTimeInterval time = [self waitForAudioRestoredAfter:end reconfigurations:reconfigurations];
+        if (time < 0)
+        {
+            NSLog(@"AudioIOStressTest: audio not restored after storm %lu", (unsigned long) storm);
+            self.failedRestorations++;
+            continue;
+        }
+
+        totalTime += time;
+        restorations++;
+        if (time > self.maximumTimeToAudioRestored)
+            self.maximumTimeToAudioRestored = time;
+    }
+
+    BOOL latencyCorrect = self.loopbackDelay ? [self checkLatency] : YES;
+
+    [self.manager stop];
+
+    self.meanTimeToAudioRestored = restorations ? totalTime / restorations : 0;
+    self.stateViolations = self.backend.stateViolations - violationsBefore;
+
+    return self.failedRestorations == 0 && self.stateViolations == 0 && latencyCorrect;
+}
+
+/*----------------------------------------------------------------------------*
+ * Loop the output back with a known delay, and check that the manager
+ * measures it.
+ *----------------------------------------------------------------------------*/
+- (BOOL)checkLatency
+{
+    self.backend.loopbackDelay = self.loopbackDelay;
+    self.backend.loopsBack = YES;
+
+    __block NSTimeInterval latency = -1;
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    [self.manager measureLatencyWithCompletion:^(NSTimeInterval measured) {
+        latency = measured;
+        dispatch_semaphore_signal(done);
+    }];
+    long timedOut = dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, (int64_t) (STRESS_LATENCY_TIMEOUT * NSEC_PER_SEC)));
+
+    self.backend.loopsBack = NO;
+    self.measuredLatency = timedOut ? -1 : latency;
+
+    double samplerate = self.manager.clientSampleRate;
+    double error = fabs(self.measuredLatency * samplerate - (double) self.loopbackDelay);
+    if (self.measuredLatency < 0 || error > STRESS_LATENCY_TOLERANCE)
+    {
+        NSLog(@"AudioIOStressTest: latency measured as %.1f frames, expected %lu",
+              self.measuredLatency * samplerate, (unsigned long) self.loopbackDelay);
+        return NO;
+    }
+    return YES;
+}
+
+/*----------------------------------------------------------------------------*
+ * Fire one storm of events. The last events always interrupt audio and
+ * end the interruption, so that audio must be restarted afterwards.
+ * Returns the time of the last event.
+ *----------------------------------------------------------------------------*/
+- (CFTimeInterval)fireStorm
+{
+    NSUInteger count = MAX(self.eventsPerStorm, 3);
+
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        AudioIOStressEvent event;
+        if (i == count - 3)
+            event = AudioIOStressEventInterruptionBegan;
+        else if (i == count - 2)
+            event = AudioIOStressEventInterruptionEnded;
+        else if (i == count - 1)
+            event = AudioIOStressEventApplicationBecameActive;
+        else
+            event = stress_random(&_random) % AudioIOStressEventCount;
+
+        [self fireEvent:event];
+        self.eventsFired++;
+
+        if (i < count - 1)
+        {
+            NSTimeInterval gap;
+            if (stress_random(&_random) % STRESS_LONG_GAP_ODDS == 0)
+                gap = self.manager.reconfigurationCoalescingInterval * 1.5;
+            else
+                gap = self.maximumEventInterval * (stress_random(&_random) % 1000) / 1000.0;
+            usleep((useconds_t) (gap * 1e6));
+        }
+    }
+
+    return CACurrentMediaTime();
+}
+
+- (void)fireEvent:(AudioIOStressEvent)event
+{
+    switch (event)
+    {
+        case AudioIOStressEventRouteChange:
+        {
+            static const AVAudioSessionRouteChangeReason reasons[] = {
+                AVAudioSessionRouteChangeReasonNewDeviceAvailable,
+                AVAudioSessionRouteChangeReasonOldDeviceUnavailable,
+                AVAudioSessionRouteChangeReasonOverride,
+                AVAudioSessionRouteChangeReasonCategoryChange
+            };
+            [self.backend simulateRouteChange:reasons[stress_random(&_random) % 4]];
+            break;
+        }
+
+        case AudioIOStressEventSampleRateChange:
+            self.backend.hardwareSampleRate = (self.backend.hardwareSampleRate == 48000) ? 44100 : 48000;
+            [self.backend simulateRouteChange:AVAudioSessionRouteChangeReasonNewDeviceAvailable];
+            break;
+
+        case AudioIOStressEventInterruptionBegan:
+            [self.backend simulateInterruptionBegan];
+            break;
+
+        case AudioIOStressEventInterruptionEnded:
+            [self.backend simulateInterruptionEnded];
+            break;
+
+        case AudioIOStressEventApplicationBecameActive:
+        default:
+            [self.backend simulateApplicationBecameActive];
+            break;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ * Wait for the reconfiguration that follows a storm, which is held back
+ * by the coalescing interval so won't have started yet, and for the first
+ * render after it restarts the unit. Returns the time from the end of the
+ * storm to that render, or -1 on timeout.
+ *----------------------------------------------------------------------------*/
+- (NSTimeInterval)waitForAudioRestoredAfter:(CFTimeInterval)end reconfigurations:(NSUInteger)reconfigurations
+{
+    while (CACurrentMediaTime() - end < self.restoreTimeout)
+    {
+        CFTimeInterval firstRender = self.backend.lastFirstRenderTime;
+        if (self.manager.reconfigurationsPerformed > reconfigurations && self.backend.isRunning && firstRender > end)
+        {
+            return firstRender - end;
+        }
+        usleep(STRESS_POLL_INTERVAL_US);
+    }
+    return -1;
+}
+
+@end
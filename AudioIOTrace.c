@@ -0,0 +1,349 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOTrace
+ *
+ *  Per-thread event rings, exported as Chrome trace event JSON.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOTrace.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+#define TRACE_THREAD_NAME_SIZE 64
+
+typedef struct
+{
+    uint64_t    time;
+    const char *name;
+    double      value;
+    uint32_t    type;
+} trace_event_t;
+
+/*----------------------------------------------------------------------------*
+ * States of a ring. A ring is released when its thread exits, but keeps
+ * its events for export until another thread needs it.
+ *----------------------------------------------------------------------------*/
+enum
+{
+    TRACE_RING_FREE = 0,
+    TRACE_RING_OWNED,
+    TRACE_RING_RELEASED
+};
+
+/*----------------------------------------------------------------------------*
+ * One thread's ring. `write` counts the events ever written; the ring
+ * holds the most recent `trace_capacity` of them.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    atomic_int              owned;
+    atomic_uint_least64_t   write;
+    atomic_uint_least64_t   thread_id;
+    char                    thread_name[TRACE_THREAD_NAME_SIZE];
+    trace_event_t          *events;
+} trace_ring_t;
+
+static trace_ring_t             trace_rings[AUDIO_TRACE_MAX_THREADS];
+static size_t                   trace_capacity;
+static uint64_t                 trace_start_time;
+static atomic_int               trace_recording;
+static atomic_uint              trace_generation;
+static atomic_uint_least64_t    trace_dropped;
+
+/*----------------------------------------------------------------------------*
+ * Holds each thread's ring, so that it is released when the thread exits.
+ * Without this, short-lived threads such as dispatch workers would use up
+ * every ring long before the trace is stopped.
+ *----------------------------------------------------------------------------*/
+static pthread_key_t            trace_ring_key;
+static pthread_once_t           trace_ring_key_once = PTHREAD_ONCE_INIT;
+
+/*----------------------------------------------------------------------------*
+ * The calling thread's ring, and the start it was claimed in. Threads
+ * claim a new ring after each start.
+ *----------------------------------------------------------------------------*/
+static _Thread_local trace_ring_t  *trace_thread_ring;
+static _Thread_local unsigned int   trace_thread_generation;
+
+static inline uint64_t trace_now(void)
+{
+#ifdef __APPLE__
+    return mach_absolute_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static uint64_t trace_thread_id(void)
+{
+#ifdef __APPLE__
+    uint64_t thread_id = 0;
+    pthread_threadid_np(NULL, &thread_id);
+    return thread_id;
+#else
+    return (uint64_t) pthread_self();
+#endif
+}
+
+/*----------------------------------------------------------------------------*
+ * Release the exiting thread's ring, unless a later start has already
+ * given it to another thread.
+ *----------------------------------------------------------------------------*/
+static void trace_release_ring(void *value)
+{
+    trace_ring_t *ring = value;
+    if (atomic_load(&ring->thread_id) != trace_thread_id())
+        return;
+
+    int expected = TRACE_RING_OWNED;
+    atomic_compare_exchange_strong(&ring->owned, &expected, TRACE_RING_RELEASED);
+}
+
+static void trace_create_ring_key(void)
+{
+    pthread_key_create(&trace_ring_key, trace_release_ring);
+}
+
+static double trace_ticks_to_microseconds(uint64_t ticks)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    return (double) ticks * timebase.numer / timebase.denom / 1000.0;
+#else
+    return (double) ticks / 1000.0;
+#endif
+}
+
+int audio_trace_start(int events_per_thread)
+{
+    atomic_store(&trace_recording, 0);
+    pthread_once(&trace_ring_key_once, trace_create_ring_key);
+
+    if (!trace_capacity)
+    {
+        size_t capacity = 1;
+        while (capacity < (size_t) (events_per_thread > 0 ? events_per_thread : AUDIO_TRACE_DEFAULT_EVENTS))
+            capacity <<= 1;
+
+        for (int i = 0; i < AUDIO_TRACE_MAX_THREADS; i++)
+        {
+            /*----------------------------------------------------------------*
+             * Touch every page now, so that the first events recorded on
+             * the audio thread don't fault.
+             *---------------------------------------------------------------*/
+            trace_rings[i].events = malloc(capacity * sizeof(trace_event_t));
+            if (!trace_rings[i].events)
+            {
+                for (int j = 0; j < i; j++)
+                {
+                    free(trace_rings[j].events);
+                    trace_rings[j].events = NULL;
+                }
+                return -1;
+            }
+            memset(trace_rings[i].events, 0, capacity * sizeof(trace_event_t));
+        }
+        trace_capacity = capacity;
+    }
+
+    for (int i = 0; i < AUDIO_TRACE_MAX_THREADS; i++)
+    {
+        atomic_store(&trace_rings[i].write, 0);
+        atomic_store(&trace_rings[i].owned, TRACE_RING_FREE);
+    }
+    atomic_store(&trace_dropped, 0);
+    trace_start_time = trace_now();
+
+    atomic_fetch_add(&trace_generation, 1);
+    atomic_store(&trace_recording, 1);
+    return 0;
+}
+
+void audio_trace_stop(void)
+{
+    atomic_store(&trace_recording, 0);
+}
+
+/*----------------------------------------------------------------------------*
+ * Claim a ring for the calling thread, or return NULL if there is none
+ * left. Free rings are taken first, so that the events of exited threads
+ * are only discarded once no other ring is left.
+ *----------------------------------------------------------------------------*/
+static trace_ring_t *trace_claim_ring(void)
+{
+    static const int states[] = { TRACE_RING_FREE, TRACE_RING_RELEASED };
+
+    for (int s = 0; s < 2; s++)
+    {
+        for (int i = 0; i < AUDIO_TRACE_MAX_THREADS; i++)
+        {
+            trace_ring_t *ring = &trace_rings[i];
+            int expected = states[s];
+            if (atomic_compare_exchange_strong(&ring->owned, &expected, TRACE_RING_OWNED))
+            {
+                atomic_store(&ring->write, 0);
+                atomic_store(&ring->thread_id, trace_thread_id());
+                ring->thread_name[0] = '\0';
+                pthread_getname_np(pthread_self(), ring->thread_name, TRACE_THREAD_NAME_SIZE);
+                pthread_setspecific(trace_ring_key, ring);
+                return ring;
+            }
+        }
+    }
+    return NULL;
+}
+
+void audio_trace_record(audio_trace_event_type_t type, const char *name, double value)
+{
+    if (!atomic_load_explicit(&trace_recording, memory_order_relaxed))
+        return;
+
+    unsigned int generation = atomic_load_explicit(&trace_generation, memory_order_acquire);
+    if (trace_thread_generation != generation || !trace_thread_ring)
+    {
+        trace_thread_ring = trace_claim_ring();
+        trace_thread_generation = generation;
+    }
+
+    trace_ring_t *ring = trace_thread_ring;
+    if (!ring)
+    {
+        atomic_fetch_add_explicit(&trace_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint64_t index = atomic_load_explicit(&ring->write, memory_order_relaxed);
+    trace_event_t *event = &ring->events[index & (trace_capacity - 1)];
+    event->time = trace_now();
+    event->name = name;
+    event->value = value;
+    event->type = type;
+    atomic_store_explicit(&ring->write, index + 1, memory_order_release);
+}
+
+uint64_t audio_trace_dropped(void)
+{
+    return atomic_load_explicit(&trace_dropped, memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Export
+////////////////////////////////////////////////////////////////////////////////
+
+static void trace_write_string(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (const char *c = string; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', file);
+        if ((unsigned char) *c >= 0x20)
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+/*----------------------------------------------------------------------------*
+ * Write one ring's events, oldest first. A thread may still be writing,
+ * so the write count is read again after copying, and any event it may
+ * have overwritten meanwhile is left out.
+ *----------------------------------------------------------------------------*/
+static void trace_write_ring(FILE *file, trace_ring_t *ring, int tid, trace_event_t *copy, int *first)
+{
+    uint64_t end = atomic_load_explicit(&ring->write, memory_order_acquire);
+    uint64_t start = end > trace_capacity ? end - trace_capacity : 0;
+
+    for (uint64_t i = start; i < end; i++)
+        copy[i - start] = ring->events[i & (trace_capacity - 1)];
+
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t written = atomic_load_explicit(&ring->write, memory_order_relaxed);
+    uint64_t valid = written + 1 > trace_capacity ? written + 1 - trace_capacity : 0;
+    if (valid < start)
+        valid = start;
+
+    static const char phases[] = { 'B', 'E', 'i', 'C' };
+
+    for (uint64_t i = valid; i < end; i++)
+    {
+        trace_event_t *event = &copy[i - start];
+        if (event->type > AUDIO_TRACE_EVENT_COUNTER || !event->name)
+            continue;
+
+        double ts = event->time >= trace_start_time ? trace_ticks_to_microseconds(event->time - trace_start_time) : 0;
+        fprintf(file, "%s\n{\"name\":", *first ? "" : ",");
+        trace_write_string(file, event->name);
+        fprintf(file, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", phases[event->type], ts, tid);
+
+        if (event->type == AUDIO_TRACE_EVENT_INSTANT)
+            fprintf(file, ",\"s\":\"t\"");
+        else if (event->type == AUDIO_TRACE_EVENT_COUNTER)
+            fprintf(file, ",\"args\":{\"value\":%.9g}", event->value);
+
+        fputc('}', file);
+        *first = 0;
+    }
+}
+
+int audio_trace_write_json(const char *path)
+{
+    if (!trace_capacity)
+        return -1;
+
+    trace_event_t *copy = malloc(trace_capacity * sizeof(trace_event_t));
+    FILE *file = copy ? fopen(path, "w") : NULL;
+    if (!file)
+    {
+        free(copy);
+        return -1;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    int first = 1;
+
+    for (int i = 0; i < AUDIO_TRACE_MAX_THREADS; i++)
+    {
+        trace_ring_t *ring = &trace_rings[i];
+        if (atomic_load_explicit(&ring->owned, memory_order_acquire) == TRACE_RING_FREE)
+            continue;
+
+        /*--------------------------------------------------------------------*
+         * Name the thread's track, by its own name if it has one.
+         *-------------------------------------------------------------------*/
+        char name[TRACE_THREAD_NAME_SIZE + 32];
+        if (ring->thread_name[0])
+            snprintf(name, sizeof(name), "%s", ring->thread_name);
+        else
+            snprintf(name, sizeof(name), "Thread %llu", (unsigned long long) atomic_load(&ring->thread_id));
+
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",", i + 1);
+        trace_write_string(file, name);
+        fprintf(file, "}}");
+        first = 0;
+
+        trace_write_ring(file, ring, i + 1, copy, &first);
+    }
+
+    fprintf(file, "\n]}\n");
+    free(copy);
+
+    return fclose(file) == 0 ? 0 : -1;
+}
@@ -0,0 +1,121 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOTrace
+ *
+ *  Lightweight event tracing, for seeing audio callbacks, worker jobs and
+ *  session events on one timeline when diagnosing glitches.
+ *
+ *  Each thread that records an event claims its own ring of events, so
+ *  recording takes no locks and never contends with other threads: it
+ *  reads the clock and writes one entry. Rings are allocated up front by
+ *  audio_trace_start(), so recording is also safe on the audio thread.
+ *  When a ring is full, its oldest events are overwritten.
+ *
+ *  A thread's ring is released when the thread exits, so that transient
+ *  threads such as dispatch workers don't use up the rings. A released
+ *  ring keeps its events for export until another thread claims it, which
+ *  happens only once no unused ring is left.
+ *
+ *  Traces are exported in the Chrome trace event JSON format, which can be
+ *  opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ *  Events are recorded with the AUDIO_TRACE_* macros, whose names must be
+ *  string literals. Build with AUDIO_TRACE_ENABLED defined to 0 to compile
+ *  them out entirely.
+ *
+ *  Example usage:
+ *
+ *  audio_trace_start(AUDIO_TRACE_DEFAULT_EVENTS);
+ *  ...
+ *  AUDIO_TRACE_BEGIN("render");
+ *  ...
+ *  AUDIO_TRACE_END("render");
+ *  ...
+ *  audio_trace_stop();
+ *  audio_trace_write_json("/path/to/trace.json");
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_TRACE_H
+#define AUDIO_IO_TRACE_H
+
+#include <stdint.h>
+
+#ifndef AUDIO_TRACE_ENABLED
+#define AUDIO_TRACE_ENABLED 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Largest number of threads traced at once; events from further threads
+ * are dropped until a traced thread exits. Default number of events kept
+ * per thread.
+ *----------------------------------------------------------------------------*/
+#define AUDIO_TRACE_MAX_THREADS 16
+#define AUDIO_TRACE_DEFAULT_EVENTS 8192
+
+typedef enum
+{
+    AUDIO_TRACE_EVENT_BEGIN = 0,
+    AUDIO_TRACE_EVENT_END,
+    AUDIO_TRACE_EVENT_INSTANT,
+    AUDIO_TRACE_EVENT_COUNTER
+} audio_trace_event_type_t;
+
+/**-----------------------------------------------------------------------------
+ * Start recording, discarding any events previously recorded. The first
+ * start allocates the rings, with room for `events_per_thread` events
+ * each (rounded up to a power of two); later starts reuse them. Not
+ * realtime-safe.
+ *
+ * @returns 0 on success, or -1 if memory could not be allocated.
+ *----------------------------------------------------------------------------*/
+int audio_trace_start(int events_per_thread);
+
+/**-----------------------------------------------------------------------------
+ * Stop recording. Recorded events are kept until the next start.
+ *----------------------------------------------------------------------------*/
+void audio_trace_stop(void);
+
+/**-----------------------------------------------------------------------------
+ * Record an event on the calling thread's ring, if recording. `name`
+ * must outlive the trace. `value` is used by counter events only.
+ * Realtime-safe; use the macros below rather than calling directly.
+ *----------------------------------------------------------------------------*/
+void audio_trace_record(audio_trace_event_type_t type, const char *name, double value);
+
+/**-----------------------------------------------------------------------------
+ * Write the recorded events to a file in Chrome trace event JSON format.
+ * Best called after audio_trace_stop(); events overwritten during the
+ * export are left out. Not realtime-safe.
+ *
+ * @returns 0 on success, or -1 if the file could not be written.
+ *----------------------------------------------------------------------------*/
+int audio_trace_write_json(const char *path);
+
+/**-----------------------------------------------------------------------------
+ * Returns the number of events dropped since the last start because
+ * AUDIO_TRACE_MAX_THREADS live threads were already being traced.
+ *----------------------------------------------------------------------------*/
+uint64_t audio_trace_dropped(void);
+
+#if AUDIO_TRACE_ENABLED
+#define AUDIO_TRACE_BEGIN(name)             audio_trace_record(AUDIO_TRACE_EVENT_BEGIN, name, 0)
+#define AUDIO_TRACE_END(name)               audio_trace_record(AUDIO_TRACE_EVENT_END, name, 0)
+#define AUDIO_TRACE_INSTANT(name)           audio_trace_record(AUDIO_TRACE_EVENT_INSTANT, name, 0)
+#define AUDIO_TRACE_COUNTER(name, value)    audio_trace_record(AUDIO_TRACE_EVENT_COUNTER, name, value)
+#else
+#define AUDIO_TRACE_BEGIN(name)             ((void) 0)
+#define AUDIO_TRACE_END(name)               ((void) 0)
+#define AUDIO_TRACE_INSTANT(name)           ((void) 0)
+#define AUDIO_TRACE_COUNTER(name, value)    ((void) 0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,24 +7,31 @@
 //
 
 #include <stdio.h>
-#include <math.h>
+#include <string.h>
+#include "AudioIOOscillator.h"
 
-static int pos = 0;
+static audio_oscillator_bank_t *oscillators = NULL;
 
 void audio_callback(float **samples, int num_channels, int num_frames, int samplerate)
 {
-    for (int c = 0; c < num_channels; c++)
+    memset(samples[0], 0, num_frames * sizeof(float));
+    audio_oscillator_bank_render(oscillators, samples[0], num_frames, samplerate);
+    
+    for (int c = 1; c < num_channels; c++)
     {
-        for (int i = 0; i < num_frames; i++)
-        {
-            samples[c][i] = sin(M_PI * 2.0 * 880.0 * pos++ / samplerate);
-            
-        }
+        memcpy(samples[c], samples[0], num_frames * sizeof(float));
     }
     // fprintf(stderr, "audio_callback, %d frames\n", num_frames);
 }
 
 #import "ViewController.h"
+#import "AudioIOStressTest.h"
+
+/*----------------------------------------------------------------------------*
+ * Time each direction runs for in the direction benchmark: long enough for
+ * the load meter's smoothing to settle.
+ *----------------------------------------------------------------------------*/
+static const NSTimeInterval kDirectionBenchmarkDuration = 5.0;
 
 @interface ViewController ()
 
@@ -36,9 +43,36 @@ void audio_callback(float **samples, int num_channels, int num_frames, int sampl
 {
     [super viewDidLoad];
     
+    /*----------------------------------------------------------------------------*
+     * Launch with -AudioIOStressTest to run the session event stress test
+     * against the mock backend instead. Only one manager may exist at a
+     * time, so the example's own audio isn't started.
+     *----------------------------------------------------------------------------*/
+    if ([[NSProcessInfo processInfo].arguments containsObject:@"-AudioIOStressTest"])
+    {
+        [self runStressTest];
+        return;
+    }
+    
+    oscillators = audio_oscillator_bank_create(AUDIO_OSCILLATOR_SINE, 1, 4096);
+    audio_oscillator_set(oscillators, 0, 880.0, 1.0);
+    
+    /*----------------------------------------------------------------------------*
+     * Launch with -AudioIODirectionBenchmark to measure what output-only
+     * saves per block, by skipping AudioUnitRender, on this device.
+     *----------------------------------------------------------------------------*/
+    if ([[NSProcessInfo processInfo].arguments containsObject:@"-AudioIODirectionBenchmark"])
+    {
+        [self runDirectionBenchmark];
+        return;
+    }
+    
     self.audioIO = [[AudioIOManager alloc] initWithCallback:audio_callback];
     self.audioIO.routeToSpeaker = YES;
-    [self.audioIO start];
+    [self.audioIO startWithCompletion:^(OSStatus error) {
+        if (error)
+            NSLog(@"Couldn't start audio: %d", (int) error);
+    }];
     
     UITapGestureRecognizer *tapGestureRecognizer =
     [[UITapGestureRecognizer alloc] initWithTarget:self
@@ -46,6 +80,68 @@ void audio_callback(float **samples, int num_channels, int num_frames, int sampl
     [self.view addGestureRecognizer:tapGestureRecognizer];
 }
 
+- (void)runStressTest
+{
+    AudioIOStressTest *test = [AudioIOStressTest new];
+    [test runWithCompletion:^(BOOL passed) {
+        NSLog(@"Stress test %@: %@", passed ? @"passed" : @"FAILED", test);
+        NSAssert(test.stateViolations == 0, @"No lifecycle violations");
+        NSAssert(passed, @"Audio restored after every storm");
+    }];
+}
+
+/*----------------------------------------------------------------------------*
+ * Run the example's audio in duplex, then output-only, and compare the
+ * time per block of the input stage, which pulls the input in duplex.
+ *----------------------------------------------------------------------------*/
+- (void)runDirectionBenchmark
+{
+    self.audioIO = [[AudioIOManager alloc] initWithCallback:audio_callback];
+    self.audioIO.measuresLoad = YES;
+    
+    NSArray<NSNumber *> *directions = @[ @(AudioIODirectionDuplex), @(AudioIODirectionOutputOnly) ];
+    [self measureInputStageForDirections:directions results:[NSMutableArray array]];
+}
+
+- (void)measureInputStageForDirections:(NSArray<NSNumber *> *)directions
+                               results:(NSMutableArray<NSNumber *> *)results
+{
+    if (results.count == directions.count)
+    {
+        double duplex = results[0].doubleValue;
+        double outputOnly = results[1].doubleValue;
+        NSLog(@"Input stage per block: duplex %.1fus, output-only %.1fus, saving %.1fus",
+              duplex * 1e6, outputOnly * 1e6, (duplex - outputOnly) * 1e6);
+        return;
+    }
+    
+    AudioIOManager *audioIO = self.audioIO;
+    AudioIODirection direction = (AudioIODirection) directions[results.count].integerValue;
+    [audioIO teardown];
+    audioIO.direction = direction;
+    
+    [audioIO startWithCompletion:^(OSStatus error) {
+        if (error)
+        {
+            NSLog(@"Couldn't start audio: %d", (int) error);
+            return;
+        }
+        
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t) (kDirectionBenchmarkDuration * NSEC_PER_SEC)),
+                       dispatch_get_main_queue(), ^{
+            audio_load_snapshot_t load = audioIO.dspLoad;
+            double period = (double) audioIO.bufferSize / audioIO.sampleRate;
+            NSLog(@"Direction %d: %lu frame blocks, load %.1f%%, input stage %.1f%%",
+                  (int) direction, (unsigned long) audioIO.bufferSize, load.load * 100.0,
+                  load.stages[AudioIOLoadStageInput] * 100.0);
+            
+            [results addObject:@(load.stages[AudioIOLoadStageInput] * period)];
+            [audioIO stop];
+            [self measureInputStageForDirections:directions results:results];
+        });
+    }];
+}
+
 - (void)togglePlayback
 {
     if (self.audioIO.isStarted)
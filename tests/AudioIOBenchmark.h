@@ -0,0 +1,74 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOBenchmark
+ *
+ *  Timing helpers shared by the benchmarks.
+ *
+ *  Each benchmark repeats an operation until a minimum time has passed,
+ *  and reports the mean time per repetition. Results are written to a
+ *  volatile sink, so that the compiler can't discard the work.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef AUDIO_IO_BENCHMARK_H
+#define AUDIO_IO_BENCHMARK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+/*----------------------------------------------------------------------------*
+ * Minimum time spent on each measurement, in seconds.
+ *----------------------------------------------------------------------------*/
+#define BENCHMARK_MIN_TIME 0.2
+
+/*----------------------------------------------------------------------------*
+ * Sample rate at which realtime budgets are judged.
+ *----------------------------------------------------------------------------*/
+#define BENCHMARK_SAMPLE_RATE 48000
+
+static volatile float benchmark_sink;
+
+/*----------------------------------------------------------------------------*
+ * Current time, in seconds, from a monotonic clock.
+ *----------------------------------------------------------------------------*/
+static inline double benchmark_now(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    return (double) mach_absolute_time() * timebase.numer / timebase.denom / 1e9;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#endif
+}
+
+/*----------------------------------------------------------------------------*
+ * Time a statement: run it until BENCHMARK_MIN_TIME has passed, and set
+ * `seconds` to the mean time per run.
+ *----------------------------------------------------------------------------*/
+#define BENCHMARK_TIME(seconds, statement)                                  \
+    do                                                                      \
+    {                                                                       \
+        long benchmark_runs_ = 0;                                           \
+        double benchmark_start_ = benchmark_now();                          \
+        double benchmark_elapsed_ = 0;                                      \
+        do                                                                  \
+        {                                                                   \
+            for (int benchmark_i_ = 0; benchmark_i_ < 16; benchmark_i_++)   \
+            {                                                               \
+                statement;                                                  \
+            }                                                               \
+            benchmark_runs_ += 16;                                          \
+            benchmark_elapsed_ = benchmark_now() - benchmark_start_;        \
+        } while (benchmark_elapsed_ < BENCHMARK_MIN_TIME);                  \
+        (seconds) = benchmark_elapsed_ / benchmark_runs_;                   \
+    } while (0)
+
+#endif
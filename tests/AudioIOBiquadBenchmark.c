@@ -0,0 +1,131 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOBiquadBenchmark
+ *
+ *  Filters per core for the biquad bank, across block sizes, against a
+ *  plain scalar biquad run one filter at a time. Also times the bank when
+ *  every filter is retuned each block, which ramps its coefficients.
+ *
+ *  "Per core" is the number of second-order sections one core could run
+ *  in real time at BENCHMARK_SAMPLE_RATE, with nothing else to do.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOBiquad.h"
+#include "AudioIOBenchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_NUM_FILTERS 64
+#define BENCH_MAX_BLOCK_SIZE 1024
+
+static float *inputs[BENCH_NUM_FILTERS];
+static float *outputs[BENCH_NUM_FILTERS];
+static audio_biquad_coefficients_t coefficients[BENCH_NUM_FILTERS];
+
+/*----------------------------------------------------------------------------*
+ * Transposed direct form II, one filter at a time: the usual way of
+ * writing a biquad.
+ *----------------------------------------------------------------------------*/
+typedef struct
+{
+    float s1;
+    float s2;
+} scalar_state_t;
+
+static scalar_state_t scalar_states[BENCH_NUM_FILTERS];
+
+static void scalar_process(int num_frames)
+{
+    for (int f = 0; f < BENCH_NUM_FILTERS; f++)
+    {
+        audio_biquad_coefficients_t c = coefficients[f];
+        float s1 = scalar_states[f].s1;
+        float s2 = scalar_states[f].s2;
+        const float *in = inputs[f];
+        float *out = outputs[f];
+
+        for (int i = 0; i < num_frames; i++)
+        {
+            float x = in[i];
+            float y = c.b0 * x + s1;
+            s1 = c.b1 * x - c.a1 * y + s2;
+            s2 = c.b2 * x - c.a2 * y;
+            out[i] = y;
+        }
+
+        scalar_states[f].s1 = s1;
+        scalar_states[f].s2 = s2;
+    }
+    benchmark_sink = outputs[0][0];
+}
+
+static void bank_process(audio_biquad_bank_t *bank, int num_frames)
+{
+    audio_biquad_bank_process(bank, (const float **) inputs, outputs, num_frames);
+    benchmark_sink = outputs[0][0];
+}
+
+static void bank_process_modulated(audio_biquad_bank_t *bank, int num_frames, int *block)
+{
+    float frequency = 500.0f + 100.0f * (float) (++*block & 7);
+    for (int f = 0; f < BENCH_NUM_FILTERS; f++)
+        audio_biquad_set(bank, f, 0, audio_biquad_design(AUDIO_BIQUAD_PEAK, frequency, 1.0f, 6.0f, BENCHMARK_SAMPLE_RATE));
+    bank_process(bank, num_frames);
+}
+
+static double sections_per_core(double seconds_per_block, int num_frames)
+{
+    double seconds_per_sample = seconds_per_block / ((double) num_frames * BENCH_NUM_FILTERS);
+    return 1.0 / (seconds_per_sample * BENCHMARK_SAMPLE_RATE);
+}
+
+int main(void)
+{
+    srand(1);
+    for (int f = 0; f < BENCH_NUM_FILTERS; f++)
+    {
+        inputs[f] = malloc(BENCH_MAX_BLOCK_SIZE * sizeof(float));
+        outputs[f] = malloc(BENCH_MAX_BLOCK_SIZE * sizeof(float));
+        for (int i = 0; i < BENCH_MAX_BLOCK_SIZE; i++)
+            inputs[f][i] = (float) rand() / RAND_MAX - 0.5f;
+        coefficients[f] = audio_biquad_design(AUDIO_BIQUAD_PEAK, 200.0f + 50.0f * f, 1.0f, 6.0f, BENCHMARK_SAMPLE_RATE);
+    }
+
+    audio_biquad_bank_t *bank = audio_biquad_bank_create(BENCH_NUM_FILTERS, 1);
+    for (int f = 0; f < BENCH_NUM_FILTERS; f++)
+        audio_biquad_set(bank, f, 0, coefficients[f]);
+    bank_process(bank, BENCH_MAX_BLOCK_SIZE);
+
+    printf("Biquad sections per core at %d Hz, %d filters of one section\n\n", BENCHMARK_SAMPLE_RATE, BENCH_NUM_FILTERS);
+    printf("%8s %12s %12s %12s %12s\n", "block", "bank", "scalar", "speedup", "modulated");
+
+    for (int num_frames = 16; num_frames <= BENCH_MAX_BLOCK_SIZE; num_frames *= 2)
+    {
+        double bank_time, scalar_time, modulated_time;
+        int block = 0;
+
+        BENCHMARK_TIME(bank_time, bank_process(bank, num_frames));
+        BENCHMARK_TIME(scalar_time, scalar_process(num_frames));
+        BENCHMARK_TIME(modulated_time, bank_process_modulated(bank, num_frames, &block));
+
+        printf("%8d %12.0f %12.0f %11.1fx %12.0f\n", num_frames,
+               sections_per_core(bank_time, num_frames),
+               sections_per_core(scalar_time, num_frames),
+               scalar_time / bank_time,
+               sections_per_core(modulated_time, num_frames));
+    }
+
+    audio_biquad_bank_destroy(bank);
+    for (int f = 0; f < BENCH_NUM_FILTERS; f++)
+    {
+        free(inputs[f]);
+        free(outputs[f]);
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOBufferControllerSimulation
+ *
+ *  Drives the adaptive buffer size offline, as the render callback does,
+ *  from a synthetic driver on a simulated clock. The driver resamples:
+ *  callbacks are at 44.1kHz, and their sample times at a 48kHz hardware
+ *  rate. Each block takes a fixed overhead plus a cost per frame; for a
+ *  while in the middle, random blocks also take a load spike. A block
+ *  that runs past its period makes the driver skip the period after it,
+ *  which the next callback's sample time shows.
+ *
+ *  Overruns are detected from the sample times with the period tracker,
+ *  and the controller is observed and updated as by AudioIOManager.
+ *  Checks that every skipped period, and nothing else, is detected; that
+ *  the buffer grows until the spikes fit; and that it shrinks back to the
+ *  smallest size once the load has gone.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOBufferController.h"
+#include "AudioIOPeriodTracker.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIM_SAMPLE_RATE 44100.0
+#define SIM_HARDWARE_RATE 48000.0
+#define SIM_DURATION 130.0
+#define SIM_UPDATE_INTERVAL 0.5
+
+/*----------------------------------------------------------------------------*
+ * Cost of a block: a fixed overhead and a cost per frame, with up to 10%
+ * jitter. Between SIM_LOAD_START and SIM_LOAD_END, a block takes an extra
+ * SIM_SPIKE seconds with probability SIM_SPIKE_CHANCE. A spike overruns
+ * 64 and 128 frame periods, but not 256 frame ones.
+ *----------------------------------------------------------------------------*/
+#define SIM_OVERHEAD 100e-6
+#define SIM_COST_PER_FRAME 2e-6
+#define SIM_LOAD_START 20.0
+#define SIM_LOAD_END 50.0
+#define SIM_SPIKE 3e-3
+#define SIM_SPIKE_CHANCE 0.01
+
+/*----------------------------------------------------------------------------*
+ * Time after the load ends by which the buffer should be back at its
+ * smallest size: one headroom period per halving, and some slack.
+ *----------------------------------------------------------------------------*/
+#define SIM_SETTLE_TIME 75.0
+
+static int failures;
+
+static double uniform(void)
+{
+    return (double) rand() / RAND_MAX;
+}
+
+static void check(const char *name, int ok)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+    failures += !ok;
+}
+
+int main(void)
+{
+    srand(1);
+
+    audio_buffer_controller_config_t config = audio_buffer_controller_config_default();
+    audio_buffer_controller_t *controller = audio_buffer_controller_create(config);
+    audio_period_tracker_t tracker = { 0 };
+
+    double now = 0;
+    double next_update = SIM_UPDATE_INTERVAL;
+    double sample_time = 0;
+    double sample_time_per_frame = SIM_HARDWARE_RATE / SIM_SAMPLE_RATE;
+    int frames = audio_buffer_controller_frames(controller);
+
+    long skipped = 0, detected = 0, late_overruns = 0;
+    int peak_frames = frames, settled_frames = 0;
+    double settled_at = -1;
+
+    printf("%8s %8s %10s\n", "time", "frames", "peak load");
+
+    while (now < SIM_DURATION)
+    {
+        /*--------------------------------------------------------------------*
+         * The callback: check its sample time for missed periods, render,
+         * and report the load.
+         *-------------------------------------------------------------------*/
+        int overran = audio_period_tracker_update(&tracker, sample_time, frames) > 0;
+        detected += overran;
+
+        double period = frames / SIM_SAMPLE_RATE;
+        double render_time = (SIM_OVERHEAD + SIM_COST_PER_FRAME * frames) * (1.0 + 0.1 * uniform());
+        if (now >= SIM_LOAD_START && now < SIM_LOAD_END && uniform() < SIM_SPIKE_CHANCE)
+            render_time += SIM_SPIKE;
+
+        audio_buffer_controller_observe(controller, (float) (render_time / period), overran);
+
+        if (overran && now >= SIM_LOAD_END - 10.0 && now < SIM_LOAD_END)
+            late_overruns++;
+
+        /*--------------------------------------------------------------------*
+         * The driver: if the block ran past its period, the next period
+         * is missed, and the stream resumes a period later.
+         *-------------------------------------------------------------------*/
+        int periods = 1;
+        if (render_time > period)
+        {
+            periods += (int) ceil(render_time / period) - 1;
+            skipped++;
+        }
+        now += periods * period;
+        sample_time += periods * frames * sample_time_per_frame;
+
+        /*--------------------------------------------------------------------*
+         * The control thread. A new buffer size takes effect from the next
+         * callback.
+         *-------------------------------------------------------------------*/
+        if (now >= next_update)
+        {
+            next_update += SIM_UPDATE_INTERVAL;
+            if (audio_buffer_controller_update(controller, now) != AUDIO_BUFFER_HOLD)
+            {
+                frames = audio_buffer_controller_frames(controller);
+                printf("%7.1fs %8d %10.2f\n", now, frames, audio_buffer_controller_peak_load(controller));
+            }
+            if (frames > peak_frames)
+                peak_frames = frames;
+            if (frames == config.min_frames && now > SIM_LOAD_END && settled_at < 0)
+                settled_at = now;
+            if (frames != config.min_frames)
+                settled_at = -1;
+            settled_frames = frames;
+        }
+    }
+
+    printf("\n%ld periods skipped, %ld overruns detected\n\n", skipped, detected);
+
+    /*------------------------------------------------------------------------*
+     * A block can only be skipped after the load starts, and the last
+     * skip is detected by the next callback, which always comes.
+     *-----------------------------------------------------------------------*/
+    check("every skipped period detected, and nothing else", skipped > 0 && detected == skipped);
+    check("buffer grew until the spikes fit", peak_frames >= 256 && late_overruns == 0);
+    check("buffer back at its smallest size once the load ended",
+          settled_frames == config.min_frames && settled_at >= 0 && settled_at - SIM_LOAD_END < SIM_SETTLE_TIME);
+
+    audio_buffer_controller_destroy(controller);
+
+    printf("%d failed\n", failures);
+    return failures ? 1 : 0;
+}
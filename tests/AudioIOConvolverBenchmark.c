@@ -0,0 +1,78 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOConvolverBenchmark
+ *
+ *  CPU cost of convolving one channel with impulse responses of 0.1s to
+ *  10s at BENCHMARK_SAMPLE_RATE, with the default configuration: the time
+ *  per head block on the audio thread, the time per tail block on the
+ *  worker, and their sum as a share of one core in realtime. The latency
+ *  added is one head block whatever the length.
+ *
+ *  Blocks are fed as fast as they are processed, so the worker may fall
+ *  behind and drop tail blocks; its time per block is still measured.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOConvolver.h"
+#include "AudioIOBenchmark.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_MAX_LENGTH (10 * BENCHMARK_SAMPLE_RATE)
+
+static const double lengths[] = { 0.1, 0.3, 1.0, 3.0, 10.0 };
+
+static float impulse_response[BENCH_MAX_LENGTH];
+static float buffer[AUDIO_CONVOLVER_MAX_BLOCK_SIZE];
+
+static void process_block(audio_convolver_t *convolver, int block_size)
+{
+    float *channels[1] = { buffer };
+    audio_convolver_process(convolver, channels, 1, block_size);
+    benchmark_sink = buffer[0];
+}
+
+int main(void)
+{
+    srand(1);
+    for (int i = 0; i < BENCH_MAX_LENGTH; i++)
+        impulse_response[i] = ((float) rand() / RAND_MAX - 0.5f) * expf(-3.0f * i / BENCH_MAX_LENGTH);
+
+    audio_convolver_config_t config = audio_convolver_config_default();
+    double head_period = (double) config.block_size / BENCHMARK_SAMPLE_RATE;
+    double tail_period = (double) config.tail_block_size / BENCHMARK_SAMPLE_RATE;
+
+    printf("Convolver: one channel at %d Hz, %d frame head blocks (%.1f ms latency), %d frame tail blocks\n\n",
+           BENCHMARK_SAMPLE_RATE, config.block_size, 1e3 * head_period, config.tail_block_size);
+    printf("%8s %8s %8s %10s %10s %10s\n", "IR", "head", "tail", "head us", "tail us", "core");
+
+    for (size_t n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++)
+    {
+        int length = (int) (lengths[n] * BENCHMARK_SAMPLE_RATE);
+        audio_convolver_t *convolver = audio_convolver_create(config, impulse_response, length, 1);
+
+        for (int i = 0; i < config.block_size; i++)
+            buffer[i] = (float) rand() / RAND_MAX - 0.5f;
+
+        double head_time;
+        BENCHMARK_TIME(head_time, process_block(convolver, config.block_size));
+
+        audio_convolver_stats_t stats = audio_convolver_stats(convolver);
+        int tail_partitions = audio_convolver_tail_partitions(convolver);
+        double core = head_time / head_period + stats.tail_block_time / tail_period;
+
+        printf("%7.1fs %8d %8d %10.1f %10.1f %9.2f%%\n", lengths[n],
+               audio_convolver_head_partitions(convolver), tail_partitions,
+               1e6 * head_time, 1e6 * stats.tail_block_time, 100.0 * core);
+
+        audio_convolver_destroy(convolver);
+    }
+
+    return 0;
+}
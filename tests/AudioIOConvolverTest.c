@@ -0,0 +1,102 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOConvolverTest
+ *
+ *  Convolves noise with random impulse responses, in calls of a size that
+ *  doesn't divide the block size, and checks the output against direct
+ *  convolution delayed by the convolver's latency. Covers responses
+ *  within the head alone and ones with a tail on the worker, which is
+ *  given time to keep up.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOConvolver.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_MAX_IR_LENGTH 6000
+#define TEST_NUM_FRAMES 16384
+#define TEST_CALL_FRAMES 100
+#define TEST_CHANNELS 2
+#define TEST_TOLERANCE 1e-4
+
+static float impulse_response[TEST_MAX_IR_LENGTH];
+static float input[TEST_CHANNELS][TEST_NUM_FRAMES];
+static float output[TEST_CHANNELS][TEST_NUM_FRAMES];
+static int failures;
+
+static void check(const char *name, int block_size, int tail_block_size, int ir_length)
+{
+    for (int i = 0; i < ir_length; i++)
+        impulse_response[i] = ((float) rand() / RAND_MAX - 0.5f) * expf(-4.0f * i / ir_length);
+    for (int c = 0; c < TEST_CHANNELS; c++)
+        for (int i = 0; i < TEST_NUM_FRAMES; i++)
+            output[c][i] = input[c][i] = (float) rand() / RAND_MAX - 0.5f;
+
+    audio_convolver_config_t config = { block_size, tail_block_size };
+    audio_convolver_t *convolver = audio_convolver_create(config, impulse_response, ir_length, TEST_CHANNELS);
+
+    /*------------------------------------------------------------------------*
+     * Wait a little after each call, as the audio thread would for the
+     * next period, so that the worker is never late.
+     *-----------------------------------------------------------------------*/
+    struct timespec pause = { 0, 200000 };
+    for (int done = 0; done < TEST_NUM_FRAMES; done += TEST_CALL_FRAMES)
+    {
+        int num_frames = TEST_NUM_FRAMES - done < TEST_CALL_FRAMES ? TEST_NUM_FRAMES - done : TEST_CALL_FRAMES;
+        float *channels[TEST_CHANNELS];
+        for (int c = 0; c < TEST_CHANNELS; c++)
+            channels[c] = output[c] + done;
+        audio_convolver_process(convolver, channels, TEST_CHANNELS, num_frames);
+        nanosleep(&pause, NULL);
+    }
+
+    int latency = audio_convolver_latency(convolver);
+    double error = 0, peak = 0;
+    for (int c = 0; c < TEST_CHANNELS; c++)
+    {
+        for (int i = 0; i < TEST_NUM_FRAMES; i++)
+        {
+            double expected = 0;
+            for (int j = 0; j < ir_length && j <= i - latency; j++)
+                expected += (double) impulse_response[j] * input[c][i - latency - j];
+            error = fmax(error, fabs(output[c][i] - expected));
+            peak = fmax(peak, fabs(expected));
+        }
+    }
+
+    audio_convolver_stats_t stats = audio_convolver_stats(convolver);
+    int ok = error / peak < TEST_TOLERANCE && stats.late_blocks == 0;
+    printf("%s: %s (%d head, %d tail partitions, error %.1e, %llu late)\n",
+           ok ? "PASS" : "FAIL", name,
+           audio_convolver_head_partitions(convolver), audio_convolver_tail_partitions(convolver),
+           error / peak, (unsigned long long) stats.late_blocks);
+    failures += !ok;
+
+    audio_convolver_destroy(convolver);
+}
+
+int main(void)
+{
+    srand(1);
+
+    check("head only", 64, 256, 300);
+    check("head and tail", 64, 256, TEST_MAX_IR_LENGTH);
+    check("head and tail, equal block sizes", 128, 128, 1000);
+
+    audio_convolver_config_t invalid = { 100, 256 };
+    int ok = !audio_convolver_create(invalid, impulse_response, 100, 1);
+    printf("%s: invalid block size rejected\n", ok ? "PASS" : "FAIL");
+    failures += !ok;
+
+    printf("%d failed\n", failures);
+    return failures ? 1 : 0;
+}
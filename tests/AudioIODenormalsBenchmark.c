@@ -0,0 +1,143 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIODenormalsBenchmark
+ *
+ *  The cost of a reverb-like tail decaying into denormals, and of the two
+ *  protections in AudioIODenormals.
+ *
+ *  A bank of low-pass biquads runs over a block of silence, starting from
+ *  state that is either in the normal range, as while a tail is audible,
+ *  or already denormal, as once it has died away. The denormal case is
+ *  then timed again with flush-to-zero enabled, as the render callback
+ *  does, and with the anti-denormal offset added to the input instead.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIODenormals.h"
+#include "AudioIOBenchmark.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_NUM_FILTERS 64
+#define BENCH_BLOCK_SIZE 256
+#define BENCH_PI 3.14159265358979323846
+
+/*----------------------------------------------------------------------------*
+ * Initial filter state for each case. At 100Hz the poles are close enough
+ * to the unit circle that neither decays out of its range over a block.
+ *----------------------------------------------------------------------------*/
+#define BENCH_NORMAL_STATE 1e-3f
+#define BENCH_DENORMAL_STATE 1e-39f
+
+typedef struct
+{
+    float b0, b1, b2, a1, a2;
+    float s1, s2;
+} bench_filter_t;
+
+static bench_filter_t filters[BENCH_NUM_FILTERS];
+static float input[BENCH_BLOCK_SIZE];
+static float output[BENCH_BLOCK_SIZE];
+
+static void design_lowpass(bench_filter_t *f, double frequency)
+{
+    double w = 2.0 * BENCH_PI * frequency / BENCHMARK_SAMPLE_RATE;
+    double alpha = sin(w) / (2.0 * M_SQRT1_2);
+    double a0 = 1.0 + alpha;
+
+    f->b0 = (float) ((1.0 - cos(w)) / 2.0 / a0);
+    f->b1 = (float) ((1.0 - cos(w)) / a0);
+    f->b2 = f->b0;
+    f->a1 = (float) (-2.0 * cos(w) / a0);
+    f->a2 = (float) ((1.0 - alpha) / a0);
+}
+
+static void reset_state(float state)
+{
+    for (int f = 0; f < BENCH_NUM_FILTERS; f++)
+    {
+        filters[f].s1 = state;
+        filters[f].s2 = state;
+    }
+}
+
+static void process_block(void)
+{
+    for (int f = 0; f < BENCH_NUM_FILTERS; f++)
+    {
+        bench_filter_t *c = &filters[f];
+        float s1 = c->s1;
+        float s2 = c->s2;
+
+        for (int i = 0; i < BENCH_BLOCK_SIZE; i++)
+        {
+            float x = input[i];
+            float y = c->b0 * x + s1;
+            s1 = c->b1 * x - c->a1 * y + s2;
+            s2 = c->b2 * x - c->a2 * y;
+            output[i] = y;
+        }
+
+        c->s1 = s1;
+        c->s2 = s2;
+    }
+    benchmark_sink = output[BENCH_BLOCK_SIZE - 1];
+}
+
+static void run_unprotected(float state)
+{
+    reset_state(state);
+    process_block();
+}
+
+static void run_flushed(float state)
+{
+    audio_fp_state_t fp_state = audio_denormals_flush_begin();
+    reset_state(state);
+    process_block();
+    audio_denormals_flush_end(fp_state);
+}
+
+static void run_offset(float state, unsigned int *block)
+{
+    reset_state(state);
+    memset(input, 0, sizeof(input));
+    audio_denormals_inject_offset(input, BENCH_BLOCK_SIZE, (*block)++);
+    process_block();
+}
+
+static void report(const char *name, double seconds, double baseline)
+{
+    double ns_per_sample = seconds * 1e9 / ((double) BENCH_BLOCK_SIZE * BENCH_NUM_FILTERS);
+    printf("%-28s %10.2f %9.1fx\n", name, ns_per_sample, seconds / baseline);
+}
+
+int main(void)
+{
+    for (int f = 0; f < BENCH_NUM_FILTERS; f++)
+        design_lowpass(&filters[f], 100.0);
+
+    printf("Denormals: %d low-pass biquads, %d frame blocks of silence\n\n", BENCH_NUM_FILTERS, BENCH_BLOCK_SIZE);
+    printf("%-28s %10s %10s\n", "", "ns/sample", "slowdown");
+
+    unsigned int block = 0;
+    double normal, denormal, flushed, offset;
+
+    BENCHMARK_TIME(normal, run_unprotected(BENCH_NORMAL_STATE));
+    BENCHMARK_TIME(denormal, run_unprotected(BENCH_DENORMAL_STATE));
+    BENCHMARK_TIME(flushed, run_flushed(BENCH_DENORMAL_STATE));
+    BENCHMARK_TIME(offset, run_offset(BENCH_DENORMAL_STATE, &block));
+
+    report("normal state", normal, normal);
+    report("denormal state, unprotected", denormal, normal);
+    report("denormal state, flush-to-zero", flushed, normal);
+    report("denormal state, offset", offset, normal);
+
+    return 0;
+}
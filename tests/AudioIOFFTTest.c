@@ -0,0 +1,81 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOFFTTest
+ *
+ *  Checks the packed real FFT against a direct DFT, scaled as vDSP's is,
+ *  and checks that a round trip returns the input scaled by 2 * size.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOFFT.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_MAX_SIZE 4096
+#define TEST_TOLERANCE 1e-5
+#define TEST_PI 3.14159265358979323846
+
+static float input[TEST_MAX_SIZE];
+static float output[TEST_MAX_SIZE];
+static float real[TEST_MAX_SIZE / 2];
+static float imag[TEST_MAX_SIZE / 2];
+static int failures;
+
+static void check(int size)
+{
+    audio_fft_t *fft = audio_fft_create(size);
+    for (int i = 0; i < size; i++)
+        input[i] = (float) rand() / RAND_MAX - 0.5f;
+
+    audio_fft_forward(fft, input, real, imag);
+
+    /*------------------------------------------------------------------------*
+     * Compare every bin with twice the DFT, relative to the largest.
+     *-----------------------------------------------------------------------*/
+    int half_size = size / 2;
+    double error = 0, peak = 0;
+    for (int k = 0; k <= half_size; k++)
+    {
+        double dft_real = 0, dft_imag = 0;
+        for (int n = 0; n < size; n++)
+        {
+            double angle = 2.0 * TEST_PI * k * n / size;
+            dft_real += input[n] * cos(angle);
+            dft_imag -= input[n] * sin(angle);
+        }
+
+        double bin_real = k == 0 ? real[0] : k == half_size ? imag[0] : real[k];
+        double bin_imag = (k == 0 || k == half_size) ? 0.0 : imag[k];
+        error = fmax(error, fabs(bin_real - 2.0 * dft_real) + fabs(bin_imag - 2.0 * dft_imag));
+        peak = fmax(peak, 2.0 * hypot(dft_real, dft_imag));
+    }
+
+    audio_fft_inverse(fft, real, imag, output);
+
+    double round_trip = 0;
+    for (int i = 0; i < size; i++)
+        round_trip = fmax(round_trip, fabs(output[i] / (2.0 * size) - input[i]));
+
+    int ok = error / peak < TEST_TOLERANCE && round_trip < TEST_TOLERANCE;
+    printf("%s: size %d (forward error %.1e, round trip error %.1e)\n",
+           ok ? "PASS" : "FAIL", size, error / peak, round_trip);
+    failures += !ok;
+
+    audio_fft_destroy(fft);
+}
+
+int main(void)
+{
+    srand(1);
+    for (int size = 4; size <= TEST_MAX_SIZE; size *= 2)
+        check(size);
+
+    int ok = !audio_fft_create(2) && !audio_fft_create(1000);
+    printf("%s: unsupported sizes rejected\n", ok ? "PASS" : "FAIL");
+    failures += !ok;
+
+    printf("%d failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOGlitchDetectorTest
+ *
+ *  Renders a sine offline, injects synthetic glitches into it, and checks
+ *  that the detector reports each of them once, and nothing else.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "AudioIOGlitchDetector.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_SAMPLE_RATE 48000.0
+#define TEST_BLOCK_SIZE 256
+#define TEST_NUM_BLOCKS 400
+#define TEST_NUM_FRAMES (TEST_BLOCK_SIZE * TEST_NUM_BLOCKS)
+#define TEST_LOG_SIZE 64
+#define TEST_PI 3.14159265358979323846
+
+static float signal[TEST_NUM_FRAMES];
+static int failures;
+
+static void render_sine(double frequency, float amplitude)
+{
+    for (int i = 0; i < TEST_NUM_FRAMES; i++)
+        signal[i] = amplitude * (float) sin(2.0 * TEST_PI * frequency * i / TEST_SAMPLE_RATE);
+}
+
+/*----------------------------------------------------------------------------*
+ * Run the signal through a new detector, a block at a time, and check
+ * the events it logs against those expected. `position` is checked if
+ * not negative.
+ *----------------------------------------------------------------------------*/
+static void check(const char *name, audio_glitch_type_t type, int expected, int64_t position)
+{
+    audio_glitch_detector_t *detector = audio_glitch_detector_create(audio_glitch_config_default(), TEST_LOG_SIZE);
+
+    for (int b = 0; b < TEST_NUM_BLOCKS; b++)
+        audio_glitch_detector_process(detector, signal + b * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE, b * TEST_BLOCK_SIZE);
+
+    audio_glitch_event_t events[TEST_LOG_SIZE];
+    int num_events = audio_glitch_detector_read_events(detector, events, TEST_LOG_SIZE);
+
+    int found = 0;
+    int ok = 1;
+    for (int i = 0; i < num_events; i++)
+    {
+        if (events[i].type != type)
+        {
+            printf("  unexpected event: type %d at %lld, magnitude %g\n",
+                   events[i].type, (long long) events[i].sample_time, events[i].magnitude);
+            ok = 0;
+            continue;
+        }
+        if (position >= 0 && events[i].sample_time != position)
+        {
+            printf("  event at %lld, expected %lld\n", (long long) events[i].sample_time, (long long) position);
+            ok = 0;
+        }
+        found++;
+    }
+    if (found != expected)
+    {
+        printf("  %d events of type %d, expected %d\n", found, type, expected);
+        ok = 0;
+    }
+
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+    failures += !ok;
+
+    audio_glitch_detector_destroy(detector);
+}
+
+/*----------------------------------------------------------------------------*
+ * As check(), but with the blocks' sample times running at another rate,
+ * as when the stream is resampled, and one period skipped.
+ *----------------------------------------------------------------------------*/
+static void check_missed_period(const char *name, double sample_time_per_frame, int skipped_block)
+{
+    audio_glitch_detector_t *detector = audio_glitch_detector_create(audio_glitch_config_default(), TEST_LOG_SIZE);
+
+    double sample_time = 0;
+    for (int b = 0; b < TEST_NUM_BLOCKS; b++)
+    {
+        if (b == skipped_block)
+            sample_time += TEST_BLOCK_SIZE * sample_time_per_frame;
+        audio_glitch_detector_process(detector, signal + b * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE, sample_time);
+        sample_time += TEST_BLOCK_SIZE * sample_time_per_frame;
+    }
+
+    uint64_t missed = audio_glitch_detector_count(detector, AUDIO_GLITCH_MISSED_PERIOD);
+    uint64_t expected = skipped_block >= 0 ? 1 : 0;
+    int ok = missed == expected;
+    if (!ok)
+        printf("  %llu missed periods, expected %llu\n", (unsigned long long) missed, (unsigned long long) expected);
+
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+    failures += !ok;
+
+    audio_glitch_detector_destroy(detector);
+}
+
+int main(void)
+{
+    static const double frequencies[] = { 30.0, 60.0, 110.0, 440.0, 1000.0, 5000.0 };
+    for (size_t f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "clean %.0fHz sine", frequencies[f]);
+        render_sine(frequencies[f], 0.5f);
+        check(name, AUDIO_GLITCH_DISCONTINUITY, 0, -1);
+    }
+
+    render_sine(440.0, 0.5f);
+    signal[30000] = 0.9f;
+    check("single-sample click", AUDIO_GLITCH_DISCONTINUITY, 1, 30000);
+
+    render_sine(440.0, 0.5f);
+    memset(signal + 30000, 0, 100 * sizeof(float));
+    check("dropout of 100 frames", AUDIO_GLITCH_ZERO_RUN, 1, 30000);
+
+    render_sine(440.0, 0.5f);
+    memset(signal + 40 * TEST_BLOCK_SIZE, 0, 10 * TEST_BLOCK_SIZE * sizeof(float));
+    check("gated silence of 10 blocks", AUDIO_GLITCH_ZERO_RUN, 0, -1);
+
+    render_sine(440.0, 0.5f);
+    memset(signal + 40 * TEST_BLOCK_SIZE, 0, (TEST_NUM_BLOCKS - 40) * TEST_BLOCK_SIZE * sizeof(float));
+    check("ending in silence", AUDIO_GLITCH_ZERO_RUN, 0, -1);
+
+    render_sine(440.0, 0.5f);
+    for (int i = 30077; i < TEST_NUM_FRAMES; i++)
+        signal[i] += 0.3f;
+    check("DC step of 0.3", AUDIO_GLITCH_DC_JUMP, 1, -1);
+
+    render_sine(440.0, 0.5f);
+    for (int i = 30077; i < TEST_NUM_FRAMES; i++)
+        signal[i] += 0.6f;
+    check("DC step of 0.6, reported as a discontinuity only", AUDIO_GLITCH_DISCONTINUITY, 1, 30077);
+
+    render_sine(60.0, 0.5f);
+    memset(signal, 0, 80 * TEST_BLOCK_SIZE * sizeof(float));
+    check("onset of a 60Hz sine after silence", AUDIO_GLITCH_DC_JUMP, 0, -1);
+
+    render_sine(440.0, 0.5f);
+    check_missed_period("missed period", 1.0, 200);
+    check_missed_period("resampled, 44.1kHz hardware", 44100.0 / 48000.0, -1);
+    check_missed_period("resampled, missed period", 44100.0 / 48000.0, 200);
+
+    printf("%d failed\n", failures);
+    return failures ? 1 : 0;
+}
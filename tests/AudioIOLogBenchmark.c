@@ -0,0 +1,109 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOLogBenchmark
+ *
+ *  Nanoseconds per AUDIO_LOG call on the logging thread, against
+ *  formatting the same message with snprintf, which is the least that
+ *  logging directly from the audio thread would cost.
+ *
+ *  Messages are logged in bursts that fit in the queue, and the logger's
+ *  thread is left to drain each burst before the next, so that every
+ *  message is queued rather than dropped. Only the bursts are timed.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOLog.h"
+#include "AudioIOBenchmark.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+/*----------------------------------------------------------------------------*
+ * The logger's thread only polls every few tens of milliseconds, so the
+ * queue is made large enough for bursts that take a useful time to log.
+ *----------------------------------------------------------------------------*/
+#define BENCH_CAPACITY 65536
+#define BENCH_BURST (BENCH_CAPACITY / 2)
+
+static atomic_long messages_written;
+static char message_buffer[AUDIO_LOG_MESSAGE_SIZE];
+
+static void count_message(void *context, double time, const char *message)
+{
+    (void) context;
+    (void) time;
+    (void) message;
+    atomic_fetch_add_explicit(&messages_written, 1, memory_order_relaxed);
+}
+
+/*----------------------------------------------------------------------------*
+ * Time bursts of a statement until BENCHMARK_MIN_TIME of them have been
+ * timed, waiting between bursts for the logger to write them all.
+ *----------------------------------------------------------------------------*/
+#define BENCHMARK_LOG(seconds, statement)                                   \
+    do                                                                      \
+    {                                                                       \
+        long runs_ = 0;                                                     \
+        double elapsed_ = 0;                                                \
+        while (elapsed_ < BENCHMARK_MIN_TIME)                               \
+        {                                                                   \
+            long target_ = atomic_load(&messages_written) + BENCH_BURST;    \
+            double start_ = benchmark_now();                                \
+            for (int i_ = 0; i_ < BENCH_BURST; i_++)                        \
+            {                                                               \
+                statement;                                                  \
+            }                                                               \
+            elapsed_ += benchmark_now() - start_;                           \
+            runs_ += BENCH_BURST;                                           \
+            while (atomic_load(&messages_written) < target_)                \
+                ;                                                           \
+        }                                                                   \
+        (seconds) = elapsed_ / runs_;                                       \
+    } while (0)
+
+static void report(const char *name, double log_seconds, double snprintf_seconds)
+{
+    printf("%-24s %10.1f %10.1f\n", name, log_seconds * 1e9, snprintf_seconds * 1e9);
+}
+
+int main(void)
+{
+    if (audio_log_start(BENCH_CAPACITY, count_message, NULL) != 0)
+    {
+        printf("Couldn't start the logger\n");
+        return 1;
+    }
+
+    printf("Logging: ns per message, bursts of %d\n\n", BENCH_BURST);
+    printf("%-24s %10s %10s\n", "", "AUDIO_LOG", "snprintf");
+
+    double log_time, snprintf_time;
+    int err = -50;
+    double sample_time = 123456.0;
+    const char *name = "Speaker";
+
+    BENCHMARK_LOG(log_time, AUDIO_LOG("Render started"));
+    BENCHMARK_TIME(snprintf_time, snprintf(message_buffer, sizeof(message_buffer), "Render started"));
+    report("no arguments", log_time, snprintf_time);
+
+    BENCHMARK_LOG(log_time, AUDIO_LOG("Render failed: %d at sample %.0f", err, sample_time));
+    BENCHMARK_TIME(snprintf_time, snprintf(message_buffer, sizeof(message_buffer),
+                                           "Render failed: %d at sample %.0f", err, sample_time));
+    report("int and double", log_time, snprintf_time);
+
+    BENCHMARK_LOG(log_time, AUDIO_LOG("%s: %d %d %d %.3f %.3f", name, err, err, err, sample_time, sample_time));
+    BENCHMARK_TIME(snprintf_time, snprintf(message_buffer, sizeof(message_buffer),
+                                           "%s: %d %d %d %.3f %.3f", name, err, err, err, sample_time, sample_time));
+    report("six arguments", log_time, snprintf_time);
+
+    uint64_t dropped = audio_log_dropped();
+    audio_log_stop();
+
+    if (dropped)
+        printf("\n%llu messages dropped\n", (unsigned long long) dropped);
+    return 0;
+}
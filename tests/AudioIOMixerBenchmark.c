@@ -0,0 +1,87 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOMixerBenchmark
+ *
+ *  The cost of mixing from 1 to 256 sources into a stereo block, with
+ *  steady gains, and with every source's gain changed each block, which
+ *  ramps it. Each source renders by copying a block of noise, so that
+ *  the figures are mostly the mixer's own.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOMixer.h"
+#include "AudioIOBenchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_BLOCK_SIZE 256
+#define BENCH_NUM_CHANNELS 2
+
+static float noise[BENCH_BLOCK_SIZE];
+static float left[BENCH_BLOCK_SIZE];
+static float right[BENCH_BLOCK_SIZE];
+static float *channels[BENCH_NUM_CHANNELS] = { left, right };
+
+static int render_noise(void *context, float *samples, int num_frames, int samplerate)
+{
+    (void) context;
+    (void) samplerate;
+    memcpy(samples, noise, num_frames * sizeof(float));
+    return 1;
+}
+
+static void mix(audio_mixer_t *mixer)
+{
+    memset(left, 0, sizeof(left));
+    memset(right, 0, sizeof(right));
+    audio_mixer_process(mixer, channels, BENCH_NUM_CHANNELS, BENCH_BLOCK_SIZE, BENCHMARK_SAMPLE_RATE);
+    benchmark_sink = left[0];
+}
+
+static void mix_ramped(audio_mixer_t *mixer, int num_sources, int *block)
+{
+    float gain = (++*block & 1) ? 0.5f : 0.25f;
+    for (int i = 0; i < num_sources; i++)
+        audio_mixer_set_gain(mixer, i, gain);
+    mix(mixer);
+}
+
+int main(void)
+{
+    srand(1);
+    for (int i = 0; i < BENCH_BLOCK_SIZE; i++)
+        noise[i] = (float) rand() / RAND_MAX - 0.5f;
+
+    printf("Mixer: %d frame stereo blocks, us per block and %% of the block's time at %d Hz\n\n",
+           BENCH_BLOCK_SIZE, BENCHMARK_SAMPLE_RATE);
+    printf("%8s %10s %8s %10s %8s\n", "sources", "steady", "", "ramped", "");
+
+    double block_seconds = (double) BENCH_BLOCK_SIZE / BENCHMARK_SAMPLE_RATE;
+
+    for (int num_sources = 1; num_sources <= AUDIO_MIXER_MAX_SOURCES; num_sources *= 2)
+    {
+        audio_mixer_t *mixer = audio_mixer_create(BENCH_BLOCK_SIZE);
+        for (int i = 0; i < num_sources; i++)
+            audio_mixer_add_source(mixer, render_noise, NULL, 0.5f, (float) (i % 9) / 4.0f - 1.0f);
+
+        double steady_time, ramped_time;
+        int block = 0;
+
+        BENCHMARK_TIME(steady_time, mix(mixer));
+        BENCHMARK_TIME(ramped_time, mix_ramped(mixer, num_sources, &block));
+
+        printf("%8d %10.2f %7.2f%% %10.2f %7.2f%%\n", num_sources,
+               steady_time * 1e6, 100.0 * steady_time / block_seconds,
+               ramped_time * 1e6, 100.0 * ramped_time / block_seconds);
+
+        audio_mixer_destroy(mixer);
+    }
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOOscillatorBenchmark
+ *
+ *  Oscillators per core at 44.1kHz in 256 frame blocks: calling sin() per
+ *  sample per oscillator, as the example's callback once did, against a
+ *  sine bank and a band-limited saw bank, for a few bank sizes.
+ *
+ *  "Per core" is the number of oscillators one core could render in real
+ *  time, with nothing else to do.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOOscillator.h"
+#include "AudioIOBenchmark.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_SAMPLE_RATE 44100
+#define BENCH_BLOCK_SIZE 256
+#define BENCH_MAX_OSCILLATORS 256
+#define BENCH_PI 3.14159265358979323846
+
+static float output[BENCH_BLOCK_SIZE];
+static double phases[BENCH_MAX_OSCILLATORS];
+static double frequencies[BENCH_MAX_OSCILLATORS];
+
+static void render_libm(int num_oscillators)
+{
+    memset(output, 0, sizeof(output));
+    for (int k = 0; k < num_oscillators; k++)
+    {
+        double phase = phases[k];
+        double increment = 2.0 * BENCH_PI * frequencies[k] / BENCH_SAMPLE_RATE;
+        for (int i = 0; i < BENCH_BLOCK_SIZE; i++)
+        {
+            output[i] += 0.1f * (float) sin(phase);
+            phase += increment;
+        }
+        phases[k] = fmod(phase, 2.0 * BENCH_PI);
+    }
+    benchmark_sink = output[0];
+}
+
+static void render_bank(audio_oscillator_bank_t *bank)
+{
+    memset(output, 0, sizeof(output));
+    audio_oscillator_bank_render(bank, output, BENCH_BLOCK_SIZE, BENCH_SAMPLE_RATE);
+    benchmark_sink = output[0];
+}
+
+static audio_oscillator_bank_t *create_bank(audio_oscillator_waveform_t waveform, int num_oscillators)
+{
+    audio_oscillator_bank_t *bank = audio_oscillator_bank_create(waveform, num_oscillators, BENCH_BLOCK_SIZE);
+    for (int k = 0; k < num_oscillators; k++)
+        audio_oscillator_set(bank, k, (float) frequencies[k], 0.1f);
+    render_bank(bank);
+    return bank;
+}
+
+static double per_core(double seconds_per_block, int num_oscillators)
+{
+    double block_seconds = (double) BENCH_BLOCK_SIZE / BENCH_SAMPLE_RATE;
+    return num_oscillators * block_seconds / seconds_per_block;
+}
+
+int main(void)
+{
+    for (int k = 0; k < BENCH_MAX_OSCILLATORS; k++)
+        frequencies[k] = 55.0 * pow(2.0, k / 48.0);
+
+    printf("Oscillators per core at %d Hz, %d frame blocks\n\n", BENCH_SAMPLE_RATE, BENCH_BLOCK_SIZE);
+    printf("%12s %12s %12s %12s %10s\n", "oscillators", "libm sin()", "sine bank", "saw bank", "speedup");
+
+    for (int num_oscillators = 16; num_oscillators <= BENCH_MAX_OSCILLATORS; num_oscillators *= 4)
+    {
+        audio_oscillator_bank_t *sines = create_bank(AUDIO_OSCILLATOR_SINE, num_oscillators);
+        audio_oscillator_bank_t *saws = create_bank(AUDIO_OSCILLATOR_SAW, num_oscillators);
+
+        double libm_time, sine_time, saw_time;
+        BENCHMARK_TIME(libm_time, render_libm(num_oscillators));
+        BENCHMARK_TIME(sine_time, render_bank(sines));
+        BENCHMARK_TIME(saw_time, render_bank(saws));
+
+        printf("%12d %12.0f %12.0f %12.0f %9.1fx\n", num_oscillators,
+               per_core(libm_time, num_oscillators),
+               per_core(sine_time, num_oscillators),
+               per_core(saw_time, num_oscillators),
+               libm_time / sine_time);
+
+        audio_oscillator_bank_destroy(sines);
+        audio_oscillator_bank_destroy(saws);
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  AudioIOSpectrumBenchmark
+ *
+ *  Frames per second for each supported FFT size: of the FFT alone, and
+ *  of the analyser's whole frame (window, FFT, magnitudes and publishing),
+ *  fed one hop of input at a time with 75% overlap. Also gives the share
+ *  of one core that analysing live input at BENCHMARK_SAMPLE_RATE takes.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __APPLE__
+#define _GNU_SOURCE
+#endif
+
+#include "AudioIOSpectrum.h"
+#include "AudioIOFFT.h"
+#include "AudioIOBenchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static float input[AUDIO_SPECTRUM_MAX_SIZE];
+static float real[AUDIO_SPECTRUM_MAX_SIZE / 2];
+static float imag[AUDIO_SPECTRUM_MAX_SIZE / 2];
+
+static void transform(audio_fft_t *fft)
+{
+    audio_fft_forward(fft, input, real, imag);
+    benchmark_sink = real[1];
+}
+
+static void analyse_hop(audio_spectrum_t *spectrum, int hop_size)
+{
+    audio_spectrum_write(spectrum, input, hop_size);
+    benchmark_sink = (float) audio_spectrum_analyse(spectrum);
+}
+
+int main(void)
+{
+    srand(1);
+    for (int i = 0; i < AUDIO_SPECTRUM_MAX_SIZE; i++)
+        input[i] = (float) rand() / RAND_MAX - 0.5f;
+
+    printf("Spectrum: frames per second, and %% of a core to analyse %d Hz input with 75%% overlap\n\n",
+           BENCHMARK_SAMPLE_RATE);
+    printf("%8s %12s %12s %10s\n", "size", "FFT", "analysis", "live");
+
+    for (int size = AUDIO_SPECTRUM_MIN_SIZE; size <= AUDIO_SPECTRUM_MAX_SIZE; size *= 2)
+    {
+        int hop_size = size / 4;
+        audio_fft_t *fft = audio_fft_create(size);
+        audio_spectrum_t *spectrum = audio_spectrum_create(size, hop_size, size);
+
+        /*--------------------------------------------------------------------*
+         * Fill the first frame, so that every later hop completes one.
+         *-------------------------------------------------------------------*/
+        audio_spectrum_write(spectrum, input, size - hop_size);
+        audio_spectrum_analyse(spectrum);
+
+        double fft_time, analysis_time;
+        BENCHMARK_TIME(fft_time, transform(fft));
+        BENCHMARK_TIME(analysis_time, analyse_hop(spectrum, hop_size));
+
+        double frames_needed = (double) BENCHMARK_SAMPLE_RATE / hop_size;
+        printf("%8d %12.0f %12.0f %9.2f%%\n", size, 1.0 / fft_time, 1.0 / analysis_time,
+               100.0 * frames_needed * analysis_time);
+
+        audio_spectrum_destroy(spectrum);
+        audio_fft_destroy(fft);
+    }
+
+    return 0;
+}